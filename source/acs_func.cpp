@@ -1795,6 +1795,9 @@ static void ACS_setLineBlocking(int tag, int block)
          break;
       }
    }
+
+   // BLOCKALL lines block sight
+   P_SightChanged();
 }
 
 //
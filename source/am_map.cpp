@@ -50,6 +50,7 @@
 #include "r_main.h"
 #include "r_portal.h"
 #include "r_state.h"
+#include "r_truecolor.h"
 #include "v_block.h"
 #include "v_misc.h"
 #include "v_patchfmt.h"
@@ -2313,6 +2314,9 @@ void AM_Drawer()
    if(!automapactive)
       return;
 
+   // the map is plotted straight into the screen, over all of the frame
+   R_TCCover(vbscreen.data, f_w, f_h, true);
+
    AM_clearFB(mapcolor_back);       //jff 1/5/98 background default color
    
    if(automap_grid)                 // killough 2/28/98: change var name
@@ -70,17 +70,134 @@
 #define VALID_ISSET(set, i) ((set)[(i) >> 3] & (1 << ((i) & 7)))
 #define VALID_SET(set, i) ((set)[(i) >> 3] |= 1 << ((i) & 7))
 
+//
+// PathScratchStack
+//
+// The scratch memory of one thread's path traversers, by nesting level. Uses
+// new and delete rather than the zone heap, as sight checks also run on the
+// worker threads of P_PrefetchSight.
+//
+class PathScratchStack
+{
+protected:
+   pathscratch_t **levels    = nullptr;
+   int             numlevels = 0;
+   int             depth     = 0;
+
+   static void reserveBits(byte *&bits, size_t &numbytes, int numbits);
+
+public:
+   ~PathScratchStack();
+
+   pathscratch_t *push();
+   void pop() { --depth; }
+};
+
+static thread_local PathScratchStack pathscratch;
+
+//
+// PathScratchStack::~PathScratchStack
+//
+PathScratchStack::~PathScratchStack()
+{
+   for(int i = 0; i < numlevels; i++)
+   {
+      delete [] levels[i]->validlines;
+      delete [] levels[i]->validpolys;
+      delete [] levels[i]->intercepts;
+      delete levels[i];
+   }
+   delete [] levels;
+}
+
+//
+// PathScratchStack::reserveBits
+//
+// Makes room for numbits cleared bits.
+//
+void PathScratchStack::reserveBits(byte *&bits, size_t &numbytes, int numbits)
+{
+   size_t needed = ((numbits + 7) & ~7) / 8;
+
+   if(needed > numbytes)
+   {
+      delete [] bits;
+      bits     = new byte[needed];
+      numbytes = needed;
+   }
+   if(needed)
+      memset(bits, 0, needed);
+}
+
+//
+// PathScratchStack::push
+//
+// Returns cleared scratch memory for a traversal on the next nesting level.
+//
+pathscratch_t *PathScratchStack::push()
+{
+   if(depth == numlevels)
+   {
+      int newnum = numlevels ? numlevels * 2 : 4;
+      pathscratch_t **newlevels = new pathscratch_t *[newnum];
+
+      for(int i = 0; i < newnum; i++)
+         newlevels[i] = i < numlevels ? levels[i] : new pathscratch_t();
+      delete [] levels;
+      levels    = newlevels;
+      numlevels = newnum;
+   }
+
+   pathscratch_t *ps = levels[depth++];
+
+   reserveBits(ps->validlines, ps->linebytes, ::numlines);
+   reserveBits(ps->validpolys, ps->polybytes, ::numPolyObjects);
+   ps->numintercepts = 0;
+
+   return ps;
+}
+
 //
 // Constructor. Initializes dynamic structures
 //
 PathTraverser::PathTraverser(const PTDef &indef, void *incontext) :
-   trace(), def(indef), context(incontext), portalguard()
+   trace(), def(indef), context(incontext), scratch(pathscratch.push()),
+   portalguard()
 {
-   VALID_ALLOC(validlines, ::numlines);
-   VALID_ALLOC(validpolys, ::numPolyObjects);
+   validlines = scratch->validlines;
+   validpolys = scratch->validpolys;
 }
 
+//
+// Destructor. Gives back the scratch memory.
+//
+PathTraverser::~PathTraverser()
+{
+   pathscratch.pop();
+}
+
+//
+// Adds an intercept to the list
+//
+intercept_t &PathTraverser::newIntercept()
+{
+   if(scratch->numintercepts == scratch->maxintercepts)
+   {
+      size_t newmax = scratch->maxintercepts ? scratch->maxintercepts * 2 : 128;
+      intercept_t *newintercepts = new intercept_t[newmax];
+
+      if(scratch->numintercepts)
+      {
+         memcpy(newintercepts, scratch->intercepts, 
+                scratch->numintercepts * sizeof(intercept_t));
+      }
+      delete [] scratch->intercepts;
+      scratch->intercepts    = newintercepts;
+      scratch->maxintercepts = newmax;
+   }
 
+   return scratch->intercepts[scratch->numintercepts++];
+}
 
 //
 // Handles intercepts in order
@@ -90,15 +207,15 @@ bool PathTraverser::traverseIntercepts() const
    size_t    count;
    fixed_t   dist;
    divline_t dl;
-   PODCollection<intercept_t>::iterator scan, end, in;
+   intercept_t *scan, *end, *in;
 
-   count = intercepts.getLength();
-   end = intercepts.end();
+   count = scratch->numintercepts;
+   end = scratch->intercepts + count;
 
    //
    // calculate intercept distance
    //
-   for(scan = intercepts.begin(); scan < end; scan++)
+   for(scan = scratch->intercepts; scan < end; scan++)
    {
       if(!scan->isaline)
          continue;   // ioanch 20151230: only lines need this treatment
@@ -115,7 +232,7 @@ bool PathTraverser::traverseIntercepts() const
    {
       dist = D_MAXINT;
 
-      for(scan = intercepts.begin(); scan < end; scan++)
+      for(scan = scratch->intercepts; scan < end; scan++)
       {
          if(scan->frac < dist)
          {
@@ -189,7 +306,7 @@ bool PathTraverser::blockThingsIterator(int x, int y)
       if(frac < 0)
          continue;                // behind source
 
-      intercept_t &inter = intercepts.addNew();
+      intercept_t &inter = newIntercept();
       inter.frac = frac;
       inter.isaline = false;
       inter.d.thing = thing;
@@ -237,7 +354,7 @@ bool PathTraverser::checkLine(size_t linenum)
    }
 
    // store the line for later intersection testing
-   intercept_t &inter = intercepts.addNew();
+   intercept_t &inter = newIntercept();
    inter.isaline = true;
    inter.d.line = ld;
 
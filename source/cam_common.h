@@ -25,8 +25,21 @@
 #include "m_collection.h"
 #include "p_maputl.h"
 
-#define VALID_ALLOC(set, n) ((set) = ecalloc(byte *, 1, (((n) + 7) & ~7) / 8))
-#define VALID_FREE(set) efree(set)
+//
+// Memory used by one path traversal. Each thread keeps one for every level of
+// nested traversals, so that traversals don't allocate in the usual case, and
+// can run on worker threads, which must not use the zone heap.
+//
+struct pathscratch_t
+{
+   byte        *validlines;    // lines already checked, one bit each
+   byte        *validpolys;    // polyobjects already checked
+   size_t       linebytes;     // bytes allocated for validlines
+   size_t       polybytes;     // bytes allocated for validpolys
+   intercept_t *intercepts;
+   size_t       numintercepts; // intercepts in use
+   size_t       maxintercepts; // intercepts allocated
+};
 
 //
 // PathTraverser setup
@@ -53,11 +66,7 @@ class PathTraverser
 public:
    bool traverse(fixed_t cx, fixed_t cy, fixed_t tx, fixed_t ty);
    PathTraverser(const PTDef &indef, void *incontext);
-   ~PathTraverser()
-   {
-      VALID_FREE(validlines);
-      VALID_FREE(validpolys);
-   }
+   ~PathTraverser();
 
    divline_t trace;
 private:
@@ -65,9 +74,11 @@ private:
    bool blockLinesIterator(int x, int y);
    bool blockThingsIterator(int x, int y);
    bool traverseIntercepts() const;
+   intercept_t &newIntercept();
 
    const PTDef def;
    void *const context;
+   pathscratch_t *const scratch;
    byte *validlines;
    byte *validpolys;
    struct
@@ -75,7 +86,6 @@ private:
       bool hitpblock;
       bool addedportal;
    } portalguard;
-   PODCollection<intercept_t> intercepts;
 };
 
 //
@@ -0,0 +1,369 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// Copyright (C) 2013 James Haley et al.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+// Additional terms and conditions compatible with the GPLv3 apply. See the
+// file COPYING-EE for details.
+//
+//--------------------------------------------------------------------------
+//
+// DESCRIPTION:
+//      Headless benchmark. "-bench demo1 demo2 ..." plays each demo once
+//      with singletics, no window and no sound, then writes the time spent
+//      in each part of the game loop, map by map, as JSON to the file given
+//      by -benchout (bench.json by default) and exits.
+//
+//-----------------------------------------------------------------------------
+
+#include "z_zone.h"
+
+#include <chrono>
+
+#include "d_bench.h"
+#include "d_files.h"
+#include "d_main.h"
+#include "doomstat.h"
+#include "g_game.h"
+#include "i_system.h"
+#include "m_argv.h"
+#include "m_collection.h"
+#include "m_qstr.h"
+#include "v_misc.h"
+#include "version.h"
+#include "w_wad.h"
+
+bool d_benchmarking;
+
+struct benchmap_t
+{
+   char    name[9];
+   int     demo;                       // index into benchdemos
+   int     starttic;
+   int     gametics;
+   int     frames;                     // calls of D_Display
+   int64_t starttime;
+   int64_t walltime;
+   int64_t times[BENCH_NUMSECTIONS];
+   size_t  startallocs;
+   size_t  startbytes;
+   size_t  numallocs;
+   size_t  allocbytes;
+   size_t  peakbytes;
+};
+
+struct benchdemo_t
+{
+   const char *name;                   // as given on the command line
+   int64_t     walltime;
+};
+
+static PODCollection<benchdemo_t> benchdemos;
+static PODCollection<benchmap_t>  benchmaps;
+
+static int benchdemo  = -1;            // demo being played
+static int benchmap   = -1;            // map being timed, or -1
+static int64_t demostart;
+
+static const char *benchout = "bench.json";
+
+//
+// D_BenchNow
+//
+// Current time in nanoseconds, from a monotonic clock.
+//
+int64_t D_BenchNow()
+{
+   return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//
+// D_BenchAdd
+//
+// Adds time to a section of the map being timed.
+//
+void D_BenchAdd(int section, int64_t time)
+{
+   if(benchmap < 0)
+      return;
+
+   benchmap_t &map = benchmaps[benchmap];
+
+   map.times[section] += time;
+   if(section == BENCH_DISPLAY)
+      ++map.frames;
+}
+
+//
+// D_BenchCheckParms
+//
+// Called while the command line is parsed. Collects the demos given to -bench,
+// adds them like -playdemo does, and turns off sound.
+//
+void D_BenchCheckParms()
+{
+   int p;
+
+   if((p = M_CheckParm("-benchout")) && p < myargc - 1)
+      benchout = myargv[p + 1];
+
+   if(!(p = M_CheckParm("-bench")))
+      return;
+
+   while(++p < myargc && myargv[p][0] != '-' && myargv[p][0] != '@')
+   {
+      qstring file;
+
+      file = myargv[p];
+      file.addDefaultExtension(".lmp");
+      D_AddFile(file.constPtr(), lumpinfo_t::ns_demos, NULL, 0, DAF_DEMO);
+
+      benchdemo_t &demo = benchdemos.addNew();
+      demo.name     = myargv[p];
+      demo.walltime = 0;
+   }
+
+   if(!benchdemos.getLength())
+      I_Error("D_BenchCheckParms: -bench needs at least one demo\n");
+
+   // sound is measured with the null sound driver only
+   nosfxparm = nomusicparm = true;
+}
+
+//
+// D_BenchActive
+//
+// True if the game was started with -bench.
+//
+bool D_BenchActive()
+{
+   return benchdemos.getLength() > 0;
+}
+
+//
+// D_benchPlayDemo
+//
+static void D_benchPlayDemo(int demo)
+{
+   benchdemo = demo;
+   demostart = D_BenchNow();
+
+   G_DeferedPlayDemo(benchdemos[demo].name);
+   singledemo = true;
+}
+
+//
+// D_BenchStart
+//
+// Called in place of the usual demo startup. Plays the first demo.
+//
+void D_BenchStart()
+{
+   singletics     = true;
+   d_benchmarking = true;
+
+   D_benchPlayDemo(0);
+}
+
+//
+// D_benchEndMap
+//
+// Closes the record of the map being timed, if any.
+//
+static void D_benchEndMap()
+{
+   if(benchmap < 0)
+      return;
+
+   benchmap_t &map = benchmaps[benchmap];
+
+   map.gametics   = gametic - map.starttic;
+   map.walltime   = D_BenchNow() - map.starttime;
+   map.numallocs  = z_stats.numallocs - map.startallocs;
+   map.allocbytes = z_stats.allocbytes - map.startbytes;
+   map.peakbytes  = z_stats.peakbytes;
+
+   benchmap = -1;
+}
+
+//
+// D_BenchBeginLevel
+//
+// Called from G_DoLoadLevel before the map is set up. Closes the record of the
+// previous map and opens one for the new map.
+//
+void D_BenchBeginLevel()
+{
+   if(!d_benchmarking)
+      return;
+
+   D_benchEndMap();
+
+   benchmap_t &map = benchmaps.addNew();
+
+   memset(&map, 0, sizeof(map));
+   strncpy(map.name, gamemapname, 8);
+   map.demo        = benchdemo;
+   map.starttic    = gametic;
+   map.starttime   = D_BenchNow();
+   map.startallocs = z_stats.numallocs;
+   map.startbytes  = z_stats.allocbytes;
+
+   // the peak is measured from what is in use when the map starts
+   z_stats.peakbytes = z_stats.inusebytes;
+
+   benchmap = static_cast<int>(benchmaps.getLength()) - 1;
+}
+
+//
+// D_benchWriteString
+//
+// Writes a JSON string, escaping what needs it.
+//
+static void D_benchWriteString(FILE *f, const char *str)
+{
+   fputc('"', f);
+   for(; *str; str++)
+   {
+      if(*str == '"' || *str == '\\')
+         fputc('\\', f);
+      if(static_cast<unsigned char>(*str) >= ' ')
+         fputc(*str, f);
+   }
+   fputc('"', f);
+}
+
+static const char *benchsectionnames[BENCH_NUMSECTIONS] =
+{
+   "setup", "playsim", "render", "display", "sound"
+};
+
+//
+// D_benchWriteTimes
+//
+// Writes the fields shared by a map and the totals.
+//
+static void D_benchWriteTimes(FILE *f, const benchmap_t &map, const char *indent)
+{
+   fprintf(f, "%s\"gametics\": %d,\n", indent, map.gametics);
+   fprintf(f, "%s\"frames\": %d,\n", indent, map.frames);
+   fprintf(f, "%s\"wall_ms\": %.3f,\n", indent, map.walltime / 1000000.0);
+   for(int i = 0; i < BENCH_NUMSECTIONS; i++)
+   {
+      fprintf(f, "%s\"%s_ms\": %.3f,\n", indent, benchsectionnames[i],
+              map.times[i] / 1000000.0);
+   }
+   fprintf(f, "%s\"zone_allocations\": %lu,\n", indent,
+           static_cast<unsigned long>(map.numallocs));
+   fprintf(f, "%s\"zone_bytes_allocated\": %lu,\n", indent,
+           static_cast<unsigned long>(map.allocbytes));
+   fprintf(f, "%s\"zone_peak_bytes\": %lu\n", indent,
+           static_cast<unsigned long>(map.peakbytes));
+}
+
+//
+// D_benchWriteReport
+//
+static void D_benchWriteReport()
+{
+   FILE *f;
+   benchmap_t total;
+
+   if(!(f = fopen(benchout, "w")))
+      I_Error("D_benchWriteReport: couldn't open %s\n", benchout);
+
+   memset(&total, 0, sizeof(total));
+
+   fputs("{\n", f);
+   fprintf(f, "  \"engine\": \"Eternity %d.%02d.%02d\",\n",
+           version / 100, version % 100, subversion);
+   fprintf(f, "  \"resolution\": \"%dx%d\",\n", video.width, video.height);
+   fputs("  \"demos\": [\n", f);
+
+   for(size_t d = 0; d < benchdemos.getLength(); d++)
+   {
+      bool first = true;
+
+      fputs("    {\n      \"demo\": ", f);
+      D_benchWriteString(f, benchdemos[d].name);
+      fprintf(f, ",\n      \"wall_ms\": %.3f,\n      \"maps\": [\n",
+              benchdemos[d].walltime / 1000000.0);
+
+      for(const benchmap_t &map : benchmaps)
+      {
+         if(map.demo != static_cast<int>(d))
+            continue;
+
+         fprintf(f, "%s        {\n          \"map\": ", first ? "" : ",\n");
+         D_benchWriteString(f, map.name);
+         fputs(",\n", f);
+         D_benchWriteTimes(f, map, "          ");
+         fputs("        }", f);
+         first = false;
+
+         total.gametics   += map.gametics;
+         total.frames     += map.frames;
+         total.walltime   += map.walltime;
+         total.numallocs  += map.numallocs;
+         total.allocbytes += map.allocbytes;
+         for(int i = 0; i < BENCH_NUMSECTIONS; i++)
+            total.times[i] += map.times[i];
+         if(map.peakbytes > total.peakbytes)
+            total.peakbytes = map.peakbytes;
+      }
+
+      fprintf(f, "\n      ]\n    }%s\n",
+              d + 1 < benchdemos.getLength() ? "," : "");
+   }
+
+   fputs("  ],\n  \"total\": {\n", f);
+   D_benchWriteTimes(f, total, "    ");
+   fputs("  }\n}\n", f);
+
+   fclose(f);
+}
+
+//
+// D_BenchNextDemo
+//
+// Called from G_CheckDemoStatus when a demo ends. Starts the next demo and
+// returns true, or writes the report and exits after the last one.
+//
+bool D_BenchNextDemo()
+{
+   if(!d_benchmarking)
+      return false;
+
+   D_benchEndMap();
+   benchdemos[benchdemo].walltime = D_BenchNow() - demostart;
+
+   if(benchdemo + 1 < static_cast<int>(benchdemos.getLength()))
+   {
+      D_benchPlayDemo(benchdemo + 1);
+      return true;
+   }
+
+   d_benchmarking = false;
+   D_benchWriteReport();
+
+   I_ExitWithMessage("Benchmark of %d demo(s) written to %s\n",
+                     static_cast<int>(benchdemos.getLength()), benchout);
+   return false;
+}
+
+// EOF
+
@@ -0,0 +1,85 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// Copyright (C) 2013 James Haley et al.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+// Additional terms and conditions compatible with the GPLv3 apply. See the
+// file COPYING-EE for details.
+//
+//--------------------------------------------------------------------------
+//
+// DESCRIPTION:
+//      Headless benchmark: plays a list of demos and writes timings as JSON.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef D_BENCH_H__
+#define D_BENCH_H__
+
+#include "doomtype.h"
+
+// Sections of the game loop timed by the benchmark. As with the renderer
+// profiler, a section's time includes everything nested inside it.
+enum benchsection_e
+{
+   BENCH_SETUP,    // G_DoLoadLevel
+   BENCH_PLAYSIM,  // P_Ticker
+   BENCH_RENDER,   // R_RenderPlayerView
+   BENCH_DISPLAY,  // D_Display, including the renderer, 2D and blit
+   BENCH_SOUND,    // sound updates and mixing
+   BENCH_NUMSECTIONS
+};
+
+extern bool d_benchmarking; // true while a benchmark demo is being timed
+
+void D_BenchCheckParms();
+bool D_BenchActive();
+void D_BenchStart();
+void D_BenchBeginLevel();
+bool D_BenchNextDemo();
+
+int64_t D_BenchNow();
+void    D_BenchAdd(int section, int64_t time);
+
+//
+// BenchScope
+//
+// Adds the time the object lives to a section of the benchmark. Costs one
+// test of d_benchmarking when no benchmark is running.
+//
+class BenchScope
+{
+protected:
+   int     section;
+   int64_t start;
+
+public:
+   explicit BenchScope(int pSection)
+      : section(pSection), start(d_benchmarking ? D_BenchNow() : -1)
+   {
+   }
+
+   ~BenchScope()
+   {
+      if(start >= 0)
+         D_BenchAdd(section, D_BenchNow() - start);
+   }
+};
+
+#endif
+
+// EOF
+
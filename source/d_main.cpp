@@ -35,10 +35,12 @@
 #include "z_zone.h"
 
 #include "acs_intr.h"
+#include "autopalette.h"
 #include "am_map.h"
 #include "c_io.h"
 #include "c_net.h"
 #include "c_runcmd.h"
+#include "d_bench.h"
 #include "d_deh.h"      // Ty 04/08/98 - Externalizations
 #include "d_dehtbl.h"
 #include "d_event.h"
@@ -47,6 +49,7 @@
 #include "d_io.h"
 #include "d_iwad.h"
 #include "d_net.h"
+#include "d_startup.h"
 #include "doomstat.h"
 #include "dstrings.h"
 #include "e_edf.h"
@@ -56,6 +59,7 @@
 #include "f_wipe.h"
 #include "g_bind.h"
 #include "g_demolog.h"
+#include "g_demosync.h"
 #include "g_dmflag.h"
 #include "g_game.h"
 #include "g_gfs.h"
@@ -74,9 +78,11 @@
 #include "mn_engin.h"
 #include "p_chase.h"
 #include "p_setup.h"
+#include "r_data.h"
 #include "r_draw.h"
 #include "r_main.h"
 #include "r_patch.h"
+#include "r_profile.h"
 #include "s_sound.h"
 #include "st_stuff.h"
 #include "v_block.h"
@@ -166,6 +172,8 @@ void usermsg(const char *s, ...)
 //sf:
 void startupmsg(const char *func, const char *desc)
 {
+   D_StartupStep(func);
+
    // add colours in console mode
    usermsg(in_textmode ? "%s: %s" : FC_HI "%s: " FC_NORMAL "%s",
            func, desc);
@@ -497,6 +505,23 @@ static void D_showMemStats()
          V_FontWriteText(font, buffer, 1, static_cast<int>(1 + i*font->cy));
       }
    }
+
+   // the chunks small blocks are carved from, and how full they are
+   for(const cachelevelprint_t &level : cachelevels)
+   {
+      zoneheapstats_t stats;
+
+      if(!Z_GetHeapStats(level.cachelevel, stats))
+         continue;
+
+      psnprintf(buffer, sizeof(buffer), "%s%9lu %3lu chunks %7.02f%% used",
+                level.cachelevel == PU_MAX ? " small: " : level.name,
+                static_cast<unsigned long>(stats.reserved),
+                static_cast<unsigned long>(stats.numchunks),
+                stats.reserved ?
+                   100.0 * (stats.carved - stats.freebytes) / stats.reserved : 0.0);
+      V_FontWriteText(font, buffer, 1, static_cast<int>(1 + i++*font->cy));
+   }
 }
 #endif
 
@@ -710,12 +735,18 @@ static void D_Display()
    if(d_drawfps)
       D_showDrawnFPS();
 
+   if(r_showprofile)
+      R_DrawProfile();
+
 #ifdef INSTRUMENTED
    if(printstats)
       D_showMemStats();
 #endif
    
-   I_FinishUpdate();              // page flip or blit buffer
+   {
+      RProfileScope profile(RPROF_BLIT);
+      I_FinishUpdate();              // page flip or blit buffer
+   }
 
    i_haltimer.EndDisplay();
 }
@@ -1245,6 +1276,59 @@ static void D_StartupMessage()
 // Broke D_DoomMain into two functions in order to keep
 // initialization stuff off the main line of execution.
 //
+//
+// Startup tasks
+//
+// The tables made from the palette alone are built on worker threads while
+// EDF and DeHackEd are processed, and waited for by the steps using them. With
+// -serialinit those steps build them, as they always did.
+//
+
+static byte d_startpalette[768];
+static int  d_starttranpct;
+
+static void D_flexTranTask(void *)
+{
+   V_InitFlexTranTable(d_startpalette);
+}
+
+static void D_tranMapTask(void *)
+{
+   R_PrebuildTranMaps(d_startpalette, d_starttranpct);
+}
+
+enum
+{
+   STARTTASK_FLEXTRAN, // needed by V_InitMisc
+   STARTTASK_TRANMAPS, // needed by R_Init
+   NUMSTARTTASKS
+};
+
+static startuptask_t d_starttasks[NUMSTARTTASKS] =
+{
+   { "V_InitFlexTranTable", D_flexTranTask },
+   { "R_PrebuildTranMaps",  D_tranMapTask  },
+};
+
+//
+// D_startPaletteTasks
+//
+// Called once all wads are in.
+//
+static void D_startPaletteTasks()
+{
+   if(!D_StartupTasksEnabled() || W_CheckNumForName("PLAYPAL") < 0)
+      return;
+
+   AutoPalette palette(wGlobalDir);
+   memcpy(d_startpalette, palette.get(), sizeof(d_startpalette));
+   d_starttranpct = tran_filter_pct;
+
+   // without general translucency, R_Init doesn't want the maps
+   D_StartStartupTasks(d_starttasks,
+                       general_translucency ? NUMSTARTTASKS : STARTTASK_TRANMAPS);
+}
+
 static void D_DoomInit()
 {
    int p, slot;
@@ -1413,6 +1497,9 @@ static void D_DoomInit()
    if((p = M_CheckParm("-demolog")) && p < myargc - 1)
       G_DemoLogInit(myargv[p + 1]);
 
+   // demo sync stream, to record or to check
+   G_DemoSyncCheckParms();
+
    // haleyjd 01/17/11: allow -play also
    const char *playdemoparms[] = { "-playdemo", "-play", NULL };
 
@@ -1522,6 +1609,9 @@ static void D_DoomInit()
    nodrawers = !!M_CheckParm("-nodraw");
    noblit    = !!M_CheckParm("-noblit");
 
+   // headless benchmark; turns sound off, so must come after the sound parms
+   D_BenchCheckParms();
+
    // haleyjd: need to do this before M_LoadDefaults
    C_InitPlayerName();
 
@@ -1560,7 +1650,11 @@ static void D_DoomInit()
    // overrides and adjustments here.
    D_InitGMIPostWads();
 
+   // build the palette tables meanwhile
+   D_startPaletteTasks();
+
    // haleyjd 10/20/03: use D_ProcessDehInWads again
+   D_StartupStep("D_ProcessDehInWads");
    D_ProcessDehInWads();
 
    // killough 10/98: process preincluded .deh files
@@ -1572,6 +1666,7 @@ static void D_DoomInit()
 
    // jff 4/24/98 load color translation lumps
    // haleyjd 09/06/12: need to do this before EDF
+   D_StartupStep("V_InitColorTranslation");
    V_InitColorTranslation(); 
 
    // haleyjd 08/28/13: init console command list
@@ -1587,15 +1682,18 @@ static void D_DoomInit()
    D_BuildBEXHashChains();
 
    // Identify root EDF file and process EDF
+   D_StartupStep("D_LoadEDF");
    D_LoadEDF(gfs);
 
    // haleyjd 03/27/11: process Hexen scripts
+   D_StartupStep("XL_ParseHexenScripts");
    XL_ParseHexenScripts();
 
    // Build BEX tables (some are EDF-dependent)
    D_BuildBEXTables();
 
    // Process the DeHackEd queue, then free it
+   D_StartupStep("D_ProcessDEHQueue");
    D_ProcessDEHQueue();
    
    // haleyjd: moved down turbo to here for player class support
@@ -1637,6 +1735,7 @@ static void D_DoomInit()
    // End new startup strings
 
    startupmsg("V_InitMisc","Init miscellaneous video patches.");
+   D_WaitStartupTask(d_starttasks[STARTTASK_FLEXTRAN]);
    V_InitMisc();
 
    startupmsg("C_Init", "Init console.");
@@ -1653,6 +1752,8 @@ static void D_DoomInit()
    }
 
    startupmsg("R_Init", "Init DOOM refresh daemon");
+   D_WaitStartupTask(d_starttasks[STARTTASK_TRANMAPS]);
+   D_FinishStartupTasks();
    R_Init();
 
    startupmsg("P_Init", "Init Playloop state.");
@@ -1741,6 +1842,7 @@ static void D_DoomInit()
       D_SetGraphicsMode();
 
    // Initialize ACS
+   D_StartupStep("ACS_Init");
    ACS_Init();
 
    // haleyjd: updated for eternity
@@ -1812,6 +1914,8 @@ static void D_DoomInit()
    // sf: -blockmap option as a variable now
    if(M_CheckParm("-blockmap")) r_blockmap = true;
 
+   D_StartupStep("G_InitNew");
+
    // start the appropriate game based on parms
 
    // killough 12/98:
@@ -1837,7 +1941,9 @@ static void D_DoomInit()
       }
    }
 
-   if((p = M_CheckParm("-fastdemo")) && ++p < myargc)
+   if(D_BenchActive())
+      D_BenchStart();
+   else if((p = M_CheckParm("-fastdemo")) && ++p < myargc)
    {                                 // killough
       fastdemo = true;                // run at fastest speed possible
       timingdemo = true;              // show stats after quit
@@ -1902,6 +2008,8 @@ static void D_DoomInit()
       */
    }
 
+   D_StartupReport();
+
    // a lot of alloca calls are made during startup; kill them all now.
    Z_FreeAlloca();
 }
@@ -1933,17 +2041,29 @@ void D_DoomMain()
       TryRunTics();
 
       // killough 3/16/98: change consoleplayer to displayplayer
-      S_UpdateSounds(players[displayplayer].mo); // move positional sounds
+      {
+         BenchScope bench(BENCH_SOUND);
+         S_UpdateSounds(players[displayplayer].mo); // move positional sounds
+      }
 
       // Update display, next frame, with current state.
-      D_Display();
+      R_ProfileBeginFrame();
+      {
+         BenchScope bench(BENCH_DISPLAY);
+         D_Display();
+      }
+      R_ProfileEndFrame();
 
-      // Sound mixing for the buffer is synchronous.
-      I_UpdateSound();
+      {
+         BenchScope bench(BENCH_SOUND);
 
-      // Synchronous sound output is explicitly called.
-      // Update sound output.
-      I_SubmitSound();
+         // Sound mixing for the buffer is synchronous.
+         I_UpdateSound();
+
+         // Synchronous sound output is explicitly called.
+         // Update sound output.
+         I_SubmitSound();
+      }
 
       // haleyjd 12/06/06: garbage-collect all alloca blocks
       Z_FreeAlloca();
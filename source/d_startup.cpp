@@ -0,0 +1,187 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// Copyright (C) 2013 James Haley et al.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+// Additional terms and conditions compatible with the GPLv3 apply. See the
+// file COPYING-EE for details.
+//
+//--------------------------------------------------------------------------
+//
+// DESCRIPTION:
+//      Startup timing and work run alongside D_DoomInit. Every step of the
+//      startup is timed, and -timestartup prints the times once the game is
+//      ready. Work which only needs the wads can be handed to worker threads
+//      as startup tasks, unless -serialinit is given.
+//
+//-----------------------------------------------------------------------------
+
+#include "z_zone.h"
+
+#include "d_bench.h"
+#include "d_main.h"
+#include "d_startup.h"
+#include "i_system.h"
+#include "m_argv.h"
+#include "m_compare.h"
+#include "m_threads.h"
+
+#define MAXSTARTUPSTEPS 64
+
+struct startupstep_t
+{
+   const char *name;
+   int64_t     start;
+};
+
+// the zone may not be up for the first steps, so this is a plain array
+static startupstep_t startupsteps[MAXSTARTUPSTEPS];
+static int           numstartupsteps;
+
+static startuptask_t *starttasks;  // tasks begun by D_StartStartupTasks
+static int            numstarttasks;
+
+static WorkerPool              startpool;
+static std::mutex              startmutex;
+static std::condition_variable startcond;
+
+//
+// D_StartupStep
+//
+// Marks the start of a startup step, and so the end of the one before it.
+//
+void D_StartupStep(const char *name)
+{
+   if(numstartupsteps == MAXSTARTUPSTEPS)
+      return;
+
+   startupsteps[numstartupsteps].name  = name;
+   startupsteps[numstartupsteps].start = D_BenchNow();
+   ++numstartupsteps;
+}
+
+//
+// D_StartupReport
+//
+// Prints how long each step of the startup took, if -timestartup was given.
+// Called once the startup is over.
+//
+void D_StartupReport()
+{
+   if(!M_CheckParm("-timestartup") || !numstartupsteps)
+      return;
+
+   int64_t end = D_BenchNow();
+
+   usermsg("Startup times:");
+   for(int i = 0; i < numstartupsteps; i++)
+   {
+      int64_t next = i + 1 < numstartupsteps ? startupsteps[i + 1].start : end;
+
+      usermsg("  %-24s %9.2f ms", startupsteps[i].name,
+              (next - startupsteps[i].start) / 1000000.0);
+   }
+   for(int i = 0; i < numstarttasks; i++)
+   {
+      usermsg("  %-24s %9.2f ms on a worker", starttasks[i].name,
+              starttasks[i].time / 1000000.0);
+   }
+   usermsg("  %-24s %9.2f ms", "total",
+           (end - startupsteps[0].start) / 1000000.0);
+}
+
+//
+// D_StartupTasksEnabled
+//
+// True if startup tasks are to be run on worker threads. Otherwise their work
+// is left to the steps that use it, in the order it has always been done.
+//
+bool D_StartupTasksEnabled()
+{
+   return !M_CheckParm("-serialinit") && M_NumCPUs() > 1;
+}
+
+//
+// D_runStartupTask
+//
+static void D_runStartupTask(int tasknum, void *data)
+{
+   startuptask_t &task  = static_cast<startuptask_t *>(data)[tasknum];
+   int64_t        start = D_BenchNow();
+
+   task.func(task.data);
+
+   std::lock_guard<std::mutex> lock(startmutex);
+   task.time = D_BenchNow() - start;
+   task.done = true;
+   startcond.notify_all();
+}
+
+//
+// D_StartStartupTasks
+//
+// Begins the given tasks on worker threads and returns at once. The tasks
+// must not touch anything the main thread changes until they are waited for.
+//
+void D_StartStartupTasks(startuptask_t *tasks, int numtasks)
+{
+   if(starttasks || numtasks <= 0)
+      return;
+
+   starttasks    = tasks;
+   numstarttasks = numtasks;
+
+   startpool.setNumThreads(emin(numtasks, M_NumCPUs() - 1));
+   startpool.start(numtasks, D_runStartupTask, tasks);
+}
+
+//
+// D_WaitStartupTask
+//
+// Returns once a task has finished, if it was begun at all.
+//
+void D_WaitStartupTask(startuptask_t &task)
+{
+   if(!starttasks || &task < starttasks || &task >= starttasks + numstarttasks)
+      return;
+
+   std::unique_lock<std::mutex> lock(startmutex);
+   startcond.wait(lock, [&task] { return task.done; });
+}
+
+//
+// D_FinishStartupTasks
+//
+// Waits for all the tasks and lets the worker threads go. Every task must
+// have run by then, since the steps waiting for them take their results.
+//
+void D_FinishStartupTasks()
+{
+   if(!starttasks)
+      return;
+
+   startpool.wait();
+   startpool.setNumThreads(0);
+
+   for(int i = 0; i < numstarttasks; i++)
+   {
+      if(!starttasks[i].done)
+         I_Error("D_FinishStartupTasks: task %s did not run\n", starttasks[i].name);
+   }
+}
+
+// EOF
+
@@ -0,0 +1,62 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// Copyright (C) 2013 James Haley et al.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+// Additional terms and conditions compatible with the GPLv3 apply. See the
+// file COPYING-EE for details.
+//
+//--------------------------------------------------------------------------
+//
+// DESCRIPTION:
+//      Startup timing and work run alongside D_DoomInit.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef D_STARTUP_H__
+#define D_STARTUP_H__
+
+#include "doomtype.h"
+
+typedef void (*startuptaskfunc_t)(void *data);
+
+//
+// startuptask_t
+//
+// Work begun on worker threads once everything it reads is ready, and waited
+// for before the first startup step that uses what it makes.
+//
+struct startuptask_t
+{
+   const char        *name;
+   startuptaskfunc_t  func;
+   void              *data;
+   bool               done;
+   int64_t            time;  // nanoseconds it took
+};
+
+void D_StartupStep(const char *name);
+void D_StartupReport();
+
+bool D_StartupTasksEnabled();
+void D_StartStartupTasks(startuptask_t *tasks, int numtasks);
+void D_WaitStartupTask(startuptask_t &task);
+void D_FinishStartupTasks();
+
+#endif
+
+// EOF
+
@@ -37,6 +37,7 @@
 #include "f_wipe.h"
 #include "i_video.h"
 #include "m_random.h"
+#include "r_truecolor.h"
 #include "v_alloc.h"
 #include "v_misc.h"
 #include "v_video.h"
@@ -286,6 +287,8 @@ void Wipe_StartScreen(void)
    else
       Z_ChangeTag(wipe_buffer, PU_STATIC); // buffer is in use
 
+   // the wipes read the screen, view included
+   R_TCCoverAll();
 
    wipers[current_wipetype].StartScreen();
 }
@@ -329,6 +332,8 @@ void Wipe_Drawer(void)
    if(!inwipe)
       return;
 
+   // the end screen shows through where the start screen is not drawn
+   R_TCCoverAll();
    wipers[current_wipetype].Drawer();
 }
 
@@ -0,0 +1,542 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// Copyright (C) 2013 James Haley et al.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+// Additional terms and conditions compatible with the GPLv3 apply. See the
+// file COPYING-EE for details.
+//
+//--------------------------------------------------------------------------
+//
+// DESCRIPTION:
+//      Demo sync stream. With -recordsync, the state of the game is hashed
+//      after every gametic of a demo being recorded or played back, and the
+//      hashes are written to a file. With -checksync, a demo is played back
+//      against such a file, and the first gametic and object that differ
+//      are reported. The engine exits with an error at the end of a single
+//      demo that lost sync, so that demos can be checked in batches.
+//
+//      Each record holds the gametic, the random number generator's state,
+//      the number of thinkers, the floor and ceiling height of each sector
+//      that moved since the previous record, and a CRC32 of each mobj's
+//      position, momentum, angle, health and state, in thinker order.
+//      Everything is little-endian.
+//
+//-----------------------------------------------------------------------------
+
+#include "z_zone.h"
+
+#include "d_main.h"
+#include "doomstat.h"
+#include "g_demolog.h"
+#include "g_demosync.h"
+#include "i_system.h"
+#include "info.h"
+#include "m_argv.h"
+#include "m_buffer.h"
+#include "m_collection.h"
+#include "m_fixed.h"
+#include "m_hash.h"
+#include "m_qstr.h"
+#include "m_random.h"
+#include "p_mobj.h"
+#include "p_tick.h"
+#include "r_defs.h"
+#include "r_state.h"
+
+static const char syncmagic[8] = { 'E', 'E', 'S', 'Y', 'N', 'C', '1', '\0' };
+
+struct syncsector_t
+{
+   int32_t index;
+   fixed_t floorheight;
+   fixed_t ceilingheight;
+};
+
+struct syncstate_t
+{
+   int32_t  gametic;
+   int32_t  rndindex;
+   int32_t  prndindex;
+   uint32_t seedhash;
+   int32_t  numthinkers;
+
+   PODCollection<syncsector_t> sectors; // sectors that moved, by index
+   PODCollection<uint32_t>     mobjs;   // hash of each mobj, in thinker order
+};
+
+static OutBuffer   syncout;
+static InBuffer    syncin;
+static const char *syncfilename;
+static bool        syncwriting;
+static bool        syncchecking;
+
+static syncstate_t           current;
+static syncstate_t           expected;
+static PODCollection<Mobj *> currentmobjs; // the mobjs hashed into current
+
+// last heights written or checked for each sector, two per sector
+static fixed_t *syncheights;
+static int      syncnumsectors;
+static bool     syncnewlevel;
+
+static int  synctics;           // records written or checked
+static bool syncdesynced;       // divergence found and reported
+static char syncreport[512];
+
+//
+// G_syncPut
+//
+// Appends a little-endian 32-bit value to a hash buffer.
+//
+static void G_syncPut(byte *&buf, int32_t value)
+{
+   uint32_t v = static_cast<uint32_t>(value);
+
+   *buf++ = static_cast<byte>(v);
+   *buf++ = static_cast<byte>(v >> 8);
+   *buf++ = static_cast<byte>(v >> 16);
+   *buf++ = static_cast<byte>(v >> 24);
+}
+
+//
+// G_syncCRC
+//
+static uint32_t G_syncCRC(const byte *data, const byte *end)
+{
+   HashData hash(HashData::CRC32, data, static_cast<uint32_t>(end - data));
+
+   return hash.getDigestPart(0);
+}
+
+//
+// G_syncHashMobj
+//
+static uint32_t G_syncHashMobj(const Mobj *mo)
+{
+   byte data[12 * 4];
+   byte *buf = data;
+
+   G_syncPut(buf, mo->type);
+   G_syncPut(buf, mo->x);
+   G_syncPut(buf, mo->y);
+   G_syncPut(buf, mo->z);
+   G_syncPut(buf, mo->momx);
+   G_syncPut(buf, mo->momy);
+   G_syncPut(buf, mo->momz);
+   G_syncPut(buf, static_cast<int32_t>(mo->angle));
+   G_syncPut(buf, mo->health);
+   G_syncPut(buf, mo->state ? mo->state->index : -1);
+   G_syncPut(buf, mo->tics);
+   G_syncPut(buf, static_cast<int32_t>(mo->flags));
+
+   return G_syncCRC(data, buf);
+}
+
+//
+// G_syncGatherSectors
+//
+// Adds the sectors whose heights changed since the last tic to the current
+// state. Every sector is added on the first tic of a level.
+//
+static void G_syncGatherSectors()
+{
+   current.sectors.makeEmpty();
+
+   if(numsectors != syncnumsectors)
+   {
+      syncheights    = erealloc(fixed_t *, syncheights,
+                                2 * numsectors * sizeof(fixed_t));
+      syncnumsectors = numsectors;
+      syncnewlevel   = true;
+   }
+
+   for(int i = 0; i < numsectors; i++)
+   {
+      const sector_t *sec = &sectors[i];
+      fixed_t *heights = &syncheights[2 * i];
+
+      if(!syncnewlevel && heights[0] == sec->floorheight && 
+         heights[1] == sec->ceilingheight)
+         continue;
+
+      heights[0] = sec->floorheight;
+      heights[1] = sec->ceilingheight;
+
+      syncsector_t &ss = current.sectors.addNew();
+      ss.index         = i;
+      ss.floorheight   = sec->floorheight;
+      ss.ceilingheight = sec->ceilingheight;
+   }
+
+   syncnewlevel = false;
+}
+
+//
+// G_syncGather
+//
+// Works out the sync state of the current gametic.
+//
+static void G_syncGather()
+{
+   byte seeds[NUMPRCLASS * 4];
+   byte *buf = seeds;
+
+   current.gametic   = gametic;
+   current.rndindex  = rng.rndindex;
+   current.prndindex = rng.prndindex;
+
+   for(unsigned int seed : rng.seed)
+      G_syncPut(buf, static_cast<int32_t>(seed));
+   current.seedhash = G_syncCRC(seeds, buf);
+
+   current.numthinkers = 0;
+   for(Thinker *th = thinkercap.next; th != &thinkercap; th = th->next)
+      ++current.numthinkers;
+
+   current.mobjs.makeEmpty();
+   currentmobjs.makeEmpty();
+   for(Mobj *mo = nullptr; (mo = P_NextThinker(mo)); )
+   {
+      current.mobjs.add(G_syncHashMobj(mo));
+      currentmobjs.add(mo);
+   }
+
+   G_syncGatherSectors();
+}
+
+//
+// G_syncWrite
+//
+static void G_syncWrite()
+{
+   syncout.writeSint32(current.gametic);
+   syncout.writeSint32(current.rndindex);
+   syncout.writeSint32(current.prndindex);
+   syncout.writeUint32(current.seedhash);
+   syncout.writeSint32(current.numthinkers);
+
+   syncout.writeSint32(static_cast<int32_t>(current.sectors.getLength()));
+   for(const syncsector_t &ss : current.sectors)
+   {
+      syncout.writeSint32(ss.index);
+      syncout.writeSint32(ss.floorheight);
+      syncout.writeSint32(ss.ceilingheight);
+   }
+
+   syncout.writeSint32(static_cast<int32_t>(current.mobjs.getLength()));
+   for(uint32_t hash : current.mobjs)
+      syncout.writeUint32(hash);
+}
+
+//
+// G_syncRead
+//
+// Reads the next record into expected. Returns false at the end of the file.
+//
+static bool G_syncRead()
+{
+   int32_t count;
+
+   if(!syncin.readSint32(expected.gametic)   ||
+      !syncin.readSint32(expected.rndindex)  ||
+      !syncin.readSint32(expected.prndindex) ||
+      !syncin.readUint32(expected.seedhash)  ||
+      !syncin.readSint32(expected.numthinkers))
+      return false;
+
+   expected.sectors.makeEmpty();
+   if(!syncin.readSint32(count) || count < 0)
+      return false;
+   while(count--)
+   {
+      syncsector_t &ss = expected.sectors.addNew();
+
+      if(!syncin.readSint32(ss.index)       ||
+         !syncin.readSint32(ss.floorheight) ||
+         !syncin.readSint32(ss.ceilingheight))
+         return false;
+   }
+
+   expected.mobjs.makeEmpty();
+   if(!syncin.readSint32(count) || count < 0)
+      return false;
+   while(count--)
+   {
+      uint32_t hash;
+
+      if(!syncin.readUint32(hash))
+         return false;
+      expected.mobjs.add(hash);
+   }
+
+   return true;
+}
+
+//
+// G_syncDescribeMobj
+//
+static void G_syncDescribeMobj(qstring &str, int index)
+{
+   const Mobj *mo = currentmobjs[index];
+
+   str.Printf(0, "mobj %d (%s at %g, %g, %g with health %d)", index,
+              mobjinfo[mo->type]->name, M_FixedToDouble(mo->x), 
+              M_FixedToDouble(mo->y), M_FixedToDouble(mo->z), mo->health);
+}
+
+//
+// G_syncCompareSectors
+//
+// Returns false and describes the first sector that moved differently.
+//
+static bool G_syncCompareSectors(qstring &str)
+{
+   size_t curlen = current.sectors.getLength();
+   size_t explen = expected.sectors.getLength();
+
+   for(size_t i = 0; i < curlen || i < explen; i++)
+   {
+      const syncsector_t *cur = i < curlen ? &current.sectors[i]  : nullptr;
+      const syncsector_t *exp = i < explen ? &expected.sectors[i] : nullptr;
+
+      if(cur && exp && cur->index == exp->index &&
+         cur->floorheight == exp->floorheight &&
+         cur->ceilingheight == exp->ceilingheight)
+         continue;
+
+      // the lower of the two indices is the sector that differs
+      if(!exp || (cur && cur->index <= exp->index))
+      {
+         str.Printf(0, "sector %d (floor %g, ceiling %g)", cur->index,
+                    M_FixedToDouble(cur->floorheight),
+                    M_FixedToDouble(cur->ceilingheight));
+      }
+      else
+      {
+         const sector_t &sec = sectors[exp->index];
+
+         str.Printf(0, "sector %d (floor %g, ceiling %g; expected %g, %g)",
+                    exp->index, M_FixedToDouble(sec.floorheight),
+                    M_FixedToDouble(sec.ceilingheight),
+                    M_FixedToDouble(exp->floorheight),
+                    M_FixedToDouble(exp->ceilingheight));
+      }
+      return false;
+   }
+
+   return true;
+}
+
+//
+// G_syncCompare
+//
+// Returns false and describes the first difference between the current and
+// expected states. Mobjs are compared before sectors, as a mobj that goes
+// astray usually moves a sector later on rather than the other way around.
+//
+static bool G_syncCompare(qstring &str)
+{
+   if(current.gametic != expected.gametic)
+   {
+      str.Printf(0, "sync stream is at gametic %d", expected.gametic);
+      return false;
+   }
+
+   size_t curlen = current.mobjs.getLength();
+   size_t explen = expected.mobjs.getLength();
+
+   for(size_t i = 0; i < curlen && i < explen; i++)
+   {
+      if(current.mobjs[i] != expected.mobjs[i])
+      {
+         G_syncDescribeMobj(str, static_cast<int>(i));
+         return false;
+      }
+   }
+
+   if(curlen != explen)
+   {
+      if(curlen > explen)
+      {
+         G_syncDescribeMobj(str, static_cast<int>(explen));
+         str << ", the first of " << static_cast<int>(curlen - explen)
+             << " extra";
+      }
+      else
+      {
+         str.Printf(0, "%d mobjs, expected %d", static_cast<int>(curlen),
+                    static_cast<int>(explen));
+      }
+      return false;
+   }
+
+   if(!G_syncCompareSectors(str))
+      return false;
+
+   if(current.rndindex != expected.rndindex || 
+      current.prndindex != expected.prndindex ||
+      current.seedhash != expected.seedhash)
+   {
+      str.Printf(0, "random number generator (rndindex %d, prndindex %d; "
+                 "expected %d, %d)", current.rndindex, current.prndindex, 
+                 expected.rndindex, expected.prndindex);
+      return false;
+   }
+
+   if(current.numthinkers != expected.numthinkers)
+   {
+      str.Printf(0, "%d thinkers, expected %d", current.numthinkers,
+                 expected.numthinkers);
+      return false;
+   }
+
+   return true;
+}
+
+//
+// G_syncDesync
+//
+// Reports the first divergence. Later ones follow from it, so checking stops.
+//
+static void G_syncDesync(const char *what)
+{
+   psnprintf(syncreport, sizeof(syncreport), 
+             "Demo lost sync with %s at gametic %d: %s", syncfilename,
+             gametic, what);
+
+   usermsg("%s\n", syncreport);
+   G_DemoLog("%d\t%s\n", gametic, syncreport);
+
+   syncdesynced = true;
+}
+
+//
+// G_DemoSyncCheckParms
+//
+// Opens the file given to -recordsync or -checksync.
+//
+void G_DemoSyncCheckParms()
+{
+   char magic[sizeof(syncmagic)];
+   int p;
+
+   if((p = M_CheckParm("-recordsync")) && p < myargc - 1)
+   {
+      syncfilename = myargv[p + 1];
+      if(!syncout.createFile(syncfilename, 0x20000, OutBuffer::LENDIAN))
+         I_Error("G_DemoSyncCheckParms: couldn't create %s\n", syncfilename);
+
+      syncout.write(syncmagic, sizeof(syncmagic));
+      syncwriting = true;
+   }
+   else if((p = M_CheckParm("-checksync")) && p < myargc - 1)
+   {
+      syncfilename = myargv[p + 1];
+      if(!syncin.openFile(syncfilename, InBuffer::LENDIAN))
+         I_Error("G_DemoSyncCheckParms: couldn't open %s\n", syncfilename);
+
+      if(syncin.read(magic, sizeof(magic)) != sizeof(magic) ||
+         memcmp(magic, syncmagic, sizeof(magic)))
+         I_Error("G_DemoSyncCheckParms: %s is not a sync stream\n", syncfilename);
+
+      syncchecking = true;
+   }
+}
+
+//
+// G_DemoSyncNewLevel
+//
+// Called when a level is set up, so that the heights of all its sectors go
+// into the next record.
+//
+void G_DemoSyncNewLevel()
+{
+   syncnewlevel = true;
+}
+
+//
+// G_DemoSyncTic
+//
+// Called after each gametic of a level has run.
+//
+void G_DemoSyncTic()
+{
+   if(!(demoplayback || demorecording) || syncdesynced)
+      return;
+
+   if(syncwriting)
+   {
+      G_syncGather();
+      G_syncWrite();
+      ++synctics;
+   }
+   else if(syncchecking)
+   {
+      qstring what;
+
+      G_syncGather();
+      if(!G_syncRead())
+         G_syncDesync("sync stream ended");
+      else if(!G_syncCompare(what))
+         G_syncDesync(what.constPtr());
+      else
+         ++synctics;
+   }
+}
+
+//
+// G_DemoSyncFinish
+//
+// Called when the demo ends. Closes the stream and, after a single demo that
+// lost sync, exits with an error.
+//
+void G_DemoSyncFinish()
+{
+   if(syncwriting)
+   {
+      syncout.close();
+      syncwriting = false;
+      usermsg("Wrote %d gametics of sync data to %s\n", synctics, 
+              syncfilename);
+   }
+   else if(syncchecking)
+   {
+      if(!syncdesynced && G_syncRead())
+         G_syncDesync("demo ended before the sync stream");
+
+      syncin.close();
+      syncchecking = false;
+
+      if(!syncdesynced)
+      {
+         usermsg("Demo kept sync with %s for %d gametics\n", syncfilename, 
+                 synctics);
+      }
+      else if(singledemo)
+         I_Error("%s\n", syncreport);
+   }
+
+   if(syncheights)
+   {
+      efree(syncheights);
+      syncheights    = nullptr;
+      syncnumsectors = 0;
+   }
+}
+
+// EOF
+
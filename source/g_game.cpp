@@ -39,6 +39,7 @@
 #include "c_io.h"
 #include "c_net.h"
 #include "c_runcmd.h"
+#include "d_bench.h"
 #include "d_deh.h"              // Ty 3/27/98 deh declarations
 #include "d_event.h"
 #include "d_gi.h"
@@ -56,6 +57,7 @@
 #include "f_wipe.h"
 #include "g_bind.h"
 #include "g_demolog.h"
+#include "g_demosync.h"
 #include "g_dmflag.h"
 #include "g_game.h"
 #include "in_lude.h"
@@ -733,7 +735,11 @@ void G_DoLoadLevel()
    // haleyjd 07/28/10: Waaaay too early for this.
    //gamestate = GS_LEVEL;
 
-   P_SetupLevel(g_dir, gamemapname, 0, gameskill);
+   D_BenchBeginLevel();
+   {
+      BenchScope bench(BENCH_SETUP);
+      P_SetupLevel(g_dir, gamemapname, 0, gameskill);
+   }
 
    if(gamestate != GS_LEVEL)       // level load error
    {
@@ -1711,6 +1717,38 @@ static const char *G_getNextLevelName(levelkind_t kind, int map)
    return G_GetNameForMap(gameepisode, map);
 }
 
+//
+// G_nextMapName
+//
+// Gets the name and number of the level entered after the intermission.
+//
+static const char *G_nextMapName(int &map)
+{
+   map = wminfo.next+1;
+
+   // haleyjd: handle heretic hidden levels via missioninfo samelevel rules
+   if(!wminfo.nextexplicit && GameModeInfo->missionInfo->sameLevels)
+   {
+      samelevel_t *sameLevel = GameModeInfo->missionInfo->sameLevels;
+      while(sameLevel->episode != -1)
+      {
+         if(gameepisode == sameLevel->episode && map == sameLevel->map)
+         {
+            --map; // return to same level by default
+            break;
+         }
+         ++sameLevel;
+      }
+   }
+   
+   // haleyjd: customizable secret exits
+   if(secretexit)
+      return G_getNextLevelName(lk_secret, map);
+
+   // haleyjd 12/14/01: don't use nextlevel for secret exits here either!
+   return G_getNextLevelName(lk_overt, map);
+}
+
 //
 // Setups the MapInfo/LevelInfo fields of wminfo
 //
@@ -1847,37 +1885,17 @@ static void G_DoCompleted()
    G_setupMapInfoWMInfo(secretexit ? lk_secret : lk_overt);
    
    IN_Start(&wminfo);
+
+   // read the next level while the intermission is up
+   int nextmap;
+   P_PrefetchLevel(g_dir, G_nextMapName(nextmap));
 }
 
 static void G_DoWorldDone()
 {
    idmusnum = -1; //jff 3/17/98 allow new level's music to be loaded
    gamestate = GS_LOADING;
-   gamemap = wminfo.next+1;
-
-   // haleyjd: handle heretic hidden levels via missioninfo samelevel rules
-   if(!wminfo.nextexplicit && GameModeInfo->missionInfo->sameLevels)
-   {
-      samelevel_t *sameLevel = GameModeInfo->missionInfo->sameLevels;
-      while(sameLevel->episode != -1)
-      {
-         if(gameepisode == sameLevel->episode && gamemap == sameLevel->map)
-         {
-            --gamemap; // return to same level by default
-            break;
-         }
-         ++sameLevel;
-      }
-   }
-   
-   // haleyjd: customizable secret exits
-   if(secretexit)
-      G_SetGameMapName(G_getNextLevelName(lk_secret, gamemap));
-   else
-   {
-      // haleyjd 12/14/01: don't use nextlevel for secret exits here either!
-      G_SetGameMapName(G_getNextLevelName(lk_overt, gamemap));
-   }
+   G_SetGameMapName(G_nextMapName(gamemap));
 
    // haleyjd 10/24/10: if in Master Levels mode, see if the next map exists
    // in the wad directory, and if so, use it. Otherwise, return to the Master
@@ -2298,7 +2316,11 @@ void G_Ticker()
  
    if(gamestate == GS_LEVEL)
    {
-      P_Ticker();
+      {
+         BenchScope bench(BENCH_PLAYSIM);
+         P_Ticker();
+      }
+      G_DemoSyncTic();
       G_CameraTicker(); // haleyjd: move cameras
       ST_Ticker(); 
       AM_Ticker(); 
@@ -3706,6 +3728,9 @@ void G_TimeDemo(const char *name, bool showmenu)
 //
 bool G_CheckDemoStatus()
 {
+   if(demorecording || demoplayback)
+      G_DemoSyncFinish();
+
    if(demorecording)
    {
       demorecording = false;
@@ -3738,6 +3763,10 @@ bool G_CheckDemoStatus()
       G_ReloadDefaults();    // killough 3/1/98
       netgame = false;       // killough 3/29/98
 
+      // the benchmark plays its demos one after another
+      if(D_BenchNextDemo())
+         return true;
+
       if(wassingledemo)
          C_SetConsole();
       else
@@ -0,0 +1,116 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// Copyright (C) 2013 James Haley et al.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+// Additional terms and conditions compatible with the GPLv3 apply. See the
+// file COPYING-EE for details.
+//
+//--------------------------------------------------------------------------
+//
+// DESCRIPTION:
+//    Hardware Abstraction Layer for Mapping Files into Memory
+//
+//-----------------------------------------------------------------------------
+
+#include "../z_zone.h"
+
+#include "i_filemap.h"
+#include "i_platform.h"
+
+#if EE_CURRENT_PLATFORM == EE_PLATFORM_LINUX \
+ || EE_CURRENT_PLATFORM == EE_PLATFORM_MACOSX \
+ || EE_CURRENT_PLATFORM == EE_PLATFORM_FREEBSD
+#include <sys/mman.h>
+#include <sys/stat.h>
+#define EE_HAVE_MMAP
+#elif EE_CURRENT_PLATFORM == EE_PLATFORM_WINDOWS
+#include <windows.h>
+#include <io.h>
+#endif
+
+//
+// I_MapFile
+//
+// Maps the whole of an open file into memory. Returns false if the file can't
+// be mapped, or the platform has no way to; the file is read as usual then.
+//
+bool I_MapFile(FILE *f, filemap_t &map)
+{
+   map.base = nullptr;
+   map.size = 0;
+
+#if EE_CURRENT_PLATFORM == EE_PLATFORM_WINDOWS
+   HANDLE        file = reinterpret_cast<HANDLE>(_get_osfhandle(_fileno(f)));
+   LARGE_INTEGER size;
+   HANDLE        mapping;
+
+   if(file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &size) ||
+      size.QuadPart <= 0 || static_cast<unsigned long long>(size.QuadPart) > SIZE_MAX)
+      return false;
+
+   if(!(mapping = CreateFileMapping(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr)))
+      return false;
+
+   // the view keeps the mapping alive by itself
+   map.base = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+   CloseHandle(mapping);
+
+   if(!map.base)
+      return false;
+
+   map.size = static_cast<size_t>(size.QuadPart);
+   return true;
+#elif defined(EE_HAVE_MMAP)
+   struct stat sbuf;
+   void *base;
+
+   if(fstat(fileno(f), &sbuf) || !S_ISREG(sbuf.st_mode) || sbuf.st_size <= 0)
+      return false;
+
+   base = mmap(nullptr, static_cast<size_t>(sbuf.st_size),
+               PROT_READ | PROT_WRITE, MAP_PRIVATE, fileno(f), 0);
+   if(base == MAP_FAILED)
+      return false;
+
+   map.base = base;
+   map.size = static_cast<size_t>(sbuf.st_size);
+   return true;
+#else
+   return false;
+#endif
+}
+
+//
+// I_UnmapFile
+//
+void I_UnmapFile(filemap_t &map)
+{
+   if(!map.base)
+      return;
+
+#if EE_CURRENT_PLATFORM == EE_PLATFORM_WINDOWS
+   UnmapViewOfFile(map.base);
+#elif defined(EE_HAVE_MMAP)
+   munmap(map.base, map.size);
+#endif
+
+   map.base = nullptr;
+   map.size = 0;
+}
+
+// EOF
+
@@ -0,0 +1,48 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// Copyright (C) 2013 James Haley et al.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+// Additional terms and conditions compatible with the GPLv3 apply. See the
+// file COPYING-EE for details.
+//
+//--------------------------------------------------------------------------
+//
+// DESCRIPTION:
+//    Hardware Abstraction Layer for Mapping Files into Memory
+//
+//-----------------------------------------------------------------------------
+
+#ifndef I_FILEMAP_H__
+#define I_FILEMAP_H__
+
+#include <stdio.h>
+
+// A whole file mapped into memory, copy-on-write: writes to the pages change
+// this process's copy only, never the file.
+struct filemap_t
+{
+   void  *base;
+   size_t size;
+};
+
+bool I_MapFile(FILE *f, filemap_t &map);
+void I_UnmapFile(filemap_t &map);
+
+#endif
+
+// EOF
+
@@ -0,0 +1,148 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// Copyright (C) 2013 James Haley et al.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+// Additional terms and conditions compatible with the GPLv3 apply. See the
+// file COPYING-EE for details.
+//
+//----------------------------------------------------------------------------
+//
+// DESCRIPTION:
+//   
+//   Null video driver, which draws into memory and shows nothing.
+//
+//-----------------------------------------------------------------------------
+
+#include "../z_zone.h"  /* memory allocation wrappers -- killough */
+
+#include "i_nullvideo.h"
+
+#include "../v_misc.h"
+#include "../v_video.h"
+
+//
+// NullVideoDriver::FinishUpdate
+//
+// Nothing is ever shown.
+//
+void NullVideoDriver::FinishUpdate()
+{
+}
+
+//
+// NullVideoDriver::ReadScreen
+//
+// Get the current screen contents.
+//
+void NullVideoDriver::ReadScreen(byte *scr)
+{
+   VBuffer temp;
+
+   V_InitVBufferFrom(&temp, vbscreen.width, vbscreen.height, 
+                     vbscreen.width, video.bitdepth, scr);
+   V_BlitVBuffer(&temp, 0, 0, &vbscreen, 0, 0, vbscreen.width, vbscreen.height);
+   V_FreeVBuffer(&temp);
+}
+
+//
+// NullVideoDriver::SetPalette
+//
+void NullVideoDriver::SetPalette(byte *pal)
+{
+}
+
+//
+// NullVideoDriver::UnsetPrimaryBuffer
+//
+void NullVideoDriver::UnsetPrimaryBuffer()
+{
+   if(screen)
+   {
+      efree(screen);
+      screen = nullptr;
+   }
+   video.screens[0] = nullptr;
+}
+
+//
+// NullVideoDriver::SetPrimaryBuffer
+//
+// Allocates the buffer the game engine renders frames into and sets it to
+// video.screens[0].
+//
+void NullVideoDriver::SetPrimaryBuffer()
+{
+   screen = ecalloc(byte *, video.width, video.height);
+
+   video.screens[0] = screen;
+   video.pitch      = video.width;
+}
+
+//
+// NullVideoDriver::ShutdownGraphicsPartway
+//
+void NullVideoDriver::ShutdownGraphicsPartway()
+{
+   UnsetPrimaryBuffer();
+}
+
+//
+// NullVideoDriver::ShutdownGraphics
+//
+void NullVideoDriver::ShutdownGraphics()
+{
+   ShutdownGraphicsPartway();
+}
+
+//
+// NullVideoDriver::InitGraphicsMode
+//
+// Takes the resolution from the configured video mode and the command line,
+// like the other drivers, so that benchmarks can be run at any size.
+// Returns false, as it cannot fail.
+//
+bool NullVideoDriver::InitGraphicsMode()
+{
+   bool wantfullscreen = false;
+   bool wantdesktopfs  = false;
+   bool wantvsync      = false;
+   bool wanthardware   = false;
+   bool wantframe      = true;
+   int  v_w            = 640;
+   int  v_h            = 480;
+
+   I_ParseGeom(i_videomode, &v_w, &v_h, &wantfullscreen, &wantvsync,
+               &wanthardware, &wantframe, &wantdesktopfs);
+   I_CheckVideoCmds(&v_w, &v_h, &wantfullscreen, &wantvsync, &wanthardware,
+                    &wantframe, &wantdesktopfs);
+
+   video.width     = v_w;
+   video.height    = v_h;
+   video.bitdepth  = 8;
+   video.pixelsize = 1;
+
+   UnsetPrimaryBuffer();
+   SetPrimaryBuffer();
+
+   return false;
+}
+
+// The one and only global instance of the null video driver.
+NullVideoDriver i_nullvideodriver;
+
+// EOF
+
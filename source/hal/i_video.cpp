@@ -32,6 +32,7 @@
 
 #include "../am_map.h"
 #include "../c_runcmd.h"
+#include "../d_bench.h"
 #include "../d_gi.h"
 #include "../d_main.h"
 #include "../doomstat.h"
@@ -43,10 +44,13 @@
 #include "../m_misc.h"
 #include "../m_qstr.h"
 #include "../r_main.h"
+#include "../r_truecolor.h"
 #include "../st_stuff.h"
 #include "../v_misc.h"
 #include "../v_video.h"
 
+#include "i_nullvideo.h"
+
 // Platform-Specific Video Drivers:
 #ifdef _SDL_VER
 #include "../sdl/i_sdlvideo.h"
@@ -172,7 +176,8 @@ void I_InitMouse();
 
 void I_StartTic()
 {
-   if(!D_noWindow())
+   // the benchmark's null driver has no window
+   if(!D_noWindow() && i_video_driver->window)
       I_StartTicInWindow(i_video_driver->window);
 }
 
@@ -216,7 +221,10 @@ void I_ReadScreen(byte *scr)
 void I_SetPalette(byte *palette)
 {
    if(in_graphics_mode)             // killough 8/11/98
+   {
       i_video_driver->SetPalette(palette);
+      R_TCSetPalette(palette);
+   }
 }
 
 void I_ShutdownGraphics()
@@ -438,7 +446,7 @@ static bool I_InitGraphicsMode()
 
 #ifdef _MSC_VER
       // Win32 specific hacks
-      if(!D_noWindow())
+      if(!D_noWindow() && i_video_driver->window)
          I_DisableSysMenu(i_video_driver->window);
 #endif
 
@@ -500,9 +508,16 @@ void I_InitGraphics()
    
    firsttime = false;
    
+   // The benchmark never opens a window. i_videodriverid is left alone, as
+   // it is saved to the configuration.
+   if(D_BenchActive())
+   {
+      i_video_driver = &i_nullvideodriver;
+      usermsg(" (using null video driver)");
+   }
    // Select video driver based on configuration (out of those available in 
    // the current compile), or get the default driver if unspecified
-   if(!(driveritem = I_DefaultVideoDriver()))
+   else if(!(driveritem = I_DefaultVideoDriver()))
    {
       I_Error("I_InitGraphics: invalid video driver %d\n", i_videodriverid);
    }
@@ -58,11 +58,16 @@
 #include "p_enemy.h"
 #include "p_map.h"
 #include "p_partcl.h"
+#include "p_reject.h"
 #include "p_user.h"
 #include "r_draw.h"
+#include "r_drawq.h"
 #include "r_main.h"
+#include "r_pvs.h"
+#include "r_truecolor.h"
 #include "r_sky.h"
 #include "r_things.h"
+#include "r_threads.h"
 #include "s_sound.h"
 #include "st_stuff.h"
 #include "v_video.h"
@@ -805,11 +810,36 @@ default_t defaults[] =
    
    DEFAULT_INT("r_columnengine",&r_column_engine_num, NULL, 
                1, 0, NUMCOLUMNENGINES - 1, default_t::wad_no, 
-               "0 = normal, 1 = optimized quad cache"),
+               "0 = normal, 1 = optimized quad cache, 2 = SIMD"),
+
+   DEFAULT_INT("r_quadwidth", &r_quadwidth, NULL,
+               2, 0, NUMQUADWIDTHS - 1, default_t::wad_no,
+               "columns buffered by quad cache: 0 = 4, 1 = 8, 2 = 16, 3 = 32"),
    
    DEFAULT_INT("r_spanengine",&r_span_engine_num, NULL,
                0, 0, NUMSPANENGINES - 1, default_t::wad_no, 
-               "0 = high precision, 1 = low precision"),
+               "0 = high precision, 1 = SIMD"),
+
+   DEFAULT_INT("r_threads", &r_threads, NULL, 1, 1, MAXRENDERTHREADS, default_t::wad_no,
+               "number of threads used for drawing (1 = single-threaded)"),
+
+   DEFAULT_BOOL("r_drawahead", &r_drawahead, NULL, true, default_t::wad_no,
+                "draw finished parts of the scene while portals are rendered"),
+
+   DEFAULT_BOOL("r_pvs", &r_pvs, NULL, false, default_t::wad_no,
+                "cull the view with potentially visible sets built at level load"),
+
+   DEFAULT_BOOL("r_truecolor", &r_truecolor, NULL, false, default_t::wad_no,
+                "render the view in 32-bit colour"),
+
+   DEFAULT_INT("r_texcachesize", &r_texcachesize, NULL, 64, 0, 4096, default_t::wad_no,
+               "megabytes of composed textures to keep (0 = no limit)"),
+
+   DEFAULT_BOOL("p_sightprefetch", &p_sightprefetch, NULL, false, default_t::wad_no,
+                "work out monsters' sight checks ahead of time on worker threads"),
+
+   DEFAULT_BOOL("p_buildreject", &p_buildreject, NULL, false, default_t::wad_no,
+                "build a REJECT at level load for levels whose REJECT is empty"),
 
    DEFAULT_INT("r_tlstyle", &r_tlstyle, NULL, 1, 0, R_TLSTYLE_NUM - 1, default_t::wad_yes,
                "Doom object translucency style (0 = none, 1 = Boom, 2 = new)"),
@@ -0,0 +1,249 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// Copyright (C) 2013 James Haley et al.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+// Additional terms and conditions compatible with the GPLv3 apply. See the
+// file COPYING-EE for details.
+//
+//--------------------------------------------------------------------------
+//
+// Worker thread pool
+//
+//-----------------------------------------------------------------------------
+
+#include "z_zone.h"
+#include "m_threads.h"
+
+WorkerPool::WorkerPool()
+   : threads(nullptr), numThreads(0), func(nullptr), data(nullptr),
+     numTasks(0), nextTask(0), pending(0), generation(0), quit(false)
+{
+}
+
+WorkerPool::~WorkerPool()
+{
+   stopThreads();
+}
+
+//
+// WorkerPool::runNextTask
+//
+// Takes the next unclaimed task of the current batch, if any, and runs it with
+// the lock released. Returns false once every task has been handed out.
+//
+bool WorkerPool::runNextTask(std::unique_lock<std::mutex> &lock)
+{
+   if(nextTask >= numTasks)
+      return false;
+
+   int        task  = nextTask++;
+   taskfunc_t tfunc = func;
+   void      *tdata = data;
+
+   lock.unlock();
+   tfunc(task, tdata);
+   lock.lock();
+
+   if(--pending == 0)
+      doneCond.notify_all();
+
+   return true;
+}
+
+//
+// WorkerPool::workerLoop
+//
+// Main function of each worker thread. seen is the batch generation when the
+// thread was created; reading it here instead would let a worker that is slow
+// to start miss a batch begun right after setNumThreads.
+//
+void WorkerPool::workerLoop(unsigned int seen)
+{
+   std::unique_lock<std::mutex> lock(mutex);
+
+   while(true)
+   {
+      wakeCond.wait(lock, [&] { return quit || generation != seen; });
+
+      if(quit)
+         return;
+
+      seen = generation;
+      while(runNextTask(lock))
+         ;
+   }
+}
+
+//
+// WorkerPool::stopThreads
+//
+void WorkerPool::stopThreads()
+{
+   if(!threads)
+      return;
+
+   {
+      std::lock_guard<std::mutex> lock(mutex);
+      quit = true;
+   }
+   wakeCond.notify_all();
+
+   for(int i = 0; i < numThreads; i++)
+      threads[i].join();
+
+   delete [] threads;
+   threads    = nullptr;
+   numThreads = 0;
+   quit       = false;
+}
+
+//
+// WorkerPool::setNumThreads
+//
+// Changes the number of worker threads. Zero workers is valid and makes run()
+// execute everything on the calling thread.
+//
+void WorkerPool::setNumThreads(int num)
+{
+   if(num < 0)
+      num = 0;
+
+   if(num == numThreads)
+      return;
+
+   stopThreads();
+
+   if(!num)
+      return;
+
+   threads    = new std::thread [num];
+   numThreads = num;
+
+   for(int i = 0; i < num; i++)
+      threads[i] = std::thread(&WorkerPool::workerLoop, this, generation);
+}
+
+//
+// WorkerPool::run
+//
+// Runs tasks 0 through pNumTasks - 1 of pFunc, spread over the workers and the
+// calling thread, and returns when all of them have finished. Tasks may run in
+// any order and concurrently with each other.
+//
+void WorkerPool::run(int pNumTasks, taskfunc_t pFunc, void *pData)
+{
+   if(pNumTasks <= 0)
+      return;
+
+   if(!numThreads || pNumTasks == 1)
+   {
+      for(int i = 0; i < pNumTasks; i++)
+         pFunc(i, pData);
+      return;
+   }
+
+   std::unique_lock<std::mutex> lock(mutex);
+
+   func     = pFunc;
+   data     = pData;
+   numTasks = pNumTasks;
+   nextTask = 0;
+   pending  = pNumTasks;
+   ++generation;
+
+   wakeCond.notify_all();
+
+   while(runNextTask(lock))
+      ;
+
+   doneCond.wait(lock, [this] { return pending == 0; });
+
+   func = nullptr;
+   data = nullptr;
+}
+
+//
+// WorkerPool::start
+//
+// Hands tasks 0 through pNumTasks - 1 of pFunc to the workers and returns at
+// once, without the calling thread taking part. wait() must be called before
+// the next batch is started or run. A pool without workers runs the tasks
+// before returning.
+//
+void WorkerPool::start(int pNumTasks, taskfunc_t pFunc, void *pData)
+{
+   if(pNumTasks <= 0)
+      return;
+
+   if(!numThreads)
+   {
+      for(int i = 0; i < pNumTasks; i++)
+         pFunc(i, pData);
+      return;
+   }
+
+   std::lock_guard<std::mutex> lock(mutex);
+
+   func     = pFunc;
+   data     = pData;
+   numTasks = pNumTasks;
+   nextTask = 0;
+   pending  = pNumTasks;
+   ++generation;
+
+   wakeCond.notify_all();
+}
+
+//
+// WorkerPool::busy
+//
+// Returns true while tasks of a started batch are unfinished.
+//
+bool WorkerPool::busy()
+{
+   std::lock_guard<std::mutex> lock(mutex);
+   return pending > 0;
+}
+
+//
+// WorkerPool::wait
+//
+// Returns when every task of the batch begun by start() has finished.
+//
+void WorkerPool::wait()
+{
+   std::unique_lock<std::mutex> lock(mutex);
+
+   doneCond.wait(lock, [this] { return pending == 0; });
+
+   func = nullptr;
+   data = nullptr;
+}
+
+//
+// M_NumCPUs
+//
+// Returns the number of hardware threads available, or 1 if unknown.
+//
+int M_NumCPUs()
+{
+   unsigned int n = std::thread::hardware_concurrency();
+   return n ? int(n) : 1;
+}
+
+// EOF
+
@@ -0,0 +1,86 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// Copyright (C) 2013 James Haley et al.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+// Additional terms and conditions compatible with the GPLv3 apply. See the
+// file COPYING-EE for details.
+//
+//--------------------------------------------------------------------------
+//
+// Worker thread pool
+//
+//-----------------------------------------------------------------------------
+
+#ifndef M_THREADS_H__
+#define M_THREADS_H__
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+//
+// WorkerPool
+//
+// A set of persistent worker threads which cooperatively run batches of
+// indexed tasks. The calling thread always takes part in a batch, so a pool
+// without any workers simply runs every task in order on the caller.
+//
+class WorkerPool
+{
+public:
+   typedef void (*taskfunc_t)(int task, void *data);
+
+protected:
+   std::thread *threads;     // worker threads
+   int          numThreads;  // number of worker threads
+
+   std::mutex              mutex;
+   std::condition_variable wakeCond; // signals workers that a batch started
+   std::condition_variable doneCond; // signals the caller a batch finished
+
+   taskfunc_t   func;        // function for the current batch
+   void        *data;        // user data for the current batch
+   int          numTasks;    // number of tasks in the current batch
+   int          nextTask;    // next task index to be handed out
+   int          pending;     // tasks not yet finished
+   unsigned int generation;  // incremented for every new batch
+   bool         quit;        // workers should exit
+
+   bool runNextTask(std::unique_lock<std::mutex> &lock);
+   void workerLoop(unsigned int seen);
+   void stopThreads();
+
+public:
+   WorkerPool();
+   ~WorkerPool();
+
+   void setNumThreads(int num);
+   int  getNumThreads() const { return numThreads; }
+
+   void run(int pNumTasks, taskfunc_t pFunc, void *pData);
+
+   void start(int pNumTasks, taskfunc_t pFunc, void *pData);
+   bool busy();
+   void wait();
+};
+
+int M_NumCPUs();
+
+#endif
+
+// EOF
+
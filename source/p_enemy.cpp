@@ -48,6 +48,7 @@
 #include "ev_specials.h"
 #include "g_game.h"
 #include "m_bbox.h"
+#include "m_compare.h"
 #include "metaapi.h"
 #include "p_anim.h"      // haleyjd
 #include "p_enemy.h"
@@ -175,6 +176,282 @@ static void P_RecursiveSound(sector_t *sec, int soundblocks,
    }
 }
 
+//
+// Sound graph
+//
+// Every weapon shot floods the sectors around it, which on big levels takes
+// P_RecursiveSound deep into the map, a line at a time. So when a level is
+// loaded, the two-sided lines of each sector are put in one array with the
+// sector on their other side, and noise alerts go through them breadth
+// first, marking sectors with a generation of their own. Sectors reached
+// without crossing a sound-blocking line are all done first, then those
+// behind one such line, which gives each sector the same soundtraversed
+// as the recursion.
+//
+// Whether a line is open is kept, and only worked out again once either of
+// its sectors has moved or changed its portals since. Line flags are still
+// checked every time, since they can be changed while playing.
+//
+
+struct soundedge_t
+{
+   int line;
+   int other;  // sector on the other side
+};
+
+struct soundline_t
+{
+   unsigned int stamp; // soundstamps of both sectors when open was found
+   bool         open;
+};
+
+static int          *soundfirst;   // numsectors + 1 indices into soundedges
+static soundedge_t  *soundedges;
+static soundline_t  *soundlines;
+static byte         *soundportals; // sector has lines with portals
+static unsigned int *soundgen;     // soundgeneration when last reached
+static byte         *soundlevel;   // sound-blocking lines crossed to get there
+static int          *soundqueue;   // sectors reached crossing none
+static int          *soundblocked; // sectors reached crossing one
+static unsigned int  soundgeneration;
+
+//
+// P_BuildSoundGraph
+//
+// Called from P_SetupLevel once specials are spawned, since those can make
+// lines two-sided.
+//
+void P_BuildSoundGraph()
+{
+   int numedges = 0;
+
+   Z_Malloc((numsectors + 1) * sizeof(int), PU_LEVEL, (void **)&soundfirst);
+   Z_Malloc(numlines * sizeof(soundline_t), PU_LEVEL, (void **)&soundlines);
+   Z_Calloc(numsectors, sizeof(byte), PU_LEVEL, (void **)&soundportals);
+   Z_Calloc(numsectors, sizeof(unsigned int), PU_LEVEL, (void **)&soundgen);
+   Z_Malloc(numsectors, PU_LEVEL, (void **)&soundlevel);
+   Z_Malloc(numsectors * sizeof(int), PU_LEVEL, (void **)&soundqueue);
+   Z_Malloc(numsectors * sizeof(int), PU_LEVEL, (void **)&soundblocked);
+
+   for(int i = 0; i < numsectors; i++)
+   {
+      soundfirst[i] = numedges;
+      for(int j = 0; j < sectors[i].linecount; j++)
+      {
+         const line_t *line = sectors[i].lines[j];
+
+         if(line->portal)
+            soundportals[i] = 1;
+         if(line->sidenum[1] != -1)
+            ++numedges;
+      }
+   }
+   soundfirst[numsectors] = numedges;
+
+   Z_Malloc(emax(numedges, 1) * sizeof(soundedge_t), PU_LEVEL,
+            (void **)&soundedges);
+
+   for(int i = 0; i < numsectors; i++)
+   {
+      soundedge_t *edge = soundedges + soundfirst[i];
+
+      for(int j = 0; j < sectors[i].linecount; j++)
+      {
+         const line_t *line = sectors[i].lines[j];
+
+         if(line->sidenum[1] == -1)
+            continue;
+
+         edge->line  = eindex(line - lines);
+         edge->other =
+            eindex(sides[line->sidenum[sides[line->sidenum[0]].sector == &sectors[i]]].sector - sectors);
+         ++edge;
+      }
+   }
+
+   // no line's opening is known yet
+   for(int i = 0; i < numlines; i++)
+   {
+      const line_t *line = &lines[i];
+
+      soundlines[i].open  = false;
+      soundlines[i].stamp = line->frontsector->soundstamp - 1;
+      if(line->backsector)
+         soundlines[i].stamp += line->backsector->soundstamp;
+   }
+}
+
+//
+// P_soundLineOpen
+//
+// True if sound goes through a two-sided line, as P_LineOpening finds.
+//
+static bool P_soundLineOpen(line_t *line)
+{
+   soundline_t &sl = soundlines[line - lines];
+   unsigned int stamp;
+
+   // the sector beyond a one-sided portal line has no say in the stamp
+   if(line->intflags & MLI_1SPORTALLINE)
+   {
+      P_LineOpening(line, NULL);
+      return clip.openrange > 0;
+   }
+
+   // both stamps only ever go up, so their sum stays the same only while
+   // neither changes
+   stamp = line->frontsector->soundstamp + line->backsector->soundstamp;
+
+   if(sl.stamp != stamp)
+   {
+      P_LineOpening(line, NULL);
+      sl.open  = clip.openrange > 0;
+      sl.stamp = stamp;
+   }
+
+   return sl.open;
+}
+
+//
+// P_soundReach
+//
+// Marks a sector as reached having crossed the given number of sound-blocking
+// lines, unless it was reached crossing as few already.
+//
+static void P_soundReach(const sector_t *sec, int level, int &numqueued,
+                         int &numblocked)
+{
+   int secnum = eindex(sec - sectors);
+
+   if(soundgen[secnum] == soundgeneration && soundlevel[secnum] <= level)
+      return;
+
+   soundgen[secnum]   = soundgeneration;
+   soundlevel[secnum] = level;
+
+   if(level)
+      soundblocked[numblocked++] = secnum;
+   else
+      soundqueue[numqueued++] = secnum;
+}
+
+//
+// P_soundSpread
+//
+// Reaches the sectors next to one that has been reached.
+//
+static void P_soundSpread(int secnum, int &numqueued, int &numblocked)
+{
+   sector_t *sec   = &sectors[secnum];
+   int       level = soundlevel[secnum];
+
+#ifdef R_LINKEDPORTALS
+   // see P_RecursiveSound
+   if(sec->f_pflags & PS_PASSSOUND)
+   {
+      line_t *check = sec->lines[0];
+
+      P_soundReach(R_PointInSubsector(((check->v1->x + check->v2->x) / 2) 
+                                       + R_FPLink(sec)->deltax,
+                                      ((check->v1->y + check->v2->y) / 2) 
+                                       + R_FPLink(sec)->deltay)->sector,
+                   level, numqueued, numblocked);
+   }
+
+   if(sec->c_pflags & PS_PASSSOUND)
+   {
+      line_t *check = sec->lines[0];
+
+      P_soundReach(R_PointInSubsector(((check->v1->x + check->v2->x) / 2) 
+                                       + R_CPLink(sec)->deltax,
+                                      ((check->v1->y + check->v2->y) / 2) 
+                                       + R_CPLink(sec)->deltay)->sector,
+                   level, numqueued, numblocked);
+   }
+
+   if(soundportals[secnum])
+   {
+      for(int i = 0; i < sec->linecount; i++)
+      {
+         line_t *check = sec->lines[i];
+
+         if(!(check->pflags & PS_PASSSOUND))
+            continue;
+
+         P_soundReach(R_PointInSubsector(((check->v1->x + check->v2->x) / 2) + check->portal->data.link.deltax,
+                                         ((check->v1->y + check->v2->y) / 2) + check->portal->data.link.deltay)->sector,
+                      level, numqueued, numblocked);
+      }
+   }
+#endif
+
+   for(int i = soundfirst[secnum]; i < soundfirst[secnum + 1]; i++)
+   {
+      const soundedge_t &edge  = soundedges[i];
+      line_t            *check = &lines[edge.line];
+
+      if(!(check->flags & ML_TWOSIDED) || !P_soundLineOpen(check))
+         continue;
+
+      if(!(check->flags & ML_SOUNDBLOCK))
+         P_soundReach(&sectors[edge.other], level, numqueued, numblocked);
+      else if(!level)
+         P_soundReach(&sectors[edge.other], 1, numqueued, numblocked);
+   }
+}
+
+//
+// P_floodSound
+//
+// Does what P_RecursiveSound does from the given sector, through the sound
+// graph.
+//
+static void P_floodSound(sector_t *start, Mobj *soundtarget)
+{
+   int numqueued = 0, numblocked = 0;
+
+   if(!++soundgeneration)
+   {
+      // wrapped around; old marks could pass for new ones
+      memset(soundgen, 0, numsectors * sizeof(unsigned int));
+      soundgeneration = 1;
+   }
+
+   P_soundReach(start, 0, numqueued, numblocked);
+
+   // everything that can be reached without crossing a sound-blocking line
+   for(int i = 0; i < numqueued; i++)
+      P_soundSpread(soundqueue[i], numqueued, numblocked);
+
+   // then what is behind one; some of these were reached the other way since
+   for(int i = 0; i < numblocked; i++)
+   {
+      if(soundlevel[soundblocked[i]])
+         P_soundSpread(soundblocked[i], numqueued, numblocked);
+   }
+
+   for(int i = 0; i < numqueued; i++)
+   {
+      sector_t *sec = &sectors[soundqueue[i]];
+
+      sec->validcount     = validcount;
+      sec->soundtraversed = 1;
+      P_SetTarget<Mobj>(&sec->soundtarget, soundtarget);
+   }
+
+   for(int i = 0; i < numblocked; i++)
+   {
+      sector_t *sec = &sectors[soundblocked[i]];
+
+      if(!soundlevel[soundblocked[i]])
+         continue;
+
+      sec->validcount     = validcount;
+      sec->soundtraversed = 2;
+      P_SetTarget<Mobj>(&sec->soundtarget, soundtarget);
+   }
+}
+
 //
 // P_NoiseAlert
 //
@@ -184,7 +461,11 @@ static void P_RecursiveSound(sector_t *sec, int soundblocks,
 void P_NoiseAlert(Mobj *target, Mobj *emitter)
 {
    validcount++;
-   P_RecursiveSound(emitter->subsector->sector, 0, target);
+
+   if(soundfirst)
+      P_floodSound(emitter->subsector->sector, target);
+   else
+      P_RecursiveSound(emitter->subsector->sector, 0, target);
 }
 
 //
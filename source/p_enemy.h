@@ -62,6 +62,7 @@ void P_NewChaseDir(Mobj *actor);
 bool P_SmartMove(Mobj *actor);
 
 void P_NoiseAlert (Mobj *target, Mobj *emmiter);
+void P_BuildSoundGraph();     // sectors sound spreads between
 void P_SpawnBrainTargets();     // killough 3/26/98: spawn icon landings
 void P_SpawnSorcSpots();        // haleyjd 11/19/02: spawn dsparil spots
 
@@ -54,6 +54,7 @@
 #include "p_spec.h"
 #include "p_tick.h"
 #include "p_user.h"
+#include "polyobj.h"
 #include "r_defs.h"
 #include "r_main.h"
 #include "r_portal.h"
@@ -1252,7 +1253,7 @@ bool P_CheckPosition(Mobj *thing, fixed_t x, fixed_t y, PODCollection<line_t *>
    {
       for(by = yl; by <= yh; by++)
       {
-         if(!P_BlockThingsIterator(bx, by, PIT_CheckThing))
+         if(!P_BlockThingsIteratorBox(bx, by, R_NOGROUP, clip.bbox, PIT_CheckThing))
             return false;
       }
    }
@@ -2740,9 +2741,16 @@ bool P_CheckSector(sector_t *sector, int crunch, int amt, int floorOrCeil)
 // phares 3/21/98
 //
 // Maintain a freelist of msecnode_t's to reduce memory allocs and frees.
+//
+// New nodes are carved from large PU_LEVEL blocks, so that the nodes of
+// things created together sit together in memory.
+
+#define SECNODESPERSLAB 512
 
 msecnode_t *headsecnode = NULL;
 
+static ZoneSlabPool secnodepool(sizeof(msecnode_t), SECNODESPERSLAB, PU_LEVEL);
+
 // sf: fix annoying crash on restarting levels
 //
 //      This crash occurred because the msecnode_t's are allocated as
@@ -2770,6 +2778,7 @@ msecnode_t *headsecnode = NULL;
 void P_FreeSecNodeList(void)
 {
    headsecnode = NULL; // this is all thats needed to fix the bug
+   secnodepool.clear();
 }
 
 //
@@ -2786,7 +2795,7 @@ static msecnode_t *P_GetSecnode(void)
 
    return headsecnode ?
    node = headsecnode, headsecnode = node->m_snext, node :
-      (msecnode_t *)(Z_Malloc(sizeof *node, PU_LEVEL, NULL)); 
+      static_cast<msecnode_t *>(secnodepool.allocPlain());
 }
 
 //
@@ -3003,7 +3012,7 @@ static bool PIT_GetSectors(line_t *ld, polyobj_s *po, void *context)
 }
 
 //
-// P_CreateSecNodeList 
+// P_rebuildSecNodeList 
 //
 // phares 3/14/98
 // Alters/creates the sector_list that shows what sectors the object resides in.
@@ -3013,7 +3022,7 @@ static bool PIT_GetSectors(line_t *ld, polyobj_s *po, void *context)
 // haleyjd 04/16/2010: rewritten to use clip stack for saving global clipping
 // variables when required
 //
-msecnode_t *P_CreateSecNodeList(Mobj *thing, fixed_t x, fixed_t y)
+static msecnode_t *P_rebuildSecNodeList(Mobj *thing, fixed_t x, fixed_t y)
 {
    msecnode_t *node, *list;
 
@@ -3136,6 +3145,163 @@ msecnode_t *P_CreateSecNodeList(Mobj *thing, fixed_t x, fixed_t y)
    return list;
 }
 
+//
+// Sector list boxes
+//
+// A thing that touches no line only touches the sector it stands in. When a
+// rebuild finds that, it also looks for a box around the thing, SECNODEMARGIN
+// wider on each side, that no line crosses either. Until the thing leaves
+// that box, its list can't change, and rebuilding it is skipped.
+//
+// The box is checked with SECNODESLACK more on each side, to keep clear of
+// the rounding in P_PointOnLineSide. Polyobjects move their lines around, so
+// levels with any get no boxes, and neither do linked portals, which add
+// sectors from other groups, nor demos whose clipping state leaks out of
+// P_CreateSecNodeList.
+//
+
+#define SECNODEMARGIN (16*FRACUNIT)
+#define SECNODESLACK  (2*FRACUNIT)
+
+//
+// P_secNodeBoxesUsable
+//
+static bool P_secNodeBoxesUsable()
+{
+   return !numPolyObjects && (demo_version < 200 || demo_version >= 329) &&
+      !(useportalgroups && full_demo_version >= make_full_version(340, 48));
+}
+
+//
+// P_secNodeBoxClear
+//
+// True if no line in the blocks under the box crosses it. Goes through the
+// blocks itself, without touching validcount.
+//
+static bool P_secNodeBoxClear(const fixed_t *bbox)
+{
+   int xl = (bbox[BOXLEFT  ] - bmaporgx) >> MAPBLOCKSHIFT;
+   int xh = (bbox[BOXRIGHT ] - bmaporgx) >> MAPBLOCKSHIFT;
+   int yl = (bbox[BOXBOTTOM] - bmaporgy) >> MAPBLOCKSHIFT;
+   int yh = (bbox[BOXTOP   ] - bmaporgy) >> MAPBLOCKSHIFT;
+
+   for(int bx = emax(xl, 0); bx <= xh && bx < bmapwidth; bx++)
+   {
+      for(int by = emax(yl, 0); by <= yh && by < bmapheight; by++)
+      {
+         const int *list = blockmaplump + blockmap[by * bmapwidth + bx];
+
+         for(; *list != -1; list++)
+         {
+            const line_t *ld;
+
+            if(*list >= numlines)
+               continue;
+
+            ld = &lines[*list];
+
+            if(bbox[BOXRIGHT]  <= ld->bbox[BOXLEFT]   ||
+               bbox[BOXLEFT]   >= ld->bbox[BOXRIGHT]  ||
+               bbox[BOXTOP]    <= ld->bbox[BOXBOTTOM] ||
+               bbox[BOXBOTTOM] >= ld->bbox[BOXTOP])
+               continue;
+
+            if(P_BoxOnLineSide(bbox, ld) == -1)
+               return false;
+         }
+      }
+   }
+
+   return true;
+}
+
+//
+// P_setSecNodeBox
+//
+// Called after a rebuild. Finds the thing a box, if it can have one.
+//
+static void P_setSecNodeBox(Mobj *thing, fixed_t x, fixed_t y,
+                            const msecnode_t *list)
+{
+   fixed_t *box = thing->secnodebox;
+   fixed_t  test[4];
+
+   // nothing fits in this
+   box[BOXTOP]    = D_MININT;
+   box[BOXBOTTOM] = D_MAXINT;
+   box[BOXLEFT]   = D_MAXINT;
+   box[BOXRIGHT]  = D_MININT;
+
+   if(!P_secNodeBoxesUsable() || !list || list->m_tnext ||
+      list->m_sector != thing->subsector->sector)
+      return;
+
+   test[BOXTOP]    = y + thing->radius + SECNODEMARGIN + SECNODESLACK;
+   test[BOXBOTTOM] = y - thing->radius - SECNODEMARGIN - SECNODESLACK;
+   test[BOXRIGHT]  = x + thing->radius + SECNODEMARGIN + SECNODESLACK;
+   test[BOXLEFT]   = x - thing->radius - SECNODEMARGIN - SECNODESLACK;
+
+   if(!P_secNodeBoxClear(test))
+      return;
+
+   box[BOXTOP]    = y + thing->radius + SECNODEMARGIN;
+   box[BOXBOTTOM] = y - thing->radius - SECNODEMARGIN;
+   box[BOXRIGHT]  = x + thing->radius + SECNODEMARGIN;
+   box[BOXLEFT]   = x - thing->radius - SECNODEMARGIN;
+}
+
+//
+// P_secNodeListHolds
+//
+// True if the thing's list would come out of a rebuild at (x, y) unchanged.
+//
+static bool P_secNodeListHolds(const Mobj *thing, fixed_t x, fixed_t y)
+{
+   const msecnode_t *list = thing->old_sectorlist;
+   const fixed_t    *box  = thing->secnodebox;
+
+   return list && !list->m_tnext && list->m_sector == thing->subsector->sector &&
+      y + thing->radius <= box[BOXTOP]   && y - thing->radius >= box[BOXBOTTOM] &&
+      x + thing->radius <= box[BOXRIGHT] && x - thing->radius >= box[BOXLEFT]  &&
+      P_secNodeBoxesUsable();
+}
+
+//
+// P_CreateSecNodeList
+//
+// Returns the list of sectors the thing touches at (x, y), made from its
+// old_sectorlist. In RANGECHECK builds, every list that is not rebuilt
+// is checked against a rebuild.
+//
+msecnode_t *P_CreateSecNodeList(Mobj *thing, fixed_t x, fixed_t y)
+{
+   msecnode_t *list;
+
+   if(P_secNodeListHolds(thing, x, y))
+   {
+#ifdef RANGECHECK
+      msecnode_t *old = thing->old_sectorlist;
+
+      list = P_rebuildSecNodeList(thing, x, y);
+      if(list != old || list->m_tnext)
+      {
+         I_Error("P_CreateSecNodeList: sector list of a %s at (%d, %d) "
+                 "changed inside its box\n", thing->info->name,
+                 x >> FRACBITS, y >> FRACBITS);
+      }
+      return list;
+#else
+      validcount++; // as a rebuild would
+      return thing->old_sectorlist;
+#endif
+   }
+
+   list = P_rebuildSecNodeList(thing, x, y);
+   P_setSecNodeBox(thing, x, y, list);
+
+   return list;
+}
+
 //----------------------------------------------------------------------------
 //
 // $Log: p_map.c,v $
@@ -98,6 +98,18 @@ bool P_TeleportMoveStrict(Mobj *thing, fixed_t x, fixed_t y, bool boss);
 //
 
 bool P_CheckSight(Mobj *t1, Mobj *t2);
+
+// Counts changes to map geometry that can affect line of sight. Sight checks
+// prefetched for the thinkers are only used while it is unchanged.
+extern unsigned int sightgeneration;
+
+inline void P_SightChanged() { ++sightgeneration; }
+
+extern bool p_sightprefetch;
+
+void P_PrefetchSight();
+void P_EndSightPrefetch();
+
 void P_UseLines(player_t *player);
 
 // killough 8/2/98: add 'mask' argument to prevent friends autoaiming at others
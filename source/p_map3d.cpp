@@ -277,13 +277,20 @@ Mobj *P_GetThingUnder(Mobj *mo)
 //
 // ioanch 20160110: added optional groupid
 //
-static bool P_SBlockThingsIterator(int x, int y, bool (*func)(Mobj *), 
-                                   Mobj *actor, int groupid = R_NOGROUP)
+// If bbox is given, a search from the start only looks at things which may
+// touch it; see P_BlockThingsIteratorBox.
+//
+static bool P_SBlockThingsIterator(int x, int y, bool (*func)(Mobj *, void *), 
+                                   Mobj *actor, int groupid = R_NOGROUP,
+                                   const fixed_t *bbox = nullptr)
 {
    Mobj *mobj;
 
    if(x < 0 || y < 0 || x >= bmapwidth || y >= bmapheight)
       return true;
+
+   if(actor == NULL && bbox)
+      return P_BlockThingsIteratorBox(x, y, groupid, bbox, func);
    
    if(actor == NULL)
       mobj = blocklinks[y * bmapwidth + x];
@@ -297,7 +304,7 @@ static bool P_SBlockThingsIterator(int x, int y, bool (*func)(Mobj *),
       {
          continue;
       }
-      if(!func(mobj))
+      if(!func(mobj, nullptr))
          return false;
    }
    
@@ -314,7 +321,7 @@ extern bool P_SkullHit(Mobj *thing);
 //
 // PIT_CheckThing3D
 // 
-static bool PIT_CheckThing3D(Mobj *thing) // killough 3/26/98: make static
+static bool PIT_CheckThing3D(Mobj *thing, void *context) // killough 3/26/98: make static
 {
    fixed_t topz;      // haleyjd: from zdoom
    fixed_t blockdist;
@@ -678,7 +685,11 @@ bool P_CheckPosition3D(Mobj *thing, fixed_t x, fixed_t y, PODCollection<line_t *
 
          do
          {
-            if(!P_SBlockThingsIterator(x, y, PIT_CheckThing3D, robin, groupid))
+            // things in other groups are offset from clip.bbox
+            const fixed_t *box = groupid == R_NOGROUP || 
+                                 groupid == thing->groupid ? clip.bbox : nullptr;
+
+            if(!P_SBlockThingsIterator(x, y, PIT_CheckThing3D, robin, groupid, box))
             { 
                // [RH] If a thing can be stepped up on, we need to continue checking
                // other things in the blocks and see if we hit something that is
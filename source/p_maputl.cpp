@@ -31,6 +31,7 @@
 #include "doomstat.h"
 #include "e_exdata.h"
 #include "m_bbox.h"
+#include "m_compare.h"
 #include "p_map.h"
 #include "p_map3d.h"
 #include "p_maputl.h"
@@ -518,6 +519,10 @@ void P_LogThingPosition(Mobj *mo, const char *caller)
 #define P_LogThingPosition(a, b)
 #endif
 
+// Counts changes to the thing links of the blockmap; also orders the things
+// of each thing cell.
+static uint64_t thinglinkseq;
+
 //
 // P_UnsetThingPosition
 // Unlinks a thing from block map and sectors.
@@ -573,6 +578,12 @@ void P_UnsetThingPosition(Mobj *thing)
       Mobj *bnext, **bprev = thing->bprev;
       if(bprev && (*bprev = bnext = thing->bnext))  // unlink from block map
          bnext->bprev = bprev;
+
+      Mobj *fnext, **fprev = thing->fprev;
+      if(fprev && (*fprev = fnext = thing->fnext))  // and from its thing cell
+         fnext->fprev = fprev;
+
+      ++thinglinkseq;
    }
 }
 
@@ -644,11 +655,33 @@ void P_SetThingPosition(Mobj *thing)
             bnext->bprev = &thing->bnext;
          thing->bprev = link;
          *link = thing;
+
+         // link into the thing cell of the block as well
+         int cellx = (thing->x - bmaporgx) >> THINGCELLSHIFT;
+         int celly = (thing->y - bmaporgy) >> THINGCELLSHIFT;
+
+         link = &thingcells[celly * thingcellwidth + cellx];
+         if((thing->fnext = *link))
+            thing->fnext->fprev = &thing->fnext;
+         thing->fprev = link;
+         *link = thing;
+
+         thing->linkseq = ++thinglinkseq;
+
+         // things in cells outside a query's box are only known not to touch
+         // it while no thing is larger than this; P_LoadBlockMap seeds it
+         // from mobjinfo, so this only catches radii set from elsewhere,
+         // such as a savegame
+         fixed_t radius = emax(thing->radius, thing->info->radius);
+         if(radius > maxthingradius)
+            maxthingradius = radius;
       }
       else        // thing is off the map
       {
          thing->bnext = NULL;
          thing->bprev = NULL;
+         thing->fnext = NULL;
+         thing->fprev = NULL;
       }
    }
 }
@@ -814,6 +847,103 @@ bool P_BlockThingsIterator(int x, int y, int groupid, bool (*func)(Mobj *, void
    return true;
 }
 
+//
+// P_blockThingsFrom
+//
+// The rest of P_BlockThingsIterator's walk through a block, from mobj on.
+//
+static bool P_blockThingsFrom(Mobj *mobj, int groupid,
+                              bool (*func)(Mobj *, void *), void *context)
+{
+   for(; mobj; mobj = mobj->bnext)
+   {
+      if(groupid != R_NOGROUP && mobj->groupid != R_NOGROUP && 
+         groupid != mobj->groupid)
+      {
+         continue;   // ignore objects from wrong groupid
+      }
+      if(!func(mobj, context))
+         return false;
+   }
+   return true;
+}
+
+//
+// P_BlockThingsIteratorBox
+//
+// Like P_BlockThingsIterator, but only calls func for the things of the block
+// which may touch bbox, given in the coordinates of the block's things. The
+// rest are those a query like PIT_CheckThing turns down first thing, without
+// doing anything else, so func must be such a function.
+//
+// Only the thing cells of the block near bbox are walked, but merged so that
+// things come in the same order as in the block. If func links or unlinks any
+// thing, the rest of the block is walked just as P_BlockThingsIterator would.
+// Old demos always walk the whole block, since a thing may have been moved
+// out of its cell without being relinked (see P_CheckMissileSpawn).
+//
+bool P_BlockThingsIteratorBox(int x, int y, int groupid, const fixed_t *bbox,
+                              bool (*func)(Mobj *, void *), void *context)
+{
+   if(x < 0 || y < 0 || x >= bmapwidth || y >= bmapheight)
+      return true;
+
+   if(full_demo_version < make_full_version(401, 1))
+      return P_BlockThingsIterator(x, y, groupid, func, context);
+
+   // the thing cells of this block which things touching bbox may be in
+   int cx = x << THINGCELLBLOCKBITS;
+   int cy = y << THINGCELLBLOCKBITS;
+   int xl = emax((bbox[BOXLEFT]   - bmaporgx - maxthingradius) >> THINGCELLSHIFT, cx);
+   int xh = emin((bbox[BOXRIGHT]  - bmaporgx + maxthingradius) >> THINGCELLSHIFT,
+                 cx + THINGCELLSPERBLOCK - 1);
+   int yl = emax((bbox[BOXBOTTOM] - bmaporgy - maxthingradius) >> THINGCELLSHIFT, cy);
+   int yh = emin((bbox[BOXTOP]    - bmaporgy + maxthingradius) >> THINGCELLSHIFT,
+                 cy + THINGCELLSPERBLOCK - 1);
+
+   Mobj *heads[THINGCELLSPERBLOCK * THINGCELLSPERBLOCK];
+   int   numheads = 0;
+
+   for(int celly = yl; celly <= yh; celly++)
+   {
+      for(int cellx = xl; cellx <= xh; cellx++)
+      {
+         if(Mobj *mobj = thingcells[celly * thingcellwidth + cellx])
+            heads[numheads++] = mobj;
+      }
+   }
+
+   uint64_t startseq = thinglinkseq;
+
+   while(numheads)
+   {
+      // the newest link of all the cells is the next one in the block
+      int best = 0;
+      for(int i = 1; i < numheads; i++)
+      {
+         if(heads[i]->linkseq > heads[best]->linkseq)
+            best = i;
+      }
+
+      Mobj *mobj = heads[best];
+      if(!(heads[best] = mobj->fnext))
+         heads[best] = heads[--numheads];
+
+      if(groupid != R_NOGROUP && mobj->groupid != R_NOGROUP && 
+         groupid != mobj->groupid)
+      {
+         continue;   // ignore objects from wrong groupid
+      }
+      if(!func(mobj, context))
+         return false;
+
+      if(thinglinkseq != startseq)
+         return P_blockThingsFrom(mobj->bnext, groupid, func, context);
+   }
+
+   return true;
+}
+
 //
 // P_PointToAngle
 //
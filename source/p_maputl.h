@@ -43,6 +43,12 @@ struct subsector_t;
 #define MAPBMASK        (MAPBLOCKSIZE-1)
 #define MAPBTOFRAC      (MAPBLOCKSHIFT-FRACBITS)
 
+// things are also linked into a finer grid of thing cells, 32 units across;
+// this is part of demo sync, so don't change it without a version check
+#define THINGCELLSHIFT    (FRACBITS+5)
+#define THINGCELLBLOCKBITS (MAPBLOCKSHIFT-THINGCELLSHIFT)
+#define THINGCELLSPERBLOCK (1 << THINGCELLBLOCKBITS)
+
 #define PT_ADDLINES     1
 #define PT_ADDTHINGS    2
 #define PT_EARLYOUT     4
@@ -128,6 +134,9 @@ inline static bool P_BlockThingsIterator(int x, int y, bool func(Mobj *, void *)
    // ioanch 20160108: avoid code duplication
    return P_BlockThingsIterator(x, y, R_NOGROUP, func, context);
 }
+bool P_BlockThingsIteratorBox(int x, int y, int groupid, const fixed_t *bbox,
+                              bool (*func)(Mobj *, void *),
+                              void *context = nullptr);
 bool ThingIsOnLine(const Mobj *t, const line_t *l);  // killough 3/15/98
 bool P_PathTraverse(fixed_t x1, fixed_t y1, fixed_t x2, fixed_t y2,
                     int flags, traverser_t trav, void *context = nullptr);
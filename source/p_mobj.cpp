@@ -46,6 +46,7 @@
 #include "hu_stuff.h"
 #include "info.h"
 #include "in_lude.h"
+#include "m_argv.h"
 #include "m_bbox.h"
 #include "m_collection.h"
 #include "m_random.h"
@@ -1823,6 +1824,65 @@ int Mobj::getModifiedSpawnHealth() const
    return (abs(spawnpoint.healthModifier) + (FRACUNIT >> 1)) >> FRACBITS;
 }
 
+//=============================================================================
+//
+// Mobj Allocation
+//
+// Mobjs are spawned and removed far more than any other thinker, so rather
+// than each getting its own zone block, they are packed into large PU_LEVEL
+// blocks and freed ones are reused. This keeps the things of a level close
+// together in memory for the thinkers, blockmap searches and sprite setup
+// which walk through them. -nomobjpool gives each its own block again, to
+// compare the two with -timedemo or -bench.
+//
+
+#define MOBJSPERSLAB 256
+
+static ZoneSlabPool mobjpool(sizeof(Mobj), MOBJSPERSLAB, PU_LEVEL);
+static bool         nomobjpool;
+
+//
+// P_InitMobjPool
+//
+// Called once at startup, before any Mobj exists.
+//
+void P_InitMobjPool()
+{
+   nomobjpool = !!M_CheckParm("-nomobjpool");
+}
+
+//
+// P_ClearMobjPool
+//
+// Called after Z_FreeTags has freed the level, and the pool's blocks with it.
+//
+void P_ClearMobjPool()
+{
+   mobjpool.clear();
+}
+
+//
+// Mobj::operator new
+//
+void *Mobj::operator new (size_t size)
+{
+   if(nomobjpool || size != sizeof(Mobj))
+      return ZoneObject::operator new(size, PU_LEVEL);
+
+   return mobjpool.alloc();
+}
+
+//
+// Mobj::operator delete
+//
+void Mobj::operator delete (void *p, size_t size)
+{
+   if(nomobjpool || size != sizeof(Mobj))
+      ZoneObject::operator delete(p);
+   else
+      mobjpool.free(p);
+}
+
 extern fixed_t tmsecfloorz;
 extern fixed_t tmsecceilz;
 
@@ -229,31 +229,32 @@ public:
    void backupPosition();
    void copyPosition(const Mobj *other);
    int getModifiedSpawnHealth() const;
+
+   // Mobjs are allocated from a pool, see P_InitMobjPool
+   void *operator new (size_t size);
+   void  operator delete (void *p, size_t size);
    
    // Data members
 
+   // The fields read most often, by the thinkers, blockmap iterators and
+   // sprite setup, come first so they share cache lines; keep it that way.
+
    // More list: links in sector (if needed)
    Mobj  *snext;
    Mobj **sprev; // killough 8/10/98: change to ptr-to-ptr
 
-   // ioanch 20160109: sprite projection chains
-   DLListItem<spriteprojnode_t> *spriteproj;
-   sprojlast_t sprojlast; // coordinates after last check. Initially "invalid"
-
-   //More drawing info: to determine current sprite.
-   angle_t     angle;  // orientation
-   spritenum_t sprite; // used to find patch_t and flip value
-   int         frame;  // might be ORed with FF_FULLBRIGHT
-
    // Interaction info, by BLOCKMAP.
    // Links in blocks (if needed).
    Mobj  *bnext;
    Mobj **bprev; // killough 8/11/98: change to ptr-to-ptr
 
-   subsector_t *subsector;
+   // Links in the thing cell of the block, and when they were made; newer
+   // links come first, in the cell as in the block.
+   Mobj    *fnext;
+   Mobj   **fprev;
+   uint64_t linkseq;
 
-   // The closest interval over all contacted Sectors.
-   zrefs_t zref;
+   subsector_t *subsector;
 
    // For movement checking.
    fixed_t radius;
@@ -264,12 +265,34 @@ public:
    fixed_t momy;
    fixed_t momz;
 
-   // If == validcount, already checked.
-   int validcount;
+   unsigned int  flags;
+   unsigned int  flags2;    // haleyjd 04/09/99: I know, kill me now
+   unsigned int  flags3;    // haleyjd 11/03/02
+   unsigned int  flags4;    // haleyjd 09/13/09
+   int           intflags;  // killough 9/15/98: internal flags
+   int           health;
 
    mobjtype_t  type;
    mobjinfo_t *info;   // mobjinfo[mobj->type]
 
+   int           tics;   // state tic counter
+   state_t      *state;
+
+   // If == validcount, already checked.
+   int validcount;
+
+   //More drawing info: to determine current sprite.
+   angle_t     angle;  // orientation
+   spritenum_t sprite; // used to find patch_t and flip value
+   int         frame;  // might be ORed with FF_FULLBRIGHT
+
+   // The closest interval over all contacted Sectors.
+   zrefs_t zref;
+
+   // ioanch 20160109: sprite projection chains
+   DLListItem<spriteprojnode_t> *spriteproj;
+   sprojlast_t sprojlast; // coordinates after last check. Initially "invalid"
+
    int colour; // sf: the sprite colour
    int tranmap;   // the translucency map
 
@@ -279,15 +302,6 @@ public:
       int            bfgcount;
    } extradata;
 
-   int           tics;   // state tic counter
-   state_t      *state;
-   unsigned int  flags;
-   unsigned int  flags2;    // haleyjd 04/09/99: I know, kill me now
-   unsigned int  flags3;    // haleyjd 11/03/02
-   unsigned int  flags4;    // haleyjd 09/13/09
-   int           intflags;  // killough 9/15/98: internal flags
-   int           health;
-
    // Movement direction, movement generation (zig-zagging).
    int16_t movedir;        // 0-7
    int16_t movecount;      // when 0, select a new dir
@@ -336,6 +350,7 @@ public:
    // a linked list of sectors where this object appears
    msecnode_t *touching_sectorlist;                 // phares 3/14/98
    msecnode_t *old_sectorlist;                      // haleyjd 04/16/10
+   fixed_t     secnodebox[4]; // sector list holds while in here; see p_map.cpp
 
    // SEE WARNING ABOVE ABOUT POINTER FIELDS!!!
 
@@ -420,6 +435,8 @@ enum bloodaction_e : int
    NUMBLOODACTIONS
 };
 
+void  P_InitMobjPool();
+void  P_ClearMobjPool();
 void  P_RespawnSpecials();
 Mobj *P_SpawnMobj(fixed_t x, fixed_t y, fixed_t z, mobjtype_t type);
 bool  P_SetMobjState(Mobj *mobj, statenum_t state);
@@ -32,6 +32,7 @@
 #include "ev_specials.h"
 #include "p_chase.h"
 #include "polyobj.h"
+#include "p_map.h"
 #include "p_portal.h"
 #include "p_portalblockmap.h"
 #include "p_setup.h"
@@ -997,6 +998,11 @@ void P_CheckCPortalState(sector_t *sec)
 {
    bool     obscured;
    
+   // called for every height change, so sight checks made so far are stale,
+   // and so are the sound graph's openings of the sector's lines
+   P_SightChanged();
+   ++sec->soundstamp;
+
    if(!sec->c_portal)
    {
       sec->c_pflags = 0;
@@ -1014,6 +1020,9 @@ void P_CheckFPortalState(sector_t *sec)
 {
    bool     obscured;
    
+   P_SightChanged();
+   ++sec->soundstamp;
+
    if(!sec->f_portal)
    {
       sec->f_pflags = 0;
@@ -1029,6 +1038,8 @@ void P_CheckFPortalState(sector_t *sec)
 
 void P_CheckLPortalState(line_t *line)
 {
+   P_SightChanged();
+
    if(!line->portal)
    {
       line->pflags = 0;
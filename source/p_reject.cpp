@@ -0,0 +1,332 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// Copyright (C) 2013 James Haley et al.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+// Additional terms and conditions compatible with the GPLv3 apply. See the
+// file COPYING-EE for details.
+//
+//--------------------------------------------------------------------------
+//
+//
+// DESCRIPTION:
+//      Building a REJECT for levels that come without a useful one.
+//
+//      Most node builders leave REJECT empty, so P_CheckSight never gets to
+//      turn a check down without tracing it. With p_buildreject on, such a
+//      REJECT is replaced when the level loads: one sector is marked as
+//      unable to see another when no subsector of either is in the other's
+//      potentially visible set (see r_pvs.cpp). The sets only go by walls,
+//      so the REJECT stays true however the sectors move, and a check it
+//      turns down would have failed anyway.
+//
+//      Sectors are worked out on worker threads, and the result is cached in
+//      the user's game directory, named after a hash of the level.
+//
+//-----------------------------------------------------------------------------
+
+#include "z_zone.h"
+
+#include "../zlib/zlib.h"
+
+#include "hal/i_directory.h"
+#include "c_io.h"
+#include "c_runcmd.h"
+#include "doomstat.h"
+#include "m_hash.h"
+#include "m_qstr.h"
+#include "m_threads.h"
+#include "r_defs.h"
+#include "p_portal.h"
+#include "p_reject.h"
+#include "p_setup.h"
+#include "r_pvs.h"
+#include "r_state.h"
+#include "v_misc.h"
+
+#define REJECT_VERSION 1 // change whenever built REJECTs would change
+
+bool p_buildreject;
+
+struct rejectbuild_t
+{
+   const byte *rows;       // subsector sets
+   int         rowbytes;
+   const int  *leafsector; // sector of each subsector
+   const int  *firstleaf;  // numsectors + 1 indices into leaves
+   const int  *leaves;     // subsectors by sector
+   byte       *seen;       // numsectors rows of seenbytes
+   int         seenbytes;
+};
+
+//
+// P_rejectSector
+//
+// Marks the sectors that one sector might see. Runs on the worker threads,
+// so it must not touch the zone heap.
+//
+static void P_rejectSector(int sector, void *data)
+{
+   const rejectbuild_t &build = *static_cast<const rejectbuild_t *>(data);
+   byte *seen = build.seen + size_t(sector) * build.seenbytes;
+
+   for(int i = build.firstleaf[sector]; i < build.firstleaf[sector + 1]; i++)
+   {
+      const byte *row = build.rows + size_t(build.leaves[i]) * build.rowbytes;
+
+      for(int b = 0; b < build.rowbytes; b++)
+      {
+         for(int bits = row[b]; bits; bits &= bits - 1)
+         {
+            int bit = 0;
+
+            while(!(bits & (1 << bit)))
+               ++bit;
+
+            int other = build.leafsector[b * 8 + bit];
+            seen[other >> 3] |= 1 << (other & 7);
+         }
+      }
+   }
+}
+
+//
+// P_rejectCompute
+//
+// Builds the REJECT from the subsector sets. Returns false if the level has
+// none.
+//
+static bool P_rejectCompute(byte *reject)
+{
+   const byte *rows;
+   byte       *ownrows = NULL;
+   rejectbuild_t build;
+
+   if(!(rows = R_PVSRows()) && !(rows = ownrows = R_PVSMakeRows()))
+      return false;
+
+   int *leafsector = ecalloc(int *, numsubsectors, sizeof(int));
+   int *firstleaf  = ecalloc(int *, numsectors + 1, sizeof(int));
+   int *nextleaf   = ecalloc(int *, numsectors, sizeof(int));
+   int *leaves     = ecalloc(int *, numsubsectors, sizeof(int));
+
+   // sort the subsectors by sector
+   for(int i = 0; i < numsubsectors; i++)
+   {
+      leafsector[i] = eindex(subsectors[i].sector - sectors);
+      ++firstleaf[leafsector[i] + 1];
+   }
+   for(int i = 0; i < numsectors; i++)
+   {
+      firstleaf[i + 1] += firstleaf[i];
+      nextleaf[i] = firstleaf[i];
+   }
+   for(int i = 0; i < numsubsectors; i++)
+      leaves[nextleaf[leafsector[i]]++] = i;
+
+   build.rows       = rows;
+   build.rowbytes   = (numsubsectors + 7) / 8;
+   build.leafsector = leafsector;
+   build.firstleaf  = firstleaf;
+   build.leaves     = leaves;
+   build.seenbytes  = (numsectors + 7) / 8;
+   build.seen       = ecalloc(byte *, numsectors, build.seenbytes);
+
+   WorkerPool pool;
+   pool.setNumThreads(M_NumCPUs() - 1);
+   pool.run(numsectors, P_rejectSector, &build);
+
+   // REJECT rows run on from each other without padding, so they are put
+   // together here rather than on the workers
+   for(int s1 = 0; s1 < numsectors; s1++)
+   {
+      const byte *seen = build.seen + size_t(s1) * build.seenbytes;
+
+      for(int s2 = 0; s2 < numsectors; s2++)
+      {
+         // sight goes both ways, so a pair is only turned down if neither
+         // can see the other
+         size_t pnum = size_t(s1) * numsectors + s2;
+         const byte *back = build.seen + size_t(s2) * build.seenbytes;
+
+         if(!(seen[s2 >> 3] & (1 << (s2 & 7))) &&
+            !(back[s1 >> 3] & (1 << (s1 & 7))))
+            reject[pnum >> 3] |= 1 << (pnum & 7);
+      }
+   }
+
+   efree(build.seen);
+   efree(leafsector);
+   efree(firstleaf);
+   efree(nextleaf);
+   efree(leaves);
+   if(ownrows)
+      efree(ownrows);
+
+   return true;
+}
+
+//=============================================================================
+//
+// Cache
+//
+
+struct rejectcacheheader_t
+{
+   char     magic[4];
+   int32_t  version;
+   int32_t  numsectors;
+   uint32_t size;     // of the compressed REJECT that follows
+};
+
+//
+// P_rejectCachePath
+//
+// The REJECT depends on the subsector sets and on which sector each
+// subsector is in.
+//
+static void P_rejectCachePath(qstring &path)
+{
+   HashData hash(HashData::SHA1);
+   int32_t  header[2] = { REJECT_VERSION, numsectors };
+   char    *digest;
+
+   R_PVSHashLevel(hash);
+   hash.addData(reinterpret_cast<const uint8_t *>(header), sizeof(header));
+   for(int i = 0; i < numsubsectors; i++)
+   {
+      int32_t sector = eindex(subsectors[i].sector - sectors);
+      hash.addData(reinterpret_cast<const uint8_t *>(&sector), sizeof(sector));
+   }
+   hash.wrapUp();
+   digest = hash.digestToString();
+
+   path = usergamepath;
+   path.pathConcatenate("cache");
+   I_CreateDirectory(path);
+   path.pathConcatenate(digest);
+   path += ".rej";
+
+   efree(digest);
+}
+
+//
+// P_rejectReadCache
+//
+static bool P_rejectReadCache(const char *filename, byte *reject, size_t size)
+{
+   rejectcacheheader_t header;
+   FILE *f;
+   bool  ok = false;
+
+   if(!(f = fopen(filename, "rb")))
+      return false;
+
+   if(fread(&header, sizeof(header), 1, f) == 1 &&
+      !memcmp(header.magic, "EREJ", 4) && header.version == REJECT_VERSION &&
+      header.numsectors == numsectors)
+   {
+      byte *data = emalloc(byte *, header.size);
+      uLongf destsize = uLongf(size);
+
+      ok = (fread(data, header.size, 1, f) == 1 &&
+            uncompress(reject, &destsize, data, header.size) == Z_OK &&
+            destsize == size);
+      efree(data);
+   }
+
+   fclose(f);
+   return ok;
+}
+
+//
+// P_rejectWriteCache
+//
+static void P_rejectWriteCache(const char *filename, const byte *reject,
+                               size_t size)
+{
+   rejectcacheheader_t header = { { 'E', 'R', 'E', 'J' }, REJECT_VERSION, numsectors, 0 };
+   uLongf compsize = compressBound(uLong(size));
+   byte  *data     = emalloc(byte *, compsize);
+   FILE  *f;
+
+   if(compress2(data, &compsize, reject, uLong(size), Z_BEST_SPEED) == Z_OK &&
+      (f = fopen(filename, "wb")))
+   {
+      header.size = uint32_t(compsize);
+      if(fwrite(&header, sizeof(header), 1, f) != 1 ||
+         fwrite(data, compsize, 1, f) != 1)
+         C_Printf(FC_ERROR "Couldn't write REJECT cache %s\n", filename);
+      fclose(f);
+   }
+
+   efree(data);
+}
+
+//=============================================================================
+//
+// Interface
+//
+
+//
+// P_BuildReject
+//
+// Called from P_SetupLevel once the PVS is built. If p_buildreject is on and
+// the level's REJECT turns nothing down, puts a built one in its place.
+//
+void P_BuildReject()
+{
+   size_t size = size_t(numsectors) * numsectors;
+
+   size = ((size + 7) & ~7) / 8;
+
+   // demos and netgames play with the level's own REJECT, whatever it is
+   if(!p_buildreject || demoplayback || demorecording || netgame)
+      return;
+
+   // sight through portals goes where the walls don't lead
+   if(useportalgroups || gMapHasSectorPortals || gMapHasLinePortals)
+      return;
+
+   for(size_t i = 0; i < size; i++)
+   {
+      if(rejectmatrix[i])
+         return;
+   }
+
+   byte   *reject = static_cast<byte *>(Z_Calloc(1, size, PU_LEVEL, NULL));
+   qstring path;
+
+   P_rejectCachePath(path);
+
+   if(!P_rejectReadCache(path.constPtr(), reject, size))
+   {
+      if(!P_rejectCompute(reject))
+      {
+         Z_Free(reject);
+         return;
+      }
+      P_rejectWriteCache(path.constPtr(), reject, size);
+   }
+
+   rejectmatrix = reject;
+}
+
+VARIABLE_TOGGLE(p_buildreject, NULL, onoff);
+CONSOLE_VARIABLE(p_buildreject, p_buildreject, 0) {}
+
+// EOF
+
@@ -46,6 +46,7 @@
 #include "m_buffer.h"
 #include "m_random.h"
 #include "p_info.h"
+#include "p_map.h"
 #include "p_maputl.h"
 #include "p_spec.h"
 #include "p_tick.h"
@@ -1596,6 +1597,9 @@ void P_LoadGame(const char *filename)
 
       P_FreeThinkerTable();
 
+      // the map is not what any sight checks were made against
+      P_SightChanged();
+
       uint8_t cmarker;
       arc << cmarker;
       if(cmarker != 0xE6)
@@ -43,10 +43,12 @@
 #include "e_udmf.h"  // IOANCH 20151206: UDMF
 #include "ev_specials.h"
 #include "g_demolog.h"
+#include "g_demosync.h"
 #include "g_game.h"
 #include "hu_frags.h"
 #include "hu_stuff.h"
 #include "in_lude.h"
+#include "info.h"
 #include "m_argv.h"
 #include "m_bbox.h"
 #include "m_binary.h"
@@ -60,6 +62,7 @@
 #include "p_mobjcol.h"
 #include "p_partcl.h"
 #include "p_portal.h"
+#include "p_reject.h"
 #include "p_scroll.h"
 #include "p_setup.h"
 #include "p_skin.h"
@@ -71,6 +74,7 @@
 #include "r_defs.h"
 #include "r_dynseg.h"
 #include "r_main.h"
+#include "r_pvs.h"
 #include "r_sky.h"
 #include "r_things.h"
 #include "s_musinfo.h"
@@ -174,6 +178,9 @@ int       *blockmaplump;          // was short -- killough
 fixed_t   bmaporgx, bmaporgy;     // origin of block map
 
 Mobj    **blocklinks;             // for thing chains
+Mobj    **thingcells;             // thing chains of the finer grid
+int       thingcellwidth;         // in thing cells
+fixed_t   maxthingradius;         // largest radius a linked thing may have
 
 byte     *portalmap;              // haleyjd: for portals
 
@@ -2729,6 +2736,22 @@ static void P_LoadBlockMap(int lump)
    blocklinks = ecalloctag(Mobj **, 1, count, PU_LEVEL, NULL);
    blockmap   = blockmaplump + 4;
 
+   // each block is split into THINGCELLSPERBLOCK squared thing cells
+   thingcellwidth = bmapwidth << THINGCELLBLOCKBITS;
+   count          = sizeof(*thingcells) * bmapwidth * bmapheight *
+                    THINGCELLSPERBLOCK * THINGCELLSPERBLOCK;
+   thingcells     = ecalloctag(Mobj **, 1, count, PU_LEVEL, NULL);
+
+   // seed the thing cell margin with the largest radius any thing type can
+   // have, so that code changing a thing's radius between relinks can't
+   // leave it outside the cells a query scans
+   maxthingradius = 0;
+   for(int i = 0; i < NUMMOBJTYPES; i++)
+   {
+      if(mobjinfo[i]->radius > maxthingradius)
+         maxthingradius = mobjinfo[i]->radius;
+   }
+
    // haleyjd 2/22/06: setup polyobject blockmap
    count = sizeof(*polyblocklinks) * bmapwidth * bmapheight;
    polyblocklinks = ecalloctag(DLListItem<polymaplink_t> **, 1, count, PU_LEVEL, NULL);
@@ -3016,6 +3039,7 @@ static void P_padRejectArray(byte *array, unsigned int len)
 // zeroes. This is preferable to adding checks to see if a reject
 // matrix exists, in my opinion. This could be improved by actually
 // generating a meaningful reject, but that will have to wait.
+// (It no longer has to; see P_BuildReject.)
 //
 static void P_LoadReject(int lump)
 {
@@ -3239,6 +3263,39 @@ int P_CheckLevelName(WadDirectory *dir, const char *mapname)
       P_CheckLevel(dir, lumpnum) : LEVEL_FORMAT_INVALID);
 }
 
+//
+// P_PrefetchLevel
+//
+// Queues the lumps of a level to be read on the I/O thread while something
+// else goes on, such as the intermission before it, so that P_SetupLevel finds
+// them read.
+//
+void P_PrefetchLevel(WadDirectory *dir, const char *mapname)
+{
+   int  lumpnum, format, count;
+   bool isUdmf;
+
+   if((lumpnum = dir->checkNumForName(mapname)) < 0 ||
+      (format = P_CheckLevel(dir, lumpnum, nullptr, &isUdmf)) == LEVEL_FORMAT_INVALID)
+      return;
+
+   if(isUdmf)
+   {
+      lumpinfo_t **lumpinfo = dir->getLumpInfo();
+
+      // P_CheckLevel found ENDMAP already
+      for(count = 2; strncmp(lumpinfo[lumpnum + count - 1]->name, "ENDMAP", 8); count++)
+         ;
+   }
+   else
+   {
+      // BEHAVIOR, or LEAFS for console maps, comes last
+      count = format == LEVEL_FORMAT_DOOM ? ML_BEHAVIOR : ML_BEHAVIOR + 1;
+   }
+
+   dir->prefetchLumpRange(lumpnum, count);
+}
+
 //
 // P_CheckLevelMapNum
 //
@@ -3397,6 +3454,12 @@ static void P_InitNewLevel(int lumpnum, WadDirectory *waddir)
 
    // re-initialize thinker list
    Thinker::InitThinkers();   
+
+   // the Mobj pool's blocks were freed with the old level
+   P_ClearMobjPool();
+
+   // sight checks made on the old level mean nothing on this one
+   P_SightChanged();
    
    // haleyjd 02/02/04 -- clear the TID hash table
    P_InitTIDHash();     
@@ -3516,6 +3579,7 @@ void P_SetupLevel(WadDirectory *dir, const char *mapname, int playermask,
 
    G_DemoLog("%d\tSetup %s\n", gametic, mapname);
    G_DemoLogSetExited(false);
+   G_DemoSyncNewLevel();
 
    // haleyjd 07/28/10: we are no longer in GS_LEVEL during the execution of
    // this routine.
@@ -3759,9 +3823,18 @@ void P_SetupLevel(WadDirectory *dir, const char *mapname, int playermask,
    // SoM: Deferred specials that need to be spawned after P_SpawnSpecials
    P_SpawnDeferredSpecials(setupSettings);
 
+   // sector adjacency for noise alerts; specials can make lines two-sided
+   P_BuildSoundGraph();
+
    // haleyjd
    P_InitLightning();
 
+   // potentially visible sets for the renderer; needs polyobjects set up
+   R_PVSBuild();
+
+   // a REJECT for levels built without one; goes by the PVS
+   P_BuildReject();
+
    // preload graphics
    if(precache)
       R_PrecacheLevel();
@@ -3789,6 +3862,9 @@ void P_SetupLevel(WadDirectory *dir, const char *mapname, int playermask,
       acslumpnum = setupwad->checkNumForNameNSG(LevelInfo.acsScriptLump, lumpinfo_t::ns_acs);
 
    ACS_LoadLevelScript(dir, acslumpnum);
+
+   // whatever was read ahead for the level and not used is left to the cache
+   W_ClaimPrefetches();
 }
 
 //
@@ -3796,6 +3872,7 @@ void P_SetupLevel(WadDirectory *dir, const char *mapname, int playermask,
 //
 void P_Init()
 {
+   P_InitMobjPool();
    P_InitParticleEffects();  // haleyjd 09/30/01
    P_InitSwitchList();
    P_InitPicAnims();
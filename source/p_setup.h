@@ -53,6 +53,7 @@ int P_CheckLevel(WadDirectory *dir, int lumpnum,
                  maplumpindex_t *mgla = nullptr, bool *udmf = nullptr);
 int P_CheckLevelName(WadDirectory *dir, const char *mapname);
 int P_CheckLevelMapNum(WadDirectory *dir, int mapnum);
+void P_PrefetchLevel(WadDirectory *dir, const char *mapname);
 
 void P_SetupLevel(WadDirectory *dir, const char *mapname, int playermask, skill_t skill);
 void P_Init();                   // Called by startup code.
@@ -84,6 +85,9 @@ extern int      bmapheight;      // in mapblocks
 extern fixed_t  bmaporgx;
 extern fixed_t  bmaporgy;        // origin of block map
 extern Mobj   **blocklinks;      // for thing chains
+extern Mobj   **thingcells;      // thing chains of the finer grid
+extern int      thingcellwidth;  // in thing cells
+extern fixed_t  maxthingradius;  // largest radius a linked thing may have
 extern byte    *portalmap;       // haleyjd: for fast linked portal checks
 extern bool     skipblstart;     // MaxW: Skip initial blocklist short
 
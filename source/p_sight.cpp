@@ -26,12 +26,20 @@
 #include "z_zone.h"
 #include "i_system.h"
 
+#include "a_common.h"
+#include "c_runcmd.h"
 #include "cam_sight.h"
+#include "d_player.h"
 #include "doomstat.h"
 #include "e_exdata.h"
 #include "m_bbox.h"
+#include "m_collection.h"
+#include "m_compare.h"
+#include "m_threads.h"
+#include "p_map.h"
 #include "p_maputl.h"
 #include "p_setup.h"
+#include "p_tick.h"
 #include "r_dynseg.h"
 #include "r_main.h"
 #include "r_state.h"
@@ -330,6 +338,453 @@ static bool P_CrossBSPNode(int bspnum, los_t *los)
       P_CrossSubsector((bspnum == -1 ? 0 : bspnum & ~NF_SUBSECTOR), los);
 }
 
+//=============================================================================
+//
+// Sight cache
+//
+// Whether one thing can see another depends only on where both are and on
+// the map, so results are kept in a direct-mapped cache, keyed by everything
+// the check reads from the two things. sightgeneration counts changes to
+// sector heights, portal state, polyobjects and BLOCKALL lines; a result is
+// only used while it is the same as when the result was worked out. The
+// same pair checked again by A_Look, A_Chase and the attack code, or by a
+// monster standing still in a quiet part of the map, is then free, and the
+// game plays out exactly as it would without the cache.
+//
+
+unsigned int sightgeneration;
+
+#define NUMSIGHTCACHE 16384 // a power of two
+
+struct sightkey_t
+{
+   camsightparams_t   params; // prev is always null
+   const subsector_t *ss1;    // the old code goes by these, not the positions
+   const subsector_t *ss2;
+};
+
+struct sightcache_t
+{
+   sightkey_t   key;
+   unsigned int generation;
+   bool         result;
+};
+
+static sightcache_t *sightcache;
+
+//
+// P_sightKey
+//
+static void P_sightKey(const Mobj *t1, const Mobj *t2, sightkey_t &key)
+{
+   key.params.prev = nullptr;
+   key.params.setLookerMobj(t1);
+   key.params.setTargetMobj(t2);
+
+   if(full_demo_version >= make_full_version(340, 24))
+      key.ss1 = key.ss2 = nullptr;
+   else
+   {
+      key.ss1 = t1->subsector;
+      key.ss2 = t2->subsector;
+   }
+}
+
+//
+// P_sightCacheSlot
+//
+static sightcache_t &P_sightCacheSlot(const sightkey_t &key)
+{
+   const camsightparams_t &p = key.params;
+   uint32_t hash;
+
+   if(!sightcache)
+   {
+      sightcache = estructalloc(sightcache_t, NUMSIGHTCACHE);
+      for(int i = 0; i < NUMSIGHTCACHE; i++)
+         sightcache[i].generation = sightgeneration - 1;
+   }
+
+   hash = (p.cx >> FRACBITS) * 0x9e3779b1u;
+   hash = (hash ^ (p.cy >> FRACBITS)) * 0x85ebca77u;
+   hash = (hash ^ (p.tx >> FRACBITS)) * 0xc2b2ae3du;
+   hash = (hash ^ (p.ty >> FRACBITS)) * 0x27d4eb2fu;
+   hash ^= (p.cz ^ p.tz) >> FRACBITS;
+
+   return sightcache[(hash ^ (hash >> 15)) & (NUMSIGHTCACHE - 1)];
+}
+
+//
+// P_sightCacheHit
+//
+static bool P_sightCacheHit(const sightcache_t &sc, const sightkey_t &key)
+{
+   const camsightparams_t &a = sc.key.params;
+   const camsightparams_t &b = key.params;
+
+   return sc.generation == sightgeneration &&
+      a.cx == b.cx && a.cy == b.cy && a.cz == b.cz &&
+      a.tx == b.tx && a.ty == b.ty && a.tz == b.tz &&
+      a.cheight  == b.cheight  && a.theight  == b.theight  &&
+      a.cgroupid == b.cgroupid && a.tgroupid == b.tgroupid &&
+      sc.key.ss1 == key.ss1 && sc.key.ss2 == key.ss2;
+}
+
+//
+// P_sightCacheStore
+//
+static void P_sightCacheStore(sightcache_t &sc, const sightkey_t &key,
+                              bool result)
+{
+   sc.key        = key;
+   sc.generation = sightgeneration;
+   sc.result     = result;
+}
+
+//=============================================================================
+//
+// Sight prefetching
+//
+// With p_sightprefetch on, the sight checks against players which the
+// monsters due to act this tic are likely to make are worked out ahead of
+// time on worker threads, while the thinkers themselves still run in order on
+// the main thread. The results go into the sight cache, where P_CheckSight
+// only finds them if nothing they depend on has changed.
+//
+// The thinkers are split into batches at each player's mobj, since players
+// move when they think. A batch is worked out when the first of its checks
+// is asked for, and again if the map changed since.
+//
+
+bool p_sightprefetch;
+
+#define MINSIGHTPREFETCH   16 // fewer checks are not worth waking the workers
+#define MAXSIGHTREFETCHES   4 // batches worked out again per tic, at most
+
+struct sightprefetch_t
+{
+   const Mobj *looker;
+   const Mobj *target;
+   sightkey_t  key;
+   int         player;     // player whose mobj is the target
+   int         batch;
+};
+
+struct sightbatch_t
+{
+   int          end;        // one past the last prefetch of the batch
+   unsigned int generation; // sightgeneration when it was worked out
+   bool         done;
+};
+
+struct sightjob_t
+{
+   const camsightparams_t *params;
+   bool                    result;
+};
+
+struct sightwork_t
+{
+   sightjob_t *jobs;
+   int         numjobs;
+   int         numtasks;
+};
+
+static PODCollection<sightprefetch_t> sightprefetches;
+static PODCollection<sightbatch_t>    sightbatches;
+static PODCollection<sightjob_t>      sightjobs;
+static int         *sighthash;      // indices into sightprefetches, or -1
+static unsigned int sighthashsize;  // a power of two
+static bool         sightprefetching;
+static int          sightrefetches;
+static WorkerPool   sightpool;
+
+//
+// P_sightHash
+//
+static unsigned int P_sightHash(const Mobj *looker, const Mobj *target)
+{
+   uintptr_t key = reinterpret_cast<uintptr_t>(looker) * 31 +
+                   reinterpret_cast<uintptr_t>(target);
+
+   return static_cast<unsigned int>((key ^ (key >> 16)) * 0x45d9f3bu);
+}
+
+//
+// P_sightJobTask
+//
+// Works out one share of a batch of checks. Runs on the workers.
+//
+static void P_sightJobTask(int task, void *data)
+{
+   const sightwork_t *work = static_cast<const sightwork_t *>(data);
+   int start = work->numjobs * task / work->numtasks;
+   int stop  = work->numjobs * (task + 1) / work->numtasks;
+
+   for(int i = start; i < stop; i++)
+      work->jobs[i].result = CAM_CheckSight(*work->jobs[i].params);
+}
+
+//
+// P_CheckSightBatch
+//
+// Works out many sight checks at once, sharing them out among the worker
+// threads. Only for the sight code of 3.40.24 on, which keeps no state
+// outside the check.
+//
+static void P_CheckSightBatch(sightjob_t *jobs, int numjobs)
+{
+   sightwork_t work;
+
+   if(!sightpool.getNumThreads())
+      sightpool.setNumThreads(emax(M_NumCPUs() - 1, 1));
+
+   work.jobs     = jobs;
+   work.numjobs  = numjobs;
+   work.numtasks = emin(numjobs, (sightpool.getNumThreads() + 1) * 4);
+
+   sightpool.run(work.numtasks, P_sightJobTask, &work);
+}
+
+//
+// P_runSightBatch
+//
+// Works out the checks of a batch, starting from the given one, with the map
+// as it stands now, and puts them in the sight cache.
+//
+static void P_runSightBatch(int batch, int first)
+{
+   sightbatch_t &sb = sightbatches[batch];
+
+   // players move as they think, so take their positions now; the lookers
+   // are not looked at again, since those already passed may be gone
+   sightjobs.makeEmpty();
+   for(int i = first; i < sb.end; i++)
+   {
+      sightprefetch_t &sp = sightprefetches[i];
+
+      if(players[sp.player].mo != sp.target)
+      {
+         sp.looker = sp.target = nullptr; // never matches again
+         continue;
+      }
+
+      sp.key.params.setTargetMobj(sp.target);
+
+      sightjob_t &job = sightjobs.addNew();
+      job.params = &sp.key.params;
+   }
+
+   if(sightjobs.getLength())
+   {
+      P_CheckSightBatch(&sightjobs[0], static_cast<int>(sightjobs.getLength()));
+
+      int job = 0;
+      for(int i = first; i < sb.end; i++)
+      {
+         const sightprefetch_t &sp = sightprefetches[i];
+
+         if(sp.target)
+         {
+            P_sightCacheStore(P_sightCacheSlot(sp.key), sp.key,
+                              sightjobs[job++].result);
+         }
+      }
+   }
+
+   sb.generation = sightgeneration;
+   sb.done       = true;
+}
+
+//
+// P_runSightPrefetch
+//
+// Called when a check is not in the sight cache. If it was to be prefetched
+// and its batch has not been worked out for the map as it is now, does that,
+// and returns true.
+//
+static bool P_runSightPrefetch(const Mobj *t1, const Mobj *t2)
+{
+   unsigned int mask = sighthashsize - 1;
+   int index;
+
+   for(unsigned int slot = P_sightHash(t1, t2) & mask;
+       (index = sighthash[slot]) >= 0; slot = (slot + 1) & mask)
+   {
+      const sightprefetch_t &sp = sightprefetches[index];
+
+      if(sp.looker != t1 || sp.target != t2)
+         continue;
+
+      sightbatch_t &sb = sightbatches[sp.batch];
+
+      if(sb.done && (sb.generation == sightgeneration ||
+                     sightrefetches >= MAXSIGHTREFETCHES))
+         return false;
+
+      // worth working out only if enough of the batch is left
+      if(sb.end - index < MINSIGHTPREFETCH)
+         return false;
+
+      if(sb.done)
+         ++sightrefetches;
+      P_runSightBatch(sp.batch, index);
+      return true;
+   }
+
+   return false;
+}
+
+//
+// P_willLookForPlayers
+//
+// True if the thing is about to enter a state that looks for or chases
+// players, and so will probably check if it can see them.
+//
+static bool P_willLookForPlayers(const Mobj *mo)
+{
+   if(mo->tics != 1 || mo->health <= 0 || mo->player ||
+      mo->flags & MF_FRIEND || mo->state->nextstate < 0)
+      return false;
+
+   const state_t *next = states[mo->state->nextstate];
+
+   if(next->action == A_Chase)
+      return true;
+
+   if(next->action != A_Look)
+      return false;
+
+   // A_Look goes for a sound target without looking around first
+   const Mobj *sndtarget = mo->subsector->sector->soundtarget;
+
+   return !sndtarget || !(sndtarget->flags & MF_SHOOTABLE) ||
+          mo->flags & MF_AMBUSH;
+}
+
+//
+// P_closeSightBatch
+//
+static void P_closeSightBatch()
+{
+   int end = static_cast<int>(sightprefetches.getLength());
+   size_t numbatches = sightbatches.getLength();
+
+   if(numbatches && sightbatches[numbatches - 1].end == end)
+      return;
+
+   sightbatch_t &sb = sightbatches.addNew();
+   sb.end        = end;
+   sb.generation = 0;
+   sb.done       = false;
+}
+
+//
+// P_PrefetchSight
+//
+// Called before the thinkers run. Gathers the sight checks to prefetch.
+//
+void P_PrefetchSight()
+{
+   int targets[MAXPLAYERS];
+   int numtargets = 0;
+
+   P_EndSightPrefetch();
+
+   // the old sight code shares validcount, and is kept for old demos
+   if(!p_sightprefetch || full_demo_version < make_full_version(340, 24))
+      return;
+
+   for(int i = 0; i < MAXPLAYERS; i++)
+   {
+      if(playeringame[i] && players[i].mo && players[i].health > 0)
+         targets[numtargets++] = i;
+   }
+
+   if(!numtargets)
+      return;
+
+   for(Thinker *th = thinkercap.next; th != &thinkercap; th = th->next)
+   {
+      const Mobj *mo;
+
+      if(th->isRemoved() || !(mo = thinker_cast<const Mobj *>(th)))
+         continue;
+
+      if(mo->player && mo->player->mo == mo)
+      {
+         P_closeSightBatch();
+         continue;
+      }
+
+      if(!P_willLookForPlayers(mo))
+         continue;
+
+      for(int i = 0; i < numtargets; i++)
+      {
+         sightprefetch_t &sp = sightprefetches.addNew();
+
+         sp.looker = mo;
+         sp.target = players[targets[i]].mo;
+         P_sightKey(mo, sp.target, sp.key);
+         sp.player = targets[i];
+         sp.batch  = static_cast<int>(sightbatches.getLength());
+      }
+   }
+   P_closeSightBatch();
+
+   unsigned int numprefetches = 
+      static_cast<unsigned int>(sightprefetches.getLength());
+
+   if(numprefetches < MINSIGHTPREFETCH)
+   {
+      P_EndSightPrefetch();
+      return;
+   }
+
+   // hash the checks, at most half full
+   if(sighthashsize < numprefetches * 2)
+   {
+      while(sighthashsize < numprefetches * 2)
+         sighthashsize = sighthashsize ? sighthashsize * 2 : 256;
+      efree(sighthash);
+      sighthash = emalloc(int *, sighthashsize * sizeof(int));
+   }
+   memset(sighthash, 0xff, sighthashsize * sizeof(int));
+
+   unsigned int mask = sighthashsize - 1;
+
+   for(unsigned int i = 0; i < numprefetches; i++)
+   {
+      const sightprefetch_t &sp = sightprefetches[i];
+      unsigned int slot = P_sightHash(sp.looker, sp.target) & mask;
+
+      while(sighthash[slot] >= 0)
+         slot = (slot + 1) & mask;
+      sighthash[slot] = static_cast<int>(i);
+   }
+
+   sightprefetching = true;
+
+   // nothing before the first player moves, so the first batch can start now
+   if(sightbatches[0].end >= MINSIGHTPREFETCH)
+      P_runSightBatch(0, 0);
+}
+
+//
+// P_EndSightPrefetch
+//
+// Called after the thinkers run, or whenever the prefetched checks must not
+// be used any more.
+//
+void P_EndSightPrefetch()
+{
+   sightprefetching = false;
+   sightprefetches.makeEmpty();
+   sightbatches.makeEmpty();
+   sightrefetches = 0;
+}
+
 //
 // P_CheckSight
 // Returns true
@@ -338,17 +793,8 @@ static bool P_CrossBSPNode(int bspnum, los_t *los)
 //
 // killough 4/20/98: cleaned up, made to use new LOS struct
 //
-bool P_CheckSight(Mobj *t1, Mobj *t2)
+static bool P_oldCheckSight(Mobj *t1, Mobj *t2)
 {
-   if(full_demo_version >= make_full_version(340, 24))
-   {
-      camsightparams_t camparams;
-      camparams.prev = nullptr;
-      camparams.setLookerMobj(t1);
-      camparams.setTargetMobj(t2);
-      return CAM_CheckSight(camparams);
-   }
-
    const sector_t *s1 = t1->subsector->sector;
    const sector_t *s2 = t2->subsector->sector;
    int pnum = eindex(s1-sectors)*numsectors + eindex(s2-sectors);
@@ -424,6 +870,38 @@ bool P_CheckSight(Mobj *t1, Mobj *t2)
    return P_CrossBSPNode(numnodes-1, &los);
 }
 
+//
+// P_CheckSight
+//
+// Goes through the sight cache; see above.
+//
+bool P_CheckSight(Mobj *t1, Mobj *t2)
+{
+   sightkey_t key;
+   bool       result;
+
+   P_sightKey(t1, t2, key);
+
+   sightcache_t &sc = P_sightCacheSlot(key);
+
+   if(P_sightCacheHit(sc, key))
+      return sc.result;
+
+   if(sightprefetching && P_runSightPrefetch(t1, t2) && P_sightCacheHit(sc, key))
+      return sc.result;
+
+   if(key.ss1)
+      result = P_oldCheckSight(t1, t2);
+   else
+      result = CAM_CheckSight(key.params);
+
+   P_sightCacheStore(sc, key, result);
+   return result;
+}
+
+VARIABLE_TOGGLE(p_sightprefetch, NULL, onoff);
+CONSOLE_VARIABLE(p_sightprefetch, p_sightprefetch, 0) {}
+
 //----------------------------------------------------------------------------
 //
 // $Log: p_sight.c,v $
@@ -34,6 +34,7 @@
 #include "i_system.h"
 #include "p_anim.h"
 #include "p_chase.h"
+#include "p_map.h"
 #include "p_saveg.h"
 #include "p_sector.h"
 #include "p_spec.h"
@@ -228,6 +229,8 @@ void Thinker::remove()
 //
 void Thinker::RunThinkers(void)
 {
+   P_PrefetchSight();
+
    for(currentthinker = thinkercap.next; 
        currentthinker != &thinkercap;
        currentthinker = currentthinker->next)
@@ -237,6 +240,8 @@ void Thinker::RunThinkers(void)
       else
          currentthinker->Think();
    }
+   P_EndSightPrefetch();
+
    S_MusInfoUpdate();
 }
 
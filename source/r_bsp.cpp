@@ -41,6 +41,8 @@
 #include "r_dynseg.h"
 #include "r_dynabsp.h"
 #include "r_portal.h"
+#include "r_profile.h"
+#include "r_pvs.h"
 #include "r_segs.h"
 #include "r_sky.h"
 #include "r_state.h"
@@ -2870,6 +2872,12 @@ static void R_Subsector(int num)
 //
 void R_RenderBSPNode(int bspnum)
 {
+   RProfileScope profile(RPROF_BSP);
+
+   // skip subtrees the PVS says can't be seen
+   if(R_PVSCulled(bspnum))
+      return;
+
    while(!(bspnum & NF_SUBSECTOR))  // Found a subsector?
    {
       const node_t *bsp = &nodes[bspnum];
@@ -2881,8 +2889,8 @@ void R_RenderBSPNode(int bspnum)
       R_RenderBSPNode(bsp->children[side]);
       
       // Possibly divide back space.
-      
-      if(!R_CheckBBox(bsp->bbox[side^=1]))
+      side ^= 1;
+      if(R_PVSCulled(bsp->children[side]) || !R_CheckBBox(bsp->bbox[side]))
          return;
       
       bspnum = bsp->children[side];
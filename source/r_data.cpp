@@ -268,6 +268,188 @@ int tran_filter_pct = 66;       // filter percent
 
 #define TSC 12        /* number of fixed point digits in filter percent */
 
+//
+// R_buildTranMap
+//
+// Composes a translucency filter map for a palette and filter percentage.
+// Shows loading progress only when asked to, as it can be run off the main
+// thread.
+//
+// By Lee Killough 2/21/98
+//
+static void R_buildTranMap(byte *tranmap, const byte *playpal, int tranpct,
+                           bool progress)
+{
+   int pal[3][256], tot[256], pal_w1[3][256];
+   int w1 = ((unsigned int) tranpct<<TSC)/100;
+   int w2 = (1l<<TSC)-w1;
+
+   // First, convert playpal into long int type, and transpose array,
+   // for fast inner-loop calculations. Precompute tot array.
+   {
+      int i = 255;
+      const unsigned char *p = playpal + 255 * 3;
+      do
+      {
+         int t,d;
+         pal_w1[0][i] = (pal[0][i] = t = p[0]) * w1;
+         d = t*t;
+         pal_w1[1][i] = (pal[1][i] = t = p[1]) * w1;
+         d += t*t;
+         pal_w1[2][i] = (pal[2][i] = t = p[2]) * w1;
+         d += t*t;
+         p -= 3;
+         tot[i] = d << (TSC - 1);
+      }
+      while (--i >= 0);
+   }
+
+   // Next, compute all entries using minimum arithmetic.
+   byte *tp = tranmap;
+   for(int i = 0; i < 256; ++i)
+   {
+      int r1 = pal[0][i] * w2;
+      int g1 = pal[1][i] * w2;
+      int b1 = pal[2][i] * w2;
+
+      if(!(i & 31) && progress)
+         V_LoadingIncrease();        //sf 
+
+      for(int j = 0; j < 256; j++, tp++)
+      {
+         int color = 255;
+         int err;
+         int r = pal_w1[0][j] + r1;
+         int g = pal_w1[1][j] + g1;
+         int b = pal_w1[2][j] + b1;
+         int best = INT_MAX;
+         do
+         {
+            if((err = tot[color] - pal[0][color]*r
+               - pal[1][color]*g - pal[2][color]*b) < best)
+            {
+               best = err;
+               *tp = color;
+            }
+         }
+         while(--color >= 0);
+      }
+   }
+}
+
+//
+// R_buildSubMap
+//
+// Composes a subtractive filter map for a palette.
+//
+static void R_buildSubMap(byte *submap, const byte *playpal)
+{
+   int pal[3][256], tot[256];
+
+   // First, convert playpal into long int type, and transpose array,
+   // for fast inner-loop calculations. Precompute tot array.
+   {
+      int i = 255;
+      const unsigned char *p = playpal + 255 * 3;
+      do
+      {
+         int t,d;
+         pal[0][i] = t = p[0];
+         d = t*t;
+         pal[1][i] = t = p[1];
+         d += t*t;
+         pal[2][i] = t = p[2];
+         d += t*t;
+         p -= 3;
+         tot[i] = d/2;
+      }
+      while (--i >= 0);
+   }
+
+   // Next, compute all entries using minimum arithmetic.
+   byte *tp = submap;
+   for(int i = 0; i < 256; i++)
+   {
+      int r1 = pal[0][i];
+      int g1 = pal[1][i];
+      int b1 = pal[2][i];
+
+      for(int j = 0; j < 256; j++, tp++)
+      {
+         int color = 255;
+         int err;
+         // haleyjd: subtract and clamp to 0
+         int r = emax(r1 - pal[0][j], 0);
+         int g = emax(g1 - pal[1][j], 0);
+         int b = emax(b1 - pal[2][j], 0);
+         int best = INT_MAX;
+         do
+         {
+            if((err = tot[color] - pal[0][color]*r
+               - pal[1][color]*g - pal[2][color]*b) < best)
+            {
+               best = err;
+               *tp = color;
+            }
+         }
+         while(--color >= 0);
+      }
+   }
+}
+
+// Maps built ahead by R_PrebuildTranMaps, and what they were built from
+static byte *prebuilt_tranmap;
+static byte *prebuilt_submap;
+static byte  prebuilt_palette[768];
+static int   prebuilt_tranpct;
+
+//
+// R_PrebuildTranMaps
+//
+// Composes the filter maps which R_InitData is going to need, ahead of time.
+// Run as a startup task while EDF and DeHackEd are processed; it only reads
+// the wads, which are all in by then.
+//
+void R_PrebuildTranMaps(const byte *playpal, int tranpct)
+{
+   memcpy(prebuilt_palette, playpal, sizeof(prebuilt_palette));
+   prebuilt_tranpct = tranpct;
+
+   if(W_CheckNumForName("TRANMAP") == -1)
+   {
+      prebuilt_tranmap = ecalloc(byte *, 256, 256);
+      R_buildTranMap(prebuilt_tranmap, playpal, tranpct, false);
+   }
+
+   if(W_CheckNumForName("SUBMAP") == -1)
+   {
+      prebuilt_submap = ecalloc(byte *, 256, 256);
+      R_buildSubMap(prebuilt_submap, playpal);
+   }
+}
+
+//
+// R_takePrebuiltMap
+//
+// Takes a map from R_PrebuildTranMaps if it was built from the same palette
+// and percentage. One that wasn't is thrown away, and nullptr is returned.
+//
+static byte *R_takePrebuiltMap(byte *&prebuilt, const byte *playpal, int tranpct)
+{
+   byte *map = prebuilt;
+
+   prebuilt = nullptr;
+
+   if(map && (tranpct != prebuilt_tranpct ||
+              memcmp(playpal, prebuilt_palette, sizeof(prebuilt_palette))))
+   {
+      efree(map);
+      map = nullptr;
+   }
+
+   return map;
+}
+
 //
 // R_InitTranMap
 //
@@ -327,67 +509,23 @@ void R_InitTranMap(bool force)
       // Compose a default transparent filter map based on PLAYPAL.
       if(main_tranmap)
          efree(main_tranmap);
-      main_tranmap  = ecalloc(byte *, 256, 256);  // killough 4/11/98
       prev_fromlump = false;
       prev_lumpnum  = -1;
       prev_built    = true;
       prev_tran_pct = tran_filter_pct;
       memcpy(prev_palette, playpal, 768);
-      
-      int pal[3][256], tot[256], pal_w1[3][256];
-      int w1 = ((unsigned int) tran_filter_pct<<TSC)/100;
-      int w2 = (1l<<TSC)-w1;
 
-      // First, convert playpal into long int type, and transpose array,
-      // for fast inner-loop calculations. Precompute tot array.
+      if((main_tranmap = R_takePrebuiltMap(prebuilt_tranmap, playpal,
+                                           tran_filter_pct)))
       {
-         int i = 255;
-         const unsigned char *p = playpal + 255 * 3;
-         do
-         {
-            int t,d;
-            pal_w1[0][i] = (pal[0][i] = t = p[0]) * w1;
-            d = t*t;
-            pal_w1[1][i] = (pal[1][i] = t = p[1]) * w1;
-            d += t*t;
-            pal_w1[2][i] = (pal[2][i] = t = p[2]) * w1;
-            d += t*t;
-            p -= 3;
-            tot[i] = d << (TSC - 1);
-         }
-         while (--i >= 0);
+         // keep the loading bar as it was
+         for(int i = 0; i < 256 && force; i += 32)
+            V_LoadingIncrease();
       }
-
-      // Next, compute all entries using minimum arithmetic.
-      byte *tp = main_tranmap;
-      for(int i = 0; i < 256; ++i)
+      else
       {
-         int r1 = pal[0][i] * w2;
-         int g1 = pal[1][i] * w2;
-         int b1 = pal[2][i] * w2;
-
-         if(!(i & 31) && force)
-            V_LoadingIncrease();        //sf 
-
-         for(int j = 0; j < 256; j++, tp++)
-         {
-            int color = 255;
-            int err;
-            int r = pal_w1[0][j] + r1;
-            int g = pal_w1[1][j] + g1;
-            int b = pal_w1[2][j] + b1;
-            int best = INT_MAX;
-            do
-            {
-               if((err = tot[color] - pal[0][color]*r
-                  - pal[1][color]*g - pal[2][color]*b) < best)
-               {
-                  best = err;
-                  *tp = color;
-               }
-            }
-            while(--color >= 0);
-         }
+         main_tranmap = ecalloc(byte *, 256, 256);  // killough 4/11/98
+         R_buildTranMap(main_tranmap, playpal, tran_filter_pct, force);
       }
    }
 }
@@ -444,62 +582,17 @@ void R_InitSubMap(bool force)
       // Compose a default transparent filter map based on PLAYPAL.
       if(main_submap)
          efree(main_submap);
-      main_submap  = ecalloc(byte *, 256, 256);  // killough 4/11/98
       prev_fromlump = false;
       prev_lumpnum  = -1;
       prev_built    = true;
       memcpy(prev_palette, playpal, 768);
-      
-      int pal[3][256], tot[256];
 
-      // First, convert playpal into long int type, and transpose array,
-      // for fast inner-loop calculations. Precompute tot array.
+      // the percentage doesn't matter to this map
+      if(!(main_submap = R_takePrebuiltMap(prebuilt_submap, playpal,
+                                           prebuilt_tranpct)))
       {
-         int i = 255;
-         const unsigned char *p = playpal + 255 * 3;
-         do
-         {
-            int t,d;
-            pal[0][i] = t = p[0];
-            d = t*t;
-            pal[1][i] = t = p[1];
-            d += t*t;
-            pal[2][i] = t = p[2];
-            d += t*t;
-            p -= 3;
-            tot[i] = d/2;
-         }
-         while (--i >= 0);
-      }
-
-      // Next, compute all entries using minimum arithmetic.
-      byte *tp = main_submap;
-      for(int i = 0; i < 256; i++)
-      {
-         int r1 = pal[0][i];
-         int g1 = pal[1][i];
-         int b1 = pal[2][i];
-
-         for(int j = 0; j < 256; j++, tp++)
-         {
-            int color = 255;
-            int err;
-            // haleyjd: subtract and clamp to 0
-            int r = emax(r1 - pal[0][j], 0);
-            int g = emax(g1 - pal[1][j], 0);
-            int b = emax(b1 - pal[2][j], 0);
-            int best = INT_MAX;
-            do
-            {
-               if((err = tot[color] - pal[0][color]*r
-                  - pal[1][color]*g - pal[2][color]*b) < best)
-               {
-                  best = err;
-                  *tp = color;
-               }
-            }
-            while(--color >= 0);
-         }
+         main_submap = ecalloc(byte *, 256, 256);  // killough 4/11/98
+         R_buildSubMap(main_submap, playpal);
       }
    }
 }
@@ -564,6 +657,9 @@ int r_precache = 1;     //sf: option not to precache the levels
 //
 // Totally rewritten by Lee Killough to use less memory,
 // to avoid using alloca(), and to improve performance.
+//
+// Textures are composed in the background by the texture cache, so they no
+// longer hold up the level start, and are warmed up for demos as well.
 
 void R_PrecacheLevel(void)
 {
@@ -571,9 +667,6 @@ void R_PrecacheLevel(void)
    byte *hitlist;
    int numalloc;
 
-   if(demoplayback)
-      return;
-   
    if(!r_precache)
       return;
 
@@ -610,14 +703,15 @@ void R_PrecacheLevel(void)
       ++sky;
    }
 
-   // Precache textures.
-   for(i = texturecount; --i >= 0; )
+   // Warm up textures.
+   R_WarmUpTextures(hitlist);
+
+   if(demoplayback)
    {
-      if(hitlist[i])
-         R_CacheTexture(i);
+      efree(hitlist);
+      return;
    }
 
-
    // Precache sprites.
    memset(hitlist, 0, numsprites);
 
@@ -658,6 +752,9 @@ void R_PrecacheLevel(void)
 //
 void R_FreeData(void)
 {
+   // composed textures live outside the zone heap
+   R_FreeTextureCache();
+
    // haleyjd: let's harness the power of the zone heap and make this simple.
    Z_FreeTags(PU_RENDERER, PU_RENDERER);
 }
@@ -136,6 +136,12 @@ byte *R_GetLinearBuffer(int tex);
 // Returns the texture for chaining.
 texture_t *R_CacheTexture(int num);
 
+// Texture cache: frame-start housekeeping, background composition of the
+// textures a level uses, and freeing of every composed texture.
+void R_TexCacheBeginFrame();
+void R_WarmUpTextures(const byte *hitlist);
+void R_FreeTextureCache();
+
 // SoM: all textures/flats are now stored in a single array (textures)
 // Walls start from wallstart to (wallstop - 1) and flats go from flatstart 
 // to (flatstop - 1)
@@ -178,14 +184,17 @@ int R_CheckForWall(const char *name);
 
 void R_InitTranMap(bool force);      // killough 3/6/98: translucency initialization
 void R_InitSubMap(bool force);
+void R_PrebuildTranMaps(const byte *playpal, int tranpct);
 int  R_ColormapNumForName(const char *name);      // killough 4/4/98
 
 // haleyjd: new global colormap method
 void R_SetGlobalLevelColormap(void);
 
-extern byte *main_tranmap, *main_submap, *tranmap;
+extern byte *main_tranmap, *main_submap;
+extern thread_local byte *tranmap;
 
 extern int r_precache;
+extern int r_texcachesize;
 
 extern int global_cmap_index; // haleyjd
 extern int global_fog_index;
@@ -245,6 +245,7 @@ struct sector_t
    int nexttag, firsttag;   // killough 1/30/98: improves searches for tags.
    int soundtraversed;      // 0 = untraversed, 1,2 = sndlines-1
    Mobj *soundtarget;       // thing that made a sound (or null)
+   unsigned int soundstamp; // goes up when heights or portal state change
    fixed_t blockbox[4];     // mapblock bounding box for height changes
    PointThinker soundorg;   // origin for any sounds played by the sector
    PointThinker csoundorg;  // haleyjd 10/16/06: separate sound origin for ceiling
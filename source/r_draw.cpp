@@ -68,7 +68,7 @@ byte *renderscreen;            // haleyjd
 //  (color ramps used for  suit colors).
 //
  
-byte *tranmap;          // translucency filter maps 256x256   // phares 
+thread_local byte *tranmap; // translucency filter maps 256x256   // phares 
 byte *main_tranmap;     // killough 4/11/98
 byte *main_submap;      // haleyjd 11/30/13
 
@@ -90,7 +90,7 @@ const int fuzzoffset[FUZZTABLE] =
   1,1,0,1,1,0,1 
 }; 
 
-int fuzzpos = 0; 
+thread_local int fuzzpos = 0; 
 
 //
 // A column is a vertical slice/span from a wall texture that,
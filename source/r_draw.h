@@ -147,7 +147,7 @@ void R_FillBackScreen(const rrect_t &window);
 // If the view size is not full screen, draws a border around it.
 void R_DrawViewBorder();
 
-extern byte  *tranmap;       // translucency filter maps 256x256  // phares 
+extern thread_local byte *tranmap;       // translucency filter maps 256x256  // phares 
 extern byte  *main_tranmap;  // killough 4/11/98
 extern byte  *main_submap;   // haleyjd 11/30/13
 
@@ -158,7 +158,7 @@ extern byte  *main_submap;   // haleyjd 11/30/13
 #define FUZZOFF (SCREENWIDTH)
 
 extern const int fuzzoffset[];
-extern int fuzzpos;
+extern thread_local int fuzzpos;
 
 // Cardboard
 typedef struct cb_column_s
@@ -179,7 +179,7 @@ typedef struct cb_column_s
 } cb_column_t;
 
 
-extern cb_column_t column;
+extern thread_local cb_column_t column;
 
 #endif
 
@@ -0,0 +1,187 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// Copyright (C) 2013 James Haley et al.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+// Additional terms and conditions compatible with the GPLv3 apply. See the
+// file COPYING-EE for details.
+//
+//--------------------------------------------------------------------------
+//
+// DESCRIPTION:
+//      AVX2 column and span drawers, eight pixels at a time. This module is
+//      compiled for AVX2 regardless of the project settings, and is only
+//      used once R_InitSIMDDrawers has found the CPU supports it.
+//
+//-----------------------------------------------------------------------------
+
+#include "z_zone.h"
+#include "r_drawsimd.h"
+
+#ifdef R_SIMD_AVX2
+
+#include <immintrin.h>
+
+// Everything the drawer templates depend on is included before switching the
+// code generation target, so that no inline function shared with the rest of
+// the program ends up compiled with AVX2 instructions.
+#include "i_system.h"
+#include "r_draw.h"
+#include "r_main.h"
+#include "r_plane.h"
+#include "v_misc.h"
+#include "v_video.h"
+
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("avx2"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#endif
+
+#include "r_simdtpl.h"
+
+struct AVX2Traits
+{
+   enum { WIDTH = 8 };
+
+   //
+   // Moves the eight 32-bit lanes out to the integer registers (see the SSE2
+   // version of this in r_drawsse2.cpp).
+   //
+   static void Store(int *out, __m256i v)
+   {
+      __m128i   l  = _mm256_castsi256_si128(v);
+      __m128i   h  = _mm256_extracti128_si256(v, 1);
+      long long q0 = _mm_cvtsi128_si64(l);
+      long long q1 = _mm_extract_epi64(l, 1);
+      long long q2 = _mm_cvtsi128_si64(h);
+      long long q3 = _mm_extract_epi64(h, 1);
+
+      out[0] = int(q0);
+      out[1] = int(q0 >> 32);
+      out[2] = int(q1);
+      out[3] = int(q1 >> 32);
+      out[4] = int(q2);
+      out[5] = int(q2 >> 32);
+      out[6] = int(q3);
+      out[7] = int(q3 >> 32);
+   }
+
+   static __m256i Lanes(unsigned int start, unsigned int step)
+   {
+      return _mm256_add_epi32(_mm256_set1_epi32(int(start)),
+                              _mm256_mullo_epi32(_mm256_set1_epi32(int(step)),
+                                                 _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7)));
+   }
+
+   class ColumnStepper
+   {
+      __m256i frac, step, mask;
+
+   public:
+      ColumnStepper(fixed_t pFrac, fixed_t pStep, int heightmask)
+      {
+         frac = Lanes(pFrac, pStep);
+         step = _mm256_set1_epi32(int(8u * unsigned(pStep)));
+         mask = _mm256_set1_epi32(heightmask);
+      }
+
+      void next(int *out)
+      {
+         Store(out, _mm256_and_si256(_mm256_srai_epi32(frac, FRACBITS), mask));
+         frac = _mm256_add_epi32(frac, step);
+      }
+   };
+
+   class SpanStepper
+   {
+      __m256i xf, yf, xs, ys, xmask;
+      __m128i xshift, yshift;
+
+   public:
+      SpanStepper(unsigned int pXf, unsigned int pYf, unsigned int pXs,
+                  unsigned int pYs, unsigned int pXShift, unsigned int pYShift,
+                  unsigned int pXMask)
+      {
+         xf     = Lanes(pXf, pXs);
+         yf     = Lanes(pYf, pYs);
+         xs     = _mm256_set1_epi32(int(8 * pXs));
+         ys     = _mm256_set1_epi32(int(8 * pYs));
+         xmask  = _mm256_set1_epi32(int(pXMask));
+         xshift = _mm_cvtsi32_si128(int(pXShift));
+         yshift = _mm_cvtsi32_si128(int(pYShift));
+      }
+
+      void next(int *out)
+      {
+         __m256i t = _mm256_and_si256(_mm256_srl_epi32(xf, xshift), xmask);
+         Store(out, _mm256_or_si256(t, _mm256_srl_epi32(yf, yshift)));
+         xf = _mm256_add_epi32(xf, xs);
+         yf = _mm256_add_epi32(yf, ys);
+      }
+   };
+
+   static __m256i Sum(const unsigned int *fg2rgb, const unsigned int *bg2rgb,
+                      const byte *fg, const byte *bg)
+   {
+      __m256i f = _mm256_setr_epi32(int(fg2rgb[fg[0]]), int(fg2rgb[fg[1]]),
+                                    int(fg2rgb[fg[2]]), int(fg2rgb[fg[3]]),
+                                    int(fg2rgb[fg[4]]), int(fg2rgb[fg[5]]),
+                                    int(fg2rgb[fg[6]]), int(fg2rgb[fg[7]]));
+      __m256i b = _mm256_setr_epi32(int(bg2rgb[bg[0]]), int(bg2rgb[bg[1]]),
+                                    int(bg2rgb[bg[2]]), int(bg2rgb[bg[3]]),
+                                    int(bg2rgb[bg[4]]), int(bg2rgb[bg[5]]),
+                                    int(bg2rgb[bg[6]]), int(bg2rgb[bg[7]]));
+      return _mm256_add_epi32(f, b);
+   }
+
+   static void BlendFlex(const unsigned int *fg2rgb, const unsigned int *bg2rgb,
+                         const byte *fg, const byte *bg, int *out)
+   {
+      __m256i t = _mm256_or_si256(Sum(fg2rgb, bg2rgb, fg, bg),
+                                  _mm256_set1_epi32(0x1f07c1f));
+      Store(out, _mm256_and_si256(t, _mm256_srli_epi32(t, 15)));
+   }
+
+   static void BlendAdd(const unsigned int *fg2rgb, const unsigned int *bg2rgb,
+                        const byte *fg, const byte *bg, int *out)
+   {
+      __m256i a = Sum(fg2rgb, bg2rgb, fg, bg);
+      __m256i b = _mm256_and_si256(a, _mm256_set1_epi32(0x40100400));
+      a = _mm256_or_si256(a, _mm256_set1_epi32(0x01f07c1f));
+      a = _mm256_and_si256(a, _mm256_set1_epi32(0x3fffffff));
+      b = _mm256_sub_epi32(b, _mm256_srli_epi32(b, 5));
+      a = _mm256_or_si256(a, b);
+      Store(out, _mm256_and_si256(a, _mm256_srli_epi32(a, 15)));
+   }
+};
+
+void R_AVX2Drawers(columndrawer_t &coldrawer, spandrawer_t &spandrawer)
+{
+   R_SetSIMDDrawers<AVX2Traits>(coldrawer, spandrawer);
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+#endif
+
+// EOF
+
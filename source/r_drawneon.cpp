@@ -0,0 +1,134 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// Copyright (C) 2013 James Haley et al.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+// Additional terms and conditions compatible with the GPLv3 apply. See the
+// file COPYING-EE for details.
+//
+//--------------------------------------------------------------------------
+//
+// DESCRIPTION:
+//      NEON column and span drawers, four pixels at a time.
+//
+//-----------------------------------------------------------------------------
+
+#include "z_zone.h"
+#include "r_drawsimd.h"
+
+#ifdef R_SIMD_NEON
+
+#include <arm_neon.h>
+
+#include "r_simdtpl.h"
+
+struct NEONTraits
+{
+   enum { WIDTH = 4 };
+
+   static uint32x4_t Lanes(unsigned int start, unsigned int step)
+   {
+      static const uint32_t index[4] = { 0, 1, 2, 3 };
+      return vmlaq_n_u32(vdupq_n_u32(start), vld1q_u32(index), step);
+   }
+
+   class ColumnStepper
+   {
+      int32x4_t frac, step, mask;
+
+   public:
+      ColumnStepper(fixed_t pFrac, fixed_t pStep, int heightmask)
+      {
+         frac = vreinterpretq_s32_u32(Lanes(pFrac, pStep));
+         step = vdupq_n_s32(int(4u * unsigned(pStep)));
+         mask = vdupq_n_s32(heightmask);
+      }
+
+      void next(int *out)
+      {
+         vst1q_s32(out, vandq_s32(vshrq_n_s32(frac, FRACBITS), mask));
+         frac = vaddq_s32(frac, step);
+      }
+   };
+
+   class SpanStepper
+   {
+      uint32x4_t xf, yf, xs, ys, xmask;
+      int32x4_t  xshift, yshift; // negative: vshlq shifts right
+
+   public:
+      SpanStepper(unsigned int pXf, unsigned int pYf, unsigned int pXs,
+                  unsigned int pYs, unsigned int pXShift, unsigned int pYShift,
+                  unsigned int pXMask)
+      {
+         xf     = Lanes(pXf, pXs);
+         yf     = Lanes(pYf, pYs);
+         xs     = vdupq_n_u32(4 * pXs);
+         ys     = vdupq_n_u32(4 * pYs);
+         xmask  = vdupq_n_u32(pXMask);
+         xshift = vdupq_n_s32(-int(pXShift));
+         yshift = vdupq_n_s32(-int(pYShift));
+      }
+
+      void next(int *out)
+      {
+         uint32x4_t t = vandq_u32(vshlq_u32(xf, xshift), xmask);
+         t = vorrq_u32(t, vshlq_u32(yf, yshift));
+         vst1q_s32(out, vreinterpretq_s32_u32(t));
+         xf = vaddq_u32(xf, xs);
+         yf = vaddq_u32(yf, ys);
+      }
+   };
+
+   static uint32x4_t Sum(const unsigned int *fg2rgb, const unsigned int *bg2rgb,
+                         const byte *fg, const byte *bg)
+   {
+      const uint32_t f[4] = { fg2rgb[fg[0]], fg2rgb[fg[1]], fg2rgb[fg[2]], fg2rgb[fg[3]] };
+      const uint32_t b[4] = { bg2rgb[bg[0]], bg2rgb[bg[1]], bg2rgb[bg[2]], bg2rgb[bg[3]] };
+      return vaddq_u32(vld1q_u32(f), vld1q_u32(b));
+   }
+
+   static void BlendFlex(const unsigned int *fg2rgb, const unsigned int *bg2rgb,
+                         const byte *fg, const byte *bg, int *out)
+   {
+      uint32x4_t t = vorrq_u32(Sum(fg2rgb, bg2rgb, fg, bg), vdupq_n_u32(0x1f07c1f));
+      t = vandq_u32(t, vshrq_n_u32(t, 15));
+      vst1q_s32(out, vreinterpretq_s32_u32(t));
+   }
+
+   static void BlendAdd(const unsigned int *fg2rgb, const unsigned int *bg2rgb,
+                        const byte *fg, const byte *bg, int *out)
+   {
+      uint32x4_t a = Sum(fg2rgb, bg2rgb, fg, bg);
+      uint32x4_t b = vandq_u32(a, vdupq_n_u32(0x40100400));
+      a = vorrq_u32(a, vdupq_n_u32(0x01f07c1f));
+      a = vandq_u32(a, vdupq_n_u32(0x3fffffff));
+      b = vsubq_u32(b, vshrq_n_u32(b, 5));
+      a = vorrq_u32(a, b);
+      a = vandq_u32(a, vshrq_n_u32(a, 15));
+      vst1q_s32(out, vreinterpretq_s32_u32(a));
+   }
+};
+
+void R_NEONDrawers(columndrawer_t &coldrawer, spandrawer_t &spandrawer)
+{
+   R_SetSIMDDrawers<NEONTraits>(coldrawer, spandrawer);
+}
+
+#endif
+
+// EOF
+
@@ -23,13 +23,19 @@
 // Optimized quad column buffer code.
 // By SoM.
 //
+// Despite the name, the number of columns buffered before they are flushed
+// to the screen a row at a time can be set from 4 to 32 through r_quadwidth.
+//
 //-----------------------------------------------------------------------------
 
 #include "z_zone.h"
 #include "i_system.h"
 
+#include "c_runcmd.h"
 #include "doomstat.h"
+#include "m_compare.h"
 #include "r_draw.h"
+#include "r_drawq.h"
 #include "r_main.h"
 #include "v_alloc.h"
 #include "v_misc.h"
@@ -50,8 +56,11 @@ typedef enum
    COL_FLEXADD
 } columntype_e;
 
+// widest batch of columns the engine can be set to buffer
+#define MAXQUADWIDTH 32
+
 static int    temp_x = 0;
-static int    tempyl[4], tempyh[4];
+static int    tempyl[MAXQUADWIDTH], tempyh[MAXQUADWIDTH];
 static int    startx = 0;
 static int    temptype = COL_NONE;
 static int    commontop, commonbot;
@@ -67,12 +76,12 @@ static byte   *newskymask;
 
 VALLOCATION(tempbuf)
 {
-   tempbuf = ecalloctag(byte *, h*4, sizeof(byte), PU_VALLOC, NULL);
+   tempbuf = ecalloctag(byte *, h*MAXQUADWIDTH, sizeof(byte), PU_VALLOC, NULL);
 }
 
 VALLOCATION(newskymask)
 {
-   newskymask = ecalloctag(byte *, h*4, sizeof(byte), PU_VALLOC, nullptr);
+   newskymask = ecalloctag(byte *, h*MAXQUADWIDTH, sizeof(byte), PU_VALLOC, nullptr);
 }
 
 //
@@ -99,6 +108,7 @@ static void R_QuadFlushNil(void)
 // This is used when a quad flush isn't possible.
 // Opaque version -- no remapping whatsoever.
 //
+template<int W>
 static void R_FlushWholeOpaque()
 {
    const byte *source;
@@ -108,14 +118,14 @@ static void R_FlushWholeOpaque()
    while(--temp_x >= 0)
    {
       yl     = tempyl[temp_x];
-      source = tempbuf + temp_x + (yl << 2);
+      source = tempbuf + temp_x + yl * W;
       dest   = R_ADDRESS(startx + temp_x, yl);
       count  = tempyh[temp_x] - yl + 1;
       
       while(--count >= 0)
       {
          *dest = *source;
-         source += 4;
+         source += W;
          dest += linesize;
       }
    }
@@ -124,6 +134,7 @@ static void R_FlushWholeOpaque()
 //
 // ioanch: doublesky variant
 //
+template<int W>
 static void R_FlushWholeNewSky()
 {
    const byte *source;
@@ -134,8 +145,8 @@ static void R_FlushWholeNewSky()
    while(--temp_x >= 0)
    {
       yl     = tempyl[temp_x];
-      source = tempbuf + temp_x + (yl << 2);
-      mask = newskymask + temp_x + (yl << 2);
+      source = tempbuf + temp_x + yl * W;
+      mask = newskymask + temp_x + yl * W;
       dest   = R_ADDRESS(startx + temp_x, yl);
       count  = tempyh[temp_x] - yl + 1;
 
@@ -143,8 +154,8 @@ static void R_FlushWholeNewSky()
       {
          if(*mask)
             *dest = *source;
-         source += 4;
-         mask += 4;
+         source += W;
+         mask += W;
          dest += linesize;
       }
    }
@@ -157,6 +168,7 @@ static void R_FlushWholeNewSky()
 // preparation for a quad flush.
 // Opaque version -- no remapping whatsoever.
 //
+template<int W>
 static void R_FlushHTOpaque(void)
 {
    const byte *source;
@@ -164,7 +176,7 @@ static void R_FlushHTOpaque(void)
    int count, colnum = 0;
    int yl, yh;
 
-   while(colnum < 4)
+   while(colnum < temp_x)
    {
       yl = tempyl[colnum];
       yh = tempyh[colnum];
@@ -172,14 +184,14 @@ static void R_FlushHTOpaque(void)
       // flush column head
       if(yl < commontop)
       {
-         source = tempbuf + colnum + (yl << 2);
+         source = tempbuf + colnum + yl * W;
          dest   = R_ADDRESS(startx + colnum, yl);
          count  = commontop - yl;
          
          while(--count >= 0)
          {
             *dest = *source;
-            source += 4;
+            source += W;
             dest += linesize;
          }
       }
@@ -187,14 +199,14 @@ static void R_FlushHTOpaque(void)
       // flush column tail
       if(yh > commonbot)
       {
-         source = tempbuf + colnum + ((commonbot + 1) << 2);
+         source = tempbuf + colnum + (commonbot + 1) * W;
          dest   = R_ADDRESS(startx + colnum, commonbot + 1);
          count  = yh - commonbot;
          
          while(--count >= 0)
          {
             *dest = *source;
-            source += 4;
+            source += W;
             dest += linesize;
          }
       }         
@@ -205,6 +217,7 @@ static void R_FlushHTOpaque(void)
 //
 // ioanch: doublesky variant
 //
+template<int W>
 static void R_FlushHTNewSky()
 {
    const byte *source;
@@ -213,7 +226,7 @@ static void R_FlushHTNewSky()
    int count, colnum = 0;
    int yl, yh;
 
-   while(colnum < 4)
+   while(colnum < temp_x)
    {
       yl = tempyl[colnum];
       yh = tempyh[colnum];
@@ -221,8 +234,8 @@ static void R_FlushHTNewSky()
       // flush column head
       if(yl < commontop)
       {
-         source = tempbuf + colnum + (yl << 2);
-         mask = newskymask + colnum + (yl << 2);
+         source = tempbuf + colnum + yl * W;
+         mask = newskymask + colnum + yl * W;
          dest   = R_ADDRESS(startx + colnum, yl);
          count  = commontop - yl;
 
@@ -230,8 +243,8 @@ static void R_FlushHTNewSky()
          {
             if(*mask)
                *dest = *source;
-            source += 4;
-            mask += 4;
+            source += W;
+            mask += W;
             dest += linesize;
          }
       }
@@ -239,8 +252,8 @@ static void R_FlushHTNewSky()
       // flush column tail
       if(yh > commonbot)
       {
-         source = tempbuf + colnum + ((commonbot + 1) << 2);
-         mask = newskymask + colnum + ((commonbot + 1) << 2);
+         source = tempbuf + colnum + (commonbot + 1) * W;
+         mask = newskymask + colnum + (commonbot + 1) * W;
          dest   = R_ADDRESS(startx + colnum, commonbot + 1);
          count  = yh - commonbot;
 
@@ -248,8 +261,8 @@ static void R_FlushHTNewSky()
          {
             if(*mask)
                *dest = *source;
-            source += 4;
-            mask += 4;
+            source += W;
+            mask += W;
             dest += linesize;
          }
       }
@@ -257,6 +270,7 @@ static void R_FlushHTNewSky()
    }
 }
 
+template<int W>
 static void R_FlushWholeTL()
 {
    const byte *source;
@@ -266,7 +280,7 @@ static void R_FlushWholeTL()
    while(--temp_x >= 0)
    {
       yl     = tempyl[temp_x];
-      source = tempbuf + temp_x + (yl << 2);
+      source = tempbuf + temp_x + yl * W;
       dest   = R_ADDRESS(startx + temp_x, yl);
       count  = tempyh[temp_x] - yl + 1;
 
@@ -274,12 +288,13 @@ static void R_FlushWholeTL()
       {
          // haleyjd 09/11/04: use temptranmap here
          *dest = temptranmap[(*dest<<8) + *source];
-         source += 4;
+         source += W;
          dest += linesize;
       }
    }
 }
 
+template<int W>
 static void R_FlushHTTL()
 {
    const byte *source;
@@ -287,7 +302,7 @@ static void R_FlushHTTL()
    int count;
    int colnum = 0, yl, yh;
 
-   while(colnum < 4)
+   while(colnum < temp_x)
    {
       yl = tempyl[colnum];
       yh = tempyh[colnum];
@@ -295,7 +310,7 @@ static void R_FlushHTTL()
       // flush column head
       if(yl < commontop)
       {
-         source = tempbuf + colnum + (yl << 2);
+         source = tempbuf + colnum + yl * W;
          dest   = R_ADDRESS(startx + colnum, yl);
          count  = commontop - yl;
 
@@ -303,7 +318,7 @@ static void R_FlushHTTL()
          {
             // haleyjd 09/11/04: use temptranmap here
             *dest = temptranmap[(*dest<<8) + *source];
-            source += 4;
+            source += W;
             dest += linesize;
          }
       }
@@ -311,7 +326,7 @@ static void R_FlushHTTL()
       // flush column tail
       if(yh > commonbot)
       {
-         source = tempbuf + colnum + ((commonbot + 1) << 2);
+         source = tempbuf + colnum + (commonbot + 1) * W;
          dest   = R_ADDRESS(startx + colnum, commonbot + 1);
          count  = yh - commonbot;
 
@@ -319,7 +334,7 @@ static void R_FlushHTTL()
          {
             // haleyjd 09/11/04: use temptranmap here
             *dest = temptranmap[(*dest<<8) + *source];
-            source += 4;
+            source += W;
             dest += linesize;
          }
       }
@@ -331,35 +346,50 @@ static void R_FlushHTTL()
 #define SRCPIXEL \
    tempfuzzmap[6*256+dest[fuzzoffset[fuzzpos] ? video.pitch: -video.pitch]]
 
+//
+// R_FlushWholeFuzz
+//
+// fuzzpos runs on from one pixel to the next, so the columns are walked in
+// the order the four-column engine used: groups of four from the left, each
+// group from its right column to its left. The pattern is then the same at
+// every batch width.
+//
+template<int W>
 static void R_FlushWholeFuzz()
 {
    const byte *source;
    byte *dest;
-   int  count, yl;
+   int  count, yl, x;
 
-   while(--temp_x >= 0)
+   for(int group = 0; group < temp_x; group += 4)
    {
-      yl     = tempyl[temp_x];
-      source = tempbuf + temp_x + (yl << 2);
-      dest   = R_ADDRESS(startx + temp_x, yl);
-      count  = tempyh[temp_x] - yl + 1;
+      x = emin(group + 4, temp_x);
 
-      while(--count >= 0)
+      while(--x >= group)
       {
-         // SoM 7-28-04: Fix the fuzz problem.
-         *dest = SRCPIXEL;
-         
-         // Clamp table lookup index.
-         if(++fuzzpos == FUZZTABLE) 
-            fuzzpos = 0;
-         
-         source += 4;
-         dest += linesize;
+         yl     = tempyl[x];
+         source = tempbuf + x + yl * W;
+         dest   = R_ADDRESS(startx + x, yl);
+         count  = tempyh[x] - yl + 1;
+
+         while(--count >= 0)
+         {
+            // SoM 7-28-04: Fix the fuzz problem.
+            *dest = SRCPIXEL;
+            
+            // Clamp table lookup index.
+            if(++fuzzpos == FUZZTABLE) 
+               fuzzpos = 0;
+            
+            source += W;
+            dest += linesize;
+         }
       }
    }
 }
 
 /*
+template<int W>
 static void R_FlushHTFuzz()
 {
    byte *source;
@@ -367,7 +397,7 @@ static void R_FlushHTFuzz()
    int count;
    int colnum = 0, yl, yh;
 
-   while(colnum < 4)
+   while(colnum < temp_x)
    {
       yl = tempyl[colnum];
       yh = tempyh[colnum];
@@ -375,7 +405,7 @@ static void R_FlushHTFuzz()
       // flush column head
       if(yl < commontop)
       {
-         source = tempbuf + colnum + (yl << 2);
+         source = tempbuf + colnum + yl * W;
          dest   = ylookup[yl] + columnofs[startx + colnum];
          count  = commontop - yl;
 
@@ -388,7 +418,7 @@ static void R_FlushHTFuzz()
             if(++fuzzpos == FUZZTABLE) 
                fuzzpos = 0;
             
-            source += 4;
+            source += W;
             dest += linesize;
          }
       }
@@ -396,7 +426,7 @@ static void R_FlushHTFuzz()
       // flush column tail
       if(yh > commonbot)
       {
-         source = tempbuf + colnum + ((commonbot + 1) << 2);
+         source = tempbuf + colnum + (commonbot + 1) * W;
          dest   = ylookup[(commonbot + 1)] + columnofs[startx + colnum];
          count  = yh - commonbot;
 
@@ -409,7 +439,7 @@ static void R_FlushHTFuzz()
             if(++fuzzpos == FUZZTABLE) 
                fuzzpos = 0;
             
-            source += 4;
+            source += W;
             dest += linesize;
          }
       }
@@ -421,6 +451,7 @@ static void R_FlushHTFuzz()
 
 #undef SRCPIXEL
 
+template<int W>
 static void R_FlushWholeFlex()
 {
    const byte *source;
@@ -431,7 +462,7 @@ static void R_FlushWholeFlex()
    while(--temp_x >= 0)
    {
       yl     = tempyl[temp_x];
-      source = tempbuf + temp_x + (yl << 2);
+      source = tempbuf + temp_x + yl * W;
       dest   = R_ADDRESS(startx + temp_x, yl);
       count  = tempyh[temp_x] - yl + 1;
 
@@ -443,12 +474,13 @@ static void R_FlushWholeFlex()
          fg = (fg+bg) | 0x1f07c1f;
          *dest = RGB32k[0][0][fg & (fg>>15)];
          
-         source += 4;
+         source += W;
          dest += linesize;
       }
    }
 }
 
+template<int W>
 static void R_FlushHTFlex()
 {
    const byte *source;
@@ -457,7 +489,7 @@ static void R_FlushHTFlex()
    int colnum = 0, yl, yh;
    unsigned int fg, bg;
 
-   while(colnum < 4)
+   while(colnum < temp_x)
    {
       yl = tempyl[colnum];
       yh = tempyh[colnum];
@@ -465,7 +497,7 @@ static void R_FlushHTFlex()
       // flush column head
       if(yl < commontop)
       {
-         source = tempbuf + colnum + (yl << 2);
+         source = tempbuf + colnum + yl * W;
          dest   = R_ADDRESS(startx + colnum, yl);
          count  = commontop - yl;
 
@@ -477,7 +509,7 @@ static void R_FlushHTFlex()
             fg = (fg+bg) | 0x1f07c1f;
             *dest = RGB32k[0][0][fg & (fg>>15)];
             
-            source += 4;
+            source += W;
             dest += linesize;
          }
       }
@@ -485,7 +517,7 @@ static void R_FlushHTFlex()
       // flush column tail
       if(yh > commonbot)
       {
-         source = tempbuf + colnum + ((commonbot + 1) << 2);
+         source = tempbuf + colnum + (commonbot + 1) * W;
          dest   = R_ADDRESS(startx + colnum, commonbot + 1);
          count  = yh - commonbot;
 
@@ -497,7 +529,7 @@ static void R_FlushHTFlex()
             fg = (fg+bg) | 0x1f07c1f;
             *dest = RGB32k[0][0][fg & (fg>>15)];
             
-            source += 4;
+            source += W;
             dest += linesize;
          }
       }
@@ -506,6 +538,7 @@ static void R_FlushHTFlex()
    }
 }
 
+template<int W>
 static void R_FlushWholeFlexAdd()
 {
    const byte *source;
@@ -516,7 +549,7 @@ static void R_FlushWholeFlexAdd()
    while(--temp_x >= 0)
    {
       yl     = tempyl[temp_x];
-      source = tempbuf + temp_x + (yl << 2);
+      source = tempbuf + temp_x + yl * W;
       dest   = R_ADDRESS(startx + temp_x, yl);
       count  = tempyh[temp_x] - yl + 1;
 
@@ -534,12 +567,13 @@ static void R_FlushWholeFlexAdd()
          
          *dest = RGB32k[0][0][a & (a >> 15)];
          
-         source += 4;
+         source += W;
          dest += linesize;
       }
    }
 }
 
+template<int W>
 static void R_FlushHTFlexAdd()
 {
    const byte *source;
@@ -548,7 +582,7 @@ static void R_FlushHTFlexAdd()
    int colnum = 0, yl, yh;
    unsigned int a, b;
 
-   while(colnum < 4)
+   while(colnum < temp_x)
    {
       yl = tempyl[colnum];
       yh = tempyh[colnum];
@@ -556,7 +590,7 @@ static void R_FlushHTFlexAdd()
       // flush column head
       if(yl < commontop)
       {
-         source = tempbuf + colnum + (yl << 2);
+         source = tempbuf + colnum + yl * W;
          dest   = R_ADDRESS(startx + colnum, yl);
          count  = commontop - yl;
 
@@ -574,7 +608,7 @@ static void R_FlushHTFlexAdd()
             
             *dest = RGB32k[0][0][a & (a >> 15)];
             
-            source += 4;
+            source += W;
             dest += linesize;
          }
       }
@@ -582,7 +616,7 @@ static void R_FlushHTFlexAdd()
       // flush column tail
       if(yh > commonbot)
       {
-         source = tempbuf + colnum + ((commonbot + 1) << 2);
+         source = tempbuf + colnum + (commonbot + 1) * W;
          dest   = R_ADDRESS(startx + colnum, commonbot + 1);
          count  = yh - commonbot;
 
@@ -600,7 +634,7 @@ static void R_FlushHTFlexAdd()
             
             *dest = RGB32k[0][0][a & (a >> 15)];
             
-            source += 4;
+            source += W;
             dest += linesize;
          }
       }
@@ -613,58 +647,85 @@ static void (*R_FlushWholeColumns)() = R_FlushWholeNil;
 static void (*R_FlushHTColumns)()    = R_FlushHTNil;
 
 // Begin: Quad column flushing functions.
+//
+// Each row of the batch is up to W bytes wide and contiguous, so it is written
+// to the screen with a single copy (or a single pass of the blending loop)
+// that the compiler can turn into wide stores. A full batch hands the row
+// loop W as a constant, so that it can be unrolled; a batch cut short by a
+// gap between columns uses its actual width.
+//
+template<int W>
 static void R_FlushQuadOpaque()
 {
-   const int *source = reinterpret_cast<const int *>(tempbuf + (commontop << 2));
-   int *dest = reinterpret_cast<int *>(R_ADDRESS(startx, commontop));
-   int count;
-   int deststep = linesize / 4;
-
-   count = commonbot - commontop + 1;
+   const byte *source = tempbuf + commontop * W;
+   byte *dest = R_ADDRESS(startx, commontop);
+   int count = commonbot - commontop + 1;
 
-   while(--count >= 0)
+   auto flush = [&](const int width)
    {
-      *dest = *source++;
-      dest += deststep;
-   }
+      while(--count >= 0)
+      {
+         memcpy(dest, source, width);
+         source += W;
+         dest += linesize;
+      }
+   };
+
+   if(temp_x == W)
+      flush(W);
+   else
+      flush(temp_x);
 }
 
 // ioanch: doublesky variant
+template<int W>
 static void R_FlushQuadNewSky()
 {
-   const int *source = reinterpret_cast<const int *>(tempbuf + (commontop << 2));
-   const int *mask = reinterpret_cast<const int *>(newskymask + (commontop << 2));
-   int *dest = reinterpret_cast<int *>(R_ADDRESS(startx, commontop));
-   int count;
-   int deststep = linesize / 4;
-
-   count = commonbot - commontop + 1;
+   const byte *source = tempbuf + commontop * W;
+   const byte *mask = newskymask + commontop * W;
+   byte *dest = R_ADDRESS(startx, commontop);
+   int count = commonbot - commontop + 1;
 
-   while(--count >= 0)
+   auto flush = [&](const int width)
    {
-      *dest = (*dest & ~*mask) | (*source++ & *mask);
-      ++mask;
-      dest += deststep;
-   }
+      while(--count >= 0)
+      {
+         for(int i = 0; i < width; i++)
+            dest[i] = (dest[i] & ~mask[i]) | (source[i] & mask[i]);
+         source += W;
+         mask += W;
+         dest += linesize;
+      }
+   };
+
+   if(temp_x == W)
+      flush(W);
+   else
+      flush(temp_x);
 }
 
+template<int W>
 static void R_FlushQuadTL()
 {
-   const byte *source = tempbuf + (commontop << 2);
+   const byte *source = tempbuf + commontop * W;
    byte *dest   = R_ADDRESS(startx, commontop);
-   int count;
-
-   count = commonbot - commontop + 1;
+   int count = commonbot - commontop + 1;
 
-   while(--count >= 0)
+   auto flush = [&](const int width)
    {
-      *dest   = temptranmap[(*dest<<8) + *source];
-      dest[1] = temptranmap[(dest[1]<<8) + source[1]];
-      dest[2] = temptranmap[(dest[2]<<8) + source[2]];
-      dest[3] = temptranmap[(dest[3]<<8) + source[3]];
-      source += 4;
-      dest += linesize;
-   }
+      while(--count >= 0)
+      {
+         for(int i = 0; i < width; i++)
+            dest[i] = temptranmap[(dest[i]<<8) + source[i]];
+         source += W;
+         dest += linesize;
+      }
+   };
+
+   if(temp_x == W)
+      flush(W);
+   else
+      flush(temp_x);
 }
 
 /*
@@ -673,7 +734,7 @@ static void R_FlushQuadTL()
 
 static void R_FlushQuadFuzz()
 {
-   byte *source = tempbuf + (commontop << 2);
+   byte *source = tempbuf + commontop * W;
    byte *dest = ylookup[commontop] + columnofs[startx];
    int count;
    int fuzz1, fuzz2, fuzz3, fuzz4;
@@ -700,7 +761,7 @@ static void R_FlushQuadFuzz()
       dest[3] = SRCPIXEL(3, fuzz4);
       if(++fuzz4 == FUZZTABLE) fuzz4 = 0;
 
-      source += 4;
+      source += W;
       dest += linesize;
    }
 
@@ -710,101 +771,85 @@ static void R_FlushQuadFuzz()
 #undef SRCPIXEL
 */
 
+template<int W>
 static void R_FlushQuadFlex()
 {
-   const byte *source = tempbuf + (commontop << 2);
+   const byte *source = tempbuf + commontop * W;
    byte *dest   = R_ADDRESS(startx, commontop);
-   int count;
-   unsigned int fg, bg;
-
-   count = commonbot - commontop + 1;
+   int count = commonbot - commontop + 1;
 
-   while(--count >= 0)
+   auto flush = [&](const int width)
    {
-      // haleyjd 09/12/04: use precalculated lookups
-      fg = temp_fg2rgb[*source];
-      bg = temp_bg2rgb[*dest];
-      fg = (fg+bg) | 0x1f07c1f;
-      *dest = RGB32k[0][0][fg & (fg>>15)];
-
-      fg = temp_fg2rgb[source[1]];
-      bg = temp_bg2rgb[dest[1]];
-      fg = (fg+bg) | 0x1f07c1f;
-      dest[1] = RGB32k[0][0][fg & (fg>>15)];
-
-      fg = temp_fg2rgb[source[2]];
-      bg = temp_bg2rgb[dest[2]];
-      fg = (fg+bg) | 0x1f07c1f;
-      dest[2] = RGB32k[0][0][fg & (fg>>15)];
-
-      fg = temp_fg2rgb[source[3]];
-      bg = temp_bg2rgb[dest[3]];
-      fg = (fg+bg) | 0x1f07c1f;
-      dest[3] = RGB32k[0][0][fg & (fg>>15)];
-
-      source += 4;
-      dest += linesize;
-   }
+      unsigned int fg, bg;
+
+      while(--count >= 0)
+      {
+         for(int i = 0; i < width; i++)
+         {
+            // haleyjd 09/12/04: use precalculated lookups
+            fg = temp_fg2rgb[source[i]];
+            bg = temp_bg2rgb[dest[i]];
+            fg = (fg+bg) | 0x1f07c1f;
+            dest[i] = RGB32k[0][0][fg & (fg>>15)];
+         }
+         source += W;
+         dest += linesize;
+      }
+   };
+
+   if(temp_x == W)
+      flush(W);
+   else
+      flush(temp_x);
 }
 
+template<int W>
 static void R_FlushQuadFlexAdd()
 {
-   const byte *source = tempbuf + (commontop << 2);
+   const byte *source = tempbuf + commontop * W;
    byte *dest   = R_ADDRESS(startx, commontop);
-   int count;
-   unsigned int a, b;
-
-   count = commonbot - commontop + 1;
+   int count = commonbot - commontop + 1;
 
-   while(--count >= 0)
+   auto flush = [&](const int width)
    {
-      // haleyjd 02/08/05: this is NOT gonna be very fast.
-      a = temp_fg2rgb[*source] + temp_bg2rgb[*dest];
-      b = a;
-      a |= 0x01f07c1f;
-      b &= 0x40100400;
-      a &= 0x3fffffff;
-      b  = b - (b >> 5);
-      a |= b;
-      *dest = RGB32k[0][0][a & (a >> 15)];
-
-      a = temp_fg2rgb[source[1]] + temp_bg2rgb[dest[1]];
-      b = a;
-      a |= 0x01f07c1f;
-      b &= 0x40100400;
-      a &= 0x3fffffff;
-      b  = b - (b >> 5);
-      a |= b;
-      dest[1] = RGB32k[0][0][a & (a >> 15)];
-
-      a = temp_fg2rgb[source[2]] + temp_bg2rgb[dest[2]];
-      b = a;
-      a |= 0x01f07c1f;
-      b &= 0x40100400;
-      a &= 0x3fffffff;
-      b  = b - (b >> 5);
-      a |= b;
-      dest[2] = RGB32k[0][0][a & (a >> 15)];
-
-      a = temp_fg2rgb[source[3]] + temp_bg2rgb[dest[3]];
-      b = a;
-      a |= 0x01f07c1f;
-      b &= 0x40100400;
-      a &= 0x3fffffff;
-      b  = b - (b >> 5);
-      a |= b;
-      dest[3] = RGB32k[0][0][a & (a >> 15)];
-
-      source += 4;
-      dest += linesize;
-   }
+      unsigned int a, b;
+
+      while(--count >= 0)
+      {
+         for(int i = 0; i < width; i++)
+         {
+            // haleyjd 02/08/05: this is NOT gonna be very fast.
+            a = temp_fg2rgb[source[i]] + temp_bg2rgb[dest[i]];
+            b = a;
+            a |= 0x01f07c1f;
+            b &= 0x40100400;
+            a &= 0x3fffffff;
+            b  = b - (b >> 5);
+            a |= b;
+            dest[i] = RGB32k[0][0][a & (a >> 15)];
+         }
+         source += W;
+         dest += linesize;
+      }
+   };
+
+   if(temp_x == W)
+      flush(W);
+   else
+      flush(temp_x);
 }
 
 static void (*R_FlushQuadColumn)(void) = R_QuadFlushNil;
 
+//
+// R_FlushColumns
+//
+// Batches of at least four columns are flushed a row at a time; a batch may
+// be shorter than the engine width when the columns stop being contiguous.
+//
 static void R_FlushColumns(void)
 {
-   if(temp_x != 4 || commontop >= commonbot || temptype == COL_FUZZ)
+   if(temp_x < 4 || commontop >= commonbot || temptype == COL_FUZZ)
       R_FlushWholeColumns();
    else
    {
@@ -836,10 +881,11 @@ static void R_QResetColumnBuffer(void)
 // functions to minimize the number of branches and take advantage
 // of as much precalculated information as possible.
 
+template<int W>
 static byte *R_GetBufferOpaque(void)
 {
    // haleyjd: reordered predicates
-   if(temp_x == 4 ||
+   if(temp_x == W ||
       (temp_x && (temptype != COL_OPAQUE || temp_x + startx != column.x)))
       R_FlushColumns();
 
@@ -850,10 +896,10 @@ static byte *R_GetBufferOpaque(void)
       *tempyl = commontop = column.y1;
       *tempyh = commonbot = column.y2;
       temptype = COL_OPAQUE;
-      R_FlushWholeColumns = R_FlushWholeOpaque;
-      R_FlushHTColumns    = R_FlushHTOpaque;
-      R_FlushQuadColumn   = R_FlushQuadOpaque;
-      return tempbuf + (column.y1 << 2);
+      R_FlushWholeColumns = R_FlushWholeOpaque<W>;
+      R_FlushHTColumns    = R_FlushHTOpaque<W>;
+      R_FlushQuadColumn   = R_FlushQuadOpaque<W>;
+      return tempbuf + column.y1 * W;
    }
 
    tempyl[temp_x] = column.y1;
@@ -864,16 +910,17 @@ static byte *R_GetBufferOpaque(void)
    if(column.y2 < commonbot)
       commonbot = column.y2;
       
-   return tempbuf + (column.y1 << 2) + temp_x++;
+   return tempbuf + column.y1 * W + temp_x++;
 }
 
 //
 // ioanch: doublesky variant
 //
+template<int W>
 static byte *R_GetBufferNewSky(byte *&mask)
 {
    // haleyjd: reordered predicates
-   if(temp_x == 4 ||
+   if(temp_x == W ||
       (temp_x && (temptype != COL_NEWSKY || temp_x + startx != column.x)))
       R_FlushColumns();
 
@@ -884,11 +931,11 @@ static byte *R_GetBufferNewSky(byte *&mask)
       *tempyl = commontop = column.y1;
       *tempyh = commonbot = column.y2;
       temptype = COL_NEWSKY;
-      R_FlushWholeColumns = R_FlushWholeNewSky;
-      R_FlushHTColumns    = R_FlushHTNewSky;
-      R_FlushQuadColumn   = R_FlushQuadNewSky;
-      mask = newskymask + (column.y1 << 2);
-      return tempbuf + (column.y1 << 2);
+      R_FlushWholeColumns = R_FlushWholeNewSky<W>;
+      R_FlushHTColumns    = R_FlushHTNewSky<W>;
+      R_FlushQuadColumn   = R_FlushQuadNewSky<W>;
+      mask = newskymask + column.y1 * W;
+      return tempbuf + column.y1 * W;
    }
 
    tempyl[temp_x] = column.y1;
@@ -899,14 +946,15 @@ static byte *R_GetBufferNewSky(byte *&mask)
    if(column.y2 < commonbot)
       commonbot = column.y2;
 
-   mask = newskymask + (column.y1 << 2) + temp_x;
-   return tempbuf + (column.y1 << 2) + temp_x++;
+   mask = newskymask + column.y1 * W + temp_x;
+   return tempbuf + column.y1 * W + temp_x++;
 }
 
+template<int W>
 static byte *R_GetBufferTrans(void)
 {
    // haleyjd: reordered predicates
-   if(temp_x == 4 || tranmap != temptranmap ||
+   if(temp_x == W || tranmap != temptranmap ||
       (temp_x && (temptype != COL_TRANS || temp_x + startx != column.x)))
       R_FlushColumns();
 
@@ -918,10 +966,10 @@ static byte *R_GetBufferTrans(void)
       *tempyh = commonbot = column.y2;
       temptype = COL_TRANS;
       temptranmap = tranmap;
-      R_FlushWholeColumns = R_FlushWholeTL;
-      R_FlushHTColumns    = R_FlushHTTL;
-      R_FlushQuadColumn   = R_FlushQuadTL;
-      return tempbuf + (column.y1 << 2);
+      R_FlushWholeColumns = R_FlushWholeTL<W>;
+      R_FlushHTColumns    = R_FlushHTTL<W>;
+      R_FlushQuadColumn   = R_FlushQuadTL<W>;
+      return tempbuf + column.y1 * W;
    }
 
    tempyl[temp_x] = column.y1;
@@ -932,13 +980,14 @@ static byte *R_GetBufferTrans(void)
    if(column.y2 < commonbot)
       commonbot = column.y2;
       
-   return tempbuf + (column.y1 << 2) + temp_x++;
+   return tempbuf + column.y1 * W + temp_x++;
 }
 
+template<int W>
 static byte *R_GetBufferFlexTrans(void)
 {
    // haleyjd: reordered predicates
-   if(temp_x == 4 || temptranslevel != column.translevel ||
+   if(temp_x == W || temptranslevel != column.translevel ||
       (temp_x && (temptype != COL_FLEXTRANS || temp_x + startx != column.x)))
       R_FlushColumns();
 
@@ -962,10 +1011,10 @@ static byte *R_GetBufferFlexTrans(void)
          temp_bg2rgb  = Col2RGB8[bglevel >> 10];
       }
 
-      R_FlushWholeColumns = R_FlushWholeFlex;
-      R_FlushHTColumns    = R_FlushHTFlex;
-      R_FlushQuadColumn   = R_FlushQuadFlex;
-      return tempbuf + (column.y1 << 2);
+      R_FlushWholeColumns = R_FlushWholeFlex<W>;
+      R_FlushHTColumns    = R_FlushHTFlex<W>;
+      R_FlushQuadColumn   = R_FlushQuadFlex<W>;
+      return tempbuf + column.y1 * W;
    }
 
    tempyl[temp_x] = column.y1;
@@ -976,13 +1025,14 @@ static byte *R_GetBufferFlexTrans(void)
    if(column.y2 < commonbot)
       commonbot = column.y2;
       
-   return tempbuf + (column.y1 << 2) + temp_x++;
+   return tempbuf + column.y1 * W + temp_x++;
 }
 
+template<int W>
 static byte *R_GetBufferFlexAdd(void)
 {
    // haleyjd: reordered predicates
-   if(temp_x == 4 || temptranslevel != column.translevel ||
+   if(temp_x == W || temptranslevel != column.translevel ||
       (temp_x && (temptype != COL_FLEXADD || temp_x + startx != column.x)))
       R_FlushColumns();
 
@@ -1004,10 +1054,10 @@ static byte *R_GetBufferFlexAdd(void)
          temp_bg2rgb  = Col2RGB8_LessPrecision[bglevel >> 10];
       }
 
-      R_FlushWholeColumns = R_FlushWholeFlexAdd;
-      R_FlushHTColumns    = R_FlushHTFlexAdd;
-      R_FlushQuadColumn   = R_FlushQuadFlexAdd;
-      return tempbuf + (column.y1 << 2);
+      R_FlushWholeColumns = R_FlushWholeFlexAdd<W>;
+      R_FlushHTColumns    = R_FlushHTFlexAdd<W>;
+      R_FlushQuadColumn   = R_FlushQuadFlexAdd<W>;
+      return tempbuf + column.y1 * W;
    }
 
    tempyl[temp_x] = column.y1;
@@ -1018,13 +1068,14 @@ static byte *R_GetBufferFlexAdd(void)
    if(column.y2 < commonbot)
       commonbot = column.y2;
       
-   return tempbuf + (column.y1 << 2) + temp_x++;
+   return tempbuf + column.y1 * W + temp_x++;
 }
 
+template<int W>
 static byte *R_GetBufferFuzz(void)
 {
    // haleyjd: reordered predicates
-   if(temp_x == 4 ||
+   if(temp_x == W ||
       (temp_x && (temptype != COL_FUZZ || temp_x + startx != column.x)))
       R_FlushColumns();
 
@@ -1036,10 +1087,10 @@ static byte *R_GetBufferFuzz(void)
       *tempyh = commonbot = column.y2;
       temptype = COL_FUZZ;
       tempfuzzmap = column.colormap; // SoM 7-28-04: Fix the fuzz problem.
-      R_FlushWholeColumns = R_FlushWholeFuzz;
+      R_FlushWholeColumns = R_FlushWholeFuzz<W>;
       R_FlushHTColumns    = R_FlushHTNil;
       R_FlushQuadColumn   = R_QuadFlushNil;
-      return tempbuf + (column.y1 << 2);
+      return tempbuf + column.y1 * W;
    }
 
    tempyl[temp_x] = column.y1;
@@ -1050,9 +1101,10 @@ static byte *R_GetBufferFuzz(void)
    if(column.y2 < commonbot)
       commonbot = column.y2;
       
-   return tempbuf + (column.y1 << 2) + temp_x++;
+   return tempbuf + column.y1 * W + temp_x++;
 }
 
+template<int W>
 static void R_QDrawColumn() 
 { 
    int      count; 
@@ -1073,7 +1125,7 @@ static void R_QDrawColumn()
 
    // Framebuffer destination address.
    // SoM: MAGIC
-   dest = R_GetBufferOpaque();
+   dest = R_GetBufferOpaque<W>();
 
    // Determine scaling, which is the only mapping to be done.
 
@@ -1110,7 +1162,7 @@ static void R_QDrawColumn()
             // heightmask is the Tutti-Frutti fix -- killough
             
             *dest = colormap[source[frac>>FRACBITS]];
-            dest += 4; //SoM: Oh, Oh it's MAGIC! You know...
+            dest += W; //SoM: Oh, Oh it's MAGIC! You know...
             if((frac += fracstep) >= (int)heightmask)
                frac -= heightmask;
          } 
@@ -1121,10 +1173,10 @@ static void R_QDrawColumn()
          while((count -= 2) >= 0)   // texture height is a power of 2 -- killough
          {
             *dest = colormap[source[(frac>>FRACBITS) & heightmask]];
-            dest += 4; //SoM: MAGIC 
+            dest += W; //SoM: MAGIC 
             frac += fracstep;
             *dest = colormap[source[(frac>>FRACBITS) & heightmask]];
-            dest += 4;
+            dest += W;
             frac += fracstep;
          }
          if(count & 1)
@@ -1137,6 +1189,7 @@ static void R_QDrawColumn()
 // ioanch: Hexen-style double-sky drawer. Like R_QDrawColumn but avoids drawing
 // if source has index 0.
 //
+template<int W>
 static void R_QDrawNewSkyColumn()
 {
    int      count;
@@ -1158,7 +1211,7 @@ static void R_QDrawNewSkyColumn()
 
    // Framebuffer destination address.
    // SoM: MAGIC
-   dest = R_GetBufferNewSky(mask);
+   dest = R_GetBufferNewSky<W>(mask);
 
    // Determine scaling, which is the only mapping to be done.
 
@@ -1196,8 +1249,8 @@ static void R_QDrawNewSkyColumn()
 
             *dest = colormap[source[frac>>FRACBITS]];
             *mask = -!!source[frac>>FRACBITS];
-            dest += 4; //SoM: Oh, Oh it's MAGIC! You know...
-            mask += 4;
+            dest += W; //SoM: Oh, Oh it's MAGIC! You know...
+            mask += W;
             if((frac += fracstep) >= (int)heightmask)
                frac -= heightmask;
          }
@@ -1209,13 +1262,13 @@ static void R_QDrawNewSkyColumn()
          {
             *dest = colormap[source[(frac>>FRACBITS) & heightmask]];
             *mask = -!!source[(frac>>FRACBITS) & heightmask];
-            dest += 4; //SoM: MAGIC
-            mask += 4;
+            dest += W; //SoM: MAGIC
+            mask += W;
             frac += fracstep;
             *dest = colormap[source[(frac>>FRACBITS) & heightmask]];
             *mask = -!!source[(frac>>FRACBITS) & heightmask];
-            dest += 4;
-            mask += 4;
+            dest += W;
+            mask += W;
             frac += fracstep;
          }
          if(count & 1)
@@ -1227,6 +1280,7 @@ static void R_QDrawNewSkyColumn()
    }
 }
 
+template<int W>
 static void R_QDrawTLColumn()                                           
 { 
    int      count; 
@@ -1247,7 +1301,7 @@ static void R_QDrawTLColumn()
 #endif 
    
    // SoM: MAGIC
-   dest = R_GetBufferTrans();
+   dest = R_GetBufferTrans<W>();
       
    fracstep = column.step; 
    frac = column.texmid + (int)((column.y1 - view.ycenter + 1) * fracstep);
@@ -1275,7 +1329,7 @@ static void R_QDrawTLColumn()
          do
          {
             *dest = colormap[source[frac>>FRACBITS]];
-            dest += 4; //SoM: Oh, Oh it's MAGIC! You know...
+            dest += W; //SoM: Oh, Oh it's MAGIC! You know...
             if((frac += fracstep) >= (int)heightmask)
                frac -= heightmask;
          } 
@@ -1286,10 +1340,10 @@ static void R_QDrawTLColumn()
          while((count -= 2) >= 0) // texture height is a power of 2 -- killough
          {
             *dest = colormap[source[(frac>>FRACBITS) & heightmask]];
-            dest += 4; //SoM: MAGIC 
+            dest += W; //SoM: MAGIC 
             frac += fracstep;
             *dest = colormap[source[(frac>>FRACBITS) & heightmask]];
-            dest += 4;
+            dest += W;
             frac += fracstep;
          }
          if(count & 1)
@@ -1302,6 +1356,7 @@ static void R_QDrawTLColumn()
 #define SRCPIXEL \
    colormap[column.translation[source[(frac>>FRACBITS) & heightmask]]]
 
+template<int W>
 static void R_QDrawTLTRColumn()
 { 
    int      count; 
@@ -1322,7 +1377,7 @@ static void R_QDrawTLTRColumn()
 #endif 
 
    // SoM: MAGIC
-   dest = R_GetBufferTrans();
+   dest = R_GetBufferTrans<W>();
    
    fracstep = column.step; 
    frac = column.texmid + (int)((column.y1 - view.ycenter + 1) * fracstep);
@@ -1346,7 +1401,7 @@ static void R_QDrawTLTRColumn()
          do
          {
             *dest = colormap[column.translation[source[frac>>FRACBITS]]];
-            dest += 4; //SoM: Oh, Oh it's MAGIC! You know...
+            dest += W; //SoM: Oh, Oh it's MAGIC! You know...
             if((frac += fracstep) >= (int)heightmask)
                frac -= heightmask;
          } 
@@ -1357,10 +1412,10 @@ static void R_QDrawTLTRColumn()
          while((count -= 2) >= 0) // texture height is a power of 2 -- killough
          {
             *dest = SRCPIXEL;
-            dest += 4; //SoM: MAGIC 
+            dest += W; //SoM: MAGIC 
             frac += fracstep;
             *dest = SRCPIXEL;
-            dest += 4;
+            dest += W;
             frac += fracstep;
          }
          if(count & 1)
@@ -1375,6 +1430,7 @@ static void R_QDrawTLTRColumn()
 // Spectre/Invisibility.
 //
 
+template<int W>
 static void R_QDrawFuzzColumn(void) 
 { 
    // Adjust borders. Low...
@@ -1398,7 +1454,7 @@ static void R_QDrawFuzzColumn(void)
 #endif
 
    // SoM: MAGIC
-   R_GetBufferFuzz();
+   R_GetBufferFuzz<W>();
    
    // REAL MAGIC... you ready for this?
    return; // DONE
@@ -1407,6 +1463,7 @@ static void R_QDrawFuzzColumn(void)
 #define SRCPIXEL \
    colormap[column.translation[source[(frac>>FRACBITS) & heightmask]]]
 
+template<int W>
 static void R_QDrawTRColumn(void) 
 { 
    int      count; 
@@ -1425,7 +1482,7 @@ static void R_QDrawTRColumn(void)
 #endif 
 
    // SoM: MAGIC
-   dest = R_GetBufferOpaque();
+   dest = R_GetBufferOpaque<W>();
    
    // Looks familiar.
    fracstep = column.step; 
@@ -1453,7 +1510,7 @@ static void R_QDrawTRColumn(void)
          do
          {
             *dest = colormap[column.translation[source[frac>>FRACBITS]]];
-            dest += 4; //SoM: Oh, Oh it's MAGIC! You know...
+            dest += W; //SoM: Oh, Oh it's MAGIC! You know...
             if((frac += fracstep) >= (int)heightmask)
                frac -= heightmask;
          } 
@@ -1464,10 +1521,10 @@ static void R_QDrawTRColumn(void)
          while((count -= 2) >= 0) // texture height is a power of 2 -- killough
          {
             *dest = SRCPIXEL;
-            dest += 4; //SoM: MAGIC 
+            dest += W; //SoM: MAGIC 
             frac += fracstep;
             *dest = SRCPIXEL;
-            dest += 4;
+            dest += W;
             frac += fracstep;
          }
          if(count & 1)
@@ -1483,6 +1540,7 @@ static void R_QDrawTRColumn(void)
 //
 // haleyjd 09/01/02: zdoom-style translucency
 //
+template<int W>
 static void R_QDrawFlexColumn()
 { 
    int      count; 
@@ -1503,7 +1561,7 @@ static void R_QDrawFlexColumn()
 #endif 
    
    // SoM: MAGIC
-   dest = R_GetBufferFlexTrans();
+   dest = R_GetBufferFlexTrans<W>();
   
    fracstep = column.step; 
    frac = column.texmid + (int)((column.y1 - view.ycenter + 1) * fracstep);
@@ -1527,7 +1585,7 @@ static void R_QDrawFlexColumn()
          do
          {
             *dest = colormap[source[frac>>FRACBITS]];
-            dest += 4; //SoM: Oh, Oh it's MAGIC! You know...
+            dest += W; //SoM: Oh, Oh it's MAGIC! You know...
             if((frac += fracstep) >= (int)heightmask)
                frac -= heightmask;
          } 
@@ -1538,10 +1596,10 @@ static void R_QDrawFlexColumn()
          while((count -= 2) >= 0) // texture height is a power of 2 -- killough
          {
             *dest = colormap[source[(frac>>FRACBITS) & heightmask]];
-            dest += 4; //SoM: MAGIC 
+            dest += W; //SoM: MAGIC 
             frac += fracstep;
             *dest = colormap[source[(frac>>FRACBITS) & heightmask]];
-            dest += 4;
+            dest += W;
             frac += fracstep;
          }
          if(count & 1)
@@ -1559,6 +1617,7 @@ static void R_QDrawFlexColumn()
 // haleyjd 11/05/02: zdoom-style translucency w/translation, for
 // player sprites
 //
+template<int W>
 static void R_QDrawFlexTRColumn(void) 
 { 
    int      count; 
@@ -1577,7 +1636,7 @@ static void R_QDrawFlexTRColumn(void)
 #endif 
 
    // MAGIC
-   dest = R_GetBufferFlexTrans();
+   dest = R_GetBufferFlexTrans<W>();
    
    // Looks familiar.
    fracstep = column.step; 
@@ -1605,7 +1664,7 @@ static void R_QDrawFlexTRColumn(void)
          do
          {
             *dest = colormap[column.translation[source[frac>>FRACBITS]]];
-            dest += 4; //SoM: Oh, Oh it's MAGIC! You know...
+            dest += W; //SoM: Oh, Oh it's MAGIC! You know...
             if((frac += fracstep) >= (int)heightmask)
                frac -= heightmask;
          } 
@@ -1616,10 +1675,10 @@ static void R_QDrawFlexTRColumn(void)
          while((count -= 2) >= 0) // texture height is a power of 2 -- killough
          {
             *dest = SRCPIXEL;
-            dest += 4; //SoM: MAGIC 
+            dest += W; //SoM: MAGIC 
             frac += fracstep;
             *dest = SRCPIXEL;
-            dest += 4;
+            dest += W;
             frac += fracstep;
          }
          if(count & 1)
@@ -1635,6 +1694,7 @@ static void R_QDrawFlexTRColumn(void)
 //
 // haleyjd 02/08/05: additive translucency
 //
+template<int W>
 static void R_QDrawAddColumn()
 { 
    int      count; 
@@ -1655,7 +1715,7 @@ static void R_QDrawAddColumn()
 #endif 
    
    // SoM: MAGIC
-   dest = R_GetBufferFlexAdd();
+   dest = R_GetBufferFlexAdd<W>();
   
    fracstep = column.step; 
    frac = column.texmid + (int)((column.y1 - view.ycenter + 1) * fracstep);
@@ -1679,7 +1739,7 @@ static void R_QDrawAddColumn()
          do
          {            
             *dest = colormap[source[frac>>FRACBITS]];
-            dest += 4; //SoM: Oh, Oh it's MAGIC! You know...
+            dest += W; //SoM: Oh, Oh it's MAGIC! You know...
             if((frac += fracstep) >= (int)heightmask)
                frac -= heightmask;
          } 
@@ -1690,10 +1750,10 @@ static void R_QDrawAddColumn()
          while((count -= 2) >= 0) // texture height is a power of 2 -- killough
          {
             *dest = colormap[source[(frac>>FRACBITS) & heightmask]];
-            dest += 4; //SoM: MAGIC 
+            dest += W; //SoM: MAGIC 
             frac += fracstep;
             *dest = colormap[source[(frac>>FRACBITS) & heightmask]];
-            dest += 4;
+            dest += W;
             frac += fracstep;
          }
          if(count & 1)
@@ -1710,6 +1770,7 @@ static void R_QDrawAddColumn()
 //
 // haleyjd 02/08/05: additive translucency + translation
 //
+template<int W>
 static void R_QDrawAddTRColumn(void) 
 { 
    int      count; 
@@ -1728,7 +1789,7 @@ static void R_QDrawAddTRColumn(void)
 #endif 
 
    // MAGIC
-   dest = R_GetBufferFlexAdd();
+   dest = R_GetBufferFlexAdd<W>();
    
    // Looks familiar.
    fracstep = column.step;
@@ -1756,7 +1817,7 @@ static void R_QDrawAddTRColumn(void)
          do
          {
             *dest = colormap[column.translation[source[frac>>FRACBITS]]];
-            dest += 4; //SoM: Oh, Oh it's MAGIC! You know...
+            dest += W; //SoM: Oh, Oh it's MAGIC! You know...
             if((frac += fracstep) >= (int)heightmask)
                frac -= heightmask;
          } 
@@ -1767,10 +1828,10 @@ static void R_QDrawAddTRColumn(void)
          while((count -= 2) >= 0) // texture height is a power of 2 -- killough
          {
             *dest = SRCPIXEL;
-            dest += 4; //SoM: MAGIC 
+            dest += W; //SoM: MAGIC 
             frac += fracstep;
             *dest = SRCPIXEL;
-            dest += 4;
+            dest += W;
             frac += fracstep;
          }
          if(count & 1)
@@ -1784,31 +1845,62 @@ static void R_QDrawAddTRColumn(void)
 //
 // haleyjd 09/04/06: Quad Column Drawer Object
 //
-columndrawer_t r_quad_drawer =
-{
-   R_QDrawColumn,
-   R_QDrawNewSkyColumn,
-   R_QDrawTLColumn,
-   R_QDrawTRColumn,
-   R_QDrawTLTRColumn,
-   R_QDrawFuzzColumn,
-   R_QDrawFlexColumn,
-   R_QDrawFlexTRColumn,
-   R_QDrawAddColumn,
-   R_QDrawAddTRColumn,
-
-   R_QResetColumnBuffer,
+#define QUADDRAWER(w) \
+   { \
+      R_QDrawColumn<w>, \
+      R_QDrawNewSkyColumn<w>, \
+      R_QDrawTLColumn<w>, \
+      R_QDrawTRColumn<w>, \
+      R_QDrawTLTRColumn<w>, \
+      R_QDrawFuzzColumn<w>, \
+      R_QDrawFlexColumn<w>, \
+      R_QDrawFlexTRColumn<w>, \
+      R_QDrawAddColumn<w>, \
+      R_QDrawAddTRColumn<w>, \
+ \
+      R_QResetColumnBuffer, \
+ \
+      { \
+         /* Normal                  Translated */ \
+         { R_QDrawColumn<w>,     R_QDrawTRColumn<w>     }, /* NORMAL  */ \
+         { R_QDrawFuzzColumn<w>, R_QDrawFuzzColumn<w>   }, /* SHADOW  */ \
+         { R_QDrawFlexColumn<w>, R_QDrawFlexTRColumn<w> }, /* ALPHA   */ \
+         { R_QDrawAddColumn<w>,  R_QDrawAddTRColumn<w>  }, /* ADD     */ \
+         { R_QDrawTLColumn<w>,   R_QDrawTLTRColumn<w>   }, /* SUB     */ \
+         { R_QDrawTLColumn<w>,   R_QDrawTLTRColumn<w>   }, /* TRANMAP */ \
+      }, \
+   }
 
-   {
-      // Normal            Translated
-      { R_QDrawColumn,     R_QDrawTRColumn     }, // NORMAL
-      { R_QDrawFuzzColumn, R_QDrawFuzzColumn   }, // SHADOW
-      { R_QDrawFlexColumn, R_QDrawFlexTRColumn }, // ALPHA
-      { R_QDrawAddColumn,  R_QDrawAddTRColumn  }, // ADD
-      { R_QDrawTLColumn,   R_QDrawTLTRColumn   }, // SUB
-      { R_QDrawTLColumn,   R_QDrawTLTRColumn   }, // TRANMAP
-   },
+// One drawer table per batch width, indexed by r_quadwidth
+static columndrawer_t r_quad_widths[NUMQUADWIDTHS] =
+{
+   QUADDRAWER(4),
+   QUADDRAWER(8),
+   QUADDRAWER(16),
+   QUADDRAWER(MAXQUADWIDTH),
 };
 
-// EOF
+#undef QUADDRAWER
 
+columndrawer_t r_quad_drawer = r_quad_widths[2];
+
+int r_quadwidth = 2;
+
+//
+// R_SetQuadWidth
+//
+// Points the quad engine at the drawers for the batch width chosen through
+// r_quadwidth. Must only be called between frames, when the column buffer
+// has been flushed.
+//
+void R_SetQuadWidth()
+{
+   r_quad_drawer = r_quad_widths[r_quadwidth];
+}
+
+static const char *quadwidthstr[NUMQUADWIDTHS] = { "4", "8", "16", "32" };
+
+VARIABLE_INT(r_quadwidth, NULL, 0, NUMQUADWIDTHS - 1, quadwidthstr);
+CONSOLE_VARIABLE(r_quadwidth, r_quadwidth, 0) {}
+
+// EOF
@@ -30,6 +30,13 @@
 
 extern columndrawer_t r_quad_drawer;
 
+// Number of columns buffered before flushing: 4 << r_quadwidth
+#define NUMQUADWIDTHS 4
+
+extern int r_quadwidth;
+
+void R_SetQuadWidth();
+
 #endif
 
 // EOF
@@ -0,0 +1,120 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// Copyright (C) 2013 James Haley et al.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+// Additional terms and conditions compatible with the GPLv3 apply. See the
+// file COPYING-EE for details.
+//
+//--------------------------------------------------------------------------
+//
+// DESCRIPTION:
+//      SIMD column and span drawing engines. The engine objects start out as
+//      copies of the normal ones, and R_InitSIMDDrawers replaces whichever
+//      drawers have a vectorized version for the best instruction set the
+//      CPU supports.
+//
+//-----------------------------------------------------------------------------
+
+#include "z_zone.h"
+
+#include "c_io.h"
+#include "c_runcmd.h"
+#include "r_draw.h"
+#include "r_drawsimd.h"
+
+#if defined(R_SIMD_AVX2) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+columndrawer_t r_simd_drawer;
+spandrawer_t   r_simdspandrawer;
+
+const char *r_simd_isa = "none";
+
+#ifdef R_SIMD_AVX2
+
+//
+// R_cpuHasAVX2
+//
+// Checks both that the processor implements AVX2 and that the operating
+// system saves the YMM registers across context switches.
+//
+static bool R_cpuHasAVX2()
+{
+#if defined(_MSC_VER)
+   const int osxsave_avx = (1 << 27) | (1 << 28);
+   int info[4];
+
+   __cpuid(info, 0);
+   if(info[0] < 7)
+      return false;
+
+   __cpuid(info, 1);
+   if((info[2] & osxsave_avx) != osxsave_avx)
+      return false;
+
+   if((_xgetbv(0) & 6) != 6)
+      return false;
+
+   __cpuidex(info, 7, 0);
+   return !!(info[1] & (1 << 5));
+#elif defined(__GNUC__)
+   __builtin_cpu_init();
+   return !!__builtin_cpu_supports("avx2");
+#else
+   return false;
+#endif
+}
+
+#endif
+
+//
+// R_InitSIMDDrawers
+//
+// Sets up the SIMD engines for this CPU. Must be called before either of
+// them can be selected.
+//
+void R_InitSIMDDrawers()
+{
+   r_simd_drawer    = r_normal_drawer;
+   r_simdspandrawer = r_spandrawer;
+
+#ifdef R_SIMD_AVX2
+   if(R_cpuHasAVX2())
+   {
+      R_AVX2Drawers(r_simd_drawer, r_simdspandrawer);
+      r_simd_isa = "AVX2";
+      return;
+   }
+#endif
+#ifdef R_SIMD_SSE2
+   R_SSE2Drawers(r_simd_drawer, r_simdspandrawer);
+   r_simd_isa = "SSE2";
+#endif
+#ifdef R_SIMD_NEON
+   R_NEONDrawers(r_simd_drawer, r_simdspandrawer);
+   r_simd_isa = "NEON";
+#endif
+}
+
+CONSOLE_COMMAND(r_simdinfo, 0)
+{
+   C_Printf("SIMD drawers: %s\n", r_simd_isa);
+}
+
+// EOF
+
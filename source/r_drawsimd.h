@@ -0,0 +1,73 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// Copyright (C) 2013 James Haley et al.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+// Additional terms and conditions compatible with the GPLv3 apply. See the
+// file COPYING-EE for details.
+//
+//--------------------------------------------------------------------------
+//
+// DESCRIPTION:
+//      SIMD column and span drawing engines.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef R_DRAWSIMD_H__
+#define R_DRAWSIMD_H__
+
+struct columndrawer_t;
+struct spandrawer_t;
+
+// Instruction sets the SIMD drawers can be built for. SSE2 and NEON are
+// assumed present whenever the compiler targets them; AVX2 is an extension
+// of x86-64 that is looked for at run time.
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define R_SIMD_SSE2
+#endif
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define R_SIMD_AVX2
+#endif
+
+#if defined(__aarch64__) || defined(_M_ARM64) || defined(__ARM_NEON)
+#define R_SIMD_NEON
+#endif
+
+extern columndrawer_t r_simd_drawer;
+extern spandrawer_t   r_simdspandrawer;
+
+extern const char *r_simd_isa; // name of the instruction set in use
+
+void R_InitSIMDDrawers();
+
+// Per-instruction set setup functions; each one replaces the drawers it has
+// vectorized versions of and leaves the others alone.
+#ifdef R_SIMD_SSE2
+void R_SSE2Drawers(columndrawer_t &coldrawer, spandrawer_t &spandrawer);
+#endif
+#ifdef R_SIMD_AVX2
+void R_AVX2Drawers(columndrawer_t &coldrawer, spandrawer_t &spandrawer);
+#endif
+#ifdef R_SIMD_NEON
+void R_NEONDrawers(columndrawer_t &coldrawer, spandrawer_t &spandrawer);
+#endif
+
+#endif
+
+// EOF
+
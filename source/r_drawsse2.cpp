@@ -0,0 +1,152 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// Copyright (C) 2013 James Haley et al.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+// Additional terms and conditions compatible with the GPLv3 apply. See the
+// file COPYING-EE for details.
+//
+//--------------------------------------------------------------------------
+//
+// DESCRIPTION:
+//      SSE2 column and span drawers, four pixels at a time.
+//
+//-----------------------------------------------------------------------------
+
+#include "z_zone.h"
+#include "r_drawsimd.h"
+
+#ifdef R_SIMD_SSE2
+
+#include <emmintrin.h>
+
+#include "r_simdtpl.h"
+
+struct SSE2Traits
+{
+   enum { WIDTH = 4 };
+
+   //
+   // Moves four 32-bit lanes out to the integer registers. Going through
+   // 64-bit moves rather than memory lets the compiler keep the offsets in
+   // registers once the pixel loop is unrolled.
+   //
+   static void Store(int *out, __m128i v)
+   {
+#if defined(__x86_64__) || defined(_M_X64)
+      long long lo = _mm_cvtsi128_si64(v);
+      long long hi = _mm_cvtsi128_si64(_mm_unpackhi_epi64(v, v));
+      out[0] = int(lo);
+      out[1] = int(lo >> 32);
+      out[2] = int(hi);
+      out[3] = int(hi >> 32);
+#else
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(out), v);
+#endif
+   }
+
+   static __m128i Lanes(unsigned int start, unsigned int step)
+   {
+      return _mm_setr_epi32(int(start),            int(start + step),
+                            int(start + 2 * step), int(start + 3 * step));
+   }
+
+   class ColumnStepper
+   {
+      __m128i frac, step, mask;
+
+   public:
+      ColumnStepper(fixed_t pFrac, fixed_t pStep, int heightmask)
+      {
+         frac = Lanes(pFrac, pStep);
+         step = _mm_set1_epi32(int(4u * unsigned(pStep)));
+         mask = _mm_set1_epi32(heightmask);
+      }
+
+      void next(int *out)
+      {
+         Store(out, _mm_and_si128(_mm_srai_epi32(frac, FRACBITS), mask));
+         frac = _mm_add_epi32(frac, step);
+      }
+   };
+
+   class SpanStepper
+   {
+      __m128i xf, yf, xs, ys, xmask, xshift, yshift;
+
+   public:
+      SpanStepper(unsigned int pXf, unsigned int pYf, unsigned int pXs,
+                  unsigned int pYs, unsigned int pXShift, unsigned int pYShift,
+                  unsigned int pXMask)
+      {
+         xf     = Lanes(pXf, pXs);
+         yf     = Lanes(pYf, pYs);
+         xs     = _mm_set1_epi32(int(4 * pXs));
+         ys     = _mm_set1_epi32(int(4 * pYs));
+         xmask  = _mm_set1_epi32(int(pXMask));
+         xshift = _mm_cvtsi32_si128(int(pXShift));
+         yshift = _mm_cvtsi32_si128(int(pYShift));
+      }
+
+      void next(int *out)
+      {
+         __m128i t = _mm_and_si128(_mm_srl_epi32(xf, xshift), xmask);
+         Store(out, _mm_or_si128(t, _mm_srl_epi32(yf, yshift)));
+         xf = _mm_add_epi32(xf, xs);
+         yf = _mm_add_epi32(yf, ys);
+      }
+   };
+
+   static __m128i Sum(const unsigned int *fg2rgb, const unsigned int *bg2rgb,
+                      const byte *fg, const byte *bg)
+   {
+      __m128i f = _mm_setr_epi32(int(fg2rgb[fg[0]]), int(fg2rgb[fg[1]]),
+                                 int(fg2rgb[fg[2]]), int(fg2rgb[fg[3]]));
+      __m128i b = _mm_setr_epi32(int(bg2rgb[bg[0]]), int(bg2rgb[bg[1]]),
+                                 int(bg2rgb[bg[2]]), int(bg2rgb[bg[3]]));
+      return _mm_add_epi32(f, b);
+   }
+
+   static void BlendFlex(const unsigned int *fg2rgb, const unsigned int *bg2rgb,
+                         const byte *fg, const byte *bg, int *out)
+   {
+      __m128i t = _mm_or_si128(Sum(fg2rgb, bg2rgb, fg, bg),
+                               _mm_set1_epi32(0x1f07c1f));
+      Store(out, _mm_and_si128(t, _mm_srli_epi32(t, 15)));
+   }
+
+   static void BlendAdd(const unsigned int *fg2rgb, const unsigned int *bg2rgb,
+                        const byte *fg, const byte *bg, int *out)
+   {
+      __m128i a = Sum(fg2rgb, bg2rgb, fg, bg);
+      __m128i b = _mm_and_si128(a, _mm_set1_epi32(0x40100400));
+      a = _mm_or_si128(a, _mm_set1_epi32(0x01f07c1f));
+      a = _mm_and_si128(a, _mm_set1_epi32(0x3fffffff));
+      b = _mm_sub_epi32(b, _mm_srli_epi32(b, 5));
+      a = _mm_or_si128(a, b);
+      Store(out, _mm_and_si128(a, _mm_srli_epi32(a, 15)));
+   }
+};
+
+void R_SSE2Drawers(columndrawer_t &coldrawer, spandrawer_t &spandrawer)
+{
+   R_SetSIMDDrawers<SSE2Traits>(coldrawer, spandrawer);
+}
+
+#endif
+
+// EOF
+
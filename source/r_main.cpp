@@ -29,6 +29,7 @@
 
 #include "c_io.h"
 #include "c_runcmd.h"
+#include "d_bench.h"
 #include "d_deh.h"
 #include "d_dehtbl.h"
 #include "d_gi.h"
@@ -50,13 +51,18 @@
 #include "r_bsp.h"
 #include "r_draw.h"
 #include "r_drawq.h"
+#include "r_drawsimd.h"
 #include "r_dynseg.h"
 #include "r_interpolate.h"
 #include "r_main.h"
 #include "r_plane.h"
 #include "r_portal.h"
+#include "r_profile.h"
+#include "r_pvs.h"
+#include "r_truecolor.h"
 #include "r_ripple.h"
 #include "r_things.h"
+#include "r_threads.h"
 #include "r_sky.h"
 #include "r_state.h"
 #include "s_sound.h"
@@ -155,6 +161,7 @@ static columndrawer_t *r_column_engines[NUMCOLUMNENGINES] =
 {
    &r_normal_drawer, // normal engine
    &r_quad_drawer,   // quad cache engine
+   &r_simd_drawer,   // SIMD engine
 };
 
 //
@@ -164,7 +171,23 @@ static columndrawer_t *r_column_engines[NUMCOLUMNENGINES] =
 //
 void R_SetColumnEngine()
 {
+   if(r_tcactive)
+   {
+      r_column_engine = &r_tc_drawer;
+      return;
+   }
+
    r_column_engine = r_column_engines[r_column_engine_num];
+
+   if(r_column_engine == &r_quad_drawer)
+   {
+      // the quad cache engine keeps drawing state between columns, so it
+      // cannot replay columns on several threads
+      if(r_threads > 1)
+         r_column_engine = &r_normal_drawer;
+      else
+         R_SetQuadWidth();
+   }
 }
 
 // haleyjd 09/10/06: span drawing engines
@@ -173,7 +196,8 @@ int r_span_engine_num;
 
 static spandrawer_t *r_span_engines[NUMSPANENGINES] =
 {
-   &r_spandrawer,    // normal engine
+   &r_spandrawer,     // normal engine
+   &r_simdspandrawer, // SIMD engine
 };
 
 //
@@ -183,7 +207,10 @@ static spandrawer_t *r_span_engines[NUMSPANENGINES] =
 //
 void R_SetSpanEngine(void)
 {
-   r_span_engine = r_span_engines[r_span_engine_num];
+   if(r_tcactive)
+      r_span_engine = &r_tcspandrawer;
+   else
+      r_span_engine = r_span_engines[r_span_engine_num];
 }
 
 //
@@ -702,11 +729,13 @@ void R_ExecuteSetViewSize()
 //
 void R_Init()
 {
+   R_InitSIMDDrawers();
    R_InitData();
    R_SetViewSize(screenSize+3);
    R_InitLightTables();
    R_InitTranslationTables();
    R_InitParticles(); // haleyjd
+   R_TCInit();
 }
 
 //
@@ -927,6 +956,7 @@ static void R_SetupFrame(player_t *player, camera_t *camera)
    // haleyjd 09/10/06: set or change span drawing engine
    R_SetColumnEngine();
    R_SetSpanEngine();
+   colfunc = r_column_engine->DrawColumn;
    R_IncrementFrameid(); // Cardboard
    
    viewplayer = player;
@@ -1142,9 +1172,13 @@ extern void R_UntaintPortals();
 //
 void R_RenderPlayerView(player_t* player, camera_t *camerapoint)
 {
+   RProfileScope profile(RPROF_RENDER);
+   BenchScope    bench(BENCH_RENDER);
    bool quake = false;
    unsigned int savedflags = 0;
 
+   R_TexCacheBeginFrame();
+   R_TCBeginView();
    R_SetupFrame(player, camerapoint);
    
    // haleyjd: untaint portals
@@ -1159,6 +1193,9 @@ void R_RenderPlayerView(player_t* player, camera_t *camerapoint)
 
    if(autodetect_hom)
       R_HOMdrawer();
+
+   // defer drawing to the render threads, if enabled
+   R_BeginDrawQueue();
    
    // check for new console commands.
    NetUpdate();
@@ -1175,7 +1212,9 @@ void R_RenderPlayerView(player_t* player, camera_t *camerapoint)
       player->mo->intflags &= ~MIF_HIDDENBYQUAKE;  // zero it otherwise
 
    // The head node is the last node output.
+   R_PVSBeginView();
    R_RenderBSPNode(numnodes - 1);
+   R_PVSEndView();
 
    if(quake)
       player->mo->flags2 = savedflags;
@@ -1192,6 +1231,7 @@ void R_RenderPlayerView(player_t* player, camera_t *camerapoint)
    R_RenderPortals();
 
    R_DrawPlanes(NULL);
+   R_KickDrawQueue();
    
    // Check for new console commands.
    NetUpdate();
@@ -1199,11 +1239,16 @@ void R_RenderPlayerView(player_t* player, camera_t *camerapoint)
    // Draw Post-BSP elements such as sprites, masked textures, and portal 
    // overlays
    R_DrawPostBSP();
+
+   // draw anything still queued for the render threads
+   R_EndDrawQueue();
    
    // haleyjd 09/04/06: handle through column engine
    if(r_column_engine->ResetBuffer)
       r_column_engine->ResetBuffer();
 
+   R_TCEndView();
+
    // haleyjd: remove sector interpolations
    if(view.lerp != FRACUNIT)
       R_setSectorInterpolationState(SEC_NORMAL);
@@ -1228,6 +1273,9 @@ void R_HOMdrawer()
    V_ColorBlock(&vbscreen, (byte)colour, viewwindow.x, viewwindow.y, 
                 viewwindow.width,
                 viewwindow.height);
+
+   if(r_tcactive)
+      R_TCFillView((byte)colour);
 }
 
 //
@@ -1383,8 +1431,8 @@ void R_DoomTLStyle()
 
 static const char *handedstr[]  = { "right", "left" };
 static const char *ptranstr[]   = { "none", "smooth", "general" };
-static const char *coleng[]     = { "normal", "quad" };
-static const char *spaneng[]    = { "highprecision" };
+static const char *coleng[]     = { "normal", "quad", "simd" };
+static const char *spaneng[]    = { "highprecision", "simd" };
 static const char *tlstylestr[] = { "none", "boom", "new" };
 
 VARIABLE_BOOLEAN(lefthanded, NULL,                  handedstr);
@@ -1473,7 +1521,12 @@ CONSOLE_VARIABLE(r_trans, general_translucency, 0)
 
 CONSOLE_VARIABLE(r_tranpct, tran_filter_pct, 0)
 {
-   R_ResetTrans();
+   // the 32-bit drawers blend by tran_filter_pct themselves, so the TRANMAP
+   // need not be rebuilt until the 8-bit ones are used again
+   if(r_truecolor)
+      r_tcstaletrans = true;
+   else
+      R_ResetTrans();
 }
 
 CONSOLE_VARIABLE(screensize, screenSize, cf_buffered)
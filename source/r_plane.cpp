@@ -40,9 +40,12 @@
 #include "i_system.h"
 
 #include "c_io.h"
+#include "c_runcmd.h"
 #include "d_gi.h"
 #include "doomstat.h"
 #include "ev_specials.h"
+#include "m_collection.h"
+#include "m_compare.h"
 #include "p_anim.h"
 #include "p_info.h"
 #include "p_slopes.h"
@@ -51,10 +54,12 @@
 #include "r_main.h"
 #include "r_plane.h"
 #include "r_portal.h"
+#include "r_profile.h"
 #include "r_ripple.h"
 #include "r_sky.h"
 #include "r_state.h"
 #include "r_things.h"
+#include "r_threads.h"
 #include "v_alloc.h"
 #include "v_misc.h"
 #include "v_video.h"
@@ -62,10 +67,25 @@
 
 #define MAINHASHCHAINS 128    /* must be a power of 2 */
 
+#define VISPLANECHUNK  64     // visplanes added to the pool at a time
+#define CACHELINESIZE  64
+
+// main visplanes which a plane may be drawn ahead of, to batch it with others
+// of the same flat
+#define PLANEBATCHLOOKAHEAD 16
+
 static visplane_t *freetail;                   // killough
 static visplane_t **freehead = &freetail;      // killough
 visplane_t *floorplane, *ceilingplane;
 
+// visplane statistics, for r_planestats
+static int numvisplanes;     // visplanes in the pool
+static int frameplanes;      // visplanes taken from the pool this frame
+static int lastframeplanes;  // ... and in the last complete frame
+static int maxframeplanes;   // most visplanes ever used in one frame
+static int lastdrawnplanes;  // non-empty main visplanes drawn last frame
+static int lastflatchanges;  // flat or light changes between them
+
 
 // SoM: New visplane hash
 // This is the main hash object used by the normal scene.
@@ -88,6 +108,7 @@ VALLOCATION(mainhash)
    freetail = NULL;
    freehead = &freetail;
    floorplane = ceilingplane = NULL;
+   numvisplanes = 0;
 
    memset(mainchains, 0, sizeof(mainchains));
 }
@@ -148,9 +169,10 @@ VALLOCATION(spanstart)
 // texture mapping
 //
 
-cb_span_t      span;
-cb_plane_t     plane;
-cb_slopespan_t slopespan;
+// span and slopespan are thread-local, for threaded drawing
+thread_local cb_span_t      span;
+cb_plane_t                  plane;
+thread_local cb_slopespan_t slopespan;
 
 VALLOCATION(slopespan)
 {
@@ -299,7 +321,7 @@ static void R_MapPlane(int y, int x1, int x2)
    span.source = plane.source;
    
    // BIG FLATS
-   flatfunc();
+   R_DrawSpanFunc(flatfunc);
 }
 
 //
@@ -389,7 +411,7 @@ static void R_MapSlope(int y, int x1, int x2)
 
    R_SlopeLights(x2 - x1 + 1, (256.0 - map1), (256.0 - map2));
  
-   slopefunc();
+   R_DrawSlopeFunc(slopefunc);
 }
 
 #define CompFloats(x, y) (fabs(x - y) < 0.001f)
@@ -575,9 +597,52 @@ void R_ClearPlanes()
 
    R_ClearPlaneHash(&mainhash);
 
+   lastframeplanes = frameplanes;
+   if(frameplanes > maxframeplanes)
+      maxframeplanes = frameplanes;
+   frameplanes = 0;
+
    lastopening = openings;
 }
 
+//
+// R_growVisplanePool
+//
+// Adds a block of VISPLANECHUNK visplanes to the free list. The visplanes
+// start on cache lines, and their silhouette arrays are allocated together
+// right after them, rather than each one being a separate zone block. Like
+// the rest of the pool, they are PU_VALLOC and go away when the video mode
+// changes.
+//
+static void R_growVisplanePool()
+{
+   const size_t stride = (sizeof(visplane_t) + CACHELINESIZE - 1) & ~(CACHELINESIZE - 1);
+   const int    silwidth = 2 * (video.width + 2);
+   byte *block;
+   int  *sil;
+
+   block = ecalloctag(byte *, 1, VISPLANECHUNK * stride + CACHELINESIZE - 1,
+                      PU_VALLOC, NULL);
+   block = reinterpret_cast<byte *>((reinterpret_cast<uintptr_t>(block) +
+                                     CACHELINESIZE - 1) & ~uintptr_t(CACHELINESIZE - 1));
+   sil   = ecalloctag(int *, VISPLANECHUNK * silwidth, sizeof(int), PU_VALLOC, NULL);
+
+   for(int i = 0; i < VISPLANECHUNK; i++)
+   {
+      visplane_t *pl = reinterpret_cast<visplane_t *>(block + i * stride);
+
+      pl->max_width = (unsigned int)video.width;
+      pl->top       = sil + 1;
+      pl->bottom    = sil + video.width + 3;
+      sil += silwidth;
+
+      *freehead = pl;
+      freehead  = &pl->next;
+   }
+
+   numvisplanes += VISPLANECHUNK;
+}
+
 
 //
 // new_visplane
@@ -586,30 +651,21 @@ void R_ClearPlanes()
 //
 static visplane_t *new_visplane(unsigned hash, planehash_t *table)
 {
-   visplane_t *check = freetail;
+   visplane_t *check;
 
-   if(!check)
-      check = ecalloctag(visplane_t *, 1, sizeof *check, PU_VALLOC, NULL);
-   else 
-      if(!(freetail = freetail->next))
-         freehead = &freetail;
+   if(!freetail)
+      R_growVisplanePool();
+
+   check = freetail;
+   if(!(freetail = freetail->next))
+      freehead = &freetail;
    
    check->next = table->chains[hash];
    table->chains[hash] = check;
    
    check->table = table;
 
-   if(!check->top)
-   {
-      int *paddedTop, *paddedBottom;
-
-      check->max_width = (unsigned int)video.width;
-      paddedTop    = ecalloctag(int *, 2 * (video.width + 2), sizeof(int), PU_VALLOC, NULL);
-      paddedBottom = paddedTop + video.width + 2;
-
-      check->top    = paddedTop    + 1;
-      check->bottom = paddedBottom + 1;
-   }
+   ++frameplanes;
    
    return check;
 }
@@ -900,7 +956,7 @@ static void do_draw_newsky(visplane_t *pl)
             R_GetRawColumn(skyTexture2,
                (((an + xtoviewangle[x])) >> (ANGLETOSKYSHIFT))+offset2);
             
-         colfunc();
+         R_DrawColumnFunc(colfunc);
       }
    }
       
@@ -923,7 +979,7 @@ static void do_draw_newsky(visplane_t *pl)
             R_GetRawColumn(skyTexture,
                (((an + xtoviewangle[x])) >> (ANGLETOSKYSHIFT))+offset);
             
-         colfunc();
+         R_DrawColumnFunc(colfunc);
       }
    }
    colfunc = r_column_engine->DrawColumn;
@@ -1051,7 +1107,7 @@ static void do_draw_plane(visplane_t *pl)
             column.source = R_GetRawColumn(texture,
                (((an + xtoviewangle[x])^flip) >> ANGLETOSKYSHIFT) + offset);
             
-            colfunc();
+            R_DrawColumnFunc(colfunc);
          }
       }
    }
@@ -1071,6 +1127,16 @@ static void do_draw_plane(visplane_t *pl)
       {
          plane.source = R_DistortedFlat(picnum);
          tex = plane.tex = textures[picnum];
+
+         // the swirl buffer is reused by the next swirling flat, so queued
+         // spans need their own copy
+         if(r_drawqueue)
+         {
+            size_t size = tex->width * tex->height;
+            void  *copy = R_DrawQueueAlloc(size);
+            memcpy(copy, plane.source, size);
+            plane.source = copy;
+         }
       }
       else
       {
@@ -1095,6 +1161,7 @@ static void do_draw_plane(visplane_t *pl)
          
          span.fg2rgb = Col2RGB8[level];
          span.bg2rgb = Col2RGB8[64 - level];
+         span.alpha  = pl->opacity + 1;
       }
       else if(stylenum == SPAN_STYLE_ADD)
       {
@@ -1102,6 +1169,7 @@ static void do_draw_plane(visplane_t *pl)
          
          span.fg2rgb = Col2RGB8_LessPrecision[level];
          span.bg2rgb = Col2RGB8_LessPrecision[64];
+         span.alpha  = pl->opacity + 1;
       }
       else
          span.fg2rgb = span.bg2rgb = NULL;
@@ -1179,24 +1247,130 @@ static void do_draw_plane(visplane_t *pl)
    }
 }
 
+//
+// R_planeFlatChanged
+//
+// True if the span drawer switches flat, colormap or light level going from
+// one visplane to the next.
+//
+static bool R_planeFlatChanged(const visplane_t *a, const visplane_t *b)
+{
+   return a->picnum != b->picnum || a->colormap != b->colormap ||
+          a->lightlevel != b->lightlevel;
+}
+
+//
+// R_planesOverlap
+//
+// True if two visplanes mark any of the same pixels, in which case the one
+// drawn last is the one that shows.
+//
+static bool R_planesOverlap(const visplane_t *a, const visplane_t *b)
+{
+   int stop = emin(a->maxx, b->maxx);
+
+   for(int x = emax(a->minx, b->minx); x <= stop; x++)
+   {
+      if(a->top[x] <= a->bottom[x] && b->top[x] <= b->bottom[x] &&
+         emax(a->top[x], b->top[x]) <= emin(a->bottom[x], b->bottom[x]))
+         return true;
+   }
+   return false;
+}
+
+//
+// R_drawMainPlane
+//
+static void R_drawMainPlane(visplane_t *pl, visplane_t *&prev)
+{
+   ++lastdrawnplanes;
+   if(prev && R_planeFlatChanged(prev, pl))
+      ++lastflatchanges;
+   prev = pl;
+
+   do_draw_plane(pl);
+}
+
 //
 // R_DrawPlanes
 //
 // Called after the BSP has been traversed and walls have rendered. This 
 // function is also now used to render portal overlays.
 //
+// Main visplanes can overlap: a closed sector's floor and ceiling may both
+// mark the same columns, and then the one drawn last shows. So they keep their
+// hash chain order, except that after each plane the later planes with the
+// same flat and light are drawn with it, provided none of them overlaps a
+// plane it is moved ahead of. The picture is then the same as in chain order,
+// while the flat stays in the cache. Overlay planes are blended, and are drawn
+// in the order they were made.
+//
 void R_DrawPlanes(planehash_t *table)
 {
-   visplane_t *pl;
-   int i;
+   RProfileScope profile(RPROF_PLANES);
+   static PODCollection<visplane_t *> planes;
+   visplane_t *skipped[PLANEBATCHLOOKAHEAD];
+   visplane_t *pl, *prev = NULL;
+   int i, numskipped;
    
-   if(!table)
-      table = &mainhash;
-   
-   for(i = 0; i < table->chaincount; ++i)
+   if(table)
    {
-      for(pl = table->chains[i]; pl; pl = pl->next)
-         do_draw_plane(pl);
+      for(i = 0; i < table->chaincount; ++i)
+      {
+         for(pl = table->chains[i]; pl; pl = pl->next)
+            do_draw_plane(pl);
+      }
+      return;
+   }
+
+   lastdrawnplanes = 0;
+   lastflatchanges = 0;
+
+   planes.makeEmpty();
+   for(i = 0; i < mainhash.chaincount; ++i)
+   {
+      for(pl = mainhash.chains[i]; pl; pl = pl->next)
+      {
+         if(pl->minx <= pl->maxx)
+            planes.add(pl);
+      }
+   }
+
+   size_t numplanes = planes.getLength();
+
+   for(size_t j = 0; j < numplanes; j++)
+   {
+      visplane_t *first = planes[j];
+
+      if(!first)
+         continue;  // already drawn with an earlier plane
+
+      R_drawMainPlane(first, prev);
+
+      // every plane still to be drawn between first and the plane looked at
+      // is in skipped, so a plane that overlaps none of them can go now
+      numskipped = 0;
+      for(size_t k = j + 1; k < numplanes && numskipped < PLANEBATCHLOOKAHEAD; k++)
+      {
+         if(!(pl = planes[k]))
+            continue;
+
+         bool batch = !R_planeFlatChanged(first, pl);
+
+         for(i = 0; batch && i < numskipped; i++)
+         {
+            if(R_planesOverlap(pl, skipped[i]))
+               batch = false;
+         }
+
+         if(batch)
+         {
+            R_drawMainPlane(pl, prev);
+            planes[k] = NULL;
+         }
+         else
+            skipped[numskipped++] = pl;
+      }
    }
 }
 
@@ -1240,6 +1414,23 @@ void R_MapInitOverlaySets()
    r_overlayfreesets = nullptr;
 }
 
+CONSOLE_COMMAND(r_planestats, 0)
+{
+   C_Printf(FC_HI "Visplanes\n"
+            FC_NORMAL "pool: %d\nused last frame: %d (most %d)\n"
+            "drawn last frame: %d, %d flat/light changes\n",
+            numvisplanes, lastframeplanes, maxframeplanes,
+            lastdrawnplanes, lastflatchanges);
+
+   if(R_ProfileFrames())
+   {
+      C_Printf("plane drawing: %.2f ms per frame\n",
+               R_ProfileAverage(RPROF_PLANES));
+   }
+   else
+      C_Printf("use r_profile to time plane drawing\n");
+}
+
 //----------------------------------------------------------------------------
 //
 // $Log: r_plane.c,v $
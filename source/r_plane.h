@@ -77,6 +77,7 @@ struct cb_span_t
    void *source;
    lighttable_t *colormap;
    unsigned int *fg2rgb, *bg2rgb; // haleyjd 06/20/08: tl lookups
+   unsigned int alpha;            // opacity out of 256, for 32-bit drawers
 
    // SoM: some values for the generalizede span drawers
    unsigned int xshift, xmask, yshift, ymask;
@@ -122,10 +123,10 @@ struct cb_slopespan_t
 };
 
 
-extern cb_span_t  span;
-extern cb_plane_t plane;
+extern thread_local cb_span_t  span;
+extern cb_plane_t              plane;
 
-extern cb_slopespan_t slopespan;
+extern thread_local cb_slopespan_t slopespan;
 
 planehash_t *R_NewOverlaySet();
 void R_FreeOverlaySet(planehash_t *set);
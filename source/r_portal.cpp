@@ -43,8 +43,11 @@
 #include "r_main.h"
 #include "r_plane.h"
 #include "r_portal.h"
+#include "r_profile.h"
 #include "r_state.h"
 #include "r_things.h"
+#include "r_threads.h"
+#include "r_truecolor.h"
 #include "v_alloc.h"
 #include "v_misc.h"
 
@@ -1053,6 +1056,34 @@ static void R_RenderSkyboxPortal(pwindow_t *window)
 
 extern int    showtainted;
 
+//
+// R_drawTaintedColumn
+//
+// Column drawer which blacks out the column, for R_ShowTainted.
+//
+static void R_drawTaintedColumn()
+{
+   if(r_tcactive)
+   {
+      uint32_t *dest = R_TCADDRESS(column.x, column.y1);
+
+      for(int count = column.y2 - column.y1 + 1; count > 0; count--)
+      {
+         *dest = r_tcbasepal[GameModeInfo->blackIndex];
+         dest += r_tcpitch;
+      }
+      return;
+   }
+
+   byte *dest = R_ADDRESS(column.x, column.y1);
+
+   for(int count = column.y2 - column.y1 + 1; count > 0; count--)
+   {
+      *dest = GameModeInfo->blackIndex;
+      dest += video.pitch;
+   }
+}
+
 static void R_ShowTainted(pwindow_t *window)
 {
    int y1, y2, count;
@@ -1102,8 +1133,6 @@ static void R_ShowTainted(pwindow_t *window)
 
    for(int i = window->minx; i <= window->maxx; i++)
    {
-      byte *dest;
-
       y1 = (int)window->top[i];
       y2 = (int)window->bottom[i];
 
@@ -1111,15 +1140,10 @@ static void R_ShowTainted(pwindow_t *window)
       if(count <= 0)
          continue;
 
-      dest = R_ADDRESS(i, y1);
-
-      while(count > 0)
-      {
-         *dest = GameModeInfo->blackIndex;
-         dest += video.pitch;
-
-         count--;
-      }
+      column.x  = i;
+      column.y1 = y1;
+      column.y2 = y2;
+      R_DrawColumnFunc(R_drawTaintedColumn);
    }
 }
 
@@ -1512,8 +1536,12 @@ void R_ClearPortals()
 //
 void R_RenderPortals()
 {
+   RProfileScope profile(RPROF_PORTALS);
    pwindow_t *w;
 
+   // let the main view be drawn while the portal windows are traversed
+   R_KickDrawQueue();
+
    while(windowhead)
    {
       portalrender.active = true;
@@ -1522,7 +1550,11 @@ void R_RenderPortals()
 //      portalrender.overlay = windowhead->portal->poverlay;
 
       if(windowhead->maxx >= windowhead->minx)
+      {
+         RProfileScope windowprofile(RPROF_PORTALWIN);
          windowhead->func(windowhead);
+         R_KickDrawQueue();
+      }
 
       portalrender.active = false;
       portalrender.w = NULL;
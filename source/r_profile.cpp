@@ -0,0 +1,398 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// Copyright (C) 2013 James Haley et al.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+// Additional terms and conditions compatible with the GPLv3 apply. See the
+// file COPYING-EE for details.
+//
+//--------------------------------------------------------------------------
+//
+// DESCRIPTION:
+//      Per-frame renderer profiler. Sections of the frame are timed with
+//      RProfileScope objects, and their per-frame totals are kept for the
+//      last PROFILEFRAMES frames. The r_profile command prints rolling
+//      statistics, r_showprofile draws them over the screen, and
+//      r_profilelog writes one CSV line per frame.
+//
+//-----------------------------------------------------------------------------
+
+#include "z_zone.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "c_io.h"
+#include "c_runcmd.h"
+#include "e_fonts.h"
+#include "m_qstr.h"
+#include "r_profile.h"
+#include "v_font.h"
+#include "v_misc.h"
+
+#define PROFILEFRAMES 256 // frames kept for the rolling statistics
+#define OVERLAYFRAMES 35  // frames averaged by the overlay
+
+bool r_profiling;
+bool r_showprofile;
+
+struct rprofsection_t
+{
+   const char *name;
+   int         parent;      // enclosing section, for indenting reports
+
+   int         depth;       // calls currently open
+   int64_t     start;       // when the outermost open call started
+   int64_t     frametime;   // nanoseconds spent this frame
+   int         framecalls;  // outermost calls this frame
+
+   float       times[PROFILEFRAMES]; // history, in milliseconds
+   int         calls[PROFILEFRAMES];
+};
+
+static rprofsection_t profsections[RPROF_NUMSECTIONS] =
+{
+   { "frame",   -1             },
+   { "render",  RPROF_FRAME    },
+   { "bsp",     RPROF_RENDER   },
+   { "walls",   RPROF_BSP      },
+   { "portals", RPROF_RENDER   },
+   { "window",  RPROF_PORTALS  },
+   { "planes",  RPROF_RENDER   },
+   { "postbsp", RPROF_RENDER   },
+   { "blit",    RPROF_FRAME    },
+};
+
+static int histpos;   // next slot of the history to fill
+static int histcount; // number of frames in the history
+
+static bool  profilecmd;  // collection requested by r_profile
+static FILE *profilelog;  // per-frame CSV log, if open
+static int   logframe;    // frame number written to the log
+
+//
+// R_profileNow
+//
+// Current time in nanoseconds, from a monotonic clock.
+//
+static int64_t R_profileNow()
+{
+   return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//
+// R_profileLevel
+//
+// Number of enclosing sections, for indentation.
+//
+static int R_profileLevel(int section)
+{
+   int level = 0;
+
+   while((section = profsections[section].parent) >= 0)
+      ++level;
+
+   return level;
+}
+
+//
+// R_ProfileStart
+//
+// Opens a call of the section. Only the outermost of nested calls is timed.
+//
+void R_ProfileStart(int section)
+{
+   rprofsection_t &ps = profsections[section];
+
+   if(ps.depth++ == 0)
+      ps.start = R_profileNow();
+}
+
+//
+// R_ProfileStop
+//
+void R_ProfileStop(int section)
+{
+   rprofsection_t &ps = profsections[section];
+
+   if(ps.depth > 0 && --ps.depth == 0)
+   {
+      ps.frametime += R_profileNow() - ps.start;
+      ++ps.framecalls;
+   }
+}
+
+//
+// R_ProfileBeginFrame
+//
+// Called before each D_Display. Profiling is only switched on or off here, so
+// that no section is ever left half timed.
+//
+void R_ProfileBeginFrame()
+{
+   r_profiling = (profilecmd || r_showprofile || profilelog);
+
+   if(!r_profiling)
+      return;
+
+   for(rprofsection_t &ps : profsections)
+   {
+      ps.depth      = 0;
+      ps.frametime  = 0;
+      ps.framecalls = 0;
+   }
+
+   R_ProfileStart(RPROF_FRAME);
+}
+
+//
+// R_ProfileEndFrame
+//
+// Called after each D_Display. Moves the frame's totals into the history and
+// the log.
+//
+void R_ProfileEndFrame()
+{
+   if(!r_profiling)
+      return;
+
+   R_ProfileStop(RPROF_FRAME);
+
+   for(rprofsection_t &ps : profsections)
+   {
+      ps.times[histpos] = static_cast<float>(ps.frametime / 1000000.0);
+      ps.calls[histpos] = ps.framecalls;
+   }
+
+   if(profilelog)
+   {
+      fprintf(profilelog, "%d", logframe++);
+      for(const rprofsection_t &ps : profsections)
+         fprintf(profilelog, ",%.4f", ps.times[histpos]);
+      for(const rprofsection_t &ps : profsections)
+         fprintf(profilelog, ",%d", ps.calls[histpos]);
+      fputc('\n', profilelog);
+   }
+
+   histpos = (histpos + 1) % PROFILEFRAMES;
+   if(histcount < PROFILEFRAMES)
+      ++histcount;
+}
+
+struct rprofstats_t
+{
+   float min, avg, max, p99;
+   float calls; // average per frame
+};
+
+//
+// R_profileStats
+//
+// Works out the statistics of a section over the last numframes frames.
+//
+static void R_profileStats(int section, int numframes, rprofstats_t &stats)
+{
+   const rprofsection_t &ps = profsections[section];
+   float sorted[PROFILEFRAMES];
+   double total = 0.0, calls = 0.0;
+
+   for(int i = 0; i < numframes; i++)
+   {
+      int frame = (histpos - 1 - i + PROFILEFRAMES) % PROFILEFRAMES;
+
+      sorted[i] = ps.times[frame];
+      total    += ps.times[frame];
+      calls    += ps.calls[frame];
+   }
+
+   std::sort(sorted, sorted + numframes);
+
+   stats.min   = sorted[0];
+   stats.max   = sorted[numframes - 1];
+   stats.avg   = static_cast<float>(total / numframes);
+   stats.p99   = sorted[(numframes * 99 + 99) / 100 - 1];
+   stats.calls = static_cast<float>(calls / numframes);
+}
+
+//
+// R_ProfileFrames
+//
+// Returns the number of frames in the history.
+//
+int R_ProfileFrames()
+{
+   return histcount;
+}
+
+//
+// R_ProfileAverage
+//
+// Returns a section's average time per frame over the whole history, in
+// milliseconds. Other modules use this to show their own timings.
+//
+float R_ProfileAverage(int section)
+{
+   rprofstats_t stats;
+
+   if(!histcount)
+      return 0.0f;
+
+   R_profileStats(section, histcount, stats);
+   return stats.avg;
+}
+
+//
+// R_DrawProfile
+//
+// Draws the average and worst time of each section over the last second or
+// so, below the drawn FPS counter.
+//
+void R_DrawProfile()
+{
+   vfont_t *font = E_FontForName("ee_consolefont");
+   int numframes = std::min(histcount, OVERLAYFRAMES);
+   char buffer[64];
+
+   if(!numframes)
+      return;
+
+   for(int i = 0; i < RPROF_NUMSECTIONS; i++)
+   {
+      rprofstats_t stats;
+
+      R_profileStats(i, numframes, stats);
+      psnprintf(buffer, sizeof(buffer), "%*s%-8s %6.2f %6.2f",
+                R_profileLevel(i) * 2, "", profsections[i].name,
+                stats.avg, stats.max);
+      V_FontWriteText(font, buffer, 1, 30 + i * font->cy);
+   }
+}
+
+//
+// R_profileCloseLog
+//
+static void R_profileCloseLog()
+{
+   if(profilelog)
+   {
+      fclose(profilelog);
+      profilelog = NULL;
+   }
+}
+
+//
+// R_profileOpenLog
+//
+// Opens the CSV log and writes its header: the frame number, the time of
+// each section in milliseconds, then the number of calls of each section.
+//
+static void R_profileOpenLog(const char *filename)
+{
+   R_profileCloseLog();
+
+   if(!(profilelog = fopen(filename, "w")))
+   {
+      C_Printf(FC_ERROR "Couldn't open file %s for profile logging\n", filename);
+      return;
+   }
+
+   fputs("frame", profilelog);
+   for(const rprofsection_t &ps : profsections)
+      fprintf(profilelog, ",%s_ms", ps.name);
+   for(const rprofsection_t &ps : profsections)
+      fprintf(profilelog, ",%s_calls", ps.name);
+   fputc('\n', profilelog);
+
+   logframe = 0;
+   C_Printf("Logging renderer profile to %s\n", filename);
+}
+
+VARIABLE_TOGGLE(r_showprofile, NULL, onoff);
+CONSOLE_VARIABLE(r_showprofile, r_showprofile, 0) {}
+
+//
+// r_profile
+//
+// With no argument, starts collecting timings or prints the statistics of
+// those collected so far. "reset" empties the history, and "off" stops
+// collecting unless the overlay or log still need it.
+//
+CONSOLE_COMMAND(r_profile, 0)
+{
+   if(Console.argc >= 1)
+   {
+      if(!Console.argv[0]->strCaseCmp("reset"))
+         histpos = histcount = 0;
+      else if(!Console.argv[0]->strCaseCmp("off"))
+         profilecmd = false;
+      else
+         C_Printf("usage: r_profile [reset | off]\n");
+      return;
+   }
+
+   if(!profilecmd && !r_profiling)
+   {
+      profilecmd = true;
+      C_Printf("Renderer profiling started; use r_profile again for results\n");
+      return;
+   }
+
+   profilecmd = true;
+
+   if(!histcount)
+   {
+      C_Printf("No frames profiled yet\n");
+      return;
+   }
+
+   C_Printf(FC_HI "Renderer profile over %d frames (ms)\n", histcount);
+   C_Printf("%-12s %7s %7s %7s %7s %7s\n", "section", "calls", "min", "avg",
+            "max", "p99");
+
+   for(int i = 0; i < RPROF_NUMSECTIONS; i++)
+   {
+      rprofstats_t stats;
+      char name[16];
+
+      R_profileStats(i, histcount, stats);
+      psnprintf(name, sizeof(name), "%*s%s", R_profileLevel(i) * 2, "",
+                profsections[i].name);
+      C_Printf("%-12s %7.1f %7.2f %7.2f %7.2f %7.2f\n", name, stats.calls,
+               stats.min, stats.avg, stats.max, stats.p99);
+   }
+}
+
+//
+// r_profilelog
+//
+// Starts logging one CSV line per frame to the given file, or stops logging
+// when no file is given.
+//
+CONSOLE_COMMAND(r_profilelog, 0)
+{
+   if(!Console.argc)
+   {
+      if(profilelog)
+         C_Printf("Renderer profile log closed\n");
+      R_profileCloseLog();
+   }
+   else
+      R_profileOpenLog(Console.argv[0]->constPtr());
+}
+
+// EOF
+
@@ -0,0 +1,91 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// Copyright (C) 2013 James Haley et al.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+// Additional terms and conditions compatible with the GPLv3 apply. See the
+// file COPYING-EE for details.
+//
+//--------------------------------------------------------------------------
+//
+// DESCRIPTION:
+//      Per-frame renderer profiler.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef R_PROFILE_H__
+#define R_PROFILE_H__
+
+// Timed sections. Each one's time includes everything nested inside it, and
+// a section entered again while already open (R_RenderBSPNode recursing, or
+// a portal window rendering its own BSP) is only timed at the outermost call.
+enum rprofsection_e
+{
+   RPROF_FRAME,      // D_Display as a whole
+   RPROF_RENDER,     // R_RenderPlayerView
+   RPROF_BSP,        // R_RenderBSPNode
+   RPROF_WALLS,      // R_StoreWallRange
+   RPROF_PORTALS,    // R_RenderPortals
+   RPROF_PORTALWIN,  // each portal window rendered by R_RenderPortals
+   RPROF_PLANES,     // R_DrawPlanes
+   RPROF_POSTBSP,    // R_DrawPostBSP
+   RPROF_BLIT,       // I_FinishUpdate
+   RPROF_NUMSECTIONS
+};
+
+extern bool r_profiling;   // true while timings are being collected
+extern bool r_showprofile; // draw the profile overlay
+
+void R_ProfileStart(int section);
+void R_ProfileStop(int section);
+
+void R_ProfileBeginFrame();
+void R_ProfileEndFrame();
+
+void R_DrawProfile();
+
+int   R_ProfileFrames();
+float R_ProfileAverage(int section);
+
+//
+// RProfileScope
+//
+// Times the section for as long as the object lives. Costs one test of
+// r_profiling when profiling is off. Only meant for the main thread.
+//
+class RProfileScope
+{
+protected:
+   int section;
+
+public:
+   explicit RProfileScope(int pSection) : section(pSection)
+   {
+      if(r_profiling)
+         R_ProfileStart(section);
+   }
+
+   ~RProfileScope()
+   {
+      if(r_profiling)
+         R_ProfileStop(section);
+   }
+};
+
+#endif
+
+// EOF
+
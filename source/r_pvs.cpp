@@ -0,0 +1,1144 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// Copyright (C) 2013 James Haley et al.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+// Additional terms and conditions compatible with the GPLv3 apply. See the
+// file COPYING-EE for details.
+//
+//--------------------------------------------------------------------------
+//
+// DESCRIPTION:
+//      Potentially visible set (PVS) of each subsector.
+//
+//      When a level is loaded with r_pvs on, the plane is cut into the
+//      convex regions of the BSP leaves. Wherever two subsectors share a
+//      piece of partition line, and no one-sided wall covers it, a portal
+//      joins them. A portal flow pass then works out, on worker threads,
+//      which subsectors can be seen through some chain of portals from
+//      anywhere inside each subsector.
+//
+//      Only walls count, never floor or ceiling heights, so the sets stay
+//      valid however the sectors move. Polyobject lines are treated as
+//      open. Subsectors the flow cannot handle, and any search that runs
+//      over its budget, simply see everything.
+//
+//      While the main view is rendered, R_RenderBSPNode skips every subtree
+//      that holds no subsector visible from the view's subsector. Portal
+//      windows look from viewpoints the sets know nothing about, so they
+//      are never culled.
+//
+//      Built sets are cached in the user's game directory, in files named
+//      after a hash of the level geometry they were built from.
+//
+//-----------------------------------------------------------------------------
+
+#include "z_zone.h"
+
+#include <atomic>
+#include <chrono>
+#include "../zlib/zlib.h"
+
+#include "hal/i_directory.h"
+#include "c_io.h"
+#include "c_runcmd.h"
+#include "doomstat.h"
+#include "m_collection.h"
+#include "m_compare.h"
+#include "m_hash.h"
+#include "m_qstr.h"
+#include "m_threads.h"
+#include "m_vector.h"
+#include "r_defs.h"
+#include "r_main.h"
+#include "r_pvs.h"
+#include "r_state.h"
+#include "v_misc.h"
+
+#define PVS_MAXLEAVES  16384     // levels with more subsectors get no PVS
+#define PVS_FLOWSTEPS  (1 << 18) // portal flow steps allowed per subsector
+#define PVS_MAXDEPTH   1024      // longest chain of portals followed
+#define PVS_EPSILON    0.125     // how far behind a clip line a point is kept
+#define PVS_ONLINE     0.01      // how near a line a point is on it
+#define PVS_MINLENGTH  0.01      // shortest piece of portal kept
+#define PVS_MINAREA    1.0       // smallest subsector the flow is trusted with
+#define PVS_VERSION    1         // change whenever built sets would change
+
+bool r_pvs;
+
+const byte *r_pvsrow;
+const byte *r_pvsnodes;
+
+static byte *pvsrows;        // numsubsectors rows of numsubsectors bits
+static byte *pvsnodevis;     // nodes visible from pvsviewleaf
+static int   pvsrowbytes;
+static int   pvsviewleaf;    // subsector pvsnodevis was marked for
+
+static int   pvsbuildtime;   // milliseconds taken by the last build
+static int   pvsoverflows;   // subsectors whose flow ran out of steps
+static bool  pvsfromcache;   // last set was read from the cache
+
+// A line, with the points in front of it at a positive distance.
+struct pvsplane_t
+{
+   double nx, ny, d;
+};
+
+// A piece of portal.
+struct pvswinding_t
+{
+   v2double_t v[2];
+};
+
+// A way out of a subsector.
+struct pvslink_t
+{
+   int          leaf;  // subsector on the other side
+   pvswinding_t w;
+   pvsplane_t   plane; // facing the other subsector
+};
+
+struct pvsrawlink_t
+{
+   int       from;
+   pvslink_t link;
+};
+
+// A piece of partition line ending up in a subsector.
+struct pvsfrag_t
+{
+   int    leaf;
+   double t1, t2;
+};
+
+typedef PODCollection<v2double_t> pvspoly_t;
+
+struct pvsbuild_t
+{
+   int         numleaves;
+   int         rowbytes;
+   byte       *rows;
+
+   pvsplane_t *nodeplanes;
+   pvsplane_t *segplanes;
+   bool       *solid;     // seg blocks sight
+   bool       *trusted;   // subsector can be handed to the flow
+
+   PODCollection<pvsrawlink_t> rawlinks;
+
+   int        *firstlink; // numleaves + 1 indices into links
+   pvslink_t  *links;
+
+   std::atomic<int> overflows;
+};
+
+//=============================================================================
+//
+// Geometry
+//
+
+//
+// R_pvsPlane
+//
+// Makes the line from a to b, with its front on the right as for a seg or
+// node.
+//
+static pvsplane_t R_pvsPlane(const v2double_t &a, const v2double_t &b)
+{
+   pvsplane_t pl = { 0.0, 0.0, 0.0 };
+   double dx  = b.x - a.x;
+   double dy  = b.y - a.y;
+   double len = sqrt(dx * dx + dy * dy);
+
+   if(len > 0.0)
+   {
+      pl.nx = dy / len;
+      pl.ny = -dx / len;
+      pl.d  = pl.nx * a.x + pl.ny * a.y;
+   }
+
+   return pl;
+}
+
+static double R_pvsDist(const pvsplane_t &pl, const v2double_t &p)
+{
+   return pl.nx * p.x + pl.ny * p.y - pl.d;
+}
+
+static v2double_t R_pvsVertex(const vertex_t *v)
+{
+   v2double_t p = { M_FixedToDouble(v->x), M_FixedToDouble(v->y) };
+   return p;
+}
+
+//
+// R_pvsSolidSeg
+//
+// One-sided walls block sight. Polyobject lines move, so they never do.
+//
+static bool R_pvsSolidSeg(const seg_t &seg)
+{
+   return !seg.backsector && !(seg.linedef->intflags & MLI_DYNASEGLINE);
+}
+
+//
+// R_pvsClipWinding
+//
+// Keeps the part of the winding in front of the line, or at most
+// PVS_EPSILON behind it. Returns false if nothing is left.
+//
+static bool R_pvsClipWinding(pvswinding_t &w, const pvsplane_t &pl)
+{
+   double d0 = R_pvsDist(pl, w.v[0]) + PVS_EPSILON;
+   double d1 = R_pvsDist(pl, w.v[1]) + PVS_EPSILON;
+
+   if(d0 >= 0.0 && d1 >= 0.0)
+      return true;
+   if(d0 < 0.0 && d1 < 0.0)
+      return false;
+
+   double frac = d0 / (d0 - d1);
+   v2double_t mid =
+   {
+      w.v[0].x + frac * (w.v[1].x - w.v[0].x),
+      w.v[0].y + frac * (w.v[1].y - w.v[0].y)
+   };
+
+   w.v[d0 < 0.0 ? 0 : 1] = mid;
+   return true;
+}
+
+//
+// R_pvsClipToSeparators
+//
+// Clips the winding to what can be seen from first through second. Every
+// line through an end of each that has the two on opposite sides bounds the
+// view, which lies on second's side of it.
+//
+static bool R_pvsClipToSeparators(const pvswinding_t &first,
+                                  const pvswinding_t &second, pvswinding_t &w)
+{
+   for(int i = 0; i < 2; i++)
+   {
+      for(int j = 0; j < 2; j++)
+      {
+         pvsplane_t pl = R_pvsPlane(first.v[i], second.v[j]);
+
+         if(pl.nx == 0.0 && pl.ny == 0.0)
+            continue;
+
+         double df = R_pvsDist(pl, first.v[i ^ 1]);
+         double ds = R_pvsDist(pl, second.v[j ^ 1]);
+
+         if(fabs(ds) < PVS_ONLINE || df * ds > 0.0)
+            continue;
+
+         if(ds < 0.0)
+         {
+            pl.nx = -pl.nx;
+            pl.ny = -pl.ny;
+            pl.d  = -pl.d;
+         }
+
+         if(!R_pvsClipWinding(w, pl))
+            return false;
+      }
+   }
+
+   return true;
+}
+
+//
+// R_pvsSplitPoly
+//
+// Splits a convex polygon along a line.
+//
+static void R_pvsSplitPoly(const pvspoly_t &poly, const pvsplane_t &pl,
+                           pvspoly_t &front, pvspoly_t &back)
+{
+   size_t numpoints = poly.getLength();
+
+   for(size_t i = 0; i < numpoints; i++)
+   {
+      const v2double_t &p = poly[i];
+      const v2double_t &q = poly[(i + 1) % numpoints];
+      double dp = R_pvsDist(pl, p);
+      double dq = R_pvsDist(pl, q);
+
+      if(dp >= 0.0)
+         front.add(p);
+      if(dp <= 0.0)
+         back.add(p);
+
+      if((dp > 0.0 && dq < 0.0) || (dp < 0.0 && dq > 0.0))
+      {
+         double frac = dp / (dp - dq);
+         v2double_t mid = { p.x + frac * (q.x - p.x), p.y + frac * (q.y - p.y) };
+
+         front.add(mid);
+         back.add(mid);
+      }
+   }
+}
+
+//
+// R_pvsLeafArea
+//
+// Area of the part of a subsector's region on the open side of its walls.
+//
+static double R_pvsLeafArea(const pvsbuild_t &build, const pvspoly_t &region,
+                            int leaf)
+{
+   const subsector_t &ss = subsectors[leaf];
+   pvspoly_t poly;
+   double area = 0.0;
+
+   poly.assign(region);
+
+   for(int i = ss.firstline; i < ss.firstline + ss.numlines; i++)
+   {
+      if(!build.solid[i])
+         continue;
+
+      pvspoly_t front, back;
+      R_pvsSplitPoly(poly, build.segplanes[i], front, back);
+      poly.assign(front);
+   }
+
+   size_t numpoints = poly.getLength();
+   for(size_t i = 0; i < numpoints; i++)
+   {
+      const v2double_t &p = poly[i];
+      const v2double_t &q = poly[(i + 1) % numpoints];
+      area += p.x * q.y - q.x * p.y;
+   }
+
+   return fabs(area) / 2.0;
+}
+
+//=============================================================================
+//
+// Portals
+//
+
+//
+// R_pvsFragments
+//
+// Sends the piece [t1, t2] of a partition line down a subtree lying on the
+// inward side of it, recording which subsectors its parts end up in.
+//
+static void R_pvsFragments(const pvsbuild_t &build, int bspnum,
+                           const v2double_t &o, const v2double_t &dir,
+                           double t1, double t2, const v2double_t &inward,
+                           PODCollection<pvsfrag_t> &frags)
+{
+   while(!(bspnum & NF_SUBSECTOR))
+   {
+      const node_t     &node = nodes[bspnum];
+      const pvsplane_t &pl   = build.nodeplanes[bspnum];
+      v2double_t a = { o.x + t1 * dir.x, o.y + t1 * dir.y };
+      v2double_t b = { o.x + t2 * dir.x, o.y + t2 * dir.y };
+      double d1 = R_pvsDist(pl, a);
+      double d2 = R_pvsDist(pl, b);
+
+      if(fabs(d1) < PVS_ONLINE && fabs(d2) < PVS_ONLINE)
+      {
+         // the piece runs along this partition, and the subtree all lies on
+         // the inward side of it
+         bspnum = node.children[pl.nx * inward.x + pl.ny * inward.y >= 0.0 ? 0 : 1];
+      }
+      else if(d1 > -PVS_ONLINE && d2 > -PVS_ONLINE)
+         bspnum = node.children[0];
+      else if(d1 < PVS_ONLINE && d2 < PVS_ONLINE)
+         bspnum = node.children[1];
+      else
+      {
+         double tm = t1 + (t2 - t1) * d1 / (d1 - d2);
+
+         R_pvsFragments(build, node.children[d1 > 0.0 ? 0 : 1], o, dir, t1, tm,
+                        inward, frags);
+         bspnum = node.children[d1 > 0.0 ? 1 : 0];
+         t1 = tm;
+      }
+   }
+
+   pvsfrag_t &frag = frags.addNew();
+   frag.leaf = (bspnum == -1) ? 0 : bspnum & ~NF_SUBSECTOR;
+   frag.t1   = t1;
+   frag.t2   = t2;
+}
+
+//
+// R_pvsClipToLeaf
+//
+// Cuts off the parts of a portal behind the subsector's walls.
+//
+static bool R_pvsClipToLeaf(const pvsbuild_t &build, pvswinding_t &w, int leaf)
+{
+   const subsector_t &ss = subsectors[leaf];
+
+   for(int i = ss.firstline; i < ss.firstline + ss.numlines; i++)
+   {
+      if(build.solid[i] && !R_pvsClipWinding(w, build.segplanes[i]))
+         return false;
+   }
+
+   return true;
+}
+
+//
+// R_pvsAddLinks
+//
+// Adds the way from one subsector to another through a portal. Walls of the
+// first subsector lying along the portal face it and cover their part of the
+// way; walls of the second are seen from behind, which the renderer does not
+// draw, so they cover nothing.
+//
+static void R_pvsAddLinks(pvsbuild_t &build, int from, int to,
+                          const pvswinding_t &w, const pvsplane_t &plane)
+{
+   const subsector_t &ss = subsectors[from];
+   v2double_t dir = { w.v[1].x - w.v[0].x, w.v[1].y - w.v[0].y };
+   double len = sqrt(dir.x * dir.x + dir.y * dir.y);
+   double open[32][2];
+   int numopen = 1;
+
+   if(len < PVS_MINLENGTH)
+      return;
+
+   dir.x /= len;
+   dir.y /= len;
+   open[0][0] = 0.0;
+   open[0][1] = len;
+
+   for(int i = ss.firstline; i < ss.firstline + ss.numlines && numopen; i++)
+   {
+      const seg_t &seg = segs[i];
+
+      if(!build.solid[i])
+         continue;
+
+      v2double_t v1 = R_pvsVertex(seg.v1);
+      v2double_t v2 = R_pvsVertex(seg.v2);
+
+      if(fabs(R_pvsDist(plane, v1)) >= PVS_ONLINE ||
+         fabs(R_pvsDist(plane, v2)) >= PVS_ONLINE)
+         continue;
+
+      // the part of the portal the wall covers, less a margin at each end
+      double s1 = (v1.x - w.v[0].x) * dir.x + (v1.y - w.v[0].y) * dir.y;
+      double s2 = (v2.x - w.v[0].x) * dir.x + (v2.y - w.v[0].y) * dir.y;
+      if(s1 > s2)
+         std::swap(s1, s2);
+      s1 += PVS_EPSILON;
+      s2 -= PVS_EPSILON;
+      if(s1 >= s2)
+         continue;
+
+      int newnum = 0;
+      double newopen[32][2];
+
+      for(int j = 0; j < numopen; j++)
+      {
+         double lo = open[j][0], hi = open[j][1];
+
+         if(s2 <= lo || s1 >= hi)
+         {
+            newopen[newnum][0] = lo;
+            newopen[newnum++][1] = hi;
+            continue;
+         }
+         if(s1 > lo && newnum < 32)
+         {
+            newopen[newnum][0] = lo;
+            newopen[newnum++][1] = s1;
+         }
+         if(s2 < hi && newnum < 32)
+         {
+            newopen[newnum][0] = s2;
+            newopen[newnum++][1] = hi;
+         }
+      }
+
+      if(newnum >= 31)
+         break; // too broken up to be worth following closely
+      memcpy(open, newopen, sizeof(open[0]) * newnum);
+      numopen = newnum;
+   }
+
+   for(int i = 0; i < numopen; i++)
+   {
+      if(open[i][1] - open[i][0] < PVS_MINLENGTH)
+         continue;
+
+      pvsrawlink_t &raw = build.rawlinks.addNew();
+      raw.from         = from;
+      raw.link.leaf    = to;
+      raw.link.plane   = plane;
+      raw.link.w.v[0].x = w.v[0].x + open[i][0] * dir.x;
+      raw.link.w.v[0].y = w.v[0].y + open[i][0] * dir.y;
+      raw.link.w.v[1].x = w.v[0].x + open[i][1] * dir.x;
+      raw.link.w.v[1].y = w.v[0].y + open[i][1] * dir.y;
+   }
+}
+
+//
+// R_pvsAddPortal
+//
+// Joins two subsectors meeting along a partition line, the first in front
+// of it and the second behind it.
+//
+static void R_pvsAddPortal(pvsbuild_t &build, int front, int back,
+                           const v2double_t &a, const v2double_t &b,
+                           const pvsplane_t &pl)
+{
+   pvswinding_t w = { { a, b } };
+   pvsplane_t   flipped = { -pl.nx, -pl.ny, -pl.d };
+
+   if(front == back)
+      return;
+
+   if(!R_pvsClipToLeaf(build, w, front) || !R_pvsClipToLeaf(build, w, back))
+      return;
+
+   R_pvsAddLinks(build, front, back, w, flipped);
+   R_pvsAddLinks(build, back, front, w, pl);
+}
+
+//
+// R_pvsNodePortals
+//
+// Walks the BSP with the region of the plane each node covers, making
+// portals where each partition line meets subsectors on both sides of it.
+//
+static void R_pvsNodePortals(pvsbuild_t &build, int bspnum,
+                             const pvspoly_t &region)
+{
+   if(bspnum & NF_SUBSECTOR)
+   {
+      int leaf = (bspnum == -1) ? 0 : bspnum & ~NF_SUBSECTOR;
+
+      if(leaf < build.numleaves)
+         build.trusted[leaf] = (R_pvsLeafArea(build, region, leaf) >= PVS_MINAREA);
+      return;
+   }
+
+   const node_t     &node = nodes[bspnum];
+   const pvsplane_t &pl   = build.nodeplanes[bspnum];
+   pvspoly_t front, back;
+
+   R_pvsSplitPoly(region, pl, front, back);
+
+   if(front.getLength() >= 3 && back.getLength() >= 3)
+   {
+      v2double_t o   = { M_FixedToDouble(node.x), M_FixedToDouble(node.y) };
+      v2double_t dir = { -pl.ny, pl.nx };
+      double tmin = HUGE_VAL, tmax = -HUGE_VAL;
+
+      // the partition's extent within the region
+      for(const v2double_t &p : front)
+      {
+         if(fabs(R_pvsDist(pl, p)) < PVS_ONLINE)
+         {
+            double t = (p.x - o.x) * dir.x + (p.y - o.y) * dir.y;
+            tmin = emin(tmin, t);
+            tmax = emax(tmax, t);
+         }
+      }
+
+      if(tmax - tmin > PVS_MINLENGTH)
+      {
+         PODCollection<pvsfrag_t> ffrags, bfrags;
+         v2double_t inward  = {  pl.nx,  pl.ny };
+         v2double_t outward = { -pl.nx, -pl.ny };
+
+         R_pvsFragments(build, node.children[0], o, dir, tmin, tmax, inward,
+                        ffrags);
+         R_pvsFragments(build, node.children[1], o, dir, tmin, tmax, outward,
+                        bfrags);
+
+         for(const pvsfrag_t &f : ffrags)
+         {
+            for(const pvsfrag_t &b : bfrags)
+            {
+               double lo = emax(f.t1, b.t1);
+               double hi = emin(f.t2, b.t2);
+
+               if(hi - lo < PVS_MINLENGTH)
+                  continue;
+
+               v2double_t pa = { o.x + lo * dir.x, o.y + lo * dir.y };
+               v2double_t pb = { o.x + hi * dir.x, o.y + hi * dir.y };
+               R_pvsAddPortal(build, f.leaf, b.leaf, pa, pb, pl);
+            }
+         }
+      }
+   }
+
+   R_pvsNodePortals(build, node.children[0], front);
+   R_pvsNodePortals(build, node.children[1], back);
+}
+
+//
+// R_pvsSortLinks
+//
+// Groups the links by the subsector they lead out of.
+//
+static void R_pvsSortLinks(pvsbuild_t &build)
+{
+   size_t numlinks = build.rawlinks.getLength();
+
+   build.firstlink = ecalloc(int *, build.numleaves + 1, sizeof(int));
+   build.links     = ecalloc(pvslink_t *, numlinks + 1, sizeof(pvslink_t));
+
+   for(const pvsrawlink_t &raw : build.rawlinks)
+      ++build.firstlink[raw.from + 1];
+   for(int i = 0; i < build.numleaves; i++)
+      build.firstlink[i + 1] += build.firstlink[i];
+
+   int *next = ecalloc(int *, build.numleaves, sizeof(int));
+   memcpy(next, build.firstlink, build.numleaves * sizeof(int));
+
+   for(const pvsrawlink_t &raw : build.rawlinks)
+      build.links[next[raw.from]++] = raw.link;
+
+   efree(next);
+   build.rawlinks.clear();
+}
+
+//=============================================================================
+//
+// Portal flow
+//
+
+struct pvsflow_t
+{
+   const pvsbuild_t *build;
+   byte *row;
+   byte *onpath;   // subsectors on the current chain of portals
+   int   steps;    // steps left before giving up
+};
+
+//
+// R_pvsFlow
+//
+// Follows every way out of a subsector that can still be seen through the
+// source portal and the portal entered by, then the ways out of the
+// subsectors those lead to, and so on. depth is 0 for the subsector right
+// behind the source portal.
+//
+static bool R_pvsFlow(pvsflow_t &flow, int leaf, const pvswinding_t &source,
+                      const pvsplane_t &srcplane, const pvswinding_t &pass,
+                      int depth)
+{
+   const pvsbuild_t &build = *flow.build;
+
+   if(--flow.steps < 0 || depth > PVS_MAXDEPTH)
+      return false;
+
+   flow.onpath[leaf] = 1;
+
+   for(int i = build.firstlink[leaf]; i < build.firstlink[leaf + 1]; i++)
+   {
+      const pvslink_t &link = build.links[i];
+
+      if(flow.onpath[link.leaf])
+         continue;
+
+      // the way must lie beyond the source portal; sight only grazes one
+      // lying along its line
+      pvswinding_t target = link.w;
+      if(!R_pvsClipWinding(target, srcplane) ||
+         emax(R_pvsDist(srcplane, target.v[0]),
+              R_pvsDist(srcplane, target.v[1])) <= PVS_ONLINE)
+         continue;
+
+      pvswinding_t newsource = source;
+      if(depth > 0 &&
+         (!R_pvsClipToSeparators(source, pass, target) ||
+          !R_pvsClipToSeparators(target, pass, newsource)))
+         continue;
+
+      flow.row[link.leaf >> 3] |= 1 << (link.leaf & 7);
+
+      if(!R_pvsFlow(flow, link.leaf, newsource, srcplane, target, depth + 1))
+         return false;
+   }
+
+   flow.onpath[leaf] = 0;
+   return true;
+}
+
+//
+// R_pvsFlowLeaf
+//
+// Works out the row of one subsector. Runs on the worker threads, so it must
+// not touch the zone heap.
+//
+static void R_pvsFlowLeaf(int leaf, void *data)
+{
+   pvsbuild_t &build = *static_cast<pvsbuild_t *>(data);
+   byte *row = build.rows + size_t(leaf) * build.rowbytes;
+
+   if(!build.trusted[leaf])
+   {
+      memset(row, 0xff, build.rowbytes);
+      return;
+   }
+
+   pvsflow_t flow = { &build, row, new byte[build.numleaves](), PVS_FLOWSTEPS };
+   bool done = true;
+
+   row[leaf >> 3] |= 1 << (leaf & 7);
+   flow.onpath[leaf] = 1;
+
+   for(int i = build.firstlink[leaf]; i < build.firstlink[leaf + 1] && done; i++)
+   {
+      const pvslink_t &link = build.links[i];
+
+      row[link.leaf >> 3] |= 1 << (link.leaf & 7);
+      done = R_pvsFlow(flow, link.leaf, link.w, link.plane, link.w, 0);
+   }
+
+   if(!done)
+   {
+      memset(row, 0xff, build.rowbytes);
+      ++build.overflows;
+   }
+
+   delete [] flow.onpath;
+}
+
+//
+// R_pvsCompute
+//
+// Builds the rows of every subsector.
+//
+static void R_pvsCompute(byte *rows, int rowbytes)
+{
+   pvsbuild_t build;
+   pvspoly_t  region;
+
+   build.numleaves  = numsubsectors;
+   build.rowbytes   = rowbytes;
+   build.rows       = rows;
+   build.nodeplanes = ecalloc(pvsplane_t *, numnodes, sizeof(pvsplane_t));
+   build.segplanes  = ecalloc(pvsplane_t *, numsegs, sizeof(pvsplane_t));
+   build.solid      = ecalloc(bool *, numsegs, sizeof(bool));
+   build.trusted    = ecalloc(bool *, numsubsectors, sizeof(bool));
+   build.overflows  = 0;
+
+   for(int i = 0; i < numnodes; i++)
+   {
+      v2double_t a = { M_FixedToDouble(nodes[i].x), M_FixedToDouble(nodes[i].y) };
+      v2double_t b = { a.x + M_FixedToDouble(nodes[i].dx),
+                       a.y + M_FixedToDouble(nodes[i].dy) };
+      build.nodeplanes[i] = R_pvsPlane(a, b);
+   }
+
+   for(int i = 0; i < numsegs; i++)
+   {
+      build.segplanes[i] = R_pvsPlane(R_pvsVertex(segs[i].v1),
+                                      R_pvsVertex(segs[i].v2));
+      build.solid[i] = R_pvsSolidSeg(segs[i]);
+   }
+
+   // start with a box around the whole level
+   double bbox[4] = { HUGE_VAL, -HUGE_VAL, HUGE_VAL, -HUGE_VAL };
+   for(int i = 0; i < numvertexes; i++)
+   {
+      v2double_t p = R_pvsVertex(&vertexes[i]);
+      bbox[0] = emin(bbox[0], p.x);
+      bbox[1] = emax(bbox[1], p.x);
+      bbox[2] = emin(bbox[2], p.y);
+      bbox[3] = emax(bbox[3], p.y);
+   }
+   v2double_t corners[4] =
+   {
+      { bbox[0] - 64.0, bbox[2] - 64.0 }, { bbox[0] - 64.0, bbox[3] + 64.0 },
+      { bbox[1] + 64.0, bbox[3] + 64.0 }, { bbox[1] + 64.0, bbox[2] - 64.0 }
+   };
+   for(const v2double_t &corner : corners)
+      region.add(corner);
+
+   R_pvsNodePortals(build, numnodes - 1, region);
+   R_pvsSortLinks(build);
+
+   WorkerPool pool;
+   pool.setNumThreads(M_NumCPUs() - 1);
+   pool.run(build.numleaves, R_pvsFlowLeaf, &build);
+
+   // the flow cannot tell what sees subsectors it wasn't trusted with, so
+   // everything does
+   for(int leaf = 0; leaf < build.numleaves; leaf++)
+   {
+      if(build.trusted[leaf])
+         continue;
+
+      for(int i = 0; i < build.numleaves; i++)
+         rows[size_t(i) * rowbytes + (leaf >> 3)] |= 1 << (leaf & 7);
+   }
+
+   pvsoverflows = build.overflows;
+
+   efree(build.nodeplanes);
+   efree(build.segplanes);
+   efree(build.solid);
+   efree(build.trusted);
+   efree(build.firstlink);
+   efree(build.links);
+}
+
+//=============================================================================
+//
+// Cache
+//
+
+struct pvscacheheader_t
+{
+   char     magic[4];
+   int32_t  version;
+   int32_t  numleaves;
+   uint32_t size;     // of the compressed rows that follow
+};
+
+//
+// R_PVSHashLevel
+//
+// Hashes everything the sets are built from. Leaves the hash open, so more
+// can be added to it.
+//
+void R_PVSHashLevel(HashData &hash)
+{
+   int32_t header[3] = { PVS_VERSION, numnodes, numsubsectors };
+
+   hash.addData(reinterpret_cast<const uint8_t *>(header), sizeof(header));
+
+   for(int i = 0; i < numnodes; i++)
+   {
+      const node_t &node = nodes[i];
+      int32_t data[6] = { node.x, node.y, node.dx, node.dy,
+                          node.children[0], node.children[1] };
+      hash.addData(reinterpret_cast<const uint8_t *>(data), sizeof(data));
+   }
+
+   for(int i = 0; i < numsubsectors; i++)
+   {
+      int32_t data[2] = { subsectors[i].firstline, subsectors[i].numlines };
+      hash.addData(reinterpret_cast<const uint8_t *>(data), sizeof(data));
+   }
+
+   for(int i = 0; i < numsegs; i++)
+   {
+      const seg_t &seg = segs[i];
+      int32_t data[5] = { seg.v1->x, seg.v1->y, seg.v2->x, seg.v2->y,
+                          R_pvsSolidSeg(seg) };
+      hash.addData(reinterpret_cast<const uint8_t *>(data), sizeof(data));
+   }
+}
+
+//
+// R_pvsCachePath
+//
+static void R_pvsCachePath(qstring &path)
+{
+   HashData hash(HashData::SHA1);
+   char *digest;
+
+   R_PVSHashLevel(hash);
+   hash.wrapUp();
+   digest = hash.digestToString();
+
+   path = usergamepath;
+   path.pathConcatenate("cache");
+   I_CreateDirectory(path);
+   path.pathConcatenate(digest);
+   path += ".pvs";
+
+   efree(digest);
+}
+
+//
+// R_pvsReadCache
+//
+static bool R_pvsReadCache(const char *filename, byte *rows, size_t size)
+{
+   pvscacheheader_t header;
+   FILE *f;
+   bool  ok = false;
+
+   if(!(f = fopen(filename, "rb")))
+      return false;
+
+   if(fread(&header, sizeof(header), 1, f) == 1 &&
+      !memcmp(header.magic, "EPVS", 4) && header.version == PVS_VERSION &&
+      header.numleaves == numsubsectors)
+   {
+      byte *data = emalloc(byte *, header.size);
+      uLongf destsize = uLongf(size);
+
+      ok = (fread(data, header.size, 1, f) == 1 &&
+            uncompress(rows, &destsize, data, header.size) == Z_OK &&
+            destsize == size);
+      efree(data);
+   }
+
+   fclose(f);
+   return ok;
+}
+
+//
+// R_pvsWriteCache
+//
+static void R_pvsWriteCache(const char *filename, const byte *rows, size_t size)
+{
+   pvscacheheader_t header = { { 'E', 'P', 'V', 'S' }, PVS_VERSION, numsubsectors, 0 };
+   uLongf compsize = compressBound(uLong(size));
+   byte  *data     = emalloc(byte *, compsize);
+   FILE  *f;
+
+   if(compress2(data, &compsize, rows, uLong(size), Z_BEST_SPEED) == Z_OK &&
+      (f = fopen(filename, "wb")))
+   {
+      header.size = uint32_t(compsize);
+      if(fwrite(&header, sizeof(header), 1, f) != 1 ||
+         fwrite(data, compsize, 1, f) != 1)
+         C_Printf(FC_ERROR "Couldn't write PVS cache %s\n", filename);
+      fclose(f);
+   }
+
+   efree(data);
+}
+
+//
+// R_pvsLoadRows
+//
+// Fills in the rows of the level from the cache, or builds them and caches
+// them. Returns true if they came from the cache.
+//
+static bool R_pvsLoadRows(byte *rows)
+{
+   size_t  size = size_t((numsubsectors + 7) / 8) * numsubsectors;
+   qstring path;
+
+   R_pvsCachePath(path);
+
+   if(R_pvsReadCache(path.constPtr(), rows, size))
+      return true;
+
+   memset(rows, 0, size);
+   R_pvsCompute(rows, (numsubsectors + 7) / 8);
+   R_pvsWriteCache(path.constPtr(), rows, size);
+   return false;
+}
+
+//=============================================================================
+//
+// Interface
+//
+
+//
+// R_PVSBuild
+//
+// Called from P_SetupLevel once polyobjects are set up, and whenever r_pvs
+// is switched on during a level. Reads the level's sets from the cache, or
+// builds them.
+//
+void R_PVSBuild()
+{
+   if(pvsrows)
+      Z_Free(pvsrows);
+   if(pvsnodevis)
+      Z_Free(pvsnodevis);
+
+   r_pvsrow    = NULL;
+   r_pvsnodes  = NULL;
+   pvsviewleaf = -1;
+
+   if(!r_pvs || numnodes < 1)
+      return;
+
+   if(numsubsectors > PVS_MAXLEAVES)
+   {
+      C_Printf(FC_ERROR "PVS: too many subsectors (%d) to build one\n",
+               numsubsectors);
+      return;
+   }
+
+   auto start = std::chrono::steady_clock::now();
+
+   pvsrowbytes = (numsubsectors + 7) / 8;
+
+   Z_Malloc(size_t(pvsrowbytes) * numsubsectors, PU_LEVEL, (void **)&pvsrows);
+   Z_Malloc(numnodes, PU_LEVEL, (void **)&pvsnodevis);
+
+   pvsfromcache = R_pvsLoadRows(pvsrows);
+
+   pvsbuildtime = int(std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - start).count());
+}
+
+//
+// R_PVSRows
+//
+// The sets R_PVSBuild made for the level, (numsubsectors + 7) / 8 bytes per
+// subsector, or NULL if r_pvs is off or the level has none.
+//
+const byte *R_PVSRows()
+{
+   return pvsrows;
+}
+
+//
+// R_PVSMakeRows
+//
+// Reads or builds sets for the level like R_PVSBuild does, whether r_pvs is
+// on or not. The caller frees them. Returns NULL if the level is too big to
+// have any.
+//
+byte *R_PVSMakeRows()
+{
+   if(numnodes < 1 || numsubsectors > PVS_MAXLEAVES)
+      return NULL;
+
+   byte *rows = emalloc(byte *, size_t((numsubsectors + 7) / 8) * numsubsectors);
+
+   R_pvsLoadRows(rows);
+   return rows;
+}
+
+//
+// R_pvsMarkNodes
+//
+// Marks the nodes with any visible subsector below them.
+//
+static bool R_pvsMarkNodes(int bspnum, const byte *row)
+{
+   if(bspnum & NF_SUBSECTOR)
+   {
+      int leaf = (bspnum == -1) ? 0 : bspnum & ~NF_SUBSECTOR;
+      return !!(row[leaf >> 3] & (1 << (leaf & 7)));
+   }
+
+   const node_t &node = nodes[bspnum];
+   bool visible = R_pvsMarkNodes(node.children[0], row);
+
+   visible |= R_pvsMarkNodes(node.children[1], row);
+   pvsnodevis[bspnum] = visible;
+
+   return visible;
+}
+
+//
+// R_pvsInsideLeaf
+//
+// A camera can end up behind the walls of the subsector it is in, and see
+// things from there no set accounts for.
+//
+static bool R_pvsInsideLeaf(int leaf, fixed_t x, fixed_t y)
+{
+   const subsector_t &ss = subsectors[leaf];
+   v2double_t p = { M_FixedToDouble(x), M_FixedToDouble(y) };
+
+   for(int i = ss.firstline; i < ss.firstline + ss.numlines; i++)
+   {
+      const seg_t &seg = segs[i];
+
+      if(R_pvsSolidSeg(seg) &&
+         R_pvsDist(R_pvsPlane(R_pvsVertex(seg.v1), R_pvsVertex(seg.v2)), p) <
+         -PVS_EPSILON)
+         return false;
+   }
+
+   return true;
+}
+
+//
+// R_PVSBeginView
+//
+// Enables culling of the main view, if there is a set for its subsector.
+//
+void R_PVSBeginView()
+{
+   r_pvsrow = NULL;
+
+   if(!pvsrows)
+      return;
+
+   int leaf = int(R_PointInSubsector(viewx, viewy) - subsectors);
+
+   if(!R_pvsInsideLeaf(leaf, viewx, viewy))
+      return;
+
+   const byte *row = pvsrows + size_t(leaf) * pvsrowbytes;
+
+   if(leaf != pvsviewleaf)
+   {
+      R_pvsMarkNodes(numnodes - 1, row);
+      pvsviewleaf = leaf;
+   }
+
+   r_pvsrow   = row;
+   r_pvsnodes = pvsnodevis;
+}
+
+//
+// R_PVSEndView
+//
+void R_PVSEndView()
+{
+   r_pvsrow = NULL;
+}
+
+VARIABLE_TOGGLE(r_pvs, NULL, onoff);
+CONSOLE_VARIABLE(r_pvs, r_pvs, 0)
+{
+   if(gamestate == GS_LEVEL)
+      R_PVSBuild();
+}
+
+//
+// r_pvsinfo
+//
+// Shows how much of the level the sets let the renderer skip.
+//
+CONSOLE_COMMAND(r_pvsinfo, 0)
+{
+   if(!pvsrows)
+   {
+      C_Printf("No PVS for this level%s\n", r_pvs ? "" : " (r_pvs is off)");
+      return;
+   }
+
+   size_t size  = size_t(pvsrowbytes) * numsubsectors;
+   double total = 0.0;
+
+   for(size_t i = 0; i < size; i++)
+   {
+      for(byte b = pvsrows[i]; b; b &= b - 1)
+         total += 1.0;
+   }
+
+   C_Printf(FC_HI "PVS for %d subsectors\n", numsubsectors);
+   C_Printf("%s in %d ms, %d overflowed\n",
+            pvsfromcache ? "Read from cache" : "Built", pvsbuildtime,
+            pvsfromcache ? 0 : pvsoverflows);
+   C_Printf("%.1f%% visible from each subsector on average\n",
+            100.0 * total / (double(numsubsectors) * numsubsectors));
+}
+
+// EOF
+
@@ -0,0 +1,73 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// Copyright (C) 2013 James Haley et al.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+// Additional terms and conditions compatible with the GPLv3 apply. See the
+// file COPYING-EE for details.
+//
+//--------------------------------------------------------------------------
+//
+// DESCRIPTION:
+//      Potentially visible set of each subsector, for culling the BSP.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef R_PVS_H__
+#define R_PVS_H__
+
+#include "doomdata.h"
+
+class HashData;
+
+extern bool r_pvs;
+
+// Set between R_PVSBeginView and R_PVSEndView when the main view can be
+// culled: the subsectors visible from the view's subsector, one bit each,
+// and whether each node has any of them below it.
+extern const byte *r_pvsrow;
+extern const byte *r_pvsnodes;
+
+void R_PVSBuild();
+void R_PVSHashLevel(HashData &hash);
+
+const byte *R_PVSRows();
+byte       *R_PVSMakeRows();
+
+void R_PVSBeginView();
+void R_PVSEndView();
+
+//
+// R_PVSCulled
+//
+// True if nothing in the given BSP subtree can be seen from the view.
+//
+inline bool R_PVSCulled(int bspnum)
+{
+   if(!r_pvsrow)
+      return false;
+
+   if(!(bspnum & NF_SUBSECTOR))
+      return !r_pvsnodes[bspnum];
+
+   bspnum = (bspnum == -1) ? 0 : bspnum & ~NF_SUBSECTOR;
+   return !(r_pvsrow[bspnum >> 3] & (1 << (bspnum & 7)));
+}
+
+#endif
+
+// EOF
+
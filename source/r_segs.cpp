@@ -38,15 +38,17 @@
 #include "r_main.h"
 #include "r_plane.h"
 #include "r_portal.h"
+#include "r_profile.h"
 #include "r_segs.h"
 #include "r_state.h"
 #include "r_things.h"
+#include "r_threads.h"
 #include "w_wad.h"
 
 // OPTIMIZE: closed two sided lines as single sided
 // SoM: Done.
 // SoM: Cardboard globals
-cb_column_t column;
+thread_local cb_column_t column; // thread-local for threaded drawing
 cb_seg_t    seg;
 cb_seg_t    segclip;
 
@@ -384,7 +386,7 @@ static void R_RenderSegLoop(void)
                         column.texmid = segclip.toptexmid;
                         column.source = R_GetRawColumn(segclip.toptex, (int)texx);
                         column.texheight = segclip.toptexh;
-                        colfunc();
+                        R_DrawColumnFunc(colfunc);
                         ceilingclip[i] = (float)(column.y2 + 1);
                      }
                      else
@@ -403,7 +405,7 @@ static void R_RenderSegLoop(void)
                         column.texmid = segclip.bottomtexmid;
                         column.source = R_GetRawColumn(segclip.bottomtex, (int)texx);
                         column.texheight = segclip.bottomtexh;
-                        colfunc();
+                        R_DrawColumnFunc(colfunc);
                         floorclip[i] = (float)(column.y1 - 1);
                      }
                      else
@@ -431,7 +433,7 @@ static void R_RenderSegLoop(void)
                column.source = R_GetRawColumn(segclip.midtex, (int)texx);
                column.texheight = segclip.midtexh;
 
-               colfunc();
+               R_DrawColumnFunc(colfunc);
 
                ceilingclip[i] = view.height - 1.0f;
                floorclip[i] = 0.0f;
@@ -465,7 +467,7 @@ static void R_RenderSegLoop(void)
                   column.source = R_GetRawColumn(segclip.toptex, (int)texx);
                   column.texheight = segclip.toptexh;
 
-                  colfunc();
+                  R_DrawColumnFunc(colfunc);
 
                   ceilingclip[i] = (float)(column.y2 + 1);
                }
@@ -504,7 +506,7 @@ static void R_RenderSegLoop(void)
                   column.source = R_GetRawColumn(segclip.bottomtex, (int)texx);
                   column.texheight = segclip.bottomtexh;
 
-                  colfunc();
+                  R_DrawColumnFunc(colfunc);
 
                   floorclip[i] = (float)(column.y1 - 1);
                }
@@ -725,6 +727,7 @@ fixed_t R_PointToDist2(fixed_t x1, fixed_t y1, fixed_t x2, fixed_t y2)
 //
 void R_StoreWallRange(const int start, const int stop)
 {
+   RProfileScope profile(RPROF_WALLS);
    float clipx1;
    float clipx2;
 
@@ -0,0 +1,354 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// Copyright (C) 2013 James Haley et al.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+// Additional terms and conditions compatible with the GPLv3 apply. See the
+// file COPYING-EE for details.
+//
+//--------------------------------------------------------------------------
+//
+// DESCRIPTION:
+//      Instruction set independent parts of the SIMD drawers. Each of the
+//      r_draw<isa>.cpp modules includes this after defining a traits class
+//      which provides the vector operations, then calls R_SetSIMDDrawers
+//      with it.
+//
+//      The traits class V must provide:
+//
+//      V::WIDTH          - number of pixels handled per step
+//      V::ColumnStepper  - constructed from (frac, fracstep, heightmask);
+//                          next(int *) stores the texel offsets of the next
+//                          WIDTH pixels of a power-of-two column.
+//      V::SpanStepper    - constructed from (xfrac, yfrac, xstep, ystep,
+//                          xshift, yshift, xmask); next(int *) does the same
+//                          for an orthogonal span.
+//      V::BlendFlex      - (fg2rgb, bg2rgb, fg, bg, out): stores the RGB32k
+//                          offsets of WIDTH alpha-blended pixels.
+//      V::BlendAdd       - as above, for additive blending.
+//
+//      Only the texture coordinate arithmetic and the blending math are
+//      vectorized; the texture, colormap and RGB table lookups are still done
+//      lane by lane with the same integer operations as the scalar drawers,
+//      so every drawer writes exactly the same pixels as its counterpart in
+//      r_draw.cpp or r_span.cpp.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef R_SIMDTPL_H__
+#define R_SIMDTPL_H__
+
+#include "i_system.h"
+#include "r_draw.h"
+#include "r_main.h"
+#include "r_plane.h"
+#include "v_misc.h"
+#include "v_video.h"
+
+enum
+{
+   R_SIMD_OPAQUE,  // plain colormapped pixels
+   R_SIMD_TRANMAP, // TRANMAP lookup
+   R_SIMD_FLEX,    // zdoom-style alpha
+   R_SIMD_ADD      // zdoom-style additive
+};
+
+//
+// simdpixels_t
+//
+// Everything needed to produce the pixels of one column or span, copied out of
+// the drawing globals so that the inner loops do not keep reloading them.
+//
+struct simdpixels_t
+{
+   const byte *source;
+   const lighttable_t *colormap;
+   const byte *translation;
+   const byte *tlmap;
+   const unsigned int *fg2rgb;
+   const unsigned int *bg2rgb;
+};
+
+//
+// R_simdDrawPixels
+//
+// Fetches the texels at the n (<= V::WIDTH) given offsets and writes them,
+// pitch bytes apart, blending them with the screen as requested. Called with
+// n == V::WIDTH for all but the last group, where the compiler can unroll the
+// loops completely.
+//
+template<typename V, bool translated, int blend>
+static inline void R_simdDrawPixels(const simdpixels_t &p, const int *texels,
+                                    byte *dest, int pitch, int n)
+{
+   byte fg[V::WIDTH], bg[V::WIDTH];
+   int  rgb[V::WIDTH];
+
+   for(int i = 0; i < n; i++)
+   {
+      fg[i] = translated ? p.colormap[p.translation[p.source[texels[i]]]]
+                         : p.colormap[p.source[texels[i]]];
+   }
+
+   switch(blend)
+   {
+   case R_SIMD_OPAQUE:
+      for(int i = 0; i < n; i++)
+         dest[i * pitch] = fg[i];
+      break;
+   case R_SIMD_TRANMAP:
+      for(int i = 0; i < n; i++)
+         dest[i * pitch] = p.tlmap[(dest[i * pitch] << 8) + fg[i]];
+      break;
+   default:
+      for(int i = 0; i < n; i++)
+         bg[i] = dest[i * pitch];
+      for(int i = n; i < V::WIDTH; i++)
+         fg[i] = bg[i] = 0;
+      if(blend == R_SIMD_FLEX)
+         V::BlendFlex(p.fg2rgb, p.bg2rgb, fg, bg, rgb);
+      else
+         V::BlendAdd(p.fg2rgb, p.bg2rgb, fg, bg, rgb);
+      for(int i = 0; i < n; i++)
+         dest[i * pitch] = RGB32k[0][0][rgb[i]];
+      break;
+   }
+}
+
+//=============================================================================
+//
+// Columns
+//
+
+//
+// R_simdScalarColumn
+//
+// Columns of textures whose height is not a power of two wrap their texture
+// coordinate one pixel at a time, so they are left to the normal drawers.
+//
+template<bool translated, int blend>
+static void R_simdScalarColumn()
+{
+   const columndrawer_t &d = r_normal_drawer;
+
+   switch(blend)
+   {
+   case R_SIMD_OPAQUE:
+      translated ? d.DrawTRColumn() : d.DrawColumn();
+      break;
+   case R_SIMD_TRANMAP:
+      translated ? d.DrawTLTRColumn() : d.DrawTLColumn();
+      break;
+   case R_SIMD_FLEX:
+      translated ? d.DrawFlexTRColumn() : d.DrawFlexColumn();
+      break;
+   case R_SIMD_ADD:
+      translated ? d.DrawAddTRColumn() : d.DrawAddColumn();
+      break;
+   }
+}
+
+template<typename V, bool translated, int blend>
+static void R_SIMDDrawColumn()
+{
+   int heightmask = column.texheight - 1;
+
+   if(column.texheight & heightmask)
+   {
+      R_simdScalarColumn<translated, blend>();
+      return;
+   }
+
+   int count = column.y2 - column.y1 + 1;
+   if(count <= 0)
+      return;
+
+#ifdef RANGECHECK
+   if(column.x  < 0 || column.x  >= video.width ||
+      column.y1 < 0 || column.y2 >= video.height)
+      I_Error("R_SIMDDrawColumn: %i to %i at %i\n", column.y1, column.y2, column.x);
+#endif
+
+   simdpixels_t p;
+
+   p.source      = static_cast<const byte *>(column.source);
+   p.colormap    = column.colormap;
+   p.translation = column.translation;
+   p.tlmap       = tranmap;
+   p.fg2rgb      = NULL;
+   p.bg2rgb      = NULL;
+
+   if(blend == R_SIMD_FLEX)
+   {
+      unsigned int fglevel = column.translevel & ~0x3ff;
+      unsigned int bglevel = FRACUNIT - fglevel;
+      p.fg2rgb = Col2RGB8[fglevel >> 10];
+      p.bg2rgb = Col2RGB8[bglevel >> 10];
+   }
+   else if(blend == R_SIMD_ADD)
+   {
+      unsigned int fglevel = column.translevel & ~0x3ff;
+      p.fg2rgb = Col2RGB8_LessPrecision[fglevel >> 10];
+      p.bg2rgb = Col2RGB8_LessPrecision[FRACUNIT >> 10];
+   }
+
+   byte   *dest     = R_ADDRESS(column.x, column.y1);
+   int     pitch    = linesize;
+   fixed_t fracstep = column.step;
+   fixed_t frac     = column.texmid + (int)((column.y1 - view.ycenter + 1) * fracstep);
+
+   typename V::ColumnStepper stepper(frac, fracstep, heightmask);
+   int texels[V::WIDTH];
+
+   while(count >= V::WIDTH)
+   {
+      stepper.next(texels);
+      R_simdDrawPixels<V, translated, blend>(p, texels, dest, pitch, V::WIDTH);
+      dest  += V::WIDTH * pitch;
+      count -= V::WIDTH;
+   }
+   if(count > 0)
+   {
+      stepper.next(texels);
+      R_simdDrawPixels<V, translated, blend>(p, texels, dest, pitch, count);
+   }
+}
+
+//=============================================================================
+//
+// Spans
+//
+
+template<typename V, int blend>
+static inline void R_simdDrawSpan(unsigned int xshift, unsigned int yshift,
+                                  unsigned int xmask)
+{
+   int count = span.x2 - span.x1 + 1;
+   if(count <= 0)
+      return;
+
+   simdpixels_t p;
+
+   p.source      = static_cast<const byte *>(span.source);
+   p.colormap    = span.colormap;
+   p.translation = NULL;
+   p.tlmap       = NULL;
+   p.fg2rgb      = span.fg2rgb;
+   p.bg2rgb      = span.bg2rgb;
+
+   byte *dest = R_ADDRESS(span.x1, span.y);
+
+   typename V::SpanStepper stepper(span.xfrac, span.yfrac, span.xstep,
+                                   span.ystep, xshift, yshift, xmask);
+   int texels[V::WIDTH];
+
+   while(count >= V::WIDTH)
+   {
+      stepper.next(texels);
+      R_simdDrawPixels<V, false, blend>(p, texels, dest, 1, V::WIDTH);
+      dest  += V::WIDTH;
+      count -= V::WIDTH;
+   }
+   if(count > 0)
+   {
+      stepper.next(texels);
+      R_simdDrawPixels<V, false, blend>(p, texels, dest, 1, count);
+   }
+}
+
+template<typename V, int blend, int xshift, int yshift, int xmask>
+static void R_SIMDDrawSpan()
+{
+   R_simdDrawSpan<V, blend>(xshift, yshift, xmask);
+}
+
+template<typename V, int blend, int style>
+static void R_SIMDDrawSpan_GEN()
+{
+   // flats one pixel tall shift by the full width of the register, which
+   // vector units and the scalar code disagree about
+   if(span.yshift >= 32)
+   {
+      r_spandrawer.DrawSpan[style][FLAT_GENERALIZED]();
+      return;
+   }
+   R_simdDrawSpan<V, blend>(span.xshift, span.yshift, span.xmask);
+}
+
+//=============================================================================
+//
+// Engine setup
+//
+
+//
+// R_SetSIMDDrawers
+//
+// Replaces the column and span drawers of the given engines with the SIMD
+// versions built on the traits class V.
+//
+template<typename V>
+static void R_SetSIMDDrawers(columndrawer_t &cd, spandrawer_t &sd)
+{
+   cd.DrawColumn       = R_SIMDDrawColumn<V, false, R_SIMD_OPAQUE >;
+   cd.DrawTLColumn     = R_SIMDDrawColumn<V, false, R_SIMD_TRANMAP>;
+   cd.DrawTRColumn     = R_SIMDDrawColumn<V, true,  R_SIMD_OPAQUE >;
+   cd.DrawTLTRColumn   = R_SIMDDrawColumn<V, true,  R_SIMD_TRANMAP>;
+   cd.DrawFlexColumn   = R_SIMDDrawColumn<V, false, R_SIMD_FLEX   >;
+   cd.DrawFlexTRColumn = R_SIMDDrawColumn<V, true,  R_SIMD_FLEX   >;
+   cd.DrawAddColumn    = R_SIMDDrawColumn<V, false, R_SIMD_ADD    >;
+   cd.DrawAddTRColumn  = R_SIMDDrawColumn<V, true,  R_SIMD_ADD    >;
+
+   // Normal                                  Translated
+   cd.ByVisSpriteStyle[VS_DRAWSTYLE_NORMAL ][0] = cd.DrawColumn;
+   cd.ByVisSpriteStyle[VS_DRAWSTYLE_NORMAL ][1] = cd.DrawTRColumn;
+   cd.ByVisSpriteStyle[VS_DRAWSTYLE_ALPHA  ][0] = cd.DrawFlexColumn;
+   cd.ByVisSpriteStyle[VS_DRAWSTYLE_ALPHA  ][1] = cd.DrawFlexTRColumn;
+   cd.ByVisSpriteStyle[VS_DRAWSTYLE_ADD    ][0] = cd.DrawAddColumn;
+   cd.ByVisSpriteStyle[VS_DRAWSTYLE_ADD    ][1] = cd.DrawAddTRColumn;
+   cd.ByVisSpriteStyle[VS_DRAWSTYLE_SUB    ][0] = cd.DrawTLColumn;
+   cd.ByVisSpriteStyle[VS_DRAWSTYLE_SUB    ][1] = cd.DrawTLTRColumn;
+   cd.ByVisSpriteStyle[VS_DRAWSTYLE_TRANMAP][0] = cd.DrawTLColumn;
+   cd.ByVisSpriteStyle[VS_DRAWSTYLE_TRANMAP][1] = cd.DrawTLTRColumn;
+
+#define SIMDSPANS(blend, style) \
+   { \
+      R_SIMDDrawSpan<V, blend, 20, 26, 0x00FC0>, /* 64x64   */ \
+      R_SIMDDrawSpan<V, blend, 18, 25, 0x03F80>, /* 128x128 */ \
+      R_SIMDDrawSpan<V, blend, 16, 24, 0x0FF00>, /* 256x256 */ \
+      R_SIMDDrawSpan<V, blend, 14, 23, 0x3FE00>, /* 512x512 */ \
+      R_SIMDDrawSpan_GEN<V, blend, style>        /* General */ \
+   }
+
+   static void (*const spans[SPAN_NUMSTYLES][FLAT_NUMSIZES])() =
+   {
+      SIMDSPANS(R_SIMD_OPAQUE, SPAN_STYLE_NORMAL),
+      SIMDSPANS(R_SIMD_FLEX,   SPAN_STYLE_TL),
+      SIMDSPANS(R_SIMD_ADD,    SPAN_STYLE_ADD),
+   };
+
+#undef SIMDSPANS
+
+   for(int style = 0; style < SPAN_NUMSTYLES; style++)
+   {
+      for(int size = 0; size < FLAT_NUMSIZES; size++)
+         sd.DrawSpan[style][size] = spans[style][size];
+   }
+}
+
+#endif
+
+// EOF
+
@@ -26,14 +26,20 @@
 #include "z_zone.h"
 #include "i_system.h"
 
+#include <algorithm>
+#include <atomic>
+
 #include "c_io.h"
+#include "c_runcmd.h"
 #include "doomstat.h"
 #include "d_gi.h"
 #include "d_io.h"
 #include "d_main.h"
 #include "e_hash.h"
+#include "m_collection.h"
 #include "m_compare.h"
 #include "m_swap.h"
+#include "m_threads.h"
 #include "p_setup.h"
 #include "p_skin.h"
 #include "r_data.h"
@@ -551,6 +557,9 @@ static int R_ReadTextureLump(texturelump_t *tlump, int *patchlookup,
    return texnum;
 }
 
+// lone-patch textures whose lumps are read ahead at once
+#define TEXPREFETCHLUMPS 256
+
 //
 // R_ReadTextureNamespace
 //
@@ -560,6 +569,9 @@ static int R_ReadTextureLump(texturelump_t *tlump, int *patchlookup,
 static int R_ReadTextureNamespace(int texnum)
 {
    WadNamespaceIterator wni(wGlobalDir, lumpinfo_t::ns_textures);
+   int prefetch[TEXPREFETCHLUMPS];
+   int prefetchEnd = wni.getFirstLump();
+   int nsEnd       = wni.getFirstLump() + wni.getNumLumps();
 
    for(wni.begin(); wni.current(); wni.next())
    {
@@ -567,6 +579,17 @@ static int R_ReadTextureNamespace(int texnum)
          V_LoadingIncrease();
 
       lumpinfo_t *lump = wni.current();
+
+      // inflate the next patches from archives ahead of time
+      if(lump->selfindex == prefetchEnd)
+      {
+         int count = emin(TEXPREFETCHLUMPS, nsEnd - prefetchEnd);
+
+         for(int i = 0; i < count; i++)
+            prefetch[i] = prefetchEnd + i;
+         wGlobalDir.prefetchLumps(prefetch, count);
+         prefetchEnd += count;
+      }
       texture_t  *texture;
       patch_t    *patch  = PatchLoader::CacheNum(wGlobalDir, lump->selfindex, PU_CACHE);
       uint16_t    width  = patch->width;
@@ -621,37 +644,48 @@ static int R_ReadTextureNamespace(int texnum)
 struct tempmask_s
 {
    // This is the buffer used for masking
-   bool       mask;       // If set to true, FinishTexture should create columns
    int        buffermax;  // size of allocated buffer
    byte      *buffer;     // mask buffer.
-   texture_t *tex;
    
    texcol_t  *tempcols;
-} tempmask = { false, 0, NULL, NULL, NULL };
+} tempmask = { 0, NULL, NULL };
+
+//
+// texbuild_t
+//
+// A texture being composed: the buffer its components are drawn into and, if
+// its columns have yet to be built, a mask of the pixels drawn. The renderer
+// uses the temporary mask, while the texture cache's workers have their own.
+//
+struct texbuild_t
+{
+   texture_t *tex;
+   byte      *buffer;
+   byte      *mask;
+};
 
 //
 // AddTexColumn
 //
-// Copies from src to the tex buffer and optionally marks the temporary mask
+// Copies from src to the tex buffer and optionally marks the mask
 //
-static void AddTexColumn(texture_t *tex, const byte *src, int srcstep, 
+static void AddTexColumn(const texbuild_t &build, const byte *src, int srcstep,
                          int ptroff, int len)
 {
-   byte *dest = tex->buffer + ptroff;
+   byte *dest = build.buffer + ptroff;
    
 #ifdef RANGECHECK
-   if(ptroff < 0 || ptroff + len > tex->width * tex->height ||
-      ptroff + len > tempmask.buffermax)
+   if(ptroff < 0 || ptroff + len > build.tex->width * build.tex->height)
    {
-      I_Error("AddTexColumn(%s) invalid ptroff: %i / (%i, %i)\n", 
-              (const char *)(tex->name), 
-              ptroff + len, tex->width * tex->height, tempmask.buffermax);
+      I_Error("AddTexColumn(%s) invalid ptroff: %i / %i\n", 
+              (const char *)(build.tex->name), 
+              ptroff + len, build.tex->width * build.tex->height);
    }
 #endif
 
-   if(tempmask.mask && tex == tempmask.tex)
+   if(build.mask)
    {
-      byte *mask = tempmask.buffer + ptroff;
+      byte *mask = build.mask + ptroff;
       
       while(len > 0)
       {
@@ -667,7 +701,7 @@ static void AddTexColumn(texture_t *tex, const byte *src, int srcstep,
       while(len > 0)
       {
          *dest = *src;
-         dest++; src++;
+         dest++; src += srcstep;
          len--;
       }
    }
@@ -678,9 +712,10 @@ static void AddTexColumn(texture_t *tex, const byte *src, int srcstep,
 // 
 // Paints the given flat-based component to the texture and marks mask info
 //
-static void AddTexFlat(texture_t *tex, tcomponent_t *component)
+static void AddTexFlat(const texbuild_t &build, const tcomponent_t *component,
+                       const byte *src)
 {
-   byte      *src = (byte *)(wGlobalDir.cacheLumpNum(component->lump, PU_CACHE));
+   texture_t *tex = build.tex;
    int       destoff, srcoff, deststep, srcxstep, srcystep;
    int       xstart, ystart, xstop, ystop;
    int       width, height, wcount, hcount;
@@ -740,7 +775,7 @@ static void AddTexFlat(texture_t *tex, tcomponent_t *component)
          I_Error("AddTexFlat(%s): Invalid srcoff %i / %i\n", 
                  (const char *)(tex->name), srcoff, tex->width * tex->height);
 #endif
-      AddTexColumn(tex, src + srcoff, srcystep, destoff, hcount);
+      AddTexColumn(build, src + srcoff, srcystep, destoff, hcount);
       srcoff += srcxstep;
       destoff += deststep;
       wcount--;
@@ -752,9 +787,10 @@ static void AddTexFlat(texture_t *tex, tcomponent_t *component)
 // 
 // Paints the given flat-based component to the texture and marks mask info
 //
-static void AddTexPatch(texture_t *tex, tcomponent_t *component)
+static void AddTexPatch(const texbuild_t &build, const tcomponent_t *component,
+                        const patch_t *patch)
 {
-   patch_t *patch = PatchLoader::CacheNum(wGlobalDir, component->lump, PU_CACHE);
+   texture_t *tex = build.tex;
    int      destoff;
    int      xstart, ystart, xstop;
    int      colindex, colstep;
@@ -786,7 +822,7 @@ static void AddTexPatch(texture_t *tex, tcomponent_t *component)
    {
       int top, y1, y2, destbase;
       const column_t *column = 
-         (const column_t *)((byte *)patch + patch->columnofs[colindex]);
+         (const column_t *)((const byte *)patch + patch->columnofs[colindex]);
          
       destbase = x * tex->height;
       top = 0;
@@ -832,7 +868,7 @@ static void AddTexPatch(texture_t *tex, tcomponent_t *component)
 #endif
             
          if(y2 - y1 > 0)
-            AddTexColumn(tex, src + srcoff, 1, destoff, y2 - y1);
+            AddTexColumn(build, src + srcoff, 1, destoff, y2 - y1);
             
          column = reinterpret_cast<const column_t *>(src + column->length + 1);
       }
@@ -840,12 +876,59 @@ static void AddTexPatch(texture_t *tex, tcomponent_t *component)
 }
 
 //
-// StartTexture
+// R_texComponentData
 //
-// Allocates the texture buffer, as well as managing the temporary structs and
-// the mask buffer.
+// Caches the graphic of a texture component.
+//
+static void *R_texComponentData(const tcomponent_t *component, int tag)
+{
+   if(component->type == TC_PATCH)
+      return PatchLoader::CacheNum(wGlobalDir, component->lump, tag);
+   else
+      return wGlobalDir.cacheLumpNum(component->lump, tag);
+}
+
+//
+// R_composeTexture
 //
-static void StartTexture(texture_t *tex, bool mask)
+// Draws the components of a texture into its buffer. The graphic of each
+// component is taken from sources when given, which is how worker threads,
+// which must not touch the WAD directory or zone heap, are fed; otherwise
+// they are cached from the WAD as they are needed.
+//
+static void R_composeTexture(const texbuild_t &build, const void *const *sources)
+{
+   texture_t *tex = build.tex;
+
+   for(int i = 0; i < tex->ccount; i++)
+   {
+      const tcomponent_t *component = tex->components + i;
+      
+      // SoM: Do NOT add lumps with a -1 lumpnum
+      if(component->lump == -1)
+         continue;
+
+      const void *data = sources ? sources[i] : 
+                         R_texComponentData(component, PU_CACHE);
+         
+      switch(component->type)
+      {
+      case TC_FLAT:
+         AddTexFlat(build, component, static_cast<const byte *>(data));
+         break;
+      case TC_PATCH:
+         AddTexPatch(build, component, static_cast<const patch_t *>(data));
+         break;
+      default:
+         break;
+      }
+   }
+}
+
+//
+// R_texBufferLength
+//
+static int R_texBufferLength(const texture_t *tex)
 {
    // haleyjd 11/18/12: We *must* allocate some pad space in the texture buffer.
    // Due to intermixed use of float and fixed_t in Cardboard, it is impossible
@@ -853,15 +936,26 @@ static void StartTexture(texture_t *tex, bool mask)
    // column drawers. This can result in a read of up to one additional pixel
    // more than what is available. :/
 
-   int bufferlen = tex->width * tex->height + 4;
+   return tex->width * tex->height + 4;
+}
+
+//
+// StartTexture
+//
+// Allocates the texture buffer, as well as managing the temporary structs and
+// the mask buffer.
+//
+static void StartTexture(texbuild_t &build, texture_t *tex, bool mask)
+{
+   int bufferlen = R_texBufferLength(tex);
    
-   // Static for now
-   tex->buffer = ecalloctag(byte *, 1, bufferlen, PU_STATIC, (void **)&tex->buffer);
+   // Owned by the texture cache rather than the zone heap
+   build.tex    = tex;
+   build.buffer = new byte[bufferlen]();
+   build.mask   = NULL;
    
-   if((tempmask.mask = mask))
+   if(mask)
    {
-      tempmask.tex = tex;
-      
       // Setup the temporary mask
       if(bufferlen > tempmask.buffermax || !tempmask.buffer)
       {
@@ -870,6 +964,7 @@ static void StartTexture(texture_t *tex, bool mask)
                                         PU_RENDERER, (void **)&tempmask.buffer));
       }
       memset(tempmask.buffer, 0, bufferlen);
+      build.mask = tempmask.buffer;
    }
 }
 
@@ -896,33 +991,22 @@ static texcol_t *NextTempCol(texcol_t *current)
 }
 
 //
-// FinishTexture
+// R_buildTexColumns
 //
-// Called after R_CacheTexture is finished drawing a texture. This function
-// builds the columns (if needed) of a texture from the temporary mask buffer.
+// Builds the columns of a texture from the mask of the pixels its components
+// have drawn.
 //
-static void FinishTexture(texture_t *tex)
+static void R_buildTexColumns(texture_t *tex, const byte *mask)
 {
    int        x, y, i, colcount;
    texcol_t   *col, *tcol;
-   byte       *maskp;
-
-   Z_ChangeTag(tex->buffer, PU_CACHE);
-   
-   if(!tempmask.mask)
-      return;
-      
-   if(tempmask.tex != tex)
-   {
-      // SoM: ERROR?
-      return;
-   }
+   const byte *maskp;
    
    // Allocate column pointers
    tex->columns = ecalloctag(texcol_t **, sizeof(texcol_t **), tex->width, PU_RENDERER, NULL);
    
    // Build the columns based on mask info
-   maskp = tempmask.buffer;
+   maskp = mask;
 
    for(x = 0; x < tex->width; x++)
    {
@@ -946,7 +1030,7 @@ static void FinishTexture(texture_t *tex)
             col = NextTempCol(col);
             
             col->yoff = y;
-            col->ptroff = uint32_t(maskp - tempmask.buffer);
+            col->ptroff = uint32_t(maskp - mask);
             
             while(y < tex->height && *maskp > 0)
             {
@@ -979,6 +1063,427 @@ static void FinishTexture(texture_t *tex)
    }
 }
 
+//=============================================================================
+//
+// Texture Cache
+//
+// Composed texture buffers are kept out of the zone heap, so that they can no
+// longer be purged while the renderer, or a thread drawing for it, is still
+// reading them. When they take up more than r_texcachesize megabytes, the
+// least recently used are freed instead, but only at the start of a frame,
+// and never those drawn in the previous frame. Textures are stamped with the
+// frame number whenever the renderer fetches them.
+//
+// When a level is set up, the textures it uses are composed by worker threads
+// from lumps the main thread has loaded and locked in memory, and are handed
+// to the renderer at the start of the following frames. A texture needed
+// before its worker gets to it is composed on the spot.
+//
+
+enum
+{
+   TEXCACHE_IDLE,      // not being warmed up
+   TEXCACHE_QUEUED,    // waiting for a worker
+   TEXCACHE_BUILDING,  // being composed by a worker
+   TEXCACHE_BUILT      // composed, waiting to be installed
+};
+
+struct texcacheentry_t
+{
+   std::atomic<int> state;
+   bool             owned;      // buffer belongs to the cache
+   byte            *warmbuffer; // composed by a worker
+   byte            *warmmask;
+};
+
+struct texwarmjob_t
+{
+   int          texnum;
+   bool         mask;    // columns have to be built as well
+   const void **sources; // locked graphic of each component
+};
+
+struct texcachestats_t
+{
+   unsigned int hits;      // first fetches in a frame of a composed texture
+   unsigned int misses;    // textures composed when the renderer needed them
+   unsigned int warmed;    // textures composed in the background
+   unsigned int evictions; // buffers freed to stay within the budget
+};
+
+int r_texcachesize = 64; // megabytes, or 0 for no limit
+
+static texcacheentry_t *texcache;
+static int             *texstamps;  // frame each texture was last fetched
+static int              texframe;
+static size_t           texcachebytes;
+static size_t           texcachepeak;
+static texcachestats_t  texcachestats;
+
+static WorkerPool        warmpool;
+static texwarmjob_t     *warmjobs;
+static int               numwarmjobs;
+static std::atomic<bool> warmcancel;
+static PODCollection<void *> warmlocks; // lumps raised to PU_STATIC
+
+//
+// R_initTextureCache
+//
+static void R_initTextureCache()
+{
+   texcache  = new texcacheentry_t[texturecount]();
+   texstamps = ecalloctag(int *, texturecount, sizeof(int), PU_RENDERER, NULL);
+}
+
+//
+// R_touchTexture
+//
+// Marks a texture as used in this frame.
+//
+static inline void R_touchTexture(int num)
+{
+   if(texstamps[num] != texframe)
+   {
+      texstamps[num] = texframe;
+      ++texcachestats.hits;
+   }
+}
+
+//
+// R_setTexBuffer
+//
+// Gives a texture a buffer allocated by the cache.
+//
+static void R_setTexBuffer(int num, byte *buffer)
+{
+   textures[num]->buffer = buffer;
+   texcache[num].owned   = true;
+
+   texcachebytes += R_texBufferLength(textures[num]);
+   if(texcachebytes > texcachepeak)
+      texcachepeak = texcachebytes;
+}
+
+//
+// R_freeTexBuffer
+//
+static void R_freeTexBuffer(int num)
+{
+   texture_t *tex = textures[num];
+
+   delete [] tex->buffer;
+   tex->buffer = NULL;
+   texcache[num].owned = false;
+
+   texcachebytes -= R_texBufferLength(tex);
+}
+
+//
+// R_installWarmTexture
+//
+// Hands a texture composed by a worker to the renderer.
+//
+static void R_installWarmTexture(int num)
+{
+   texcacheentry_t &entry = texcache[num];
+   texture_t       *tex   = textures[num];
+
+   R_setTexBuffer(num, entry.warmbuffer);
+
+   if(entry.warmmask)
+   {
+      if(!tex->columns)
+         R_buildTexColumns(tex, entry.warmmask);
+      delete [] entry.warmmask;
+   }
+
+   entry.warmbuffer = NULL;
+   entry.warmmask   = NULL;
+   entry.state.store(TEXCACHE_IDLE);
+
+   ++texcachestats.warmed;
+}
+
+//
+// R_warmTexture
+//
+// Worker task composing one texture of the level.
+//
+static void R_warmTexture(int task, void *data)
+{
+   const texwarmjob_t &job   = warmjobs[task];
+   texcacheentry_t    &entry = texcache[job.texnum];
+   int                 state = TEXCACHE_QUEUED;
+
+   // the renderer may have taken the texture over already
+   if(warmcancel.load() ||
+      !entry.state.compare_exchange_strong(state, TEXCACHE_BUILDING))
+      return;
+
+   texbuild_t build;
+   int        bufferlen = R_texBufferLength(textures[job.texnum]);
+
+   build.tex    = textures[job.texnum];
+   build.buffer = new byte[bufferlen]();
+   build.mask   = job.mask ? new byte[bufferlen]() : NULL;
+
+   R_composeTexture(build, job.sources);
+
+   entry.warmbuffer = build.buffer;
+   entry.warmmask   = build.mask;
+   entry.state.store(TEXCACHE_BUILT);
+}
+
+//
+// R_lockWarmLump
+//
+// Keeps a cached lump in memory while the workers may read it.
+//
+static void R_lockWarmLump(void *data)
+{
+   if(Z_CheckTag(data) == PU_CACHE)
+   {
+      Z_ChangeTag(data, PU_STATIC);
+      warmlocks.add(data);
+   }
+}
+
+//
+// R_endWarmUp
+//
+// Waits for the workers, installs whatever they finished unless the warm-up
+// was cancelled, and releases the locked lumps.
+//
+static void R_endWarmUp(bool cancel)
+{
+   if(!warmjobs)
+      return;
+
+   if(cancel)
+      warmcancel.store(true);
+   warmpool.wait();
+
+   for(int i = 0; i < numwarmjobs; i++)
+   {
+      texwarmjob_t    &job   = warmjobs[i];
+      texcacheentry_t &entry = texcache[job.texnum];
+
+      if(entry.state.load() == TEXCACHE_BUILT)
+      {
+         if(cancel)
+         {
+            delete [] entry.warmbuffer;
+            delete [] entry.warmmask;
+            entry.warmbuffer = NULL;
+            entry.warmmask   = NULL;
+         }
+         else
+            R_installWarmTexture(job.texnum);
+      }
+      entry.state.store(TEXCACHE_IDLE);
+
+      delete [] job.sources;
+   }
+
+   delete [] warmjobs;
+   warmjobs    = NULL;
+   numwarmjobs = 0;
+
+   for(void *data : warmlocks)
+      Z_ChangeTag(data, PU_CACHE);
+   warmlocks.makeEmpty();
+}
+
+//
+// R_WarmUpTextures
+//
+// Composes the textures marked in hitlist in the background. Called by
+// R_PrecacheLevel.
+//
+void R_WarmUpTextures(const byte *hitlist)
+{
+   int i, numjobs = 0;
+
+   R_endWarmUp(true);
+
+   for(i = 0; i < texturecount; i++)
+   {
+      if(hitlist[i] && !textures[i]->buffer && textures[i]->ccount)
+         ++numjobs;
+   }
+
+   if(!numjobs)
+      return;
+
+   // inflate the components from archives ahead of time, all at once
+   PODCollection<int> prefetch;
+
+   for(i = 0; i < texturecount; i++)
+   {
+      const texture_t *tex = textures[i];
+
+      if(!hitlist[i] || tex->buffer || !tex->ccount)
+         continue;
+
+      for(int c = 0; c < tex->ccount; c++)
+      {
+         if(tex->components[c].lump != -1)
+            prefetch.add(tex->components[c].lump);
+      }
+   }
+   if(!prefetch.isEmpty())
+      wGlobalDir.prefetchLumps(&prefetch[0], static_cast<int>(prefetch.getLength()));
+
+   warmjobs    = new texwarmjob_t[numjobs];
+   numwarmjobs = 0;
+
+   for(i = 0; i < texturecount; i++)
+   {
+      texture_t *tex = textures[i];
+
+      if(!hitlist[i] || tex->buffer || !tex->ccount)
+         continue;
+
+      texwarmjob_t &job = warmjobs[numwarmjobs++];
+
+      job.texnum  = i;
+      job.mask    = (tex->columns == NULL);
+      job.sources = new const void *[tex->ccount];
+
+      for(int c = 0; c < tex->ccount; c++)
+      {
+         const tcomponent_t *component = tex->components + c;
+         void *data = NULL;
+
+         if(component->lump != -1)
+         {
+            data = R_texComponentData(component, PU_CACHE);
+            R_lockWarmLump(data);
+         }
+         job.sources[c] = data;
+      }
+
+      texcache[i].state.store(TEXCACHE_QUEUED);
+   }
+
+   if(!warmpool.getNumThreads())
+      warmpool.setNumThreads(emax(M_NumCPUs() / 2, 1));
+
+   warmcancel.store(false);
+   warmpool.start(numwarmjobs, R_warmTexture, NULL);
+}
+
+//
+// R_evictTextures
+//
+// Frees the least recently used textures while the cache is over budget,
+// down to seven eighths of it so that this does not happen every frame.
+//
+static void R_evictTextures()
+{
+   static PODCollection<int> lru;
+   size_t budget = size_t(r_texcachesize) << 20;
+
+   if(!r_texcachesize || texcachebytes <= budget)
+      return;
+
+   lru.makeEmpty();
+   for(int i = 0; i < texturecount; i++)
+   {
+      if(texcache[i].owned && texstamps[i] < texframe - 1)
+         lru.add(i);
+   }
+
+   std::sort(lru.begin(), lru.end(), [] (int a, int b) {
+      return texstamps[a] < texstamps[b];
+   });
+
+   for(int num : lru)
+   {
+      if(texcachebytes <= budget - budget / 8)
+         break;
+      R_freeTexBuffer(num);
+      ++texcachestats.evictions;
+   }
+}
+
+//
+// R_TexCacheBeginFrame
+//
+// Called at the start of each frame, while nothing is drawing: installs the
+// textures warmed up since the last frame and keeps the cache in budget.
+//
+void R_TexCacheBeginFrame()
+{
+   ++texframe;
+
+   if(warmjobs)
+   {
+      if(!warmpool.busy())
+         R_endWarmUp(false);
+      else
+      {
+         for(int i = 0; i < numwarmjobs; i++)
+         {
+            if(texcache[warmjobs[i].texnum].state.load() == TEXCACHE_BUILT)
+               R_installWarmTexture(warmjobs[i].texnum);
+         }
+      }
+   }
+
+   R_evictTextures();
+}
+
+//
+// R_FreeTextureCache
+//
+// Frees every buffer the cache owns. Called by R_FreeData.
+//
+void R_FreeTextureCache()
+{
+   if(!texcache)
+      return;
+
+   R_endWarmUp(true);
+
+   for(int i = 0; i < texturecount; i++)
+   {
+      if(texcache[i].owned)
+         R_freeTexBuffer(i);
+   }
+
+   delete [] texcache;
+   texcache  = NULL;
+   texstamps = NULL; // PU_RENDERER
+}
+
+//
+// R_claimTexture
+//
+// Takes a texture the renderer needs over from the warm-up. Returns true if a
+// worker composed it, in which case it has been installed.
+//
+static bool R_claimTexture(int num)
+{
+   texcacheentry_t &entry = texcache[num];
+   int              state = TEXCACHE_QUEUED;
+
+   if(entry.state.compare_exchange_strong(state, TEXCACHE_IDLE))
+      return false;
+
+   while(state == TEXCACHE_BUILDING)
+   {
+      std::this_thread::yield();
+      state = entry.state.load();
+   }
+
+   if(state != TEXCACHE_BUILT)
+      return false;
+
+   R_installWarmTexture(num);
+   return true;
+}
+
 //
 // R_CacheTexture
 // 
@@ -987,7 +1492,7 @@ static void FinishTexture(texture_t *tex)
 texture_t *R_CacheTexture(int num)
 {
    texture_t  *tex;
-   int        i;
+   texbuild_t  build;
    
 #ifdef RANGECHECK
    if(num < 0 || num >= texturecount)
@@ -996,7 +1501,10 @@ texture_t *R_CacheTexture(int num)
 
    tex = textures[num];
    if(tex->buffer)
+   {
+      R_touchTexture(num);
       return tex;
+   }
    
    // SoM: This situation would most certainly require an abort.
    if(tex->ccount == 0)
@@ -1005,40 +1513,29 @@ texture_t *R_CacheTexture(int num)
               (const char *)(tex->name));
    }
 
+   if(R_claimTexture(num))
+      return tex;
+
    // This function has two primary branches:
    // 1. There is no buffer, and there are no columns which means the texture
    //    has never been built before and needs a full treatment
    // 2. There is no buffer, but there are columns which means that the buffer
-   //    (PU_CACHE) has been freed but the columns (PU_RENDERER) have not. 
-   //    This case means we only have to rebuilt the buffer.
+   //    has been evicted from the cache but the columns (PU_RENDERER) have 
+   //    not. This case means we only have to rebuilt the buffer.
 
    // Start the texture. Check the size of the mask buffer if needed.   
-   StartTexture(tex, tex->columns == NULL);
+   StartTexture(build, tex, tex->columns == NULL);
    
    // Add the components to the buffer/mask
-   for(i = 0; i < tex->ccount; i++)
-   {
-      tcomponent_t *component = tex->components + i;
-      
-      // SoM: Do NOT add lumps with a -1 lumpnum
-      if(component->lump == -1)
-         continue;
-         
-      switch(component->type)
-      {
-      case TC_FLAT:
-         AddTexFlat(tex, component);
-         break;
-      case TC_PATCH:
-         AddTexPatch(tex, component);
-         break;
-      default:
-         break;
-      }
-   }
+   R_composeTexture(build, NULL);
 
    // Finish texture
-   FinishTexture(tex);
+   R_setTexBuffer(num, build.buffer);
+   texstamps[num] = texframe;
+   if(build.mask)
+      R_buildTexColumns(tex, build.mask);
+
+   ++texcachestats.misses;
    return tex;
 }
 
@@ -1417,6 +1914,7 @@ void R_InitTextures()
    
    // Allocate textures
    textures = (texture_t **)(Z_Malloc(sizeof(texture_t *) * texturecount, PU_RENDERER, NULL));
+   R_initTextureCache();
    memset(textures, 0, sizeof(texture_t *) * texturecount);
 
    // init lookup tables
@@ -1454,12 +1952,9 @@ void R_InitTextures()
 
    // SoM: This REALLY hits us when starting EE with large wads. Caching 
    // textures on map start would probably be preferable 99.9% of the time...
-   // Precache textures
+   // Textures are now composed on first use, or warmed up at level start.
    for(i = wallstart; i < wallstop; i++)
-   {
       R_checkInvalidTexture(i);
-      R_CacheTexture(i);
-   }
    
    if(errors)
       I_Error("\n\n%d texture errors.\n", errors); 
@@ -1496,10 +1991,13 @@ byte *R_GetRawColumn(int tex, int32_t col)
       col = (col & t->widthmask) * t->height;
 
    // Lee Killough, eat your heart out! ... well this isn't really THAT bad...
-   return (t->flags & TF_SWIRLY) ?
-          R_DistortedFlat(tex) + col :
-          !t->buffer ? R_GetLinearBuffer(tex) + col :
-          t->buffer + col;
+   if(t->flags & TF_SWIRLY)
+      return R_DistortedFlat(tex) + col;
+   if(!t->buffer)
+      return R_GetLinearBuffer(tex) + col;
+
+   R_touchTexture(tex);
+   return t->buffer + col;
 }
 
 //
@@ -1509,8 +2007,7 @@ texcol_t *R_GetMaskedColumn(int tex, int32_t col)
 {
    texture_t *t = textures[tex];
    
-   if(!t->buffer)
-      R_CacheTexture(tex);
+   R_CacheTexture(tex);
 
    // haleyjd 05/28/14: support non-power-of-two widths
    return t->columns[(t->flags & TF_WIDTHNP2) ? col % t->width : col & t->widthmask];
@@ -1523,8 +2020,7 @@ byte *R_GetLinearBuffer(int tex)
 {
    texture_t *t = textures[tex];
    
-   if(!t->buffer)
-      R_CacheTexture(tex);
+   R_CacheTexture(tex);
 
    return t->buffer;
 }
@@ -1791,5 +2287,62 @@ static int R_Doom1Texture(const char *name)
    return -1;
 }
 
+//=============================================================================
+//
+// Texture Cache Console Commands
+//
+
+VARIABLE_INT(r_texcachesize, NULL, 0, 4096, NULL);
+CONSOLE_VARIABLE(r_texcachesize, r_texcachesize, 0) {}
+
+//
+// r_texcache
+//
+// Prints the state of the texture cache. "reset" zeroes the counters.
+//
+CONSOLE_COMMAND(r_texcache, 0)
+{
+   if(Console.argc >= 1)
+   {
+      if(!Console.argv[0]->strCaseCmp("reset"))
+      {
+         texcachestats = texcachestats_t();
+         texcachepeak  = texcachebytes;
+      }
+      else
+         C_Printf("usage: r_texcache [reset]\n");
+      return;
+   }
+
+   int resident = 0;
+   for(int i = 0; i < texturecount; i++)
+   {
+      if(texcache[i].owned)
+         ++resident;
+   }
+
+   C_Printf(FC_HI "Texture cache\n");
+   C_Printf("%d textures in %.2f MB, peak %.2f MB, ", resident, 
+            texcachebytes / 1048576.0, texcachepeak / 1048576.0);
+   if(r_texcachesize)
+      C_Printf("budget %d MB\n", r_texcachesize);
+   else
+      C_Printf("no budget\n");
+   C_Printf("hits %u, misses %u, warmed %u, evictions %u\n", 
+            texcachestats.hits, texcachestats.misses, texcachestats.warmed,
+            texcachestats.evictions);
+
+   if(warmjobs)
+   {
+      int left = 0;
+      for(int i = 0; i < numwarmjobs; i++)
+      {
+         if(texcache[warmjobs[i].texnum].state.load() != TEXCACHE_IDLE)
+            ++left;
+      }
+      C_Printf("warming up, %d of %d textures left\n", left, numwarmjobs);
+   }
+}
+
 // EOF
 
@@ -56,10 +56,13 @@
 #include "r_patch.h"
 #include "r_plane.h"
 #include "r_portal.h"
+#include "r_profile.h"
 #include "r_pcheck.h"   // ioanch 20160109: for sprite rendering through portals
 #include "r_segs.h"
 #include "r_state.h"
 #include "r_things.h"
+#include "r_threads.h"
+#include "r_truecolor.h"
 #include "v_alloc.h"
 #include "v_misc.h"
 #include "v_patchfmt.h"
@@ -207,9 +210,27 @@ VALLOCATION(portaltop)
 static float *ptop, *pbottom;
 
 // haleyjd 04/25/10: drawsegs optimization
+// The drawsegs able to clip sprites are indexed by the screen columns they
+// cover, in buckets of (1 << dsbucketshift) columns. Those overlapping bucket
+// b are drawsegs_xrange[dsbucketstart[b]] to [dsbucketstart[b + 1] - 1], most
+// recent first, so that sprites only look at the drawsegs near them.
+#define MAXDSBUCKETS 64
+
 static drawsegs_xrange_t *drawsegs_xrange;
 static unsigned int drawsegs_xrange_size = 0;
-static int drawsegs_xrange_count = 0;
+static int dsbucketstart[MAXDSBUCKETS + 1];
+static int dsbucketshift;
+
+// Sort keys for R_SortVisSpriteRange, and room for the radix sort to move
+// them back and forth
+struct vissortkey_t
+{
+   uint32_t     key;
+   vissprite_t *spr;
+};
+
+static vissortkey_t *vissortkeys;
+static size_t num_vissortkeys;
 
 static float *pscreenheightarray; // for psprites
 
@@ -659,7 +680,7 @@ static void R_DrawMaskedColumn(column_t *tcolumn)
          column.source = (byte *)tcolumn + 3;
          column.texmid = basetexturemid - (tcolumn->topdelta << FRACBITS);
 
-         colfunc();
+         R_DrawColumnFunc(colfunc);
       }
 
       tcolumn = (column_t *)((byte *)tcolumn + tcolumn->length + 4);
@@ -696,8 +717,21 @@ void R_DrawNewMaskedColumn(texture_t *tex, texcol_t *tcol)
          column.texmid = basetexturemid - (tcol->yoff << FRACBITS);
 
          byte *last = tex->buffer + tcol->ptroff + tcol->len;
-         byte orig;
-         if(last < texend && last > tex->buffer)
+         byte orig = 0;
+         bool patch = (last < texend && last > tex->buffer);
+
+         // a queued column is drawn after the texture has been restored, so
+         // give it a copy of the post with the extra pixel already in place
+         if(patch && r_drawqueue)
+         {
+            byte *copy = static_cast<byte *>(R_DrawQueueAlloc(tcol->len + 1));
+            memcpy(copy, column.source, tcol->len);
+            copy[tcol->len] = last[-1];
+            column.source = copy;
+            patch = false;
+         }
+
+         if(patch)
          {
             orig = *last;
             *last = last[-1];
@@ -705,8 +739,8 @@ void R_DrawNewMaskedColumn(texture_t *tex, texcol_t *tcol)
 
          // Drawn by either R_DrawColumn
          //  or (SHADOW) R_DrawFuzzColumn.
-         colfunc();
-         if(last < texend && last > tex->buffer)
+         R_DrawColumnFunc(colfunc);
+         if(patch)
             *last = orig;
       }
 
@@ -1488,6 +1522,76 @@ static void R_SortVisSprites()
 }
 #endif
 
+//
+// R_radixSortVisSprites
+//
+// Sorts vissprite pointers nearest first, by a radix sort on the bits of their
+// inverse distances; positive floats order the same way as their bits do as
+// integers. Sprites at equal distance stay in BSP order. Passes on a byte that
+// is the same in every key are skipped, which is most of them for the top
+// byte.
+//
+static void R_radixSortVisSprites(vissprite_t **ptrs, int n)
+{
+   unsigned int counts[4][256];
+   vissortkey_t *src, *dst;
+
+   if(num_vissortkeys < size_t(n))
+   {
+      efree(vissortkeys);
+      num_vissortkeys = num_vissprite_alloc;
+      vissortkeys = emalloc(vissortkey_t *, 
+                            2 * num_vissortkeys * sizeof(*vissortkeys));
+   }
+
+   src = vissortkeys;
+   dst = vissortkeys + num_vissortkeys;
+
+   memset(counts, 0, sizeof(counts));
+
+   for(int i = 0; i < n; i++)
+   {
+      uint32_t key;
+
+      // inverted, for the nearest (largest dist) to come first
+      memcpy(&key, &ptrs[i]->dist, sizeof(key));
+      key = ~key;
+
+      src[i].key = key;
+      src[i].spr = ptrs[i];
+
+      ++counts[0][key & 0xff];
+      ++counts[1][(key >>  8) & 0xff];
+      ++counts[2][(key >> 16) & 0xff];
+      ++counts[3][key >> 24];
+   }
+
+   for(int pass = 0; pass < 4; pass++)
+   {
+      unsigned int *count = counts[pass];
+      unsigned int  offset = 0;
+      int           shift = pass * 8;
+
+      if(count[(src[0].key >> shift) & 0xff] == unsigned(n))
+         continue;
+
+      for(int b = 0; b < 256; b++)
+      {
+         unsigned int c = count[b];
+         count[b] = offset;
+         offset += c;
+      }
+
+      for(int i = 0; i < n; i++)
+         dst[count[(src[i].key >> shift) & 0xff]++] = src[i];
+
+      std::swap(src, dst);
+   }
+
+   for(int i = 0; i < n; i++)
+      ptrs[i] = src[i].spr;
+}
+
 //
 // R_SortVisSpriteRange
 //
@@ -1518,17 +1622,87 @@ static void R_SortVisSpriteRange(int first, int last)
 
       // killough 9/22/98: replace qsort with merge sort, since the keys
       // are roughly in order to begin with, due to BSP rendering.
+      // A handful of sprites is still insertion sorted by msort; anything
+      // more goes through the radix sort, which stays linear in the number
+      // of sprites on slaughter maps.
       
-      msort(vissprite_ptrs, vissprite_ptrs + numsprites, numsprites);
+      if(numsprites < 16)
+         msort(vissprite_ptrs, vissprite_ptrs + numsprites, numsprites);
+      else
+         R_radixSortVisSprites(vissprite_ptrs, numsprites);
+   }
+}
+
+//
+// R_buildDrawsegBuckets
+//
+// Sorts the drawsegs of a masked range which can clip sprites into buckets of
+// screen columns, in two passes: one counting the drawsegs of each bucket,
+// the other filling them in.
+//
+static void R_buildDrawsegBuckets(int firstds, int lastds)
+{
+   int counts[MAXDSBUCKETS];
+   int numbuckets, total = 0;
+   drawseg_t *ds;
+
+   dsbucketshift = 4;
+   while(((viewwindow.width - 1) >> dsbucketshift) >= MAXDSBUCKETS)
+      ++dsbucketshift;
+   numbuckets = ((viewwindow.width - 1) >> dsbucketshift) + 1;
+
+   memset(counts, 0, sizeof(counts));
+
+   for(ds = drawsegs + lastds; ds-- > drawsegs + firstds; )
+   {
+      if(ds->silhouette || ds->maskedtexturecol)
+      {
+         for(int b = ds->x1 >> dsbucketshift; b <= ds->x2 >> dsbucketshift; b++)
+            ++counts[b];
+      }
+   }
+
+   for(int b = 0; b < numbuckets; b++)
+   {
+      dsbucketstart[b] = total;
+      total += counts[b];
+      counts[b] = dsbucketstart[b];
+   }
+   for(int b = numbuckets; b <= MAXDSBUCKETS; b++)
+      dsbucketstart[b] = total;
+
+   if(drawsegs_xrange_size < unsigned(total))
+   {
+      // haleyjd: fix reallocation to track 2x size
+      drawsegs_xrange_size = 2 * total;
+      drawsegs_xrange = 
+         erealloc(drawsegs_xrange_t *, drawsegs_xrange, 
+                  drawsegs_xrange_size * sizeof(*drawsegs_xrange));
+   }
+
+   for(ds = drawsegs + lastds; ds-- > drawsegs + firstds; )
+   {
+      if(ds->silhouette || ds->maskedtexturecol)
+      {
+         for(int b = ds->x1 >> dsbucketshift; b <= ds->x2 >> dsbucketshift; b++)
+         {
+            drawsegs_xrange_t &dsx = drawsegs_xrange[counts[b]++];
+
+            dsx.x1   = ds->x1;
+            dsx.x2   = ds->x2;
+            dsx.user = ds;
+         }
+      }
    }
 }
 
 //
 // R_DrawSpriteInDSRange
 //
-// Draws a sprite within a given drawseg range, for portals.
+// Draws a sprite within the drawseg range last sorted by
+// R_buildDrawsegBuckets, for portals.
 //
-static void R_DrawSpriteInDSRange(vissprite_t *spr, int firstds, int lastds)
+static void R_DrawSpriteInDSRange(vissprite_t *spr)
 {
    drawseg_t *ds;
    int        x;
@@ -1542,88 +1716,29 @@ static void R_DrawSpriteInDSRange(vissprite_t *spr, int firstds, int lastds)
 
    // haleyjd 04/25/10:
    // e6y: optimization
-   if(drawsegs_xrange_count)
-   {
-      drawsegs_xrange_t *dsx = drawsegs_xrange;
-
-      // drawsegs_xrange is sorted by ::x1
-      // haleyjd: way faster to use a pointer here
-      while((ds = dsx->user))
+   // Each bucket of columns the sprite covers is clipped against only the
+   // drawsegs in that bucket. They are in the same order as in the drawseg
+   // list, so every column ends up clipped by the same drawseg as if all of
+   // them had been scanned.
+   for(int b = spr->x1 >> dsbucketshift; b <= spr->x2 >> dsbucketshift; b++)
+   {
+      const drawsegs_xrange_t *dsx = drawsegs_xrange + dsbucketstart[b];
+      const drawsegs_xrange_t *end = drawsegs_xrange + dsbucketstart[b + 1];
+      int lo = emax(spr->x1, b << dsbucketshift);
+      int hi = emin(spr->x2, ((b + 1) << dsbucketshift) - 1);
+
+      for(; dsx != end; ++dsx)
       {
          // determine if the drawseg obscures the sprite
-         if(dsx->x1 > spr->x2 || dsx->x2 < spr->x1)
-         {
-            ++dsx;
+         if(dsx->x1 > hi || dsx->x2 < lo)
             continue;      // does not cover sprite
-         }
-         ++dsx;
-
-         if(ds->dist1 > ds->dist2)
-         {
-            fardist = ds->dist2;
-            dist = ds->dist1;
-         }
-         else
-         {
-            fardist = ds->dist1;
-            dist = ds->dist2;
-         }
-
-         if(dist < spr->dist || (fardist < spr->dist &&
-            !R_PointOnSegSide(spr->gx, spr->gy, ds->curline)))
-         {
-            if(ds->maskedtexturecol) // masked mid texture?
-            {
-               r1 = ds->x1 < spr->x1 ? spr->x1 : ds->x1;
-               r2 = ds->x2 > spr->x2 ? spr->x2 : ds->x2;
-               R_RenderMaskedSegRange(ds, r1, r2);
-            }
-            continue;                // seg is behind sprite
-         }
 
-         r1 = ds->x1 < spr->x1 ? spr->x1 : ds->x1;
-         r2 = ds->x2 > spr->x2 ? spr->x2 : ds->x2;
+         ds = dsx->user;
 
-         // clip this piece of the sprite
-         // killough 3/27/98: optimized and made much shorter
-
-         // bottom sil
-         if(ds->silhouette & SIL_BOTTOM && spr->gz < ds->bsilheight)
-         {
-            for(x = r1; x <= r2; x++)
-            {
-               if(clipbot[x] == CLIP_UNDEF)
-                  clipbot[x] = ds->sprbottomclip[x];
-            }
-         }
+         r1 = dsx->x1 < lo ? lo : dsx->x1;
+         r2 = dsx->x2 > hi ? hi : dsx->x2;
 
-         // top sil
-         if(ds->silhouette & SIL_TOP && spr->gzt > ds->tsilheight)
-         {
-            for(x = r1; x <= r2; x++)
-            {
-               if(cliptop[x] == CLIP_UNDEF)
-                  cliptop[x] = ds->sprtopclip[x];
-            }
-         }
-      }
-   }
-   else
-   {
-      // Scan drawsegs from end to start for obscuring segs.
-      // The first drawseg that has a greater scale is the clip seg.
-
-      for(ds = drawsegs + lastds; ds-- > drawsegs + firstds; )
-      {      
-         // determine if the drawseg obscures the sprite
-         if(ds->x1 > spr->x2 || ds->x2 < spr->x1 ||
-            (!ds->silhouette && !ds->maskedtexturecol))
-            continue; // does not cover sprite
-
-         r1 = ds->x1 < spr->x1 ? spr->x1 : ds->x1;
-         r2 = ds->x2 > spr->x2 ? spr->x2 : ds->x2;
-
-         if (ds->dist1 > ds->dist2)
+         if(ds->dist1 > ds->dist2)
          {
             fardist = ds->dist2;
             dist = ds->dist1;
@@ -1784,6 +1899,7 @@ static void R_DrawSpriteInDSRange(vissprite_t *spr, int firstds, int lastds)
 //
 void R_DrawPostBSP()
 {
+   RProfileScope profile(RPROF_POSTBSP);
    maskedrange_t *masked;
    drawseg_t     *ds;
    int           firstds, lastds, firstsprite, lastsprite;
@@ -1808,36 +1924,13 @@ void R_DrawPostBSP()
             // Reducing of cache misses in the following R_DrawSprite()
             // Makes sense for scenes with huge amount of drawsegs.
             // ~12% of speed improvement on epic.wad map05
-            drawsegs_xrange_count = 0;
-            if(num_vissprite > 0)
-            {
-               if(drawsegs_xrange_size <= maxdrawsegs+1)
-               {
-                  // haleyjd: fix reallocation to track 2x size
-                  drawsegs_xrange_size =  2 * (maxdrawsegs+1);
-                  drawsegs_xrange = 
-                     erealloc(drawsegs_xrange_t *, drawsegs_xrange, 
-                              drawsegs_xrange_size * sizeof(*drawsegs_xrange));
-               }
-               for(ds = drawsegs + lastds; ds-- > drawsegs + firstds; )
-               {
-                  if (ds->silhouette || ds->maskedtexturecol)
-                  {
-                     drawsegs_xrange[drawsegs_xrange_count].x1   = ds->x1;
-                     drawsegs_xrange[drawsegs_xrange_count].x2   = ds->x2;
-                     drawsegs_xrange[drawsegs_xrange_count].user = ds;
-                     drawsegs_xrange_count++;
-                  }
-               }
-               // haleyjd: terminate with a NULL user for faster loop - adds ~3 FPS
-               drawsegs_xrange[drawsegs_xrange_count].user = NULL;
-            }
+            R_buildDrawsegBuckets(firstds, lastds);
 
             ptop    = masked->ceilingclip;
             pbottom = masked->floorclip;
 
             for(int i = lastsprite - firstsprite; --i >= 0; )
-               R_DrawSpriteInDSRange(vissprite_ptrs[i], firstds, lastds);         // killough
+               R_DrawSpriteInDSRange(vissprite_ptrs[i]);         // killough
          }
 
          // render any remaining masked mid textures
@@ -1871,6 +1964,10 @@ void R_DrawPostBSP()
       }
    }
 
+   // the player sprites are drawn with a different view center, so any queued
+   // drawing has to be finished before them
+   R_EndDrawQueue();
+
    // draw the psprites on top of everything
    //  but does not draw on side views
    if(!viewangleoffset)
@@ -2397,6 +2494,7 @@ static void R_DrawParticle(vissprite_t *vis)
    int x1, x2, ox1, ox2;
    int yl, yh;
    byte color;
+   unsigned int *fg2rgb = NULL, *bg2rgb = NULL;
 
    ox1 = x1 = vis->x1;
    ox2 = x2 = vis->x2;
@@ -2422,65 +2520,95 @@ static void R_DrawParticle(vissprite_t *vis)
    yl = (int)vis->ytop;
    yh = (int)vis->ybottom;
 
+   if(yh < yl)
+      return;
+
    color = vis->colormap[vis->colour];
 
+   // look up translucency information
+   if(general_translucency && particle_trans)
    {
-      int xcount, ycount, spacing;
-      byte *dest;
+      unsigned int fglevel, bglevel;
 
-      xcount = x2 - x1 + 1;
-      
-      ycount = yh - yl;      
-      if(ycount < 0)
-         return;
-      ++ycount;
+      fglevel = ((unsigned int)(vis->translucency) + 1) & ~0x3ff;
+      bglevel = FRACUNIT - fglevel;
+      fg2rgb  = Col2RGB8[fglevel >> 10];
+      bg2rgb  = Col2RGB8[bglevel >> 10];
+   }
 
-      spacing = video.pitch - xcount;
-      dest    = R_ADDRESS(x1, yl);
+   if(r_drawqueue)
+      R_QueueParticle(x1, x2, yl, yh, color, fg2rgb, bg2rgb);
+   else
+   {
+      // sprite columns still held by the quad cache lie behind the particle,
+      // so they must reach the screen before it does
+      if(r_column_engine->ResetBuffer)
+         r_column_engine->ResetBuffer();
+      R_DrawParticleRect(x1, x2, yl, yh, color, fg2rgb, bg2rgb);
+   }
+}
 
-      // haleyjd 02/08/05: rewritten to remove inner loop invariants
-      if(general_translucency && particle_trans)
-      {
-         unsigned int bg, fg;
-         unsigned int *fg2rgb, *bg2rgb;
-         unsigned int fglevel, bglevel;
-
-         // look up translucency information
-         fglevel = ((unsigned int)(vis->translucency) + 1) & ~0x3ff;
-         bglevel = FRACUNIT - fglevel;
-         fg2rgb  = Col2RGB8[fglevel >> 10];
-         bg2rgb  = Col2RGB8[bglevel >> 10];
-         fg      = fg2rgb[color]; // foreground color is invariant
-
-         do // step in y
-         {
-            int count = xcount;
+//
+// R_DrawParticleRect
+//
+// Fills the screen rectangle of a particle, blending it with the background
+// when translucency tables are given.
+//
+void R_DrawParticleRect(int x1, int x2, int yl, int yh, byte color,
+                        unsigned int *fg2rgb, unsigned int *bg2rgb)
+{
+   int xcount, ycount, spacing;
+   byte *dest;
 
-            do // step in x
-            {
-               bg = bg2rgb[*dest];
-               bg = (fg + bg) | 0x1f07c1f;
-               *dest++ = RGB32k[0][0][bg & (bg >> 15)];
-            } 
-            while(--count);
-            dest += spacing;  // go to next row
-         } 
-         while(--ycount);
-      }
-      else // opaque (fast, and looks terrible)
+   if(r_tcactive)
+   {
+      // the translucency level is the row of Col2RGB8 being used
+      R_TCDrawParticleRect(x1, x2, yl, yh, color,
+                           fg2rgb ? int(fg2rgb - Col2RGB8[0]) >> 8 : 64);
+      return;
+   }
+
+   xcount = x2 - x1 + 1;
+   ycount = yh - yl + 1;
+
+   spacing = video.pitch - xcount;
+   dest    = R_ADDRESS(x1, yl);
+
+   // haleyjd 02/08/05: rewritten to remove inner loop invariants
+   if(fg2rgb)
+   {
+      unsigned int bg, fg;
+
+      fg = fg2rgb[color]; // foreground color is invariant
+
+      do // step in y
       {
-         do // step in y
+         int count = xcount;
+
+         do // step in x
          {
-            int count = xcount;
-            
-            do // step in x
-               *dest++ = color;
-            while(--count);
-            dest += spacing;  // go to next row
+            bg = bg2rgb[*dest];
+            bg = (fg + bg) | 0x1f07c1f;
+            *dest++ = RGB32k[0][0][bg & (bg >> 15)];
          } 
-         while(--ycount);
-      } // end else [!general_translucency]
-   } // end local block
+         while(--count);
+         dest += spacing;  // go to next row
+      } 
+      while(--ycount);
+   }
+   else // opaque (fast, and looks terrible)
+   {
+      do // step in y
+      {
+         int count = xcount;
+         
+         do // step in x
+            *dest++ = color;
+         while(--count);
+         dest += spacing;  // go to next row
+      } 
+      while(--ycount);
+   } // end else [!general_translucency]
 }
 
 //============================================================================
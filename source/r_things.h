@@ -76,6 +76,8 @@ void R_ClearSprites(void);
 void R_DrawPostBSP(void);
 void R_ClearParticles(void);
 void R_InitParticles(void);
+void R_DrawParticleRect(int x1, int x2, int yl, int yh, byte color,
+                        unsigned int *fg2rgb, unsigned int *bg2rgb);
 particle_t *newParticle(void);
 
 typedef struct cb_maskedcolumn_s
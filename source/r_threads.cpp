@@ -0,0 +1,592 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// Copyright (C) 2013 James Haley et al.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+// Additional terms and conditions compatible with the GPLv3 apply. See the
+// file COPYING-EE for details.
+//
+//--------------------------------------------------------------------------
+//
+// DESCRIPTION:
+//      Threaded drawing.
+//
+//      The view is divided into r_threads vertical slices of equal width.
+//      While r_drawqueue is set, every column, span and particle the renderer
+//      would draw is instead recorded into the command list of each slice it
+//      touches, clipped to that slice. BSP traversal, clipping, visplane and
+//      sprite setup all still happen on the main thread exactly as before, so
+//      the drawer inputs are unchanged. At the end of the frame each slice's
+//      commands are replayed in their original order on its own thread.
+//      Since every slice sees the same sequence of writes to its pixels as
+//      the single-threaded renderer would have made, the output is identical.
+//
+//      Slope spans cannot be split without changing their interpolation, so
+//      they are recorded as serial commands. A serial command closes the
+//      current parallel phase; it is drawn on the main thread once every
+//      slice has caught up to it.
+//
+//      With r_drawahead, the slices do not wait for the end of the frame:
+//      whenever the main thread finishes a large piece of the scene (the
+//      main BSP, each portal window, the visplanes), R_KickDrawQueue lets the
+//      workers start replaying what has been recorded so far, while the main
+//      thread goes on to traverse the next portal window. A slice only ever
+//      replays its own commands in order, and never past a serial phase
+//      boundary, so the output is still identical.
+//
+//-----------------------------------------------------------------------------
+
+#include "z_zone.h"
+
+#include "c_runcmd.h"
+#include "m_threads.h"
+#include "r_draw.h"
+#include "r_main.h"
+#include "r_plane.h"
+#include "r_state.h"
+#include "r_things.h"
+#include "r_threads.h"
+#include "r_truecolor.h"
+
+int  r_threads = 1;     // number of slices; 1 disables threaded drawing
+bool r_drawqueue;       // true while drawing commands are being recorded
+bool r_drawahead = true; // replay commands while the frame is still recorded
+
+// draw command types
+enum
+{
+   RDC_COLUMN,   // column drawer call
+   RDC_SPAN,     // span drawer call, clipped to the slice
+   RDC_SLOPE,    // slope span drawer call (serial only)
+   RDC_PARTICLE, // particle rectangle, clipped to the slice
+   RDC_BARRIER,  // end of a parallel phase
+};
+
+struct rparticlecmd_t
+{
+   int x1, x2, y1, y2;
+   unsigned int *fg2rgb, *bg2rgb; // NULL if opaque
+   byte color;
+};
+
+struct rdrawcmd_t
+{
+   int    type;
+   void (*func)();
+   byte  *tranmap;
+   int    fuzzpos;
+
+   union
+   {
+      cb_column_t    column;
+      cb_span_t      span;
+      cb_slopespan_t slopespan;
+      rparticlecmd_t particle;
+   };
+};
+
+//
+// rdrawlist_t
+//
+// Growable array of draw commands. Storage is kept from frame to frame.
+//
+static void R_finishDrawAhead();
+
+struct rdrawlist_t
+{
+   rdrawcmd_t *cmds;
+   size_t      numcmds;
+   size_t      numalloc;
+   size_t      pos;       // replay position, carried across phases
+   size_t      limit;     // commands available to a draw-ahead replay
+
+   rdrawcmd_t &newCmd(int type)
+   {
+      if(numcmds >= numalloc)
+      {
+         // the workers may be reading the array
+         R_finishDrawAhead();
+         numalloc = numalloc ? numalloc * 2 : 1024;
+         cmds = erealloc(rdrawcmd_t *, cmds, numalloc * sizeof(rdrawcmd_t));
+      }
+      rdrawcmd_t &cmd = cmds[numcmds++];
+      cmd.type = type;
+      return cmd;
+   }
+};
+
+struct rdrawslice_t
+{
+   int x1, x2;         // inclusive column range covered by the slice
+   rdrawlist_t list;
+};
+
+static rdrawslice_t drawslices[MAXRENDERTHREADS];
+static int          numdrawslices;
+static int          slicewidth;
+
+static rdrawlist_t  serialcmds;   // serial groups, each opened by a barrier
+static bool         inserial;     // last recorded command was serial
+
+static WorkerPool   drawpool;
+static bool         drawingahead; // a draw-ahead batch was started
+
+//=============================================================================
+//
+// Per-frame memory
+//
+// Some drawer sources only live until the renderer overwrites them, such as
+// the slope span light table or a swirling flat's buffer. Copies made here
+// last until the queue has been drawn.
+//
+
+struct rqueueblock_t
+{
+   rqueueblock_t *next;
+   size_t         size;
+   size_t         used;
+   // data follows
+};
+
+static rqueueblock_t *queueblocks;   // blocks in use this frame
+static rqueueblock_t *freeblocks;    // blocks kept for reuse
+
+#define QUEUEBLOCKSIZE 262144
+
+static size_t R_queueBlockHeader()
+{
+   return (sizeof(rqueueblock_t) + 15) & ~15;
+}
+
+//
+// R_DrawQueueAlloc
+//
+// Allocates memory which stays valid until the end of the current draw queue.
+//
+void *R_DrawQueueAlloc(size_t size)
+{
+   size = (size + 15) & ~15;
+
+   if(!queueblocks || queueblocks->used + size > queueblocks->size)
+   {
+      rqueueblock_t *block = freeblocks;
+
+      if(block && block->size >= size)
+         freeblocks = block->next;
+      else
+      {
+         size_t bsize = size > QUEUEBLOCKSIZE ? size : QUEUEBLOCKSIZE;
+         block = static_cast<rqueueblock_t *>(emalloc(void *, R_queueBlockHeader() + bsize));
+         block->size = bsize;
+      }
+      block->used = 0;
+      block->next = queueblocks;
+      queueblocks = block;
+   }
+
+   void *ret = reinterpret_cast<byte *>(queueblocks) + R_queueBlockHeader() +
+               queueblocks->used;
+   queueblocks->used += size;
+   return ret;
+}
+
+//
+// R_freeQueueMemory
+//
+static void R_freeQueueMemory()
+{
+   while(queueblocks)
+   {
+      rqueueblock_t *next = queueblocks->next;
+      queueblocks->next = freeblocks;
+      freeblocks = queueblocks;
+      queueblocks = next;
+   }
+}
+
+//=============================================================================
+//
+// Recording
+//
+
+//
+// R_sliceForX
+//
+inline static int R_sliceForX(int x)
+{
+   int slice = x / slicewidth;
+   return slice < numdrawslices ? slice : numdrawslices - 1;
+}
+
+//
+// R_parallelCmd
+//
+// Records a command for the given slice, closing any serial phase in progress.
+//
+static rdrawcmd_t &R_parallelCmd(int slice, int type)
+{
+   inserial = false;
+   return drawslices[slice].list.newCmd(type);
+}
+
+//
+// R_QueueColumn
+//
+// Records the current column for deferred drawing with the given function.
+//
+void R_QueueColumn(void (*func)())
+{
+   rdrawcmd_t &cmd = R_parallelCmd(R_sliceForX(column.x), RDC_COLUMN);
+
+   cmd.func    = func;
+   cmd.tranmap = tranmap;
+   cmd.fuzzpos = fuzzpos;
+   cmd.column  = column;
+
+   // The fuzz drawer walks fuzzpos along as it draws, and the next fuzz column
+   // drawn anywhere on the screen continues from there, so advance it now by
+   // as many pixels as the drawer is going to touch.
+   if(func == r_normal_drawer.DrawFuzzColumn ||
+      func == r_tc_drawer.DrawFuzzColumn)
+   {
+      int y1 = column.y1 ? column.y1 : 1;
+      int y2 = column.y2 == viewwindow.height - 1 ? viewwindow.height - 2 : column.y2;
+      int count = y2 - y1 + 1;
+
+      if(count > 0)
+         fuzzpos = (fuzzpos + count) % FUZZTABLE;
+   }
+}
+
+//
+// R_QueueSpan
+//
+// Records the current span, split at the slice boundaries. The texture
+// coordinates advance by a fixed integer step per pixel, so a piece starting
+// part way along the span steps through exactly the same values.
+//
+void R_QueueSpan(void (*func)())
+{
+   int first = R_sliceForX(span.x1);
+   int last  = R_sliceForX(span.x2);
+
+   for(int i = first; i <= last; i++)
+   {
+      const rdrawslice_t &slice = drawslices[i];
+      rdrawcmd_t &cmd = R_parallelCmd(i, RDC_SPAN);
+
+      cmd.func = func;
+      cmd.span = span;
+
+      if(span.x1 < slice.x1)
+      {
+         unsigned int skip = unsigned(slice.x1 - span.x1);
+         cmd.span.x1     = slice.x1;
+         cmd.span.xfrac += span.xstep * skip;
+         cmd.span.yfrac += span.ystep * skip;
+      }
+      if(span.x2 > slice.x2)
+         cmd.span.x2 = slice.x2;
+   }
+}
+
+//
+// R_QueueSlope
+//
+// Records the current slope span as a serial command.
+//
+void R_QueueSlope(void (*func)())
+{
+   // start a new serial group, which every slice must reach first
+   if(!inserial)
+   {
+      for(int i = 0; i < numdrawslices; i++)
+         drawslices[i].list.newCmd(RDC_BARRIER);
+      serialcmds.newCmd(RDC_BARRIER);
+      inserial = true;
+   }
+
+   rdrawcmd_t &cmd = serialcmds.newCmd(RDC_SLOPE);
+   int len = slopespan.x2 - slopespan.x1 + 1;
+
+   cmd.func      = func;
+   cmd.slopespan = slopespan;
+
+   if(len > 0)
+   {
+      size_t size = len * sizeof(lighttable_t *);
+      cmd.slopespan.colormap =
+         static_cast<lighttable_t **>(R_DrawQueueAlloc(size));
+      memcpy(cmd.slopespan.colormap, slopespan.colormap, size);
+   }
+}
+
+//
+// R_QueueParticle
+//
+// Records a particle rectangle.
+//
+void R_QueueParticle(int x1, int x2, int y1, int y2, byte color,
+                     unsigned int *fg2rgb, unsigned int *bg2rgb)
+{
+   int first = R_sliceForX(x1);
+   int last  = R_sliceForX(x2);
+
+   for(int i = first; i <= last; i++)
+   {
+      const rdrawslice_t &slice = drawslices[i];
+      rdrawcmd_t &cmd = R_parallelCmd(i, RDC_PARTICLE);
+
+      cmd.particle.x1     = x1 > slice.x1 ? x1 : slice.x1;
+      cmd.particle.x2     = x2 < slice.x2 ? x2 : slice.x2;
+      cmd.particle.y1     = y1;
+      cmd.particle.y2     = y2;
+      cmd.particle.color  = color;
+      cmd.particle.fg2rgb = fg2rgb;
+      cmd.particle.bg2rgb = bg2rgb;
+   }
+}
+
+//=============================================================================
+//
+// Replay
+//
+
+//
+// R_runCommand
+//
+// Executes one command on the calling thread.
+//
+static void R_runCommand(const rdrawcmd_t &cmd)
+{
+   switch(cmd.type)
+   {
+   case RDC_COLUMN:
+      column  = cmd.column;
+      tranmap = cmd.tranmap;
+      fuzzpos = cmd.fuzzpos;
+      cmd.func();
+      break;
+   case RDC_SPAN:
+      span = cmd.span;
+      cmd.func();
+      break;
+   case RDC_SLOPE:
+      slopespan = cmd.slopespan;
+      cmd.func();
+      break;
+   case RDC_PARTICLE:
+      R_DrawParticleRect(cmd.particle.x1, cmd.particle.x2,
+                         cmd.particle.y1, cmd.particle.y2, cmd.particle.color,
+                         cmd.particle.fg2rgb, cmd.particle.bg2rgb);
+      break;
+   default:
+      break;
+   }
+}
+
+//
+// R_runSlicePhase
+//
+// Worker task: replays one slice's commands up to the next barrier.
+//
+static void R_runSlicePhase(int task, void *data)
+{
+   rdrawlist_t &list = drawslices[task].list;
+
+   while(list.pos < list.numcmds)
+   {
+      const rdrawcmd_t &cmd = list.cmds[list.pos++];
+
+      if(cmd.type == RDC_BARRIER)
+         break;
+
+      R_runCommand(cmd);
+   }
+}
+
+//
+// R_drawAheadSlice
+//
+// Worker task: replays one slice's commands recorded up to the last kick,
+// stopping before any barrier so that the serial phases stay in step.
+//
+static void R_drawAheadSlice(int task, void *data)
+{
+   rdrawlist_t &list = drawslices[task].list;
+
+   while(list.pos < list.limit && list.cmds[list.pos].type != RDC_BARRIER)
+      R_runCommand(list.cmds[list.pos++]);
+}
+
+//
+// R_finishDrawAhead
+//
+// Waits for a draw-ahead batch, if one was started.
+//
+static void R_finishDrawAhead()
+{
+   if(drawingahead)
+   {
+      drawpool.wait();
+      drawingahead = false;
+   }
+}
+
+//
+// R_KickDrawQueue
+//
+// Called by the renderer between large pieces of the scene. If the workers are
+// idle, they start drawing everything recorded so far in the background. If
+// they are still busy, nothing happens, and the next kick or the end of the
+// frame picks up the commands.
+//
+void R_KickDrawQueue()
+{
+   if(!r_drawqueue || !r_drawahead)
+      return;
+
+   if(drawingahead)
+   {
+      if(drawpool.busy())
+         return;
+      R_finishDrawAhead();
+   }
+
+   for(int i = 0; i < numdrawslices; i++)
+      drawslices[i].list.limit = drawslices[i].list.numcmds;
+
+   drawpool.start(numdrawslices, R_drawAheadSlice, NULL);
+   drawingahead = true;
+}
+
+//
+// R_setupSlices
+//
+// Divides the view window among the slices.
+//
+static void R_setupSlices()
+{
+   int num = r_threads;
+
+   if(num > viewwindow.width)
+      num = viewwindow.width;
+   if(num < 1)
+      num = 1;
+
+   numdrawslices = num;
+   slicewidth    = (viewwindow.width + num - 1) / num;
+
+   for(int i = 0; i < num; i++)
+   {
+      rdrawslice_t &slice = drawslices[i];
+
+      slice.x1 = i * slicewidth;
+      slice.x2 = slice.x1 + slicewidth - 1;
+      if(slice.x2 >= viewwindow.width)
+         slice.x2 = viewwindow.width - 1;
+
+      slice.list.numcmds = 0;
+      slice.list.pos     = 0;
+      slice.list.limit   = 0;
+   }
+
+   serialcmds.numcmds = 0;
+   serialcmds.pos     = 0;
+   inserial = false;
+
+   // one worker fewer than slices, since the main thread takes part too
+   drawpool.setNumThreads(num - 1);
+}
+
+//
+// R_BeginDrawQueue
+//
+// Called at the start of a frame. If threaded drawing is enabled, drawing is
+// recorded from now on instead of being done immediately.
+//
+void R_BeginDrawQueue()
+{
+   if(r_threads <= 1)
+   {
+      drawpool.setNumThreads(0);
+      return;
+   }
+
+   R_setupSlices();
+   r_drawqueue = true;
+}
+
+//
+// R_EndDrawQueue
+//
+// Draws everything recorded since R_BeginDrawQueue and returns to immediate
+// drawing. Does nothing if the queue isn't active.
+//
+void R_EndDrawQueue()
+{
+   if(!r_drawqueue)
+      return;
+
+   r_drawqueue = false;
+
+   R_finishDrawAhead();
+
+   // the main thread replays commands too, so keep its drawer state
+   cb_column_t    savedcolumn    = column;
+   cb_span_t      savedspan      = span;
+   cb_slopespan_t savedslopespan = slopespan;
+   byte          *savedtranmap   = tranmap;
+   int            savedfuzzpos   = fuzzpos;
+
+   while(true)
+   {
+      drawpool.run(numdrawslices, R_runSlicePhase, NULL);
+
+      // run the serial commands recorded where the slices stopped
+      if(serialcmds.pos >= serialcmds.numcmds)
+         break;
+
+      ++serialcmds.pos; // skip the group's opening barrier
+      while(serialcmds.pos < serialcmds.numcmds &&
+            serialcmds.cmds[serialcmds.pos].type != RDC_BARRIER)
+      {
+         R_runCommand(serialcmds.cmds[serialcmds.pos++]);
+      }
+   }
+
+   column    = savedcolumn;
+   span      = savedspan;
+   slopespan = savedslopespan;
+   tranmap   = savedtranmap;
+   fuzzpos   = savedfuzzpos;
+
+   R_freeQueueMemory();
+}
+
+//=============================================================================
+//
+// Console Variables
+//
+
+VARIABLE_INT(r_threads, NULL, 1, MAXRENDERTHREADS, NULL);
+CONSOLE_VARIABLE(r_threads, r_threads, 0) {}
+
+VARIABLE_TOGGLE(r_drawahead, NULL, onoff);
+CONSOLE_VARIABLE(r_drawahead, r_drawahead, 0) {}
+
+// EOF
+
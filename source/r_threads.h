@@ -0,0 +1,88 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// Copyright (C) 2013 James Haley et al.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+// Additional terms and conditions compatible with the GPLv3 apply. See the
+// file COPYING-EE for details.
+//
+//--------------------------------------------------------------------------
+//
+// DESCRIPTION:
+//      Threaded drawing. While a frame is being set up, column, span and
+//      particle drawing is recorded into per-slice command lists, which are
+//      then executed concurrently, one vertical screen slice per thread.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef R_THREADS_H__
+#define R_THREADS_H__
+
+#include "doomtype.h"
+
+#define MAXRENDERTHREADS 16
+
+extern int  r_threads;     // number of screen slices (1 = single-threaded)
+extern bool r_drawqueue;   // true while drawing is being deferred
+extern bool r_drawahead;   // start drawing before the frame is recorded
+
+void R_BeginDrawQueue();
+void R_KickDrawQueue();
+void R_EndDrawQueue();
+
+void R_QueueColumn(void (*func)());
+void R_QueueSpan(void (*func)());
+void R_QueueSlope(void (*func)());
+void R_QueueParticle(int x1, int x2, int y1, int y2, byte color,
+                     unsigned int *fg2rgb, unsigned int *bg2rgb);
+
+void *R_DrawQueueAlloc(size_t size);
+
+//
+// R_DrawColumnFunc / R_DrawSpanFunc / R_DrawSlopeFunc
+//
+// Call sites use these instead of invoking the drawer function pointers
+// directly, so that the drawer runs immediately or is deferred to the worker
+// threads depending on the current mode.
+//
+inline void R_DrawColumnFunc(void (*func)())
+{
+   if(r_drawqueue)
+      R_QueueColumn(func);
+   else
+      func();
+}
+
+inline void R_DrawSpanFunc(void (*func)())
+{
+   if(r_drawqueue)
+      R_QueueSpan(func);
+   else
+      func();
+}
+
+inline void R_DrawSlopeFunc(void (*func)())
+{
+   if(r_drawqueue)
+      R_QueueSlope(func);
+   else
+      func();
+}
+
+#endif
+
+// EOF
+
@@ -0,0 +1,932 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// Copyright (C) 2013 James Haley et al.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+// Additional terms and conditions compatible with the GPLv3 apply. See the
+// file COPYING-EE for details.
+//
+//--------------------------------------------------------------------------
+//
+// DESCRIPTION:
+//      32-bit rendering of the player view.
+//
+//      With r_truecolor on, the view is drawn into a 0xAARRGGBB buffer by
+//      column and span drawers that light through the usual colormaps and
+//      then look the result up in PLAYPAL, so that translucency can blend
+//      real RGB values at any opacity instead of going through TRANMAP or
+//      the 32k colour cube.
+//
+//      Everything else on the screen is still drawn in 8 bits. The finished
+//      view is not copied into the 8-bit screen; instead the view is split
+//      into tiles, and before anything reads or draws over a tile of the
+//      screen, R_TCCover quantizes that tile through the 32k colour cube and
+//      marks it covered. Wipes, screenshots and translucent 2D graphics so
+//      still see the view in 8 bits where they need it. At presentation time
+//      covered tiles go through the palette, and the rest of the view comes
+//      from the 32-bit buffer.
+//
+//-----------------------------------------------------------------------------
+
+#include "z_zone.h"
+
+#include "autopalette.h"
+#include "c_runcmd.h"
+#include "doomstat.h"
+#include "i_system.h"
+#include "m_compare.h"
+#include "r_draw.h"
+#include "r_main.h"
+#include "r_plane.h"
+#include "r_truecolor.h"
+#include "v_misc.h"
+#include "v_video.h"
+#include "w_wad.h"
+
+bool r_truecolor;
+bool r_tcactive;
+bool r_tcstaletrans;
+
+uint32_t *r_tcscreen;
+int       r_tcpitch;
+
+uint32_t r_tcbasepal[256];
+
+static bool tcinit;              // r_tcbasepal has been loaded
+static byte tcbasebytes[768];    // PLAYPAL
+static byte tccurbytes[768];     // palette last given to I_SetPalette
+static bool tchavecur;
+
+// Output tables: the current palette with gamma for 8-bit pixels, and the
+// per-channel curves that take base palette colours to the current palette
+// for 32-bit pixels. The alpha byte is carried by tcred.
+static uint32_t tcpalette[256];
+static uint32_t tcred[256], tcgreen[256], tcblue[256];
+
+#define TCTILESHIFT 3             // tiles are 8x8 pixels
+#define TCTILESIZE  (1 << TCTILESHIFT)
+
+bool r_tcpending;
+
+static byte *tccover;            // per tile of the view: quantized into the screen
+static int   tctilesw, tctilesh; // tiles across and down the view
+static int   tcwidth, tcheight;  // screen size the buffers were made for
+static bool  tcready;            // the view buffer belongs to this frame
+static int   tcviewx, tcviewy, tcviewwidth, tcviewheight;
+
+//=============================================================================
+//
+// Palette
+//
+
+//
+// R_tcBuildOutputTables
+//
+// The palette effects (damage, pickups, radiation suit) are palettes
+// blended towards a colour, one channel at a time, so a straight line fitted
+// through each channel of the current palette against the base palette
+// carries them over to colours that are not in the palette.
+//
+static void R_tcBuildOutputTables()
+{
+   static uint32_t *const channels[3] = { tcred, tcgreen, tcblue };
+   const byte *gamma = gammatable[usegamma];
+   const byte *cur   = tchavecur ? tccurbytes : tcbasebytes;
+
+   for(int i = 0; i < 256; i++)
+   {
+      tcpalette[i] = 0xff000000u |
+                     (uint32_t(gamma[cur[i * 3 + 0]]) << 16) |
+                     (uint32_t(gamma[cur[i * 3 + 1]]) <<  8) |
+                      uint32_t(gamma[cur[i * 3 + 2]]);
+   }
+
+   for(int c = 0; c < 3; c++)
+   {
+      double sx = 0.0, sy = 0.0, sxx = 0.0, sxy = 0.0;
+      double a = 1.0, b = 0.0;
+
+      for(int i = 0; i < 256; i++)
+      {
+         double x = tcbasebytes[i * 3 + c];
+         double y = cur[i * 3 + c];
+
+         sx  += x;
+         sy  += y;
+         sxx += x * x;
+         sxy += x * y;
+      }
+
+      double d = 256.0 * sxx - sx * sx;
+      if(tcinit && d > 0.0)
+      {
+         a = (256.0 * sxy - sx * sy) / d;
+         b = (sy - a * sx) / 256.0;
+      }
+
+      for(int v = 0; v < 256; v++)
+      {
+         int out = eclamp(int(a * v + b + 0.5), 0, 255);
+
+         channels[c][v] = uint32_t(gamma[out]) << (16 - 8 * c);
+      }
+   }
+
+   for(uint32_t &red : tcred)
+      red |= 0xff000000u;
+}
+
+//
+// R_TCInit
+//
+// Loads the base palette. Called once the WADs are loaded.
+//
+void R_TCInit()
+{
+   AutoPalette palette(wGlobalDir);
+
+   memcpy(tcbasebytes, palette.get(), sizeof(tcbasebytes));
+
+   for(int i = 0; i < 256; i++)
+   {
+      r_tcbasepal[i] = 0xff000000u |
+                       (uint32_t(tcbasebytes[i * 3 + 0]) << 16) |
+                       (uint32_t(tcbasebytes[i * 3 + 1]) <<  8) |
+                        uint32_t(tcbasebytes[i * 3 + 2]);
+   }
+
+   tcinit = true;
+   R_tcBuildOutputTables();
+}
+
+//
+// R_TCSetPalette
+//
+// Called along with the video driver's SetPalette; a NULL palette means the
+// gamma level has changed.
+//
+void R_TCSetPalette(const byte *palette)
+{
+   if(palette)
+   {
+      memcpy(tccurbytes, palette, sizeof(tccurbytes));
+      tchavecur = true;
+   }
+
+   R_tcBuildOutputTables();
+}
+
+//=============================================================================
+//
+// View
+//
+
+//
+// R_tcFreeBuffers
+//
+static void R_tcFreeBuffers()
+{
+   if(r_tcscreen)
+   {
+      efree(r_tcscreen);
+      efree(tccover);
+   }
+
+   r_tcscreen  = NULL;
+   tccover     = NULL;
+   tcwidth     = tcheight = 0;
+   tcready     = false;
+   r_tcpending = false;
+}
+
+//
+// R_TCBeginView
+//
+// Decides whether the view about to be rendered is drawn in 32 bits, and
+// makes sure the buffers fit the screen.
+//
+void R_TCBeginView()
+{
+   tcready     = false;
+   r_tcpending = false;
+   r_tcactive  = (r_truecolor && tcinit);
+
+   if(!r_tcactive)
+      return;
+
+   if(tcwidth != video.width || tcheight != video.height)
+   {
+      R_tcFreeBuffers();
+
+      tcwidth    = video.width;
+      tcheight   = video.height;
+      r_tcpitch  = video.width;
+      r_tcscreen = emalloc(uint32_t *, sizeof(uint32_t) * tcwidth * tcheight);
+      tccover    = emalloc(byte *, ((tcwidth  + TCTILESIZE - 1) >> TCTILESHIFT) *
+                                   ((tcheight + TCTILESIZE - 1) >> TCTILESHIFT));
+   }
+}
+
+//
+// R_TCEndView
+//
+// Hands the finished view over to R_TCCover and R_TCBlitFrame. None of it is
+// in the 8-bit screen yet.
+//
+void R_TCEndView()
+{
+   if(!r_tcactive)
+      return;
+
+   r_tcactive = false;
+
+   tcviewx      = viewwindow.x;
+   tcviewy      = viewwindow.y;
+   tcviewwidth  = viewwindow.width;
+   tcviewheight = viewwindow.height;
+   tctilesw     = (tcviewwidth  + TCTILESIZE - 1) >> TCTILESHIFT;
+   tctilesh     = (tcviewheight + TCTILESIZE - 1) >> TCTILESHIFT;
+
+   memset(tccover, 0, tctilesw * tctilesh);
+
+   tcready     = true;
+   r_tcpending = true;
+}
+
+//
+// R_tcQuantizeTile
+//
+static void R_tcQuantizeTile(int tx, int ty)
+{
+   int x1 = tx << TCTILESHIFT;
+   int y1 = ty << TCTILESHIFT;
+   int w  = emin(TCTILESIZE, tcviewwidth  - x1);
+   int h  = emin(TCTILESIZE, tcviewheight - y1);
+
+   for(int y = y1; y < y1 + h; y++)
+   {
+      const uint32_t *src = r_tcscreen + (tcviewy + y) * r_tcpitch + tcviewx + x1;
+      byte *dest = video.screens[0] + (tcviewy + y) * video.pitch + tcviewx + x1;
+
+      for(int x = 0; x < w; x++)
+      {
+         uint32_t c = src[x];
+
+         dest[x] = RGB32k[(c >> 19) & 31][(c >> 11) & 31][(c >> 3) & 31];
+      }
+   }
+}
+
+//
+// R_TCCoverArea
+//
+// Called through R_TCCover before the given area of the screen is read or
+// drawn over in 8 bits. Quantizes the view tiles in it that are not yet, and
+// marks them covered. An opaque area replaces what it covers, so the tiles
+// wholly inside it need no quantizing.
+//
+void R_TCCoverArea(const byte *dest, int width, int height, bool opaque)
+{
+   const byte *screen = video.screens[0];
+
+   if(tcwidth != video.width || tcheight != video.height)
+   {
+      r_tcpending = false;  // the mode changed under the view
+      return;
+   }
+
+   if(dest < screen || dest >= screen + video.pitch * video.height ||
+      width <= 0 || height <= 0)
+      return;  // not the screen
+
+   int offset = int(dest - screen);
+   int x1 = int(offset % video.pitch) - tcviewx;
+   int y1 = int(offset / video.pitch) - tcviewy;
+   int x2 = emin(x1 + width,  tcviewwidth);
+   int y2 = emin(y1 + height, tcviewheight);
+
+   x1 = emax(x1, 0);
+   y1 = emax(y1, 0);
+
+   if(x1 >= x2 || y1 >= y2)
+      return;
+
+   for(int ty = y1 >> TCTILESHIFT; ty <= (y2 - 1) >> TCTILESHIFT; ty++)
+   {
+      int  ty1     = ty << TCTILESHIFT;
+      bool fullrow = (opaque && ty1 >= y1 && 
+                      emin(ty1 + TCTILESIZE, tcviewheight) <= y2);
+      byte *cover  = tccover + ty * tctilesw;
+
+      for(int tx = x1 >> TCTILESHIFT; tx <= (x2 - 1) >> TCTILESHIFT; tx++)
+      {
+         int tx1 = tx << TCTILESHIFT;
+
+         if(cover[tx])
+            continue;
+
+         if(!fullrow || tx1 < x1 || emin(tx1 + TCTILESIZE, tcviewwidth) > x2)
+            R_tcQuantizeTile(tx, ty);
+         cover[tx] = 1;
+      }
+   }
+}
+
+//
+// R_TCCoverAll
+//
+// Puts the whole view into the 8-bit screen, for code that reads it.
+//
+void R_TCCoverAll()
+{
+   if(r_tcpending)
+   {
+      R_TCCoverArea(video.screens[0] + tcviewy * video.pitch + tcviewx,
+                    tcviewwidth, tcviewheight, false);
+      r_tcpending = false;
+   }
+}
+
+//
+// R_TCFillView
+//
+// Fills the view with a palette colour, for HOM detection.
+//
+void R_TCFillView(byte colour)
+{
+   for(int y = 0; y < viewwindow.height; y++)
+   {
+      uint32_t *dest = R_TCADDRESS(0, y);
+
+      for(int x = 0; x < viewwindow.width; x++)
+         dest[x] = r_tcbasepal[colour];
+   }
+}
+
+//
+// R_TCFrameReady
+//
+// True if the frame about to be presented has a 32-bit view.
+//
+bool R_TCFrameReady()
+{
+   return tcready && tcwidth == video.width && tcheight == video.height;
+}
+
+//
+// R_TCBlitFrame
+//
+// Converts the 8-bit screen to 0xAARRGGBB pixels for presentation, taking
+// the view tiles nothing was drawn over from the 32-bit buffer. The source
+// pitch is in bytes and the destination pitch in pixels.
+//
+void R_TCBlitFrame(const byte *src, int srcpitch, uint32_t *dest,
+                   int destpitch)
+{
+   bool view = R_TCFrameReady();
+
+   // a view left over from an earlier frame goes out in 8 bits, like the rest
+   // of the screen drawn since
+   if(!view)
+      R_TCCoverAll();
+
+   for(int y = 0; y < video.height; y++, src += srcpitch, dest += destpitch)
+   {
+      int x = 0;
+
+      if(view && y >= tcviewy && y < tcviewy + tcviewheight)
+      {
+         const uint32_t *rgb   = r_tcscreen + y * r_tcpitch;
+         const byte     *cover = tccover + ((y - tcviewy) >> TCTILESHIFT) * tctilesw;
+
+         for(; x < tcviewx; x++)
+            dest[x] = tcpalette[src[x]];
+
+         for(int tx = 0; tx < tctilesw; tx++)
+         {
+            int stop = tcviewx + emin((tx + 1) << TCTILESHIFT, tcviewwidth);
+
+            if(cover[tx])
+            {
+               for(; x < stop; x++)
+                  dest[x] = tcpalette[src[x]];
+            }
+            else
+            {
+               for(; x < stop; x++)
+               {
+                  uint32_t c = rgb[x];
+                  dest[x] = tcred[(c >> 16) & 0xff] | tcgreen[(c >> 8) & 0xff] |
+                            tcblue[c & 0xff];
+               }
+            }
+         }
+      }
+
+      for(; x < video.width; x++)
+         dest[x] = tcpalette[src[x]];
+   }
+
+   tcready = false;
+}
+
+//=============================================================================
+//
+// Blending
+//
+
+enum
+{
+   TC_OPAQUE, // replace the background
+   TC_SKY,    // replace the background, except with colour 0
+   TC_ALPHA,  // mix with the background
+   TC_ADD,    // add to the background
+   TC_SUB,    // subtract from the background
+};
+
+//
+// R_tcBlend
+//
+// Combines a foreground pixel with the background. alpha runs from 0 to 256.
+//
+template<int blend>
+static inline uint32_t R_tcBlend(uint32_t fg, uint32_t bg, unsigned int alpha)
+{
+   if(blend == TC_ALPHA)
+   {
+      uint32_t rb = ((fg & 0xff00ff) * alpha + (bg & 0xff00ff) * (256 - alpha)) >> 8;
+      uint32_t g  = ((fg & 0x00ff00) * alpha + (bg & 0x00ff00) * (256 - alpha)) >> 8;
+
+      return 0xff000000u | (rb & 0xff00ff) | (g & 0x00ff00);
+   }
+   else if(blend == TC_ADD)
+   {
+      unsigned int r = (((fg >> 16) & 0xff) * alpha >> 8) + ((bg >> 16) & 0xff);
+      unsigned int g = (((fg >>  8) & 0xff) * alpha >> 8) + ((bg >>  8) & 0xff);
+      unsigned int b = (( fg        & 0xff) * alpha >> 8) + ( bg        & 0xff);
+
+      return 0xff000000u | (emin(r, 255u) << 16) | (emin(g, 255u) << 8) |
+             emin(b, 255u);
+   }
+   else if(blend == TC_SUB)
+   {
+      int r = int((bg >> 16) & 0xff) - int(((fg >> 16) & 0xff) * alpha >> 8);
+      int g = int((bg >>  8) & 0xff) - int(((fg >>  8) & 0xff) * alpha >> 8);
+      int b = int( bg        & 0xff) - int(( fg        & 0xff) * alpha >> 8);
+
+      return 0xff000000u | (emax(r, 0) << 16) | (emax(g, 0) << 8) | emax(b, 0);
+   }
+   else
+      return fg;
+}
+
+//
+// R_tcPut
+//
+// Lights and stores one texel.
+//
+template<bool translated, int blend>
+static inline void R_tcPut(uint32_t *dest, byte texel,
+                           const lighttable_t *colormap,
+                           const byte *translation, unsigned int alpha)
+{
+   if(blend == TC_SKY && !texel)
+      return;
+   if(translated)
+      texel = translation[texel];
+
+   *dest = R_tcBlend<blend>(r_tcbasepal[colormap[texel]], *dest, alpha);
+}
+
+//
+// R_tcFilterAlpha
+//
+// Drawers which would use a TRANMAP blend by tran_filter_pct instead, which
+// only differs from the BOOM lump for WADs that replace TRANMAP.
+//
+static inline unsigned int R_tcFilterAlpha()
+{
+   return unsigned(tran_filter_pct * 256 / 100);
+}
+
+//
+// R_tcLevelAlpha
+//
+static inline unsigned int R_tcLevelAlpha(fixed_t translevel)
+{
+   return unsigned(eclamp(translevel, 0, FRACUNIT)) >> 8;
+}
+
+//=============================================================================
+//
+// Column Drawers
+//
+
+//
+// R_tcColumn
+//
+// The column loop shared by the drawers below.
+//
+template<bool translated, int blend>
+static void R_tcColumn(unsigned int alpha)
+{
+   int count = column.y2 - column.y1 + 1;
+   if(count <= 0)
+      return;
+
+#ifdef RANGECHECK
+   if(column.x  < 0 || column.x  >= video.width ||
+      column.y1 < 0 || column.y2 >= video.height)
+      I_Error("R_tcColumn: %i to %i at %i\n", column.y1, column.y2, column.x);
+#endif
+
+   uint32_t *dest     = R_TCADDRESS(column.x, column.y1);
+   fixed_t   fracstep = column.step;
+   fixed_t   frac     = column.texmid +
+                        (int)((column.y1 - view.ycenter + 1) * fracstep);
+
+   const byte *source = static_cast<const byte *>(column.source);
+   const lighttable_t *colormap = column.colormap;
+   const byte *translation = column.translation;
+   int heightmask = column.texheight - 1;
+
+   if(column.texheight & heightmask)
+   {
+      heightmask++;
+      heightmask <<= FRACBITS;
+
+      if(frac < 0)
+         while((frac += heightmask) < 0);
+      else
+         while(frac >= heightmask)
+            frac -= heightmask;
+
+      do
+      {
+         R_tcPut<translated, blend>(dest, source[frac >> FRACBITS], colormap,
+                                    translation, alpha);
+         dest += r_tcpitch;
+         if((frac += fracstep) >= heightmask)
+            frac -= heightmask;
+      }
+      while(--count);
+   }
+   else
+   {
+      do
+      {
+         R_tcPut<translated, blend>(dest, source[(frac >> FRACBITS) & heightmask],
+                                    colormap, translation, alpha);
+         dest += r_tcpitch;
+         frac += fracstep;
+      }
+      while(--count);
+   }
+}
+
+static void R_tcDrawColumn()
+{
+   R_tcColumn<false, TC_OPAQUE>(0);
+}
+
+static void R_tcDrawNewSkyColumn()
+{
+   R_tcColumn<false, TC_SKY>(0);
+}
+
+static void R_tcDrawTRColumn()
+{
+   R_tcColumn<true, TC_OPAQUE>(0);
+}
+
+static void R_tcDrawTLColumn()
+{
+   if(tranmap == main_submap)
+      R_tcColumn<false, TC_SUB>(256);
+   else
+      R_tcColumn<false, TC_ALPHA>(R_tcFilterAlpha());
+}
+
+static void R_tcDrawTLTRColumn()
+{
+   if(tranmap == main_submap)
+      R_tcColumn<true, TC_SUB>(256);
+   else
+      R_tcColumn<true, TC_ALPHA>(R_tcFilterAlpha());
+}
+
+static void R_tcDrawFlexColumn()
+{
+   R_tcColumn<false, TC_ALPHA>(R_tcLevelAlpha(column.translevel));
+}
+
+static void R_tcDrawFlexTRColumn()
+{
+   R_tcColumn<true, TC_ALPHA>(R_tcLevelAlpha(column.translevel));
+}
+
+static void R_tcDrawAddColumn()
+{
+   R_tcColumn<false, TC_ADD>(R_tcLevelAlpha(column.translevel));
+}
+
+static void R_tcDrawAddTRColumn()
+{
+   R_tcColumn<true, TC_ADD>(R_tcLevelAlpha(column.translevel));
+}
+
+//
+// R_tcDrawFuzzColumn
+//
+// Darkens a neighbouring pixel by as much as light level 6 of COLORMAP does.
+//
+static void R_tcDrawFuzzColumn()
+{
+   if(!column.y1)
+      column.y1 = 1;
+   if(column.y2 == viewwindow.height - 1)
+      column.y2 = viewwindow.height - 2;
+
+   int count = column.y2 - column.y1 + 1;
+   if(count <= 0)
+      return;
+
+#ifdef RANGECHECK
+   if(column.x  < 0 || column.x  >= video.width ||
+      column.y1 < 0 || column.y2 >= video.height)
+      I_Error("R_tcDrawFuzzColumn: %i to %i at %i\n", column.y1, column.y2, column.x);
+#endif
+
+   uint32_t *dest = R_TCADDRESS(column.x, column.y1);
+
+   do
+   {
+      uint32_t c = dest[fuzzoffset[fuzzpos] ? r_tcpitch : -r_tcpitch];
+
+      *dest = 0xff000000u | ((((c & 0xff00ff) * 208) >> 8) & 0xff00ff) |
+                            ((((c & 0x00ff00) * 208) >> 8) & 0x00ff00);
+      if(++fuzzpos == FUZZTABLE)
+         fuzzpos = 0;
+      dest += r_tcpitch;
+   }
+   while(--count);
+}
+
+columndrawer_t r_tc_drawer =
+{
+   R_tcDrawColumn,
+   R_tcDrawNewSkyColumn,
+   R_tcDrawTLColumn,
+   R_tcDrawTRColumn,
+   R_tcDrawTLTRColumn,
+   R_tcDrawFuzzColumn,
+   R_tcDrawFlexColumn,
+   R_tcDrawFlexTRColumn,
+   R_tcDrawAddColumn,
+   R_tcDrawAddTRColumn,
+
+   NULL,
+
+   {
+      // Normal               Translated
+      { R_tcDrawColumn,     R_tcDrawTRColumn     }, // NORMAL
+      { R_tcDrawFuzzColumn, R_tcDrawFuzzColumn   }, // SHADOW
+      { R_tcDrawFlexColumn, R_tcDrawFlexTRColumn }, // ALPHA
+      { R_tcDrawAddColumn,  R_tcDrawAddTRColumn  }, // ADD
+      { R_tcDrawTLColumn,   R_tcDrawTLTRColumn   }, // SUB
+      { R_tcDrawTLColumn,   R_tcDrawTLTRColumn   }, // TRANMAP
+   },
+};
+
+//=============================================================================
+//
+// Span Drawers
+//
+
+//
+// R_tcSpan
+//
+// The span loop; the flat size specific drawers pass constants in.
+//
+template<int blend>
+static inline void R_tcSpan(unsigned int xshift, unsigned int yshift,
+                            unsigned int xmask)
+{
+   unsigned int xf = span.xfrac, xs = span.xstep;
+   unsigned int yf = span.yfrac, ys = span.ystep;
+   const lighttable_t *colormap = span.colormap;
+   unsigned int alpha = span.alpha;
+   int count = span.x2 - span.x1 + 1;
+
+   const byte *source = static_cast<const byte *>(span.source);
+   uint32_t   *dest   = R_TCADDRESS(span.x1, span.y);
+
+   while(count-- > 0)
+   {
+      R_tcPut<false, blend>(dest++, source[((xf >> xshift) & xmask) | (yf >> yshift)],
+                            colormap, NULL, alpha);
+      xf += xs;
+      yf += ys;
+   }
+}
+
+template<int xshift, int yshift, int xmask, int blend>
+static void R_tcDrawSpan()
+{
+   R_tcSpan<blend>(xshift, yshift, xmask);
+}
+
+template<int blend>
+static void R_tcDrawSpan_GEN()
+{
+   R_tcSpan<blend>(span.xshift, span.yshift, span.xmask);
+}
+
+#define SPANJUMP 16
+
+//
+// R_tcSlope
+//
+// Sloped spans, perspective correct every SPANJUMP pixels and lit per pixel.
+//
+static inline void R_tcSlope(unsigned int xshift, unsigned int xmask,
+                             unsigned int ymask)
+{
+   double iu  = slopespan.iufrac, iv  = slopespan.ivfrac;
+   double ius = slopespan.iustep, ivs = slopespan.ivstep;
+   double id  = slopespan.idfrac, ids = slopespan.idstep;
+
+   lighttable_t **colormaps = slopespan.colormap;
+   int count;
+
+   if((count = slopespan.x2 - slopespan.x1 + 1) < 0)
+      return;
+
+   const byte *src  = static_cast<const byte *>(slopespan.source);
+   uint32_t   *dest = R_TCADDRESS(slopespan.x1, slopespan.y);
+
+   while(count > 0)
+   {
+      int incount = emin(count, SPANJUMP);
+
+      double mulstart = 65536.0f / id;
+      id += ids * incount;
+      double mulend = 65536.0f / id;
+
+      double ustart = iu * mulstart, vstart = iv * mulstart;
+      iu += ius * incount;
+      iv += ivs * incount;
+      double uend = iu * mulend, vend = iv * mulend;
+
+      unsigned int ufrac = (int)ustart, vfrac = (int)vstart;
+      unsigned int ustep = (int)((uend - ustart) / incount);
+      unsigned int vstep = (int)((vend - vstart) / incount);
+
+      count -= incount;
+      while(incount--)
+      {
+         const lighttable_t *colormap = *colormaps++;
+
+         *dest++ = r_tcbasepal[colormap[src[((vfrac >> xshift) & xmask) |
+                                            ((ufrac >> 16) & ymask)]]];
+         ufrac += ustep;
+         vfrac += vstep;
+      }
+   }
+}
+
+#undef SPANJUMP
+
+template<int xshift, int xmask, int ymask>
+static void R_tcDrawSlope()
+{
+   R_tcSlope(xshift, xmask, ymask);
+}
+
+static void R_tcDrawSlope_GEN()
+{
+   R_tcSlope(span.xshift, span.xmask, span.ymask);
+}
+
+spandrawer_t r_tcspandrawer =
+{
+   // Orthogonal span drawers
+   {
+      // Solid
+      {
+         R_tcDrawSpan<20, 26, 0x00FC0, TC_OPAQUE>, // 64x64
+         R_tcDrawSpan<18, 25, 0x03F80, TC_OPAQUE>, // 128x128
+         R_tcDrawSpan<16, 24, 0x0FF00, TC_OPAQUE>, // 256x256
+         R_tcDrawSpan<14, 23, 0x3FE00, TC_OPAQUE>, // 512x512
+         R_tcDrawSpan_GEN<TC_OPAQUE>               // General
+      },
+      // Translucent
+      {
+         R_tcDrawSpan<20, 26, 0x00FC0, TC_ALPHA>,  // 64x64
+         R_tcDrawSpan<18, 25, 0x03F80, TC_ALPHA>,  // 128x128
+         R_tcDrawSpan<16, 24, 0x0FF00, TC_ALPHA>,  // 256x256
+         R_tcDrawSpan<14, 23, 0x3FE00, TC_ALPHA>,  // 512x512
+         R_tcDrawSpan_GEN<TC_ALPHA>                // General
+      },
+      // Additive
+      {
+         R_tcDrawSpan<20, 26, 0x00FC0, TC_ADD>,    // 64x64
+         R_tcDrawSpan<18, 25, 0x03F80, TC_ADD>,    // 128x128
+         R_tcDrawSpan<16, 24, 0x0FF00, TC_ADD>,    // 256x256
+         R_tcDrawSpan<14, 23, 0x3FE00, TC_ADD>,    // 512x512
+         R_tcDrawSpan_GEN<TC_ADD>                  // General
+      }
+   },
+
+   // Sloped span drawers; like the 8-bit ones, these are all opaque for now
+   {
+      {
+         R_tcDrawSlope<10, 0x00FC0, 0x03F>,        // 64x64
+         R_tcDrawSlope< 9, 0x03F80, 0x07F>,        // 128x128
+         R_tcDrawSlope< 8, 0x0FF00, 0x0FF>,        // 256x256
+         R_tcDrawSlope< 7, 0x3FE00, 0x1FF>,        // 512x512
+         R_tcDrawSlope_GEN                         // General
+      },
+      {
+         R_tcDrawSlope<10, 0x00FC0, 0x03F>,
+         R_tcDrawSlope< 9, 0x03F80, 0x07F>,
+         R_tcDrawSlope< 8, 0x0FF00, 0x0FF>,
+         R_tcDrawSlope< 7, 0x3FE00, 0x1FF>,
+         R_tcDrawSlope_GEN
+      },
+      {
+         R_tcDrawSlope<10, 0x00FC0, 0x03F>,
+         R_tcDrawSlope< 9, 0x03F80, 0x07F>,
+         R_tcDrawSlope< 8, 0x0FF00, 0x0FF>,
+         R_tcDrawSlope< 7, 0x3FE00, 0x1FF>,
+         R_tcDrawSlope_GEN
+      }
+   }
+};
+
+//=============================================================================
+//
+// Particles
+//
+
+//
+// R_TCDrawParticleRect
+//
+// As R_DrawParticleRect, with the translucency level out of 64.
+//
+void R_TCDrawParticleRect(int x1, int x2, int yl, int yh, byte color,
+                          int level)
+{
+   uint32_t     fg    = r_tcbasepal[color];
+   unsigned int alpha = unsigned(eclamp(level, 0, 64)) << 2;
+
+   for(int y = yl; y <= yh; y++)
+   {
+      uint32_t *dest = R_TCADDRESS(x1, y);
+
+      for(int x = x1; x <= x2; x++, dest++)
+      {
+         if(alpha < 256)
+            *dest = R_tcBlend<TC_ALPHA>(fg, *dest, alpha);
+         else
+            *dest = fg;
+      }
+   }
+}
+
+//=============================================================================
+//
+// Console Variables
+//
+
+VARIABLE_TOGGLE(r_truecolor, NULL, onoff);
+CONSOLE_VARIABLE(r_truecolor, r_truecolor, 0)
+{
+   if(!r_truecolor)
+   {
+      R_tcFreeBuffers();
+
+      // r_tranpct was changed while the 8-bit drawers were not in use
+      if(r_tcstaletrans)
+      {
+         r_tcstaletrans = false;
+         R_ResetTrans();
+      }
+   }
+}
+
+// EOF
+
@@ -0,0 +1,94 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// Copyright (C) 2013 James Haley et al.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+// Additional terms and conditions compatible with the GPLv3 apply. See the
+// file COPYING-EE for details.
+//
+//--------------------------------------------------------------------------
+//
+// DESCRIPTION:
+//      32-bit rendering of the player view.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef R_TRUECOLOR_H__
+#define R_TRUECOLOR_H__
+
+#include "doomtype.h"
+
+struct columndrawer_t;
+struct spandrawer_t;
+
+extern bool r_truecolor;  // render the view in 32-bit colour
+extern bool r_tcactive;   // the view being drawn goes to r_tcscreen
+
+// TRANMAP is out of date with tran_filter_pct, which was changed while only
+// the 32-bit drawers were in use
+extern bool r_tcstaletrans;
+
+// a finished 32-bit view is waiting to be put into the 8-bit screen
+extern bool r_tcpending;
+
+// 0xAARRGGBB view buffer, the size of the screen, r_tcpitch pixels per row
+extern uint32_t *r_tcscreen;
+extern int       r_tcpitch;
+
+// PLAYPAL, as 0xAARRGGBB without gamma; indexed by the output of a colormap
+extern uint32_t r_tcbasepal[256];
+
+extern columndrawer_t r_tc_drawer;
+extern spandrawer_t   r_tcspandrawer;
+
+#define R_TCADDRESS(px, py) \
+   (r_tcscreen + (viewwindow.y + (py)) * r_tcpitch + (viewwindow.x + (px)))
+
+void R_TCInit();
+void R_TCSetPalette(const byte *palette);
+
+void R_TCBeginView();
+void R_TCEndView();
+
+void R_TCCoverArea(const byte *dest, int width, int height, bool opaque);
+void R_TCCoverAll();
+
+//
+// R_TCCover
+//
+// Must be called before 2D drawing reads or writes an area of the screen,
+// given by its top left pixel and size. Quantizes any of the 32-bit view
+// still under it into the screen. Pointers into other buffers are ignored.
+//
+inline void R_TCCover(const byte *dest, int width, int height,
+                      bool opaque = false)
+{
+   if(r_tcpending)
+      R_TCCoverArea(dest, width, height, opaque);
+}
+
+void R_TCFillView(byte colour);
+void R_TCDrawParticleRect(int x1, int x2, int yl, int yh, byte color,
+                          int level);
+
+bool R_TCFrameReady();
+void R_TCBlitFrame(const byte *src, int srcpitch, uint32_t *dest,
+                   int destpitch);
+
+#endif
+
+// EOF
+
@@ -32,6 +32,7 @@
 #include "../z_zone.h"
 #include "../d_main.h"
 #include "../i_system.h"
+#include "../r_truecolor.h"
 #include "../v_misc.h"
 #include "../v_video.h"
 #include "../version.h"
@@ -155,6 +156,14 @@ void SDLGL2DVideoDriver::DrawPixels(void *buffer, unsigned int destwidth)
 {
    Uint32 *fb = static_cast<Uint32 *>(buffer);
 
+   // the 32-bit view is composited with the rest of the screen
+   if(R_TCFrameReady())
+   {
+      R_TCBlitFrame(static_cast<byte *>(screen->pixels), screen->pitch, fb,
+                    static_cast<int>(destwidth));
+      return;
+   }
+
    for(int y = 0; y < screen->h; y++)
    {
       byte   *src  = static_cast<byte *>(screen->pixels) + y * screen->pitch;
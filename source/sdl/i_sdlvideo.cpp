@@ -33,6 +33,7 @@
 #include "../i_system.h"
 #include "../m_argv.h"
 #include "../m_misc.h"
+#include "../r_truecolor.h"
 #include "../v_misc.h"
 #include "../v_video.h"
 #include "../version.h"
@@ -58,6 +59,7 @@ void UpdateFocus(SDL_Window *window);
 
 static SDL_Surface  *primary_surface;
 static SDL_Surface  *rgba_surface;
+static SDL_Surface  *truecolor_surface; // ARGB8888 staging for 32-bit views
 static SDL_Texture  *sdltexture; // the texture to use for rendering
 static SDL_Renderer *renderer;
 static SDL_Rect     *destrect;
@@ -78,6 +80,43 @@ extern char *i_videomode;
 // MaxW: 2017/10/20: display number
 int displaynum = 0;
 
+//
+// I_SDLBlitTrueColor
+//
+// Composites a frame with a 32-bit view into rgba_surface. Surfaces with some
+// other layout than 0xAARRGGBB get a converting blit from a staging surface.
+//
+static void I_SDLBlitTrueColor()
+{
+   const byte *src = static_cast<byte *>(primary_surface->pixels);
+   Uint32 format = rgba_surface->format->format;
+
+   if(format == SDL_PIXELFORMAT_ARGB8888 || format == SDL_PIXELFORMAT_RGB888)
+   {
+      R_TCBlitFrame(src, primary_surface->pitch,
+                    static_cast<uint32_t *>(rgba_surface->pixels),
+                    rgba_surface->pitch / 4);
+      return;
+   }
+
+   if(!truecolor_surface)
+   {
+      truecolor_surface = SDL_CreateRGBSurfaceWithFormat(0, rgba_surface->w,
+                                                         rgba_surface->h, 0,
+                                                         SDL_PIXELFORMAT_ARGB8888);
+      if(!truecolor_surface)
+      {
+         SDL_BlitSurface(primary_surface, nullptr, rgba_surface, nullptr);
+         return;
+      }
+   }
+
+   R_TCBlitFrame(src, primary_surface->pitch,
+                 static_cast<uint32_t *>(truecolor_surface->pixels),
+                 truecolor_surface->pitch / 4);
+   SDL_BlitSurface(truecolor_surface, nullptr, rgba_surface, nullptr);
+}
+
 //
 // SDLVideoDriver::FinishUpdate
 //
@@ -106,7 +145,10 @@ void SDLVideoDriver::FinishUpdate()
    if(primary_surface)
    {
       // Don't bother checking for errors. It should just cancel itself in that case.
-      SDL_BlitSurface(primary_surface, nullptr, rgba_surface, nullptr);
+      if(R_TCFrameReady())
+         I_SDLBlitTrueColor();
+      else
+         SDL_BlitSurface(primary_surface, nullptr, rgba_surface, nullptr);
       SDL_UpdateTexture(sdltexture, nullptr, rgba_surface->pixels, rgba_surface->pitch);
       SDL_RenderCopy(renderer, sdltexture, nullptr, destrect);
    }
@@ -197,6 +239,11 @@ void SDLVideoDriver::UnsetPrimaryBuffer()
       SDL_FreeSurface(rgba_surface);
       rgba_surface = nullptr;
    }
+   if(truecolor_surface)
+   {
+      SDL_FreeSurface(truecolor_surface);
+      truecolor_surface = nullptr;
+   }
    if(primary_surface)
    {
       SDL_FreeSurface(primary_surface);
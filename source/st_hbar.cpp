@@ -33,6 +33,7 @@
 #include "m_swap.h"
 #include "metaapi.h"
 #include "p_mobj.h"
+#include "r_truecolor.h"
 #include "v_patchfmt.h"
 #include "v_video.h"
 #include "w_wad.h"
@@ -287,6 +288,8 @@ static void ST_BlockDrawerS(int x, int y, int startcmap, int mapdir)
 
    dest = subscreen43.data + realy * subscreen43.pitch + realx;
 
+   R_TCCover(dest, w, h);
+
    mapstep = mapdir * (16 << FRACBITS) / w;
 
 #ifdef RANGECHECK
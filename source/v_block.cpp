@@ -27,6 +27,7 @@
 
 #include "i_system.h"
 #include "m_compare.h"
+#include "r_truecolor.h"
 #include "v_video.h"
 
 //==============================================================================
@@ -76,6 +77,8 @@ static void V_BlockDrawer(int x, int y, VBuffer *buffer,
    src  = source + dy * width + dx;
    dest = VBADDRESS(buffer, cx1, cy1);
 
+   R_TCCover(dest, cw, ch, true);
+
    while(ch--)
    {
       memcpy(dest, src, cw);
@@ -133,6 +136,8 @@ static void V_BlockDrawerS(int x, int y, VBuffer *buffer,
    src  = source + dy * width + dx;
    dest = VBADDRESS(buffer, realx, realy);
 
+   R_TCCover(dest, w, h, true);
+
 #ifdef RANGECHECK
    // sanity check
    if(realx < 0 || realx + w > buffer->width ||
@@ -208,6 +213,8 @@ static void V_MaskedBlockDrawer(int x, int y, VBuffer *buffer,
    src  = source + dy * srcpitch + dx;
    dest = VBADDRESS(buffer, cx1, cy1);
 
+   R_TCCover(dest, cw, ch);
+
    while(ch--)
    {
       for(i = 0; i < cw; ++i)
@@ -270,6 +277,8 @@ static void V_MaskedBlockDrawerS(int x, int y, VBuffer *buffer,
    src  = source + dy * srcpitch + dx;
    dest = VBADDRESS(buffer, realx, realy);
 
+   R_TCCover(dest, w, h);
+
 #ifdef RANGECHECK
    // sanity check
    if(realx < 0 || realx + w > buffer->width ||
@@ -341,6 +350,8 @@ void V_ColorBlockScaled(VBuffer *dest, byte color, int x, int y, int w, int h)
    d    = VBADDRESS(dest, x, y);
    size = w;
 
+   R_TCCover(d, w, h, true);
+
    for(i = 0; i < h; i++)
    {
       memset(d, color, size);
@@ -399,6 +410,8 @@ void V_ColorBlockTLScaled(VBuffer *dest, byte color, int x, int y, int w, int h,
 
    d = VBADDRESS(dest, x, y);
 
+   R_TCCover(d, w, h);
+
    for(i = 0; i < h; i++)
    {
       row = d;
@@ -429,6 +442,8 @@ void V_ColorBlock(VBuffer *buffer, byte color, int x, int y, int w, int h)
 #endif
 
    dest = VBADDRESS(buffer, x, y);
+
+   R_TCCover(dest, w, h, true);
    
    while(h--)
    {
@@ -470,6 +485,8 @@ void V_ColorBlockTL(VBuffer *buffer, byte color, int x, int y,
    bg2rgb  = Col2RGB8[bglevel >> 10];
 
    dest = VBADDRESS(buffer, x, y);
+
+   R_TCCover(dest, w, h);
    
    while(h--)
    { 
@@ -501,6 +518,8 @@ static void V_TileBlock64(VBuffer *buffer, byte *src)
    byte *row, *dest = buffer->data;
    int wmod;
 
+   R_TCCover(dest, buffer->width, buffer->height, true);
+
    // if width % 64 != 0, we must do some extra copying at the end
    if((wmod = buffer->width & 63))
    {
@@ -547,6 +566,8 @@ static void V_TileBlock64S(VBuffer *buffer, byte *src)
    
    dest = buffer->data;
 
+   R_TCCover(dest, w, h, true);
+
    while(h--)
    {
       int i = w;
@@ -583,6 +604,8 @@ void V_FillBuffer(VBuffer *buffer, byte *src, int texw, int texh)
    fixed_t  xfrac, yfrac = 0;
    int      xtex, ytex;
 
+   R_TCCover(dest, w, h, true);
+
    while(h--)
    {
       int x = w;
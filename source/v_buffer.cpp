@@ -34,6 +34,7 @@
 #include "v_misc.h"
 #include "v_patch.h"
 #include "r_state.h"
+#include "r_truecolor.h"
 
 //
 // VB_AllocateData
@@ -428,6 +429,9 @@ void V_BlitVBuffer(VBuffer *dest, int dx, int dy, VBuffer *src,
    dbuf = dest->data + (dpitch * dy) + dx;
    sbuf = src->data + (spitch * sy) + sx;
 
+   R_TCCover(sbuf, slice, i);
+   R_TCCover(dbuf, slice, i, true);
+
    while(i--)
    {
       memcpy(dbuf, sbuf, slice);
@@ -30,6 +30,7 @@
 #include "m_collection.h"
 #include "m_swap.h"
 #include "r_patch.h"
+#include "r_truecolor.h"
 #include "v_block.h"
 #include "v_misc.h"
 #include "v_patchfmt.h"
@@ -488,6 +489,9 @@ static void V_DrawMaskedColumn(column_t *column)
       // killough 3/2/98, 3/27/98: Failsafe against overflow/crash:
       if(patchcol.y1 <= patchcol.y2 && patchcol.y2 < patchcol.buffer->height)
       {
+         R_TCCover(VBADDRESS(patchcol.buffer, patchcol.x, patchcol.y1), 1,
+                   patchcol.y2 - patchcol.y1 + 1);
+
          patchcol.source = (byte *)column + 3;
          patchcol.colfunc();
       }
@@ -521,6 +525,9 @@ static void V_DrawMaskedColumnUnscaled(column_t *column)
       // killough 3/2/98, 3/27/98: Failsafe against overflow/crash:
       if(patchcol.y1 <= patchcol.y2 && patchcol.y2 < patchcol.buffer->height)
       {
+         R_TCCover(VBADDRESS(patchcol.buffer, patchcol.x, patchcol.y1), 1,
+                   patchcol.y2 - patchcol.y1 + 1);
+
          patchcol.source = (byte *)column + 3;
          patchcol.colfunc();
       }
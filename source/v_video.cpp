@@ -36,6 +36,7 @@
 #include "m_bbox.h"
 #include "r_draw.h"
 #include "r_main.h"
+#include "r_truecolor.h"
 #include "v_block.h"
 #include "v_misc.h"
 #include "v_patchfmt.h"
@@ -367,6 +368,9 @@ void V_CopyRect(int srcx, int srcy, VBuffer *src, int width,
       useh = (srcrect.ch < dstrect.ch ? srcrect.ch : dstrect.ch);
    }
 
+   R_TCCover(srcp, usew, useh);
+   R_TCCover(dstp, usew, useh, true);
+
    // block copy
    if(src->pitch == dest->pitch && usew == src->width && usew == dest->width)
    {
@@ -38,6 +38,7 @@
 #include "doomtype.h"
 #include "e_hash.h"
 #include "g_game.h"
+#include "m_compare.h"
 #include "m_dllist.h"
 #include "m_utils.h"
 #include "mn_engin.h"
@@ -759,5 +760,19 @@ CONSOLE_COMMAND(w_writelump, 0)
    wGlobalDir.writeLump(lumpname, filename.constPtr());
 }
 
+// Time lump name lookups in a large made-up directory
+CONSOLE_COMMAND(w_benchlookup, 0)
+{
+   int numlumps   = 100000;
+   int numlookups = 1000000;
+
+   if(Console.argc >= 1)
+      numlumps = emax(Console.argv[0]->toInt(), 1);
+   if(Console.argc >= 2)
+      numlookups = emax(Console.argv[1]->toInt(), 1);
+
+   W_BenchLumpLookups(numlumps, numlookups);
+}
+
 // EOF
 
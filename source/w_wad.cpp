@@ -35,16 +35,20 @@
 #include "d_io.h"  // SoM 3/12/2002: moved unistd stuff into d_io.h
 
 #include "c_io.h"
+#include "d_bench.h"
 #include "d_dehtbl.h"
 #include "d_files.h"
 #include "e_hash.h"
 #include "hal/i_directory.h"
+#include "hal/i_filemap.h"
 #include "m_argv.h"
 #include "m_collection.h"
+#include "m_compare.h"
 #include "m_dllist.h"
 #include "m_hash.h"
 #include "m_qstr.h"
 #include "m_swap.h"
+#include "m_threads.h"
 #include "m_utils.h"
 #include "p_skin.h"
 #include "s_sound.h"
@@ -88,6 +92,7 @@ static size_t W_DirectReadLump(lumpinfo_t *, void *);
 static size_t W_MemoryReadLump(lumpinfo_t *, void *);
 static size_t W_FileReadLump  (lumpinfo_t *, void *);
 static size_t W_ZipReadLump   (lumpinfo_t *, void *);
+static size_t W_MappedReadLump(lumpinfo_t *, void *);
 
 static lumptype_t LumpHandlers[lumpinfo_t::lump_numtypes] =
 {
@@ -110,8 +115,65 @@ static lumptype_t LumpHandlers[lumpinfo_t::lump_numtypes] =
    {
       W_ZipReadLump,
    },
+
+   // mapped file lump
+   {
+      W_MappedReadLump,
+   },
+};
+
+//=============================================================================
+//
+// Lump Name Indices
+//
+// Names are looked up in open-addressing tables rather than by walking the
+// hash chains. A lump name is packed uppercase into one 64-bit word, so each
+// probe is a single compare, and the namespace is part of the key so that
+// lumps of other namespaces are never probed. The later of two lumps with the
+// same key replaces the earlier, observing pwad ordering rules. The chains
+// are still kept for code which walks all lumps of a name.
+//
+
+struct lumpslot_t
+{
+   uint64_t name;         // packed uppercase name
+   int      li_namespace;
+   int      lumpnum;      // -1 if the slot is empty
 };
 
+struct lfnslot_t
+{
+   unsigned int hashcode; // of the long file name; saves most string compares
+   int          li_namespace;
+   int          lumpnum;  // -1 if the slot is empty
+};
+
+//
+// W_packLumpName
+//
+// Packs up to 8 characters of a lump name into a word, uppercased and padded
+// with zeroes, so that it compares like strncasecmp(a, b, 8) does.
+//
+static uint64_t W_packLumpName(const char *name)
+{
+   uint64_t packed = 0;
+
+   for(int i = 0; i < 8 && name[i]; i++)
+      packed |= static_cast<uint64_t>(static_cast<byte>(ectype::toUpper(name[i]))) << (i * 8);
+
+   return packed;
+}
+
+//
+// W_slotHash
+//
+// Mixes a key and a namespace into an index into a table of lump slots.
+//
+static unsigned int W_slotHash(uint64_t key, int li_namespace)
+{
+   return static_cast<unsigned int>(((key + li_namespace) * 0x9E3779B97F4A7C15ull) >> 32);
+}
+
 //=============================================================================
 //
 // WadDirectoryPimpl
@@ -149,10 +211,168 @@ public:
 
    PODCollection<lumpinfo_t *>  infoptrs; // lumpinfo_t allocations
    DLListItem<ZipFile>         *zipFiles; // zip files attached to this waddir
+   PODCollection<filemap_t>     mappings; // wad files mapped into memory
+
+   lumpslot_t  *nameSlots; // index of lump names
+   lfnslot_t   *lfnSlots;  // index of long file names
+   unsigned int slotMask;  // number of slots in each index, less one
 
    WadDirectoryPimpl()
-      : ZoneObject(), infoptrs(), zipFiles(nullptr)
+      : ZoneObject(), infoptrs(), zipFiles(nullptr), mappings(),
+        nameSlots(nullptr), lfnSlots(nullptr), slotMask(0)
+   {
+   }
+
+   ~WadDirectoryPimpl()
+   {
+      freeIndices();
+   }
+
+   //
+   // Build the name indices, at no more than half load
+   //
+   void buildIndices(lumpinfo_t **lumpinfo, int numlumps)
+   {
+      unsigned int numslots = 16;
+
+      freeIndices();
+
+      while(numslots < 2 * static_cast<unsigned int>(numlumps))
+         numslots *= 2;
+      slotMask = numslots - 1;
+
+      nameSlots = estructalloc(lumpslot_t, numslots);
+      lfnSlots  = estructalloc(lfnslot_t,  numslots);
+      for(unsigned int i = 0; i < numslots; i++)
+         nameSlots[i].lumpnum = lfnSlots[i].lumpnum = -1;
+
+      for(int i = 0; i < numlumps; i++)
+      {
+         const lumpinfo_t *lump = lumpinfo[i];
+
+         if(lump->name[0])
+         {
+            uint64_t key = W_packLumpName(lump->name);
+            unsigned int slot = W_slotHash(key, lump->li_namespace) & slotMask;
+
+            while(nameSlots[slot].lumpnum >= 0 &&
+                  (nameSlots[slot].name != key ||
+                   nameSlots[slot].li_namespace != lump->li_namespace))
+               slot = (slot + 1) & slotMask;
+
+            nameSlots[slot].name         = key;
+            nameSlots[slot].li_namespace = lump->li_namespace;
+            nameSlots[slot].lumpnum      = i;
+         }
+
+         if(lump->lfn && *lump->lfn)
+         {
+            unsigned int hashcode = D_HashTableKeyCase(lump->lfn);
+            unsigned int slot = W_slotHash(hashcode, lump->li_namespace) & slotMask;
+
+            while(lfnSlots[slot].lumpnum >= 0 &&
+                  (lfnSlots[slot].hashcode != hashcode ||
+                   lfnSlots[slot].li_namespace != lump->li_namespace ||
+                   strcmp(lumpinfo[lfnSlots[slot].lumpnum]->lfn, lump->lfn)))
+               slot = (slot + 1) & slotMask;
+
+            lfnSlots[slot].hashcode     = hashcode;
+            lfnSlots[slot].li_namespace = lump->li_namespace;
+            lfnSlots[slot].lumpnum      = i;
+         }
+      }
+   }
+
+   //
+   // Free the name indices
+   //
+   void freeIndices()
+   {
+      if(nameSlots)
+         efree(nameSlots);
+      if(lfnSlots)
+         efree(lfnSlots);
+      nameSlots = nullptr;
+      lfnSlots  = nullptr;
+      slotMask  = 0;
+   }
+
+   //
+   // Find the last lump of a name in a namespace
+   //
+   int findName(const char *name, int li_namespace) const
+   {
+      if(!nameSlots)
+         return -1;
+
+      uint64_t key = W_packLumpName(name);
+
+      for(unsigned int slot = W_slotHash(key, li_namespace) & slotMask; ;
+          slot = (slot + 1) & slotMask)
+      {
+         const lumpslot_t &ls = nameSlots[slot];
+
+         if(ls.lumpnum < 0)
+            return -1;
+         if(ls.name == key && ls.li_namespace == li_namespace)
+            return ls.lumpnum;
+      }
+   }
+
+   //
+   // Find the last lump of a long file name in a namespace
+   //
+   int findLFN(lumpinfo_t **lumpinfo, const char *lfn, int li_namespace) const
    {
+      if(!lfnSlots)
+         return -1;
+
+      unsigned int hashcode = D_HashTableKeyCase(lfn);
+
+      for(unsigned int slot = W_slotHash(hashcode, li_namespace) & slotMask; ;
+          slot = (slot + 1) & slotMask)
+      {
+         const lfnslot_t &ls = lfnSlots[slot];
+
+         if(ls.lumpnum < 0)
+            return -1;
+         if(ls.hashcode == hashcode && ls.li_namespace == li_namespace &&
+            !strcmp(lumpinfo[ls.lumpnum]->lfn, lfn))
+            return ls.lumpnum;
+      }
+   }
+
+   //
+   // Map a wad file into memory, unless that can't be done or is disabled
+   //
+   bool mapFile(FILE *f, filemap_t &map)
+   {
+      // -nommap reads all wad lumps with stdio
+      if(M_CheckParm("-nommap") || !I_MapFile(f, map))
+         return false;
+
+      // the zone must know its lumps aren't blocks
+      if(!Z_AddMappedRange(map.base, map.size))
+      {
+         I_UnmapFile(map);
+         return false;
+      }
+
+      mappings.add(map);
+      return true;
+   }
+
+   //
+   // Unmap the wad files, once no lump in them is in use
+   //
+   void unmapFiles()
+   {
+      for(filemap_t &map : mappings)
+      {
+         Z_RemoveMappedRange(map.base);
+         I_UnmapFile(map);
+      }
+      mappings.clear();
    }
 };
 
@@ -422,6 +642,7 @@ bool WadDirectory::addWadFile(openwad_t &openData, const wfileadd_t &addInfo,
    bool         showHash = false;
    bool         doHacks  = (addInfo.flags & WFA_ALLOWHACKS) == WFA_ALLOWHACKS;
    long         baseoffset = static_cast<long>(addInfo.baseoffset);
+   filemap_t    map;
    wadinfo_t    header;
    ZAutoBuffer  fileinfo2free; // killough
    filelump_t  *fileinfo;
@@ -532,6 +753,10 @@ bool WadDirectory::addWadFile(openwad_t &openData, const wfileadd_t &addInfo,
    // Add lumpinfo_t's for all lumps in the wad file
    lump_p = reAllocLumpInfo(header.numlumps, startlump);
 
+   // Lumps are read straight out of the file mapped into memory if possible
+   if(!pImpl->mapFile(openData.handle, map))
+      map.base = nullptr;
+
    // Merge into the directory
    for(int i = startlump; i < this->numlumps; i++, lump_p++, fileinfo++)
    {
@@ -547,6 +772,15 @@ bool WadDirectory::addWadFile(openwad_t &openData, const wfileadd_t &addInfo,
       if(addInfo.flags & WFA_SUBFILE)
          lump_p->direct.position += static_cast<size_t>(baseoffset);
 
+      // lumps lying wholly inside the mapping are read from it
+      size_t position = lump_p->direct.position;
+      if(map.base && position <= map.size && lump_p->size <= map.size - position)
+      {
+         lump_p->type        = lumpinfo_t::lump_mapped;
+         lump_p->mapped.file = openData.handle;
+         lump_p->mapped.data = static_cast<const byte *>(map.base) + position;
+      }
+
       lump_p->li_namespace = addInfo.li_namespace;     // killough 4/17/98
 
       strncpy(lump_p->name, fileinfo->name, 8);
@@ -573,7 +807,7 @@ bool WadDirectory::addZipFile(openwad_t &openData,
    lumpinfo_t *lump_p;
 
    // Read in the ZIP file's header and directory information
-   if(!zip->readFromFile(openData.handle))
+   if(!zip->readFromFile(openData.handle, openData.filename))
    {
       handleOpenError(openData, addInfo, openData.filename);
       return false;
@@ -1254,26 +1488,13 @@ unsigned int WadDirectory::LumpNameHash(const char *s)
 //
 // haleyjd 03/01/09: added InDir version.
 //
+// The chains have since made way for the open-addressing index above, which
+// does pack the names, and looks up the namespace along with the name.
+//
 int WadDirectory::checkNumForName(const char *name, int li_namespace) const
 {
-   // Hash function maps the name to one of possibly numlump chains.
-   // It has been tuned so that the average chain length never exceeds 2.
-
-   unsigned int hashkey = LumpNameHash(name) % (unsigned int)numlumps;
-   int i = lumpinfo[hashkey]->index;
-
-   // We search along the chain until end, looking for case-insensitive
-   // matches which also match a namespace tag. Separate hash tables are
-   // not used for each namespace, because the performance benefit is not
-   // worth the overhead, considering namespace collisions are rare in
-   // Doom wads.
-
-   while(i >= 0 && (strncasecmp(lumpinfo[i]->name, name, 8) ||
-         lumpinfo[i]->li_namespace != li_namespace))
-      i = lumpinfo[i]->next;
-
    // Return the matching lump, or -1 if none found.
-   return i;
+   return pImpl->findName(name, li_namespace);
 }
 
 //
@@ -1361,12 +1582,7 @@ int W_GetNumForName(const char *name)
 //
 int WadDirectory::checkNumForLFN(const char *lfn, int li_namespace) const
 {
-   lumpinfo_t *currinfo = e_LFNHash.keyIterator(nullptr, lfn);
-
-   while(currinfo != nullptr && currinfo->li_namespace != li_namespace)
-       currinfo = e_LFNHash.keyIterator(currinfo, lfn);
-
-   return currinfo ? currinfo->selfindex : -1;
+   return pImpl->findLFN(lumpinfo, lfn, li_namespace);
 }
 
 //
@@ -1475,10 +1691,150 @@ void WadDirectory::initLumpHashes()
       if(lumpinfo[i]->lfn && *lumpinfo[i]->lfn)
          e_LFNHash.addObject(lumpinfo[i]);
    }
+
+   pImpl->buildIndices(lumpinfo, numlumps);
 }
 
 // End of lump hashing -- killough 1/31/98
 
+//=============================================================================
+//
+// Lookup Benchmark
+//
+
+//
+// A private directory of made-up lumps, for timing name lookups
+//
+class BenchWadDirectory : public WadDirectory
+{
+public:
+   //
+   // Make count lumps with names of 4 to 8 characters, spread over a few
+   // namespaces, from a fixed seed
+   //
+   void makeLumps(int count, unsigned int seed)
+   {
+      static const int namespaces[] =
+      {
+         lumpinfo_t::ns_global, lumpinfo_t::ns_global, lumpinfo_t::ns_sprites,
+         lumpinfo_t::ns_flats, lumpinfo_t::ns_textures, lumpinfo_t::ns_graphics,
+         lumpinfo_t::ns_sounds, lumpinfo_t::ns_global
+      };
+
+      lumpinfo_t *lumps = reAllocLumpInfo(count, 0);
+
+      for(int i = 0; i < count; i++)
+      {
+         MakeName(lumps[i].name, seed);
+         lumps[i].type         = lumpinfo_t::lump_memory;
+         lumps[i].li_namespace = namespaces[i % earrlen(namespaces)];
+      }
+
+      initLumpHashes();
+   }
+
+   //
+   // Make a name like makeLumps does
+   //
+   static void MakeName(char *name, unsigned int &seed)
+   {
+      static const char chars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_";
+
+      seed = seed * 1103515245 + 12345;
+      int len = 4 + (seed >> 16) % 5;
+
+      for(int c = 0; c < len; c++)
+      {
+         seed = seed * 1103515245 + 12345;
+         name[c] = chars[(seed >> 16) % (sizeof(chars) - 1)];
+      }
+      name[len] = '\0';
+   }
+
+   //
+   // Look a name up by walking its hash chain, as it was done before the
+   // open-addressing index
+   //
+   int checkNumForNameChained(const char *name, int li_namespace) const
+   {
+      int i = lumpinfo[LumpNameHash(name) % (unsigned int)numlumps]->index;
+
+      while(i >= 0 && (strncasecmp(lumpinfo[i]->name, name, 8) ||
+            lumpinfo[i]->li_namespace != li_namespace))
+         i = lumpinfo[i]->next;
+
+      return i;
+   }
+};
+
+//
+// W_BenchLumpLookups
+//
+// Times name lookups in a directory of numlumps made-up lumps, through the
+// hash chains and through the index, and prints both rates. Half the names
+// looked up are in the directory, though maybe not in the namespace asked.
+//
+void W_BenchLumpLookups(int numlumps, int numlookups)
+{
+   BenchWadDirectory dir;
+   PODCollection<char> names;
+   PODCollection<int>  spaces;
+   unsigned int seed = 1;
+   int64_t chainedtime, indextime;
+   int chainedhits = 0, indexhits = 0, mismatches = 0;
+
+   dir.makeLumps(numlumps, seed);
+
+   names.resize(numlookups * 9);
+   spaces.resize(numlookups);
+
+   // queries: every other one from the directory, the rest from elsewhere
+   for(int i = 0; i < numlookups; i++)
+   {
+      lumpinfo_t *lump = dir.getLumpInfo()[(i * 7919ull) % numlumps];
+
+      if(i & 1)
+         BenchWadDirectory::MakeName(&names[i * 9], seed);
+      else
+         strcpy(&names[i * 9], lump->name);
+      spaces[i] = (i % 3) ? lump->li_namespace : lumpinfo_t::ns_global;
+   }
+
+   int64_t start = D_BenchNow();
+   for(int i = 0; i < numlookups; i++)
+   {
+      if(dir.checkNumForNameChained(&names[i * 9], spaces[i]) >= 0)
+         ++chainedhits;
+   }
+   chainedtime = D_BenchNow() - start;
+
+   start = D_BenchNow();
+   for(int i = 0; i < numlookups; i++)
+   {
+      if(dir.checkNumForName(&names[i * 9], spaces[i]) >= 0)
+         ++indexhits;
+   }
+   indextime = D_BenchNow() - start;
+
+   for(int i = 0; i < numlookups; i++)
+   {
+      if(dir.checkNumForNameChained(&names[i * 9], spaces[i]) !=
+         dir.checkNumForName(&names[i * 9], spaces[i]))
+         ++mismatches;
+   }
+
+   dir.close();
+
+   C_Printf("%d lookups in %d lumps, %d found:\n", numlookups, numlumps,
+            indexhits);
+   C_Printf("  chained: %.1f ns/lookup\n",
+            static_cast<double>(chainedtime) / numlookups);
+   C_Printf("  index:   %.1f ns/lookup\n",
+            static_cast<double>(indextime) / numlookups);
+   if(mismatches || chainedhits != indexhits)
+      C_Printf(FC_ERROR "  %d lookups disagree\n", mismatches);
+}
+
 //
 // W_InitResources
 //
@@ -1577,6 +1933,306 @@ bool WadDirectory::addNewPrivateFile(const char *filename)
    return true;
 }
 
+//=============================================================================
+//
+// Asynchronous Prefetch
+//
+// Lumps given to prefetchLumps are read on an I/O thread into blocks of their
+// own, which are then taken over as the lumps' caches instead of being read a
+// second time. A lump wanted before its read has started is taken back and
+// read on the spot; one being read is waited for. Reads from files and
+// archives are serialized on wadiomutex, since all lumps of a file share its
+// FILE.
+//
+// Only the main thread queues, takes and claims prefetches; the I/O thread
+// only reads them.
+//
+
+#define PREFETCHPAGESIZE 4096
+
+enum
+{
+   PREFETCH_QUEUED,  // waiting for the I/O thread
+   PREFETCH_READING, // being read by the I/O thread
+   PREFETCH_DONE,    // read, and waiting to be taken or claimed
+   PREFETCH_TAKEN    // taken by the main thread; only waits to be freed
+};
+
+struct lumpprefetch_t
+{
+   lumpinfo_t *lump;
+   void       *data;  // the lump, PU_STATIC until it is taken or claimed
+   int         state;
+};
+
+static std::mutex              wadiomutex;
+static std::mutex              prefetchmutex;
+static std::condition_variable prefetchcond;
+
+// guarded by prefetchmutex
+static PODCollection<lumpprefetch_t *> prefetchqueue;
+static PODCollection<lumpprefetch_t *> prefetchdone;
+static size_t prefetchnext;     // next job in prefetchqueue for the I/O thread
+static bool   prefetchrunning;  // the I/O thread is at work
+
+static WorkerPool prefetchpool;
+
+//
+// W_prefetchRead
+//
+// Reads a queued lump on the I/O thread. Mapped lumps are only touched page by
+// page, so that they are faulted in before they are used in place.
+//
+static void W_prefetchRead(lumpprefetch_t *job)
+{
+   lumpinfo_t *lump = job->lump;
+
+   if(lump->type == lumpinfo_t::lump_mapped)
+   {
+      const volatile byte *data = static_cast<const byte *>(lump->mapped.data);
+      byte sum = 0;
+
+      for(size_t i = 0; i < lump->size; i += PREFETCHPAGESIZE)
+         sum += data[i];
+      (void)sum;
+      return;
+   }
+
+   Z_Malloc(lump->size, PU_STATIC, &job->data);
+
+   std::lock_guard<std::mutex> iolock(wadiomutex);
+
+   if(LumpHandlers[lump->type].readLump(lump, job->data) < lump->size)
+      Z_Free(job->data); // read it again on the main thread, where it can fail
+}
+
+//
+// W_prefetchTask
+//
+// Runs on the I/O thread until the queue is empty. The ZIP lumps of each batch
+// are inflated together on all cores first.
+//
+static void W_prefetchTask(int, void *)
+{
+   static const int PREFETCHBATCH = 32;
+   std::unique_lock<std::mutex> lock(prefetchmutex);
+
+   while(prefetchnext < prefetchqueue.getLength())
+   {
+      lumpprefetch_t *batch[PREFETCHBATCH];
+      ZipLump        *zipLumps[PREFETCHBATCH];
+      int             count = 0, numzip = 0;
+
+      while(count < PREFETCHBATCH && prefetchnext < prefetchqueue.getLength())
+      {
+         lumpprefetch_t *job = prefetchqueue[prefetchnext++];
+
+         if(job->state == PREFETCH_TAKEN)
+         {
+            prefetchdone.add(job);
+            continue;
+         }
+
+         job->state = PREFETCH_READING;
+         batch[count++] = job;
+         if(job->lump->type == lumpinfo_t::lump_zip)
+            zipLumps[numzip++] = job->lump->zip.zipLump;
+      }
+
+      if(prefetchnext == prefetchqueue.getLength())
+      {
+         prefetchqueue.makeEmpty();
+         prefetchnext = 0;
+      }
+
+      lock.unlock();
+
+      if(numzip > 1)
+      {
+         std::lock_guard<std::mutex> iolock(wadiomutex);
+         ZipFile::PrefetchLumps(zipLumps, numzip);
+      }
+
+      for(int i = 0; i < count; i++)
+      {
+         W_prefetchRead(batch[i]);
+
+         lock.lock();
+         batch[i]->state = PREFETCH_DONE;
+         prefetchdone.add(batch[i]);
+         lock.unlock();
+         prefetchcond.notify_all();
+      }
+
+      lock.lock();
+   }
+
+   prefetchrunning = false;
+   prefetchcond.notify_all();
+}
+
+//
+// W_takePrefetch
+//
+// Takes the prefetched data of a lump, if it has any, into a zone block with
+// the given tag and user. When its read hasn't started, the job is dropped and
+// false is returned so that the caller reads the lump itself; when it is being
+// read, this waits for it.
+//
+static bool W_takePrefetch(lumpinfo_t *lump, void **user, int tag)
+{
+   lumpprefetch_t *job;
+
+   if(!(job = lump->prefetch))
+      return false;
+
+   lump->prefetch = nullptr;
+
+   std::unique_lock<std::mutex> lock(prefetchmutex);
+
+   prefetchcond.wait(lock, [job] { return job->state != PREFETCH_READING; });
+
+   bool taken = false;
+
+   if(job->state == PREFETCH_DONE && job->data)
+   {
+      Z_Realloc(job->data, lump->size, tag, user);
+      taken = true;
+   }
+   job->state = PREFETCH_TAKEN;
+
+   return taken;
+}
+
+//
+// W_ClaimPrefetches
+//
+// Frees the jobs which are finished with. Lumps which were read but not taken
+// become PU_CACHE lumps of the default format, like they had been cached.
+//
+void W_ClaimPrefetches()
+{
+   std::lock_guard<std::mutex> lock(prefetchmutex);
+
+   for(lumpprefetch_t *job : prefetchdone)
+   {
+      if(job->state == PREFETCH_DONE)
+      {
+         lumpinfo_t *lump = job->lump;
+         void **cache = &lump->cache[lumpinfo_t::fmt_default];
+
+         if(job->data && !*cache)
+            Z_Realloc(job->data, lump->size, PU_CACHE, cache);
+         else if(job->data)
+            Z_Free(job->data);
+         lump->prefetch = nullptr;
+      }
+      efree(job);
+   }
+   prefetchdone.makeEmpty();
+}
+
+//
+// W_FinishPrefetches
+//
+// Waits for all queued reads and claims them. Must be done before lumps are
+// freed or their files closed.
+//
+void W_FinishPrefetches()
+{
+   {
+      std::unique_lock<std::mutex> lock(prefetchmutex);
+      prefetchcond.wait(lock, [] { return !prefetchrunning; });
+   }
+
+   W_ClaimPrefetches();
+}
+
+//
+// WadDirectory::prefetchLumps
+//
+// Queues the given lumps to be read on the I/O thread, when they are about to
+// be cached. Lumps which are cached or queued already, or held in memory, are
+// passed over.
+//
+void WadDirectory::prefetchLumps(const int *lumpnums, int count) const
+{
+   PODCollection<lumpprefetch_t *> jobs;
+
+   W_ClaimPrefetches();
+
+   for(int i = 0; i < count; i++)
+   {
+      if(lumpnums[i] < 0 || lumpnums[i] >= numlumps)
+         continue;
+
+      lumpinfo_t *lump = lumpinfo[lumpnums[i]];
+
+      if(!lump->size || lump->type == lumpinfo_t::lump_memory ||
+         lump->cache[lumpinfo_t::fmt_default] || lump->prefetch)
+         continue;
+
+      lumpprefetch_t *job = estructalloc(lumpprefetch_t, 1);
+
+      job->lump  = lump;
+      job->state = PREFETCH_QUEUED;
+      lump->prefetch = job;
+      jobs.add(job);
+   }
+
+   if(jobs.isEmpty())
+      return;
+
+   bool start = false;
+   {
+      std::lock_guard<std::mutex> lock(prefetchmutex);
+
+      for(lumpprefetch_t *job : jobs)
+         prefetchqueue.add(job);
+
+      if(!prefetchrunning)
+         start = prefetchrunning = true;
+   }
+
+   if(start)
+   {
+      if(!prefetchpool.getNumThreads())
+         prefetchpool.setNumThreads(1);
+
+      // the last run may not have returned quite yet
+      prefetchpool.wait();
+      prefetchpool.start(1, W_prefetchTask, nullptr);
+   }
+}
+
+//
+// WadDirectory::prefetchLumpRange
+//
+// Queues count lumps starting from firstlump to be read ahead.
+//
+void WadDirectory::prefetchLumpRange(int firstlump, int count) const
+{
+   PODCollection<int> lumpnums;
+
+   for(int i = emax(firstlump, 0); i < firstlump + count && i < numlumps; i++)
+      lumpnums.add(i);
+
+   if(!lumpnums.isEmpty())
+      prefetchLumps(&lumpnums[0], static_cast<int>(lumpnums.getLength()));
+}
+
+//
+// WadDirectory::prefetchNamespace
+//
+// Queues every lump in a namespace to be read ahead.
+//
+void WadDirectory::prefetchNamespace(int li_namespace) const
+{
+   const namespace_t &ns = m_namespaces[li_namespace];
+
+   prefetchLumpRange(ns.firstLump, ns.numLumps);
+}
+
 //
 // W_LumpLength
 //
@@ -1594,6 +2250,33 @@ int W_LumpLength(int lump)
    return wGlobalDir.lumpLength(lump);
 }
 
+//
+// W_formatLump
+//
+// haleyjd 06/26/11: Apply lump formatting/preprocessing if provided
+//
+static void W_formatLump(lumpinfo_t *lptr, const WadLumpLoader *lfmt)
+{
+   if(lfmt)
+   {
+      WadLumpLoader::Code code = lfmt->verifyData(lptr);
+
+      switch(code)
+      {
+      case WadLumpLoader::CODE_OK:
+         // When OK is returned, do formatting
+         code = lfmt->formatData(lptr);
+         break;
+      default:
+         break;
+      }
+
+      // Does the formatter want us to bomb out in response to an error?
+      if(code == WadLumpLoader::CODE_FATAL)
+         I_Error("WadDirectory::readLump: lump %s is malformed\n", lptr->name);
+   }
+}
+
 //
 // W_ReadLump
 //
@@ -1616,32 +2299,40 @@ void WadDirectory::readLump(int lump, void *dest,
 
    // killough 1/31/98: Reload hack (-wart) removed
 
-   c = LumpHandlers[lptr->type].readLump(lptr, dest);
-   if(c < lptr->size)
+   void *prefetched = nullptr;
+
+   if(W_takePrefetch(lptr, &prefetched, PU_STATIC))
    {
-      I_Error("WadDirectory::readLump: only read %d of %d on lump %d\n",
-              (int)c, (int)lptr->size, lump);
+      memcpy(dest, prefetched, lptr->size);
+      Z_Free(prefetched);
    }
-
-   // haleyjd 06/26/11: Apply lump formatting/preprocessing if provided
-   if(lfmt)
+   else
    {
-      WadLumpLoader::Code code = lfmt->verifyData(lptr);
+      std::lock_guard<std::mutex> iolock(wadiomutex);
 
-      switch(code)
+      c = LumpHandlers[lptr->type].readLump(lptr, dest);
+      if(c < lptr->size)
       {
-      case WadLumpLoader::CODE_OK:
-         // When OK is returned, do formatting
-         code = lfmt->formatData(lptr);
-         break;
-      default:
-         break;
+         I_Error("WadDirectory::readLump: only read %d of %d on lump %d\n",
+                 (int)c, (int)lptr->size, lump);
       }
-
-      // Does the formatter want us to bomb out in response to an error?
-      if(code == WadLumpLoader::CODE_FATAL)
-         I_Error("WadDirectory::readLump: lump %s is malformed\n", lptr->name);
    }
+
+   W_formatLump(lptr, lfmt);
+}
+
+//
+// W_useMappedLump
+//
+// A mapped lump can be cached without a copy when no loader needs to format it
+// in place, and it is aligned well enough for the structures read from it.
+// Such a lump stays valid until its directory is closed; the zone treats it as
+// PU_PERMANENT.
+//
+static bool W_useMappedLump(const lumpinfo_t *lump, const WadLumpLoader *lfmt)
+{
+   return !lfmt && lump->type == lumpinfo_t::lump_mapped && lump->size &&
+          !(reinterpret_cast<uintptr_t>(lump->mapped.data) & 3);
 }
 
 //
@@ -1663,9 +2354,16 @@ void *WadDirectory::cacheLumpNum(int lump, int tag,
 
    if(!(lumpinfo[lump]->cache[fmt]))      // read the lump in
    {
-      readLump(lump,
-               Z_Malloc(lumpLength(lump), tag, &(lumpinfo[lump]->cache[fmt])),
-               lfmt);
+      if(W_useMappedLump(lumpinfo[lump], lfmt))
+         lumpinfo[lump]->cache[fmt] = const_cast<void *>(lumpinfo[lump]->mapped.data);
+      else if(W_takePrefetch(lumpinfo[lump], &lumpinfo[lump]->cache[fmt], tag))
+         W_formatLump(lumpinfo[lump], lfmt);
+      else
+      {
+         readLump(lump,
+                  Z_Malloc(lumpLength(lump), tag, &(lumpinfo[lump]->cache[fmt])),
+                  lfmt);
+      }
    }
    else
    {
@@ -1819,17 +2517,26 @@ void WadDirectory::close()
    // close the wad file if it is open; public directories can't be closed
    if(lumpinfo && !ispublic)
    {
+      // nothing may still be reading from the wad
+      W_FinishPrefetches();
+
       // free all resources loaded from the wad
       freeDirectoryLumps();
 
+      // nothing points into the mapped files any more
+      pImpl->unmapFiles();
+
       if(lumpinfo[0]->type == lumpinfo_t::lump_direct && lumpinfo[0]->direct.file)
          fclose(lumpinfo[0]->direct.file);
+      else if(lumpinfo[0]->type == lumpinfo_t::lump_mapped)
+         fclose(lumpinfo[0]->mapped.file);
 
       // free all lumpinfo_t's allocated for the wad
       freeDirectoryAllocs();
 
       // free the private wad directory
       Z_Free(lumpinfo);
+      pImpl->freeIndices();
 
       lumpinfo = nullptr;
    }
@@ -1894,6 +2601,18 @@ static size_t W_FileReadLump(lumpinfo_t *l, void *dest)
    return sizeread;
 }
 
+//
+// Mapped lumps -- direct lumps in a file that could be mapped into memory.
+// They are copied out of the mapping when a copy is needed at all.
+//
+
+static size_t W_MappedReadLump(lumpinfo_t *l, void *dest)
+{
+   memcpy(dest, l->mapped.data, l->size);
+
+   return l->size;
+}
+
 //
 // ZIP lumps -- files embedded inside a ZIP archive. The ZipFile
 // and ZipLump classes take care of all the specifics.
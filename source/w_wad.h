@@ -28,6 +28,7 @@
 class  ZAutoBuffer;
 class  ZipFile;
 struct ZipLump;
+struct lumpprefetch_t;
 
 //
 // TYPES
@@ -61,6 +62,14 @@ struct memorylump_t
    size_t position;  // for direct and memory lumps, offset into file/buffer
 };
 
+// A mapped lump is in a file mapped into memory, and is used right there when
+// it can be.
+struct mappedlump_t
+{
+   FILE *file;       // the file, kept open like that of a direct lump
+   const void *data; // the lump in the mapping
+};
+
 // A ZIP lump is managed by a ZipFile instance.
 struct ziplump_t
 {
@@ -124,6 +133,7 @@ struct lumpinfo_t
       lump_memory,  // lump is a memory buffer
       lump_file,    // lump is a directory file; must be opened to use
       lump_zip,     // lump is inside a zip file
+      lump_mapped,  // lump is in a file mapped into memory
       lump_numtypes
    };
    int type;
@@ -136,11 +146,14 @@ struct lumpinfo_t
       directlump_t direct;
       memorylump_t memory;
       ziplump_t    zip;
+      mappedlump_t mapped;
    };
 
    char *lfn;      // long file name, where relevant
    char *filepath; // file path, where relevant
    DLListItem<lumpinfo_t> lfnlinks;
+
+   lumpprefetch_t *prefetch; // read queued by prefetchLumps, if any
 };
 
 // Flags for wfileadd_t
@@ -325,6 +338,9 @@ public:
                        const WadLumpLoader *lfmt = nullptr) const;
    void  cacheLumpAuto(int lumpnum, ZAutoBuffer &buffer) const;
    void  cacheLumpAuto(const char *name, ZAutoBuffer &buffer) const;
+   void  prefetchLumps(const int *lumpnums, int count) const;
+   void  prefetchLumpRange(int firstlump, int count) const;
+   void  prefetchNamespace(int li_namespace) const;
    bool  writeLump(const char *lumpname, const char *destpath) const;
    void  close(); // haleyjd 03/09/11
 
@@ -359,6 +375,11 @@ uint32_t W_LumpCheckSum(int lumpnum);
 
 lumpinfo_t *W_NextInLFNHash(lumpinfo_t *lumpinfo);
 
+void     W_ClaimPrefetches();
+void     W_FinishPrefetches();
+
+void     W_BenchLumpLookups(int numlumps, int numlookups);
+
 #endif
 
 //----------------------------------------------------------------------------
@@ -28,12 +28,20 @@
 
 #include "z_auto.h"
 
+#include <algorithm>
+
+#include "d_io.h"
+#include "doomstat.h"
+#include "hal/i_directory.h"
 #include "i_system.h"
 #include "m_buffer.h"
+#include "m_collection.h"
 #include "m_compare.h"
+#include "m_hash.h"
 #include "m_qstr.h"
 #include "m_structio.h"
 #include "m_swap.h"
+#include "m_threads.h"
 #include "w_wad.h"
 #include "w_zip.h"
 
@@ -258,20 +266,7 @@ static bool ZIP_FindEndOfCentralDir(InBuffer &fin, long &position)
 ZipFile::~ZipFile()
 {
    // free the directory
-   if(lumps && numLumps)
-   {
-      // free lump names
-      for(int i = 0; i < numLumps; i++)
-      {
-         if(lumps[i].name)
-            efree(lumps[i].name);
-      }
-
-      // free the lump directory
-      efree(lumps);
-      lumps    = NULL;
-      numLumps = 0;
-   }
+   freeDirectory();
 
    // free zipwads
    if(wads)
@@ -296,6 +291,34 @@ ZipFile::~ZipFile()
    }
 }
 
+//
+// ZipFile::freeDirectory
+//
+// Protected method. Frees the lump directory and anything read ahead for it.
+//
+void ZipFile::freeDirectory()
+{
+   if(lumps)
+   {
+      for(int i = 0; i < numLumps; i++)
+      {
+         // free lump names
+         if(lumps[i].name)
+            efree(lumps[i].name);
+
+         // free lumps inflated ahead of time and never read
+         if(lumps[i].prefetched)
+            Z_Free(lumps[i].prefetched);
+      }
+
+      // free the lump directory
+      efree(lumps);
+   }
+
+   lumps    = NULL;
+   numLumps = 0;
+}
+
 //
 // ZipFile::readEndOfCentralDir
 //
@@ -463,19 +486,224 @@ static int ZIP_LumpSortCB(const void *va, const void *vb)
    return strcmp(lumpA->name, lumpB->name);
 }
 
+//=============================================================================
+//
+// Directory Cache
+//
+// The sorted directory of an archive is kept in the user's cache directory, so
+// that later launches need not parse and sort the central directory again. It
+// is found by the archive's path, and holds the archive's size and time of
+// modification; if either has changed, the archive is read as usual and the
+// cache is rewritten.
+//
+
+#define ZIPDIRCACHE_VERSION 1
+
+struct ZIPDirCacheKey
+{
+   uint64_t size;
+   int64_t  mtime;
+};
+
+struct ZIPDirCacheHeader
+{
+   char           magic[4];  // Must be "EZDC"
+   int32_t        version;
+   ZIPDirCacheKey key;
+   int32_t        numLumps;
+   uint32_t       namesSize; // Length of the lump names following the entries
+};
+
+struct ZIPDirCacheEntry
+{
+   int32_t  gpFlags;
+   int32_t  flags;
+   int32_t  method;
+   uint32_t compressed;
+   uint32_t size;
+   uint32_t offset;
+};
+
+//
+// ZIP_dirCacheKey
+//
+static bool ZIP_dirCacheKey(const char *filename, ZIPDirCacheKey &key)
+{
+   struct stat sbuf;
+
+   if(stat(filename, &sbuf))
+      return false;
+
+   key.size  = static_cast<uint64_t>(sbuf.st_size);
+   key.mtime = static_cast<int64_t>(sbuf.st_mtime);
+   return true;
+}
+
+//
+// ZIP_dirCachePath
+//
+static void ZIP_dirCachePath(const char *filename, qstring &path)
+{
+   qstring real;
+   char   *digest;
+
+   I_GetRealPath(filename, real);
+   digest = HashData(HashData::SHA1, 
+                     reinterpret_cast<const uint8_t *>(real.constPtr()),
+                     static_cast<uint32_t>(real.length())).digestToString();
+
+   path = usergamepath;
+   path.pathConcatenate("cache");
+   I_CreateDirectory(path);
+   path.pathConcatenate(digest);
+   path += ".zdc";
+
+   efree(digest);
+}
+
+//
+// ZipFile::readDirCache
+//
+// Protected method. Reads the directory from the cache, if it is there and was
+// made from the archive as it is now.
+//
+bool ZipFile::readDirCache(const char *cachename, const ZIPDirCacheKey &key)
+{
+   ZIPDirCacheHeader header;
+   ZAutoBuffer entryBuffer, nameBuffer;
+   FILE *f;
+   bool  ok = false;
+
+   if(!(f = fopen(cachename, "rb")))
+      return false;
+
+   if(fread(&header, sizeof(header), 1, f) == 1 &&
+      !memcmp(header.magic, "EZDC", 4) && header.version == ZIPDIRCACHE_VERSION &&
+      header.key.size == key.size && header.key.mtime == key.mtime &&
+      header.numLumps > 0 && header.namesSize > 0)
+   {
+      size_t entrySize = header.numLumps * sizeof(ZIPDirCacheEntry);
+
+      entryBuffer.alloc(entrySize, false);
+      nameBuffer.alloc(header.namesSize, false);
+      ok = (fread(entryBuffer.get(), entrySize, 1, f) == 1 &&
+            fread(nameBuffer.get(), header.namesSize, 1, f) == 1);
+   }
+
+   fclose(f);
+
+   if(!ok)
+      return false;
+
+   const ZIPDirCacheEntry *entry = entryBuffer.getAs<ZIPDirCacheEntry *>();
+   const char *name = nameBuffer.getAs<char *>();
+   const char *end  = name + header.namesSize;
+
+   numLumps = header.numLumps;
+   lumps    = ecalloc(ZipLump *, numLumps + 1, sizeof(ZipLump));
+
+   for(int i = 0; i < numLumps; i++, entry++)
+   {
+      ZipLump &lump = lumps[i];
+      const char *nameEnd;
+
+      // every name must be terminated inside the cache
+      if(!(nameEnd = static_cast<const char *>(memchr(name, 0, end - name))))
+      {
+         freeDirectory();
+         return false;
+      }
+
+      lump.name       = estrdup(name);
+      lump.gpFlags    = entry->gpFlags;
+      lump.flags      = entry->flags;
+      lump.method     = entry->method;
+      lump.compressed = entry->compressed;
+      lump.size       = entry->size;
+      lump.offset     = static_cast<long>(entry->offset);
+      lump.file       = this;
+
+      name = nameEnd + 1;
+   }
+
+   return true;
+}
+
+//
+// ZipFile::writeDirCache
+//
+// Protected method. Writes the directory just read from the archive to the
+// cache.
+//
+void ZipFile::writeDirCache(const char *cachename, const ZIPDirCacheKey &key) const
+{
+   edefstructvar(ZIPDirCacheHeader, header);
+   ZAutoBuffer entryBuffer;
+   FILE *f;
+   bool  ok;
+
+   memcpy(header.magic, "EZDC", 4);
+   header.version  = ZIPDIRCACHE_VERSION;
+   header.key      = key;
+   header.numLumps = numLumps;
+
+   entryBuffer.alloc(numLumps * sizeof(ZIPDirCacheEntry), true);
+   ZIPDirCacheEntry *entries = entryBuffer.getAs<ZIPDirCacheEntry *>();
+
+   for(int i = 0; i < numLumps; i++)
+   {
+      const ZipLump    &lump  = lumps[i];
+      ZIPDirCacheEntry &entry = entries[i];
+
+      entry.gpFlags    = lump.gpFlags;
+      entry.flags      = lump.flags;
+      entry.method     = lump.method;
+      entry.compressed = lump.compressed;
+      entry.size       = lump.size;
+      entry.offset     = static_cast<uint32_t>(lump.offset);
+
+      header.namesSize += static_cast<uint32_t>(strlen(lump.name) + 1);
+   }
+
+   if(!(f = fopen(cachename, "wb")))
+      return;
+
+   ok = fwrite(&header, sizeof(header), 1, f) == 1 &&
+        fwrite(entries, numLumps * sizeof(ZIPDirCacheEntry), 1, f) == 1;
+   for(int i = 0; ok && i < numLumps; i++)
+      ok = fwrite(lumps[i].name, strlen(lumps[i].name) + 1, 1, f) == 1;
+
+   fclose(f);
+
+   // don't leave a broken cache behind
+   if(!ok)
+      remove(cachename);
+}
+
 //
 // ZipFile::readFromFile
 //
-// Extracts the directory from a physical ZIP file.
+// Extracts the directory from a physical ZIP file. If the file's name is
+// given, the directory is cached for next time.
 //
-bool ZipFile::readFromFile(FILE *f)
+bool ZipFile::readFromFile(FILE *f, const char *filename)
 {
    InBuffer reader;
    edefstructvar(ZIPEndOfCentralDir, zcd);
+   ZIPDirCacheKey key;
+   qstring cachename;
 
    // remember our disk file
    file = f;
 
+   // use the directory cached on an earlier launch, if the archive is unchanged
+   if(filename && usergamepath && ZIP_dirCacheKey(filename, key))
+   {
+      ZIP_dirCachePath(filename, cachename);
+      if(readDirCache(cachename.constPtr(), key))
+         return true;
+   }
+
    reader.openExisting(f, InBuffer::LENDIAN);
 
    // read in the end-of-central-directory structure
@@ -490,6 +718,9 @@ bool ZipFile::readFromFile(FILE *f)
    if(numLumps > 1)
       qsort(lumps, numLumps, sizeof(ZipLump), ZIP_LumpSortCB);
 
+   if(cachename.length() && numLumps > 0)
+      writeDirCache(cachename.constPtr(), key);
+
    return true;
 }
 
@@ -570,6 +801,153 @@ int ZipFile::findLump(const char *name) const
    return lumpnum;
 }
 
+//=============================================================================
+//
+// Prefetching
+//
+// Lumps about to be read one after another are inflated ahead of time, on all
+// cores. The compressed data is read on the calling thread, since the archive
+// is a single FILE, and the workers only inflate from memory to memory.
+//
+
+// compressed bytes read for each batch given to the workers
+#define ZIPPREFETCHBATCH (8*1024*1024)
+
+struct zipprefetch_t
+{
+   ZipLump *lump;
+   byte    *source; // compressed data
+   bool     ok;
+};
+
+static WorkerPool zippool;
+
+//
+// ZIP_inflateTask
+//
+// Runs on the workers; inflates one lump into its prefetch buffer.
+//
+static void ZIP_inflateTask(int task, void *data)
+{
+   zipprefetch_t &job = static_cast<zipprefetch_t *>(data)[task];
+   z_stream zlStream;
+   int code;
+
+   memset(&zlStream, 0, sizeof(zlStream));
+   job.ok = false;
+
+   if(inflateInit2(&zlStream, -MAX_WBITS) != Z_OK)
+      return;
+
+   zlStream.next_in   = job.source;
+   zlStream.avail_in  = static_cast<uInt>(job.lump->compressed);
+   zlStream.next_out  = static_cast<Bytef *>(job.lump->prefetched);
+   zlStream.avail_out = static_cast<uInt>(job.lump->size);
+
+   // like ZIPDeflateReader, all that matters is that the lump is filled
+   code = inflate(&zlStream, Z_FINISH);
+   job.ok = (code == Z_STREAM_END || code == Z_OK || code == Z_BUF_ERROR) &&
+            !zlStream.avail_out;
+
+   inflateEnd(&zlStream);
+}
+
+//
+// ZIP_runPrefetch
+//
+// Inflates a batch of lumps on the workers. Lumps that fail are dropped, to be
+// read, and complained about, as usual.
+//
+static void ZIP_runPrefetch(PODCollection<zipprefetch_t> &jobs)
+{
+   if(jobs.isEmpty())
+      return;
+
+   if(!zippool.getNumThreads())
+      zippool.setNumThreads(emax(M_NumCPUs() - 1, 1));
+
+   zippool.run(static_cast<int>(jobs.getLength()), ZIP_inflateTask, &jobs[0]);
+
+   for(zipprefetch_t &job : jobs)
+   {
+      efree(job.source);
+
+      if(job.ok)
+         Z_ChangeTag(job.lump->prefetched, PU_CACHE);
+      else
+         Z_Free(job.lump->prefetched);
+   }
+
+   jobs.makeEmpty();
+}
+
+//
+// ZipFile::PrefetchLumps
+//
+// Inflates the lumps ahead of time, so that the next ZipLump::read of each is
+// only a copy. The inflated lumps are PU_CACHE until read. The array is sorted
+// into archive order.
+//
+void ZipFile::PrefetchLumps(ZipLump **lumps, int count)
+{
+   PODCollection<zipprefetch_t> jobs;
+   size_t batchBytes = 0;
+
+   // read each archive from front to back
+   std::sort(lumps, lumps + count, [] (const ZipLump *a, const ZipLump *b) {
+      return a->file != b->file ? a->file < b->file : a->offset < b->offset;
+   });
+
+   for(int i = 0; i < count; i++)
+   {
+      ZipLump &lump = *lumps[i];
+      InBuffer reader;
+
+      if(lump.prefetched || !lump.size)
+         continue;
+
+      reader.openExisting(lump.file->getFile(), InBuffer::LENDIAN);
+
+      if(lump.flags & LF_CALCOFFSET)
+         lump.setAddress(reader);
+      else if(reader.seek(lump.offset, SEEK_SET))
+         continue;
+
+      // static until inflated, so no allocation in between can purge it
+      Z_Malloc(lump.size, PU_STATIC, &lump.prefetched);
+
+      if(lump.method == METHOD_STORED)
+      {
+         if(reader.read(lump.prefetched, lump.size) == lump.size)
+            Z_ChangeTag(lump.prefetched, PU_CACHE);
+         else
+            Z_Free(lump.prefetched);
+         continue;
+      }
+
+      byte *source = emalloc(byte *, lump.compressed + 1);
+      if(reader.read(source, lump.compressed) != lump.compressed)
+      {
+         efree(source);
+         Z_Free(lump.prefetched);
+         continue;
+      }
+
+      zipprefetch_t &job = jobs.addNew();
+      job.lump   = &lump;
+      job.source = source;
+      job.ok     = false;
+
+      if((batchBytes += lump.compressed) >= ZIPPREFETCHBATCH)
+      {
+         ZIP_runPrefetch(jobs);
+         batchBytes = 0;
+      }
+   }
+
+   ZIP_runPrefetch(jobs);
+}
+
 //=============================================================================
 //
 // ZipLump Methods
@@ -722,6 +1100,14 @@ void ZipLump::read(void *buffer)
 {
    InBuffer reader;
 
+   // a lump inflated ahead of time only needs copying, once
+   if(prefetched)
+   {
+      memcpy(buffer, prefetched, size);
+      Z_Free(prefetched);
+      return;
+   }
+
    reader.openExisting(file->getFile(), InBuffer::LENDIAN);
 
    // Calculate an offset beyond the lump's local file header, if such hasn't
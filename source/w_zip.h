@@ -35,6 +35,7 @@
 class  InBuffer;
 class  WadDirectory;
 class  ZAutoBuffer;
+struct ZIPDirCacheKey;
 struct ZIPEndOfCentralDir;
 class  ZipFile;
 
@@ -48,6 +49,7 @@ struct ZipLump
    long      offset;     // file offset
    char     *name;       // full name 
    ZipFile  *file;       // parent zipfile
+   void     *prefetched; // inflated ahead of time by ZipFile::PrefetchLumps
 
    void setAddress(InBuffer &fin);
    void read(void *buffer);
@@ -97,6 +99,10 @@ protected:
    bool readCentralDirEntry(InBuffer &fin, ZipLump &lump, bool &skip);
    bool readCentralDirectory(InBuffer &fin, long offset, uint32_t size);
 
+   void freeDirectory();
+   bool readDirCache(const char *cachename, const ZIPDirCacheKey &key);
+   void writeDirCache(const char *cachename, const ZIPDirCacheKey &key) const;
+
 public:
    ZipFile() 
       : ZoneObject(), lumps(NULL), numLumps(0), file(NULL), links(), wads(NULL) 
@@ -105,7 +111,7 @@ public:
    
    ~ZipFile();
 
-   bool readFromFile(FILE *f);
+   bool readFromFile(FILE *f, const char *filename = nullptr);
 
    void checkForWadFiles(WadDirectory &parentDir);
 
@@ -114,6 +120,8 @@ public:
    int      findLump(const char *name) const;
    int      getNumLumps() const { return numLumps; }   
    FILE    *getFile()     const { return file;     }
+
+   static void PrefetchLumps(ZipLump **lumps, int count);
 };
 
 #endif
@@ -29,6 +29,17 @@
 // When running with this heap, there is no limitation to the amount of memory
 // allocated except what the system will provide.
 //
+// Small blocks are not malloc'd one by one. They are rounded up to a size
+// class and carved from large chunks, and freed ones wait on a free list for
+// the next block of their class. PU_LEVEL and PU_RENDERER blocks have arenas
+// of their own, whose chunks are let go of all at once when Z_FreeTags frees
+// the tag: it only walks the tag's blocks to clear their users, rather than
+// freeing them one by one. A chunk holding a block that was moved to another
+// tag is kept until that block is freed.
+//
+// All of the Z_ functions may be called from any thread; ZoneObjects are
+// still for the main thread only.
+//
 // Limitations:
 // * Purgables are never currently dumped unless the machine runs out of RAM.
 // * Instrumentation cannot track the amount of free memory.
@@ -37,6 +48,9 @@
 //-----------------------------------------------------------------------------
 
 #include "z_zone.h"
+
+#include <mutex>
+
 #include "i_system.h"
 #include "doomstat.h"
 #include "m_argv.h"
@@ -80,6 +94,10 @@
 // signature for block header
 #define ZONEID  0x931d4a11
 
+// bytes in each chunk small blocks are carved from
+#define ZONECHUNKSIZE  (64*1024)
+#define ARENACHUNKSIZE (256*1024)
+
 // End Tunables
 
 //=============================================================================
@@ -96,7 +114,9 @@ typedef struct memblock
   struct memblock *next,**prev;
   size_t size;
   void **user;
+  struct zonechunk *chunk;   // chunk it was carved from, or NULL if malloc'd
   unsigned char tag;
+  unsigned char sizeclass;   // index into zoneclasses, if carved
 
 #ifdef INSTRUMENTED
   const char *file;
@@ -119,7 +139,275 @@ static memblock_t *blockbytag[PU_MAX];   // used for tracking all zone blocks
 
 // ZoneObject class statics
 ZoneObject *ZoneObject::objectbytag[PU_MAX]; // like blockbytag but for objects
-void       *ZoneObject::newalloc;            // most recent ZoneObject alloc
+thread_local void *ZoneObject::newalloc;     // most recent ZoneObject alloc
+
+// held by every zone function, so loader threads can allocate too; the zone
+// functions call each other, hence recursive
+static std::recursive_mutex zonemutex;
+
+//=============================================================================
+//
+// Size Classes and Arenas
+//
+
+// block sizes small blocks are rounded up to; all multiples of 16
+static const size_t zoneclasses[] =
+{
+   16, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024
+};
+
+#define NUMZONECLASSES earrlen(zoneclasses)
+
+struct zonearena_t;
+
+typedef struct zonechunk
+{
+   struct zonechunk *next;
+   zonearena_t      *arena;   // arena it was carved for
+   size_t            size;    // bytes after the header
+   size_t            used;    // bytes carved so far
+   int               pins;    // live blocks in it tagged other than the arena
+   bool              dropped; // arena let go of it while it was pinned
+} zonechunk_t;
+
+static const size_t chunkheader_size = (sizeof(zonechunk_t) + 15) & ~15;
+
+struct zonearena_t
+{
+   int          tag;          // tag whose blocks it holds, or PU_MAX
+   size_t       chunksize;
+   zonechunk_t *chunks;       // newest first; blocks are carved from the first
+   memblock_t  *freelists[NUMZONECLASSES];
+   size_t       numchunks;
+   size_t       reserved;     // bytes in the chunks
+   size_t       carved;       // bytes carved from them, headers included
+   size_t       freebytes;    // bytes of carved blocks on the free lists
+   size_t       numblocks;    // carved blocks in use
+};
+
+// small blocks of every tag without an arena of its own
+static zonearena_t zonesmall = { PU_MAX, ZONECHUNKSIZE };
+
+static zonearena_t zonelevel    = { PU_LEVEL,    ARENACHUNKSIZE };
+static zonearena_t zonerenderer = { PU_RENDERER, ARENACHUNKSIZE };
+
+// chunks of dropped arenas kept for their pinned blocks
+static zonechunk_t *droppedchunks;
+
+//
+// Z_arenaForTag
+//
+// Returns the arena blocks of the tag are carved from.
+//
+static zonearena_t *Z_arenaForTag(int tag)
+{
+   switch(tag)
+   {
+   case PU_LEVEL:    return &zonelevel;
+   case PU_RENDERER: return &zonerenderer;
+   default:          return &zonesmall;
+   }
+}
+
+//
+// Z_sizeClass
+//
+// Returns the size class blocks of a size go in, or -1 if they are too large
+// to be carved.
+//
+static int Z_sizeClass(size_t size)
+{
+   for(size_t i = 0; i < NUMZONECLASSES; i++)
+   {
+      if(size <= zoneclasses[i])
+         return static_cast<int>(i);
+   }
+   return -1;
+}
+
+//
+// Z_carveBlock
+//
+// Takes a block of a size class from the arena's free list, or carves a new
+// one. Returns NULL if the system is out of memory.
+//
+static memblock_t *Z_carveBlock(zonearena_t &arena, int sizeclass)
+{
+   memblock_t  *block;
+   zonechunk_t *chunk;
+   size_t       blocksize = header_size + zoneclasses[sizeclass];
+
+   if((block = arena.freelists[sizeclass]))
+   {
+      arena.freelists[sizeclass] = block->next;
+      arena.freebytes -= blocksize;
+   }
+   else
+   {
+      if(!(chunk = arena.chunks) || chunk->used + blocksize > chunk->size)
+      {
+         if(!(chunk = (zonechunk_t *)(malloc(chunkheader_size + arena.chunksize))))
+            return NULL;
+
+         chunk->next    = arena.chunks;
+         chunk->arena   = &arena;
+         chunk->size    = arena.chunksize;
+         chunk->used    = 0;
+         chunk->pins    = 0;
+         chunk->dropped = false;
+         arena.chunks   = chunk;
+
+         ++arena.numchunks;
+         arena.reserved += arena.chunksize;
+      }
+
+      block = (memblock_t *)((byte *)chunk + chunkheader_size + chunk->used);
+      block->chunk = chunk;
+      chunk->used += blocksize;
+      arena.carved += blocksize;
+   }
+
+   block->sizeclass = static_cast<unsigned char>(sizeclass);
+   ++arena.numblocks;
+
+   return block;
+}
+
+//
+// Z_pinned
+//
+// True if a carved block is tagged other than the arena it came from, so that
+// its chunk must outlive the arena.
+//
+static inline bool Z_pinned(const memblock_t *block, int tag)
+{
+   return block->chunk->arena->tag != PU_MAX && block->chunk->arena->tag != tag;
+}
+
+//
+// Z_releaseBlock
+//
+// Gives back the memory of a block that has been unlinked from its tag list.
+// The tag it had is passed in.
+//
+static void Z_releaseBlock(memblock_t *block, int tag)
+{
+   zonechunk_t *chunk = block->chunk;
+
+   if(!chunk)
+   {
+      free(block);
+      return;
+   }
+
+   if(chunk->dropped)
+   {
+      // the last pinned block of a dropped arena chunk frees it
+      if(!--chunk->pins)
+      {
+         zonechunk_t **link = &droppedchunks;
+
+         while(*link != chunk)
+            link = &(*link)->next;
+         *link = chunk->next;
+         free(chunk);
+      }
+      return;
+   }
+
+   zonearena_t &arena = *chunk->arena;
+
+   if(Z_pinned(block, tag))
+      --chunk->pins;
+
+   block->next = arena.freelists[block->sizeclass];
+   arena.freelists[block->sizeclass] = block;
+   arena.freebytes += header_size + zoneclasses[block->sizeclass];
+   --arena.numblocks;
+}
+
+//
+// Z_retag
+//
+// Keeps the pin count of a carved block's chunk right when the block's tag is
+// changed.
+//
+static void Z_retag(memblock_t *block, int oldtag, int newtag)
+{
+   zonechunk_t *chunk = block->chunk;
+
+   // a dropped chunk counts all of its blocks as pinned, whatever their tag
+   if(!chunk || chunk->dropped)
+      return;
+
+   chunk->pins += int(Z_pinned(block, newtag)) - int(Z_pinned(block, oldtag));
+}
+
+//
+// Z_dropArena
+//
+// Lets go of all of an arena's chunks, once its tag has been freed. Chunks
+// with pinned blocks are kept until those go.
+//
+static void Z_dropArena(zonearena_t &arena)
+{
+   zonechunk_t *chunk = arena.chunks;
+
+   while(chunk)
+   {
+      zonechunk_t *next = chunk->next;
+
+      if(chunk->pins)
+      {
+         chunk->dropped = true;
+         chunk->next    = droppedchunks;
+         droppedchunks  = chunk;
+      }
+      else
+         free(chunk);
+
+      chunk = next;
+   }
+
+   arena.chunks = NULL;
+   memset(arena.freelists, 0, sizeof(arena.freelists));
+   arena.numchunks = 0;
+   arena.reserved  = 0;
+   arena.carved    = 0;
+   arena.freebytes = 0;
+   arena.numblocks = 0;
+}
+
+//
+// Z_GetHeapStats
+//
+// Fills in the statistics of the arena of a tag, or of the small blocks of
+// the tags without one if passed PU_MAX. Returns false if the tag has no
+// arena.
+//
+bool Z_GetHeapStats(int tag, zoneheapstats_t &stats)
+{
+   std::lock_guard<std::recursive_mutex> lock(zonemutex);
+   const zonearena_t *arena = Z_arenaForTag(tag);
+
+   if(arena->tag != tag)
+      return false;
+
+   stats.numchunks = arena->numchunks;
+   stats.reserved  = arena->reserved;
+   stats.carved    = arena->carved;
+   stats.freebytes = arena->freebytes;
+   stats.numblocks = arena->numblocks;
+   stats.kept      = 0;
+
+   for(const zonechunk_t *chunk = droppedchunks; chunk; chunk = chunk->next)
+   {
+      if(chunk->arena == arena)
+         ++stats.kept;
+   }
+
+   return true;
+}
 
 //=============================================================================
 //
@@ -203,6 +491,79 @@ static void Z_IDCheck(bool err, const char *errmsg,
 #define SCRAMBLER(b, s)
 #endif
 
+//=============================================================================
+//
+// Mapped Ranges
+//
+// Pointers into these are handed out like zone blocks but have no header, so
+// the zone functions must recognize them before looking for one.
+//
+
+#define MAXMAPPEDRANGES 64
+
+struct zonemapped_t
+{
+   const byte *base;
+   size_t      size;
+};
+
+static zonemapped_t zonemapped[MAXMAPPEDRANGES];
+static int          numzonemapped;
+
+//
+// Z_AddMappedRange
+//
+// Returns false if there are too many ranges already; the memory must not be
+// handed out to zone users then.
+//
+bool Z_AddMappedRange(const void *base, size_t size)
+{
+   std::lock_guard<std::recursive_mutex> lock(zonemutex);
+
+   if(numzonemapped == MAXMAPPEDRANGES)
+      return false;
+
+   zonemapped[numzonemapped].base = static_cast<const byte *>(base);
+   zonemapped[numzonemapped].size = size;
+   ++numzonemapped;
+
+   return true;
+}
+
+//
+// Z_RemoveMappedRange
+//
+void Z_RemoveMappedRange(const void *base)
+{
+   std::lock_guard<std::recursive_mutex> lock(zonemutex);
+
+   for(int i = 0; i < numzonemapped; i++)
+   {
+      if(zonemapped[i].base == base)
+      {
+         zonemapped[i] = zonemapped[--numzonemapped];
+         return;
+      }
+   }
+}
+
+//
+// Z_mappedRange
+//
+// Returns the mapped range a pointer is in, if any.
+//
+static const zonemapped_t *Z_mappedRange(const void *ptr)
+{
+   const byte *p = static_cast<const byte *>(ptr);
+
+   for(int i = 0; i < numzonemapped; i++)
+   {
+      if(p >= zonemapped[i].base && p < zonemapped[i].base + zonemapped[i].size)
+         return &zonemapped[i];
+   }
+   return NULL;
+}
+
 //=============================================================================
 //
 // Instrumentation Statistics
@@ -212,6 +573,21 @@ static void Z_IDCheck(bool err, const char *errmsg,
 INSTRUMENT(size_t memorybytag[PU_MAX]); // haleyjd 04/02/11: track by tag
 INSTRUMENT(int printstats = 0);         // killough 8/23/98
 
+zonestats_t z_stats;
+
+//
+// Z_countAlloc
+//
+// Adds a newly allocated block of size bytes to the statistics.
+//
+static inline void Z_countAlloc(size_t size)
+{
+   ++z_stats.numallocs;
+   z_stats.allocbytes += size;
+   if((z_stats.inusebytes += size) > z_stats.peakbytes)
+      z_stats.peakbytes = z_stats.inusebytes;
+}
+
 // haleyjd 04/02/11: Instrumentation output has been moved to d_main.cpp and
 // is now drawn directly to the screen instead of passing through doom_printf.
 
@@ -312,6 +688,9 @@ void *(Z_Malloc)(size_t size, int tag, void **user, const char *file, int line)
 {
    memblock_t *block;
    byte *ret;
+   int sizeclass;
+
+   std::lock_guard<std::recursive_mutex> lock(zonemutex);
 
    DEBUG_CHECKHEAP();
 
@@ -321,8 +700,21 @@ void *(Z_Malloc)(size_t size, int tag, void **user, const char *file, int line)
 
    if(!size)
       return user ? *user = NULL : NULL;          // malloc(0) returns NULL
-   
-   if(!(block = (memblock_t *)(malloc(size + header_size))))
+
+   if((sizeclass = Z_sizeClass(size)) >= 0)
+   {
+      zonearena_t &arena = *Z_arenaForTag(tag);
+
+      if(!(block = Z_carveBlock(arena, sizeclass)))
+      {
+         if(blockbytag[PU_CACHE])
+         {
+            Z_FreeTags(PU_CACHE, PU_CACHE);
+            block = Z_carveBlock(arena, sizeclass);
+         }
+      }
+   }
+   else if(!(block = (memblock_t *)(malloc(size + header_size))))
    {
       if(blockbytag[PU_CACHE])
       {
@@ -336,8 +728,12 @@ void *(Z_Malloc)(size_t size, int tag, void **user, const char *file, int line)
       I_FatalError(I_ERR_KILL, "Z_Malloc: Failure trying to allocate %u bytes\n"
                                "Source: %s:%d\n", (unsigned int)size, file, line);
    }
+
+   if(sizeclass < 0)
+      block->chunk = NULL;
    
    block->size = size;
+   Z_countAlloc(size);
    
    if((block->next = blockbytag[tag]))
       block->next->prev = &block->next;
@@ -366,14 +762,42 @@ void *(Z_Malloc)(size_t size, int tag, void **user, const char *file, int line)
    return ret;
 }
 
+//
+// Z_freeBlock
+//
+// Frees a block, without the checks Z_Free makes first.
+//
+static void Z_freeBlock(memblock_t *block)
+{
+   int tag = block->tag;
+
+   INSTRUMENT(memorybytag[tag] -= block->size);
+   z_stats.inusebytes -= block->size;
+   block->tag = PU_FREE;       // Mark block freed
+
+   // scramble memory -- weed out any bugs
+   SCRAMBLER((byte *)block + header_size, block->size);
+
+   if(block->user)            // Nullify user if one exists
+      *block->user = NULL;
+
+   if((*block->prev = block->next))
+      block->next->prev = block->prev;
+
+   Z_releaseBlock(block, tag);
+}
+
 //
 // Z_Free
 //
 void (Z_Free)(void *p, const char *file, int line)
 {
+   std::lock_guard<std::recursive_mutex> lock(zonemutex);
+
    DEBUG_CHECKHEAP();
 
-   if(p)
+   // mapped memory is never freed, like permanent blocks
+   if(p && !Z_mappedRange(p))
    {
       memblock_t *block = (memblock_t *)((byte *) p - header_size);
 
@@ -401,19 +825,7 @@ void (Z_Free)(void *p, const char *file, int line)
 #endif
                      );
       }
-      INSTRUMENT(memorybytag[block->tag] -= block->size);
-      block->tag = PU_FREE;       // Mark block freed
-
-      // scramble memory -- weed out any bugs
-      SCRAMBLER(p, block->size);
-
-      if(block->user)            // Nullify user if one exists
-         *block->user = NULL;
-
-      if((*block->prev = block->next))
-         block->next->prev = block->prev;
-         
-      free(block);
+      Z_freeBlock(block);
          
       Z_LogPrintf("* Z_Free(p=%p, file=%s:%d)\n", p, file, line);
    }
@@ -428,6 +840,8 @@ void (Z_FreeTags)(int lowtag, int hightag, const char *file, int line)
 
    // haleyjd 03/30/2011: delete ZoneObjects of the same tags as well
    ZoneObject::FreeTags(lowtag, hightag);
+
+   std::lock_guard<std::recursive_mutex> lock(zonemutex);
    
    if(lowtag <= PU_FREE)
       lowtag = PU_FREE+1;
@@ -437,6 +851,9 @@ void (Z_FreeTags)(int lowtag, int hightag, const char *file, int line)
    
    for(; lowtag <= hightag; ++lowtag)
    {
+      zonearena_t &arena = *Z_arenaForTag(lowtag);
+      bool ownarena = (arena.tag == lowtag);
+
       for(block = blockbytag[lowtag], blockbytag[lowtag] = NULL; block;)
       {
          memblock_t *next = block->next;
@@ -445,9 +862,24 @@ void (Z_FreeTags)(int lowtag, int hightag, const char *file, int line)
                    "Z_FreeTags: Changed a tag without ZONEID", 
                    block, file, line);
 
-         (Z_Free)((byte *)block + header_size, file, line);
+         // blocks carved from the tag's own arena go with it below, so only
+         // their users have to be told; the rest are freed one by one
+         if(ownarena && block->chunk && block->chunk->arena == &arena &&
+            !block->chunk->dropped)
+         {
+            INSTRUMENT(memorybytag[lowtag] -= block->size);
+            z_stats.inusebytes -= block->size;
+            if(block->user)
+               *block->user = NULL;
+         }
+         else
+            (Z_Free)((byte *)block + header_size, file, line);
+
          block = next;               // Advance to next block
       }
+
+      if(ownarena)
+         Z_dropArena(arena);
    }
 
    Z_LogPrintf("* Z_FreeTags(lowtag=%d, hightag=%d, file=%s:%d)\n",
@@ -460,6 +892,8 @@ void (Z_FreeTags)(int lowtag, int hightag, const char *file, int line)
 void (Z_ChangeTag)(void *ptr, int tag, const char *file, int line)
 {
    memblock_t *block;
+
+   std::lock_guard<std::recursive_mutex> lock(zonemutex);
    
    DEBUG_CHECKHEAP();
    
@@ -469,6 +903,9 @@ void (Z_ChangeTag)(void *ptr, int tag, const char *file, int line)
                    "Z_ChangeTag: can't change a NULL pointer at %s:%d\n",
                    file, line);
    }
+
+   if(Z_mappedRange(ptr))
+      return;
    
    block = (memblock_t *)((byte *) ptr - header_size);
 
@@ -493,6 +930,7 @@ void (Z_ChangeTag)(void *ptr, int tag, const char *file, int line)
    INSTRUMENT(memorybytag[block->tag] -= block->size);
    INSTRUMENT(memorybytag[tag] += block->size);
 
+   Z_retag(block, block->tag, tag);
    block->tag = tag;
 
    Z_LogPrintf("* Z_ChangeTag(p=%p, tag=%d, file=%s:%d)\n",
@@ -522,8 +960,20 @@ void *(Z_Realloc)(void *ptr, size_t n, int tag, void **user,
       return NULL;
    }
 
+   std::lock_guard<std::recursive_mutex> lock(zonemutex);
+
    DEBUG_CHECKHEAP();
 
+   // mapped memory is copied to a new block, as far as the range goes
+   if(const zonemapped_t *range = Z_mappedRange(ptr))
+   {
+      size_t avail = range->base + range->size - (byte *)ptr;
+
+      p = (Z_Malloc)(n, tag, user, file, line);
+      memcpy(p, ptr, n < avail ? n : avail);
+      return p;
+   }
+
    block = origblock = (memblock_t *)((byte *)ptr - header_size);
 
    Z_IDCheck(IDBOOL(block->id != ZONEID),
@@ -546,8 +996,35 @@ void *(Z_Realloc)(void *ptr, size_t n, int tag, void **user,
    block->prev = NULL;
 
    INSTRUMENT(memorybytag[block->tag] -= block->size);
+   z_stats.inusebytes -= block->size;
+
+   if(block->chunk)
+   {
+      // a carved block stays put while it fits its size class and the arena
+      // of the new tag, and is moved to a new block otherwise
+      if(n <= zoneclasses[block->sizeclass] && !block->chunk->dropped &&
+         block->chunk->arena == Z_arenaForTag(tag))
+      {
+         newblock = block;
+      }
+      else
+      {
+         int oldtag = block->tag;
 
-   if(!(newblock = (memblock_t *)(realloc(block, n + header_size))))
+         // the old block is off the tag lists, so a purge can't take it
+         p = (Z_Malloc)(n, tag, user, file, line);
+         memcpy(p, ptr, n < block->size ? n : block->size);
+
+         IDCHECK(block->id = 0);
+         block->tag = PU_FREE;
+         Z_releaseBlock(block, oldtag);
+
+         Z_LogPrintf("* %p = Z_Realloc(ptr=%p, n=%lu, tag=%d, user=%p, source=%s:%d)\n",
+                     p, ptr, n, tag, user, file, line);
+         return p;
+      }
+   }
+   else if(!(newblock = (memblock_t *)(realloc(block, n + header_size))))
    {
       // haleyjd 07/09/10: Note that unlinking the block above makes this safe 
       // even if the current block is PU_CACHE; Z_FreeTags won't find it.
@@ -572,8 +1049,10 @@ void *(Z_Realloc)(void *ptr, size_t n, int tag, void **user,
       }
    }
 
+   Z_retag(block, block->tag, tag);
    block->size = n;
    block->tag  = tag;
+   Z_countAlloc(n);
 
    p = (byte *)block + header_size;
 
@@ -630,6 +1109,8 @@ void (Z_CheckHeap)(const char *file, int line)
    memblock_t *block;
    int lowtag;
 
+   std::lock_guard<std::recursive_mutex> lock(zonemutex);
+
    for(lowtag = PU_FREE+1; lowtag < PU_MAX; ++lowtag)
    {
       for(block = blockbytag[lowtag]; block; block = block->next)
@@ -658,14 +1139,58 @@ int (Z_CheckTag)(void *ptr, const char *file, int line)
 {
    memblock_t *block = (memblock_t *)((byte *) ptr - header_size);
 
+   std::lock_guard<std::recursive_mutex> lock(zonemutex);
+
    DEBUG_CHECKHEAP();
 
+   if(Z_mappedRange(ptr))
+      return PU_PERMANENT;
+
    Z_IDCheck(IDBOOL(block->id != ZONEID),
              "Z_CheckTag: block doesn't have ZONEID", block, file, line);
    
    return block->tag;
 }
 
+static const char *zonetagnames[PU_MAX] =
+{
+   "PU_FREE", 
+   "PU_STATIC",
+   "PU_PERMANENT",
+   "PU_SOUND",
+   "PU_MUSIC",
+   "PU_RENDERER",
+   "PU_VALLOC",
+   "PU_AUTO",
+   "PU_LEVEL",
+   "PU_CACHE",
+};
+
+//
+// Z_printHeapStats
+//
+// Writes the statistics of the chunks small blocks are carved from.
+//
+static void Z_printHeapStats(FILE *outfile)
+{
+   static const int tags[] = { PU_MAX, PU_LEVEL, PU_RENDERER };
+
+   for(int tag : tags)
+   {
+      zoneheapstats_t stats;
+
+      Z_GetHeapStats(tag, stats);
+      fprintf(outfile,
+              "%-12s: %lu chunks, %lu bytes reserved, %lu carved, %lu free, "
+              "%lu blocks, %lu chunks kept\n",
+              tag == PU_MAX ? "small blocks" : zonetagnames[tag],
+              (unsigned long)stats.numchunks, (unsigned long)stats.reserved,
+              (unsigned long)stats.carved, (unsigned long)stats.freebytes,
+              (unsigned long)stats.numblocks, (unsigned long)stats.kept);
+   }
+   fputc('\n', outfile);
+}
+
 //
 // Z_PrintZoneHeap
 //
@@ -675,6 +1200,8 @@ void Z_PrintZoneHeap(void)
    int lowtag;
    FILE *outfile;
 
+   std::lock_guard<std::recursive_mutex> lock(zonemutex);
+
    const char *fmtstr =
 #if defined(ZONEIDCHECK) && defined(INSTRUMENTED)
       "%p: { %8X : %p : %p : %8u : %p : %d : %s : %d }\n"
@@ -691,6 +1218,8 @@ void Z_PrintZoneHeap(void)
    if(!outfile)
       return;
 
+   Z_printHeapStats(outfile);
+
    for(lowtag = PU_FREE; lowtag < PU_MAX; ++lowtag)
    {
       for(block = blockbytag[lowtag]; block; block = block->next)
@@ -733,26 +1262,14 @@ void Z_PrintZoneHeap(void)
 //
 void Z_DumpCore()
 {
-   static const char *namefortag[PU_MAX] =
-   {
-      "PU_FREE", 
-      "PU_STATIC",
-      "PU_PERMANENT",
-      "PU_SOUND",
-      "PU_MUSIC",
-      "PU_RENDERER",
-      "PU_VALLOC",
-      "PU_AUTO",
-      "PU_LEVEL",
-      "PU_CACHE",
-   };
-
    int tag;
    memblock_t *block;
    uint32_t dirofs = 12;
    uint32_t dirlen;
    uint32_t numentries = 0;
 
+   std::lock_guard<std::recursive_mutex> lock(zonemutex);
+
    for(tag = PU_FREE+1; tag < PU_MAX; tag++)
    {
       for(block = blockbytag[tag]; block; block = block->next)
@@ -779,7 +1296,7 @@ void Z_DumpCore()
 
          memset(name, 0, sizeof(name));
          sprintf(name, "/%s/%p", 
-                 block->tag < PU_MAX ? namefortag[block->tag] : "UNKNOWN",
+                 block->tag < PU_MAX ? zonetagnames[block->tag] : "UNKNOWN",
                  block);
          fwrite(name,     sizeof(name),    1, f);
          fwrite(&filepos, sizeof(filepos), 1, f);
@@ -893,6 +1410,7 @@ void Z_SysFree(void *p)
 //
 void Z_FreeAlloca(void)
 {
+   std::lock_guard<std::recursive_mutex> lock(zonemutex);
    memblock_t *block = blockbytag[PU_AUTO];
 
    if(!block)
@@ -1189,6 +1707,99 @@ size_t ZoneObject::getZoneSize() const
    return retsize;
 }
 
+//
+// ZoneSlabPool
+//
+// Each object is preceded by a pointer to the zone block of its slab, which is
+// what the ZoneObject constructor records as the object's allocation.
+//
+
+#define SLABHEADER 16 // keeps the objects 16-char aligned
+
+//
+// ZoneSlabPool Constructor
+//
+ZoneSlabPool::ZoneSlabPool(size_t pObjSize, int pPerSlab, int pTag)
+   : objsize((pObjSize + 15) & ~static_cast<size_t>(15)), perslab(pPerSlab),
+     tag(pTag), freelist(NULL), slab(NULL), next(NULL), end(NULL), numslabs(0)
+{
+}
+
+//
+// ZoneSlabPool::alloc
+//
+// Returns zeroed memory for one object, to be returned from a class's
+// operator new. The ZoneObject constructor then puts the object on the tag
+// list of the pool's blocks.
+//
+void *ZoneSlabPool::alloc()
+{
+   void *p = allocPlain();
+
+   ZoneObject::newalloc = *reinterpret_cast<char **>(static_cast<char *>(p) -
+                                                     SLABHEADER);
+   return p;
+}
+
+//
+// ZoneSlabPool::allocPlain
+//
+// Returns zeroed memory for something that is not a ZoneObject. It goes with
+// the pool's blocks, when they are freed.
+//
+void *ZoneSlabPool::allocPlain()
+{
+   char *p;
+
+   if(freelist)
+   {
+      p = static_cast<char *>(freelist);
+      freelist = *static_cast<void **>(freelist);
+   }
+   else
+   {
+      if(next == end)
+      {
+         size_t slotsize = SLABHEADER + objsize;
+
+         slab = static_cast<char *>(Z_Malloc(slotsize * perslab, tag, NULL));
+         next = slab;
+         end  = slab + slotsize * perslab;
+         ++numslabs;
+      }
+      *reinterpret_cast<char **>(next) = slab;
+      p = next + SLABHEADER;
+      next += SLABHEADER + objsize;
+   }
+
+   memset(p, 0, objsize);
+
+   return p;
+}
+
+//
+// ZoneSlabPool::free
+//
+// Takes back an object, from a class's operator delete.
+//
+void ZoneSlabPool::free(void *p)
+{
+   *static_cast<void **>(p) = freelist;
+   freelist = p;
+}
+
+//
+// ZoneSlabPool::clear
+//
+// Forgets all blocks. Call after they have been freed by Z_FreeTags.
+//
+void ZoneSlabPool::clear()
+{
+   freelist = NULL;
+   slab = next = end = NULL;
+   numslabs = 0;
+}
+
 //-----------------------------------------------------------------------------
 //
 // $Log: z_zone.c,v $
@@ -182,6 +182,35 @@ extern size_t memorybytag[PU_MAX]; // haleyjd  04/01/11
 extern int printstats;             // killough 08/23/98
 #endif
 
+// Allocation statistics, kept in every build for the benchmark
+struct zonestats_t
+{
+   size_t numallocs;   // blocks allocated or reallocated
+   size_t allocbytes;  // bytes given to those blocks
+   size_t inusebytes;  // bytes allocated right now
+   size_t peakbytes;   // most bytes allocated at once
+};
+
+extern zonestats_t z_stats;
+
+// Statistics of the chunks the small blocks of a tag are carved from
+struct zoneheapstats_t
+{
+   size_t numchunks;   // chunks held
+   size_t reserved;    // bytes in them
+   size_t carved;      // bytes carved from them, block headers included
+   size_t freebytes;   // bytes of carved blocks waiting to be reused
+   size_t numblocks;   // carved blocks in use
+   size_t kept;        // chunks of a dropped arena kept for re-tagged blocks
+};
+
+bool Z_GetHeapStats(int tag, zoneheapstats_t &stats);
+
+// Memory outside the heap, such as a mapped file, whose pointers may be handed
+// out in place of blocks. The zone functions treat them as PU_PERMANENT.
+bool Z_AddMappedRange(const void *base, size_t size);
+void Z_RemoveMappedRange(const void *base);
+
 void Z_PrintZoneHeap();
 
 void Z_DumpCore();
@@ -197,7 +226,7 @@ class ZoneObject
 private:
    // static data
    static ZoneObject *objectbytag[PU_MAX];
-   static void *newalloc;
+   static thread_local void *newalloc;
 
    // instance data
    void        *zonealloc; // If non-null, the object is living on the zone heap
@@ -207,6 +236,8 @@ private:
    void removeFromTagList();
    void addToTagList(int tag);
 
+   friend class ZoneSlabPool;
+
 public:
    ZoneObject();
    virtual ~ZoneObject();
@@ -224,6 +255,40 @@ public:
    static void FreeTags(int lowtag, int hightag);
 };
 
+//
+// ZoneSlabPool
+//
+// Hands out ZoneObjects of one size packed together in large zone blocks, and
+// keeps freed ones on a free list for reuse. Objects never move, and are put
+// on the tag lists like any other ZoneObject, so Z_FreeTags destroys them as
+// usual; after that the pool must be cleared, since its blocks went with them.
+// Pooled objects report their block as the whole slab, and so must not change
+// tag. Plain structures can be pooled too, with allocPlain.
+//
+class ZoneSlabPool
+{
+protected:
+   size_t objsize;   // size of each object, rounded up for alignment
+   int    perslab;   // objects per zone block
+   int    tag;       // tag of the zone blocks
+   void  *freelist;  // freed objects, linked through their first word
+   char  *slab;      // zone block objects are being carved from
+   char  *next;      // next unused object in it
+   char  *end;
+   int    numslabs;  // zone blocks allocated since the last clear
+
+public:
+   ZoneSlabPool(size_t pObjSize, int pPerSlab, int pTag);
+
+   void *alloc();
+   void *allocPlain();
+   void  free(void *p);
+   void  clear();
+
+   size_t getObjSize()  const { return objsize;  }
+   int    getNumSlabs() const { return numslabs; }
+};
+
 #endif
 
 //----------------------------------------------------------------------------